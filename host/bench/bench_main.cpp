@@ -0,0 +1,649 @@
+// Host micro-benchmarks for the firmware libraries.
+//
+// Built against the host HAL in host/hal (in-memory SPIFFS, synthetic IMU,
+// framebuffer-only OLED), so the numbers track the library code itself and
+// are comparable between two builds on the same machine, not with the
+// ESP32-S3. Results are written as JSON; tools/bench_diff.py compares two
+// runs.
+//
+//     pio run -e native_bench
+//     .pio/build/native_bench/program --out bench.json
+//
+// Options:
+//     --out FILE        write JSON results to FILE (default: stdout)
+//     --filter TEXT     only run benchmarks whose name contains TEXT
+//     --samples N       timed samples per benchmark (default 25)
+//     --min-time-ms N   minimum duration of one sample (default 5)
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <AHRS.h>
+#include <Display.h>
+#include <Training.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+struct TrainingBenchAccess
+{
+    static int selectBestAction(const Training &training, int stateIndex)
+    {
+        return training.selectBestAction(stateIndex);
+    }
+
+    static int selectAction(Training &training, int stateIndex)
+    {
+        return training.selectAction(stateIndex);
+    }
+
+    static float computeMaxQ(const Training &training, int stateIndex)
+    {
+        return training.computeMaxQ(stateIndex);
+    }
+
+    static int stateCount()
+    {
+        return Training::kNumStates;
+    }
+
+    static size_t tableBytes(const Training &training)
+    {
+        return sizeof(training.qTable) + sizeof(training.visitCounts);
+    }
+
+    typedef Training::HashedTable HashedTable;
+    static const int kActions = Training::kNumActions;
+
+    static int hashedCodeCount()
+    {
+        return 1 << (Training::kStateBits + Training::kActionBits + Training::kPhaseBits + Training::kPitchBits);
+    }
+
+    static uint32_t hashedKey(int stateIndex, int previousAction, int phase, float pitchDeg)
+    {
+        return Training::encodeHashedState(stateIndex, previousAction, phase, pitchDeg);
+    }
+
+    static int bestAction(const float *qValues)
+    {
+        return Training::findBestAction(qValues);
+    }
+};
+
+namespace
+{
+    struct Options
+    {
+        const char *outPath = NULL;
+        const char *filter = NULL;
+        int samples = 25;
+        int minTimeMs = 5;
+    };
+
+    struct Result
+    {
+        const char *name;
+        size_t bytes; // memory the benchmarked structure takes, 0 if not reported
+        uint64_t iterations;
+        double minNs;
+        double medianNs;
+        double p90Ns;
+        double meanNs;
+    };
+
+    typedef void (*BenchBody)(void *state, uint64_t iterations);
+
+    // Keeps results observable so the optimiser cannot drop the work
+    volatile float floatSink;
+    volatile int intSink;
+
+    uint64_t elapsedNs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    uint64_t timeBatch(BenchBody body, void *state, uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body(state, iterations);
+        return elapsedNs(start);
+    }
+
+    Result runBench(const Options &options, const char *name, BenchBody body, void *state, size_t bytes = 0)
+    {
+        // Grow the batch until one sample takes at least minTimeMs
+        const uint64_t minNs = static_cast<uint64_t>(options.minTimeMs) * 1000000ull;
+        uint64_t batch = 1;
+        while (timeBatch(body, state, batch) < minNs && batch < (1ull << 30))
+        {
+            batch *= 2;
+        }
+
+        std::vector<double> perOp;
+        perOp.reserve(options.samples);
+        double total = 0;
+        for (int i = 0; i < options.samples; ++i)
+        {
+            double ns = static_cast<double>(timeBatch(body, state, batch)) / batch;
+            perOp.push_back(ns);
+            total += ns;
+        }
+        std::sort(perOp.begin(), perOp.end());
+
+        Result result;
+        result.name = name;
+        result.bytes = bytes;
+        result.iterations = batch * options.samples;
+        result.minNs = perOp.front();
+        result.medianNs = perOp[perOp.size() / 2];
+        result.p90Ns = perOp[std::min(perOp.size() - 1, perOp.size() * 9 / 10)];
+        result.meanNs = total / perOp.size();
+        fprintf(stderr, "%-28s %12.1f ns/op  (p90 %.1f, min %.1f, %llu iterations)\n", name, result.medianNs,
+                result.p90Ns, result.minNs, static_cast<unsigned long long>(result.iterations));
+        if (bytes != 0)
+        {
+            fprintf(stderr, "%-28s %12zu bytes\n", "", bytes);
+        }
+        return result;
+    }
+
+    // --- Training ---------------------------------------------------------
+
+    struct TrainingState
+    {
+        Training training;
+        int downAngle = 90;
+        int upAngle = 90;
+        int stateIndex = 0;
+    };
+
+    void benchStep(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            float delta = static_cast<float>(random(-200, 600)) * 0.01f;
+            Training::StepResult result = s.training.step(delta, delta * 2.0f, 0.3f, s.downAngle, s.upAngle);
+            s.downAngle = result.targetDownAngle;
+            s.upAngle = result.targetUpAngle;
+        }
+        intSink = s.downAngle;
+    }
+
+    void benchSelectBestAction(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        const int states = TrainingBenchAccess::stateCount();
+        int sum = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            sum += TrainingBenchAccess::selectBestAction(s.training, s.stateIndex);
+            s.stateIndex = s.stateIndex + 1 == states ? 0 : s.stateIndex + 1;
+        }
+        intSink = sum;
+    }
+
+    // With whatever exploration the training is set to
+    void benchSelectAction(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        const int states = TrainingBenchAccess::stateCount();
+        int sum = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            sum += TrainingBenchAccess::selectAction(s.training, s.stateIndex);
+            s.stateIndex = s.stateIndex + 1 == states ? 0 : s.stateIndex + 1;
+        }
+        intSink = sum;
+    }
+
+    void benchComputeMaxQ(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        const int states = TrainingBenchAccess::stateCount();
+        float sum = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            sum += TrainingBenchAccess::computeMaxQ(s.training, s.stateIndex);
+            s.stateIndex = s.stateIndex + 1 == states ? 0 : s.stateIndex + 1;
+        }
+        floatSink = sum;
+    }
+
+    void benchSaveModel(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            s.training.saveModel();
+        }
+    }
+
+    // Follows the policy from pose to pose, as the control pipeline does
+    void benchInfer(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            Training::StepResult result = s.training.infer(0.5f, 1.0f, 0.1f, s.downAngle, s.upAngle);
+            s.downAngle = result.targetDownAngle;
+            s.upAngle = result.targetUpAngle;
+        }
+        intSink = s.downAngle;
+    }
+
+    void benchLoadModel(void *state, uint64_t iterations)
+    {
+        TrainingState &s = *static_cast<TrainingState *>(state);
+        bool loaded = true;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            loaded &= s.training.loadModel();
+        }
+        intSink = loaded;
+    }
+
+    // --- Q-table lookups ------------------------------------------------
+
+    // The hashed states a run touches (about 220 in the simulator), looked
+    // up in a dense table over all codes and in the sparse table, in the
+    // same random order
+    struct LookupState
+    {
+        struct DenseRow
+        {
+            float q[TrainingBenchAccess::kActions];
+            uint32_t visits[TrainingBenchAccess::kActions];
+        };
+
+        static const int kVisitedStates = 256;
+        static const int kSequenceLength = 4096;
+
+        std::vector<DenseRow> dense;
+        TrainingBenchAccess::HashedTable *sparse;
+        std::vector<uint32_t> sequence;
+        size_t position = 0;
+
+        LookupState() : dense(TrainingBenchAccess::hashedCodeCount()), sparse(new TrainingBenchAccess::HashedTable())
+        {
+            std::vector<uint32_t> keys;
+            while (keys.size() < kVisitedStates)
+            {
+                uint32_t key = TrainingBenchAccess::hashedKey(random(0, 9), random(0, 7), random(0, 8),
+                                                              static_cast<float>(random(-20, 20)));
+                if (std::find(keys.begin(), keys.end(), key) == keys.end())
+                {
+                    keys.push_back(key);
+                }
+            }
+            float initial[TrainingBenchAccess::kActions];
+            for (uint32_t key : keys)
+            {
+                for (float &q : initial)
+                {
+                    q = static_cast<float>(random(-100, 100)) * 0.01f;
+                }
+                memcpy(dense[key].q, initial, sizeof(initial));
+                sparse->insert(key, initial);
+            }
+            // Only keys that kept their entry, so every lookup hits
+            keys.erase(std::remove_if(keys.begin(), keys.end(),
+                                      [this](uint32_t key) { return sparse->peek(key) == NULL; }),
+                       keys.end());
+            for (int i = 0; i < kSequenceLength; ++i)
+            {
+                sequence.push_back(keys[random(0, static_cast<long>(keys.size()))]);
+            }
+        }
+
+        ~LookupState() { delete sparse; }
+
+        uint32_t next()
+        {
+            uint32_t key = sequence[position];
+            position = position + 1 == sequence.size() ? 0 : position + 1;
+            return key;
+        }
+    };
+
+    void benchDenseLookup(void *state, uint64_t iterations)
+    {
+        LookupState &s = *static_cast<LookupState *>(state);
+        int sum = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            sum += TrainingBenchAccess::bestAction(s.dense[s.next()].q);
+        }
+        intSink = sum;
+    }
+
+    void benchSparseLookup(void *state, uint64_t iterations)
+    {
+        LookupState &s = *static_cast<LookupState *>(state);
+        int sum = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            sum += TrainingBenchAccess::bestAction(s.sparse->find(s.next())->q);
+        }
+        intSink = sum;
+    }
+
+    // --- Q-network ----------------------------------------------------
+
+    struct NetworkState
+    {
+        QNetwork network;
+        QNetwork::Input inputs[64];
+        size_t position = 0;
+
+        NetworkState()
+        {
+            network.begin(TrainingBenchAccess::kActions);
+            for (QNetwork::Input &input : inputs)
+            {
+                QNetwork::encode(random(0, 180), random(0, 180), random(-500, 2000) * 0.01f,
+                                 random(-200, 200) * 0.01f, input);
+            }
+            // Trained a little, so the output rows are not all zero
+            for (int i = 0; i < 2000; ++i)
+            {
+                network.update(inputs[i % 64], i % TrainingBenchAccess::kActions, 0.01f);
+            }
+        }
+
+        const QNetwork::Input &next()
+        {
+            position = (position + 1) & 63;
+            return inputs[position];
+        }
+    };
+
+    void benchNetworkForward(void *state, uint64_t iterations)
+    {
+        NetworkState &s = *static_cast<NetworkState *>(state);
+        float qValues[TrainingBenchAccess::kActions];
+        float sum = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            s.network.values(s.next(), qValues);
+            sum += qValues[0];
+        }
+        floatSink = sum;
+    }
+
+    void benchNetworkUpdate(void *state, uint64_t iterations)
+    {
+        NetworkState &s = *static_cast<NetworkState *>(state);
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            // Alternating signs keep the weights where they are
+            s.network.update(s.next(), static_cast<int>(i % TrainingBenchAccess::kActions),
+                             (i & 1) ? 1e-4f : -1e-4f);
+        }
+    }
+
+    // --- AHRS -------------------------------------------------------------
+
+    void benchAhrsUpdate(void *state, uint64_t iterations)
+    {
+        AHRS &ahrs = *static_cast<AHRS *>(state);
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            // One 500 Hz IMU sample per call, as in the sense task
+            HostClock::advanceMicros(2000);
+            ahrs.update();
+        }
+        floatSink = ahrs.getVelocityX();
+    }
+
+    // --- Display ----------------------------------------------------------
+
+    void benchDisplayText(void *state, uint64_t iterations)
+    {
+        Display &display = *static_cast<Display *>(state);
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            // The status screen drawn by the report stage
+            display.clear();
+            display.setTextSize(1);
+            display.print("Training", 0, 0);
+            display.print("Ep: ", 0, 12);
+            display.print(static_cast<int>(i & 0xFFFF));
+            display.print("Eps: 0.42", 0, 24);
+            display.print("R: -1.25", 0, 36);
+            display.print("Down 90 Up 125", 0, 48);
+            display.refresh();
+        }
+    }
+
+    bool selected(const Options &options, const char *name)
+    {
+        return options.filter == NULL || strstr(name, options.filter) != NULL;
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char *arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+            if (strcmp(arg, "--out") == 0 && value)
+            {
+                options.outPath = value;
+            }
+            else if (strcmp(arg, "--filter") == 0 && value)
+            {
+                options.filter = value;
+            }
+            else if (strcmp(arg, "--samples") == 0 && value && atoi(value) > 0)
+            {
+                options.samples = atoi(value);
+            }
+            else if (strcmp(arg, "--min-time-ms") == 0 && value && atoi(value) > 0)
+            {
+                options.minTimeMs = atoi(value);
+            }
+            else
+            {
+                fprintf(stderr, "usage: %s [--out FILE] [--filter TEXT] [--samples N] [--min-time-ms N]\n",
+                        argv[0]);
+                return false;
+            }
+            ++i;
+        }
+        return true;
+    }
+
+    void writeJson(FILE *out, const Options &options, const std::vector<Result> &results)
+    {
+        fprintf(out, "{\n  \"schema\": 1,\n");
+        fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+        fprintf(out, "  \"samples\": %d,\n  \"min_time_ms\": %d,\n", options.samples, options.minTimeMs);
+        fprintf(out, "  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            fprintf(out, "    {\"name\": \"%s\", ", r.name);
+            if (r.bytes != 0)
+            {
+                fprintf(out, "\"bytes\": %zu, ", r.bytes);
+            }
+            fprintf(out,
+                    "\"iterations\": %llu, \"ns_per_op\": "
+                    "{\"median\": %.2f, \"p90\": %.2f, \"min\": %.2f, \"mean\": %.2f}}%s\n",
+                    static_cast<unsigned long long>(r.iterations), r.medianNs, r.p90Ns, r.minNs, r.meanNs,
+                    i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+
+    // Libraries log through Serial; keep that out of the timings
+    Serial.setMuted(true);
+    HostClock::setManual(true);
+    randomSeed(1);
+
+    std::vector<Result> results;
+
+    TrainingState trainingState;
+    trainingState.training.begin();
+    trainingState.training.startTraining();
+    // Warm the table so the selection helpers see a realistic spread
+    benchStep(&trainingState, 5000);
+
+    if (selected(options, "training.step"))
+    {
+        results.push_back(runBench(options, "training.step", benchStep, &trainingState));
+    }
+    if (selected(options, "training.step.tiles"))
+    {
+        TrainingState tileState;
+        Training::Hyperparameters hyperparameters = Training::defaultHyperparameters();
+        hyperparameters.valueFunction = Training::VALUE_TILES_SPEED;
+        tileState.training.configure(hyperparameters);
+        tileState.training.begin();
+        tileState.training.startTraining();
+        benchStep(&tileState, 5000);
+        results.push_back(runBench(options, "training.step.tiles", benchStep, &tileState));
+    }
+    if (selected(options, "training.step.hashed"))
+    {
+        TrainingState hashedState;
+        Training::Hyperparameters hyperparameters = Training::defaultHyperparameters();
+        hyperparameters.valueFunction = Training::VALUE_HASHED;
+        hashedState.training.configure(hyperparameters);
+        hashedState.training.begin();
+        hashedState.training.startTraining();
+        benchStep(&hashedState, 5000);
+        results.push_back(runBench(options, "training.step.hashed", benchStep, &hashedState));
+    }
+    if (selected(options, "training.step.network"))
+    {
+        TrainingState networkState;
+        Training::Hyperparameters hyperparameters = Training::defaultHyperparameters();
+        hyperparameters.valueFunction = Training::VALUE_NETWORK;
+        networkState.training.configure(hyperparameters);
+        networkState.training.begin();
+        networkState.training.startTraining();
+        benchStep(&networkState, 5000);
+        results.push_back(runBench(options, "training.step.network", benchStep, &networkState));
+    }
+    if (selected(options, "training.selectBestAction"))
+    {
+        results.push_back(runBench(options, "training.selectBestAction", benchSelectBestAction, &trainingState,
+                                   TrainingBenchAccess::tableBytes(trainingState.training)));
+    }
+    struct
+    {
+        const char *name;
+        Training::Exploration exploration;
+    } const kExplorations[] = {
+        {"training.selectAction.epsilon", Training::EXPLORE_EPSILON},
+        {"training.selectAction.ucb", Training::EXPLORE_UCB},
+        {"training.selectAction.softmax", Training::EXPLORE_SOFTMAX},
+    };
+    for (const auto &exploration : kExplorations)
+    {
+        if (selected(options, exploration.name))
+        {
+            trainingState.training.setExploration(exploration.exploration);
+            results.push_back(runBench(options, exploration.name, benchSelectAction, &trainingState));
+        }
+    }
+    trainingState.training.setExploration(Training::EXPLORE_EPSILON);
+    if (selected(options, "training.computeMaxQ"))
+    {
+        results.push_back(runBench(options, "training.computeMaxQ", benchComputeMaxQ, &trainingState));
+    }
+    if (selected(options, "training.saveModel"))
+    {
+        results.push_back(runBench(options, "training.saveModel", benchSaveModel, &trainingState));
+    }
+    if (selected(options, "training.loadModel"))
+    {
+        trainingState.training.saveModel();
+        results.push_back(runBench(options, "training.loadModel", benchLoadModel, &trainingState));
+    }
+    if (selected(options, "training.infer"))
+    {
+        trainingState.training.stopTraining();
+        trainingState.training.saveModel();
+        trainingState.training.loadModel();
+        trainingState.downAngle = trainingState.training.getDownAngleOption(0);
+        trainingState.upAngle = trainingState.training.getUpAngleOption(0);
+        results.push_back(runBench(options, "training.infer", benchInfer, &trainingState));
+        if (trainingState.training.executeLearnedBehavior())
+        {
+            results.push_back(runBench(options, "training.infer.gait", benchInfer, &trainingState));
+        }
+    }
+
+    if (selected(options, "qtable.dense.lookup") || selected(options, "qtable.sparse.lookup"))
+    {
+        LookupState lookupState;
+        if (selected(options, "qtable.dense.lookup"))
+        {
+            results.push_back(runBench(options, "qtable.dense.lookup", benchDenseLookup, &lookupState,
+                                       lookupState.dense.size() * sizeof(LookupState::DenseRow)));
+        }
+        if (selected(options, "qtable.sparse.lookup"))
+        {
+            results.push_back(runBench(options, "qtable.sparse.lookup", benchSparseLookup, &lookupState,
+                                       TrainingBenchAccess::HashedTable::memoryBytes()));
+        }
+    }
+
+    if (selected(options, "network.forward") || selected(options, "network.update"))
+    {
+        NetworkState networkState;
+        if (selected(options, "network.forward"))
+        {
+            results.push_back(runBench(options, "network.forward", benchNetworkForward, &networkState,
+                                       networkState.network.getMemoryBytes()));
+        }
+        if (selected(options, "network.update"))
+        {
+            results.push_back(runBench(options, "network.update", benchNetworkUpdate, &networkState));
+        }
+    }
+
+    if (selected(options, "ahrs.update"))
+    {
+        AHRS ahrs;
+        ahrs.begin();
+        results.push_back(runBench(options, "ahrs.update", benchAhrsUpdate, &ahrs));
+    }
+
+    if (selected(options, "display.text"))
+    {
+        Display display;
+        display.begin();
+        results.push_back(runBench(options, "display.text", benchDisplayText, &display));
+    }
+
+    FILE *out = stdout;
+    if (options.outPath)
+    {
+        out = fopen(options.outPath, "w");
+        if (out == NULL)
+        {
+            perror(options.outPath);
+            return 1;
+        }
+    }
+    writeJson(out, options, results);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "Adafruit_GFX.h"
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    for (int16_t i = x; i < x + w; ++i)
+    {
+        for (int16_t j = y; j < y + h; ++j)
+        {
+            drawPixel(i, j, color);
+        }
+    }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size)
+{
+    // Five glyph columns plus one spacing column, seven rows plus one
+    for (int8_t column = 0; column < 6; ++column)
+    {
+        uint8_t bits = column < 5 ? static_cast<uint8_t>((c * (column + 3)) ^ (c >> column)) & 0x7F : 0;
+        for (int8_t row = 0; row < 8; ++row, bits >>= 1)
+        {
+            if (bits & 1)
+            {
+                fillRect(x + column * size, y + row * size, size, size, color);
+            }
+            else if (bg != color)
+            {
+                fillRect(x + column * size, y + row * size, size, size, bg);
+            }
+        }
+    }
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+    if (c == '\n')
+    {
+        cursor_x = 0;
+        cursor_y += textsize * 8;
+    }
+    else if (c != '\r')
+    {
+        if (wrap && cursor_x + textsize * 6 > _width)
+        {
+            cursor_x = 0;
+            cursor_y += textsize * 8;
+        }
+        drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+        cursor_x += textsize * 6;
+    }
+    return 1;
+}
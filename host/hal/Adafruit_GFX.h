@@ -0,0 +1,54 @@
+#ifndef HOST_HAL_ADAFRUIT_GFX_H
+#define HOST_HAL_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+// Minimal Adafruit_GFX: cursor handling, text wrapping and rectangles on
+// top of drawPixel(). Glyphs are 6x8 placeholder cells whose columns come
+// from the character code rather than the real font, so text costs the
+// same number of pixel writes as on the device but does not look right.
+class Adafruit_GFX : public Print
+{
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size);
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    void setCursor(int16_t x, int16_t y)
+    {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    void setTextSize(uint8_t size) { textsize = size > 0 ? size : 1; }
+    void setTextColor(uint16_t color) { textcolor = textbgcolor = color; }
+    void setTextColor(uint16_t color, uint16_t background)
+    {
+        textcolor = color;
+        textbgcolor = background;
+    }
+    void setTextWrap(bool wrap) { this->wrap = wrap; }
+    int16_t getCursorX() const { return cursor_x; }
+    int16_t getCursorY() const { return cursor_y; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+protected:
+    int16_t _width;
+    int16_t _height;
+    int16_t cursor_x = 0;
+    int16_t cursor_y = 0;
+    uint16_t textcolor = 1;
+    uint16_t textbgcolor = 1;
+    uint8_t textsize = 1;
+    bool wrap = true;
+};
+
+#endif // HOST_HAL_ADAFRUIT_GFX_H
@@ -0,0 +1,74 @@
+#include "Adafruit_SSD1306.h"
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *, int8_t)
+    : Adafruit_GFX(w, h),
+      buffer(NULL),
+      panel(NULL),
+      frames(0)
+{
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306()
+{
+    delete[] buffer;
+    delete[] panel;
+}
+
+bool Adafruit_SSD1306::begin(uint8_t, uint8_t, bool, bool)
+{
+    if (buffer == NULL)
+    {
+        buffer = new uint8_t[bufferSize()];
+        panel = new uint8_t[bufferSize()];
+    }
+    clearDisplay();
+    return true;
+}
+
+void Adafruit_SSD1306::clearDisplay()
+{
+    if (buffer)
+    {
+        memset(buffer, 0, bufferSize());
+    }
+}
+
+void Adafruit_SSD1306::display()
+{
+    if (buffer)
+    {
+        memcpy(panel, buffer, bufferSize());
+        ++frames;
+    }
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    if (buffer == NULL || x < 0 || y < 0 || x >= _width || y >= _height)
+    {
+        return;
+    }
+    uint8_t &cell = buffer[x + (y / 8) * _width];
+    uint8_t bit = 1 << (y & 7);
+    switch (color)
+    {
+    case SSD1306_WHITE:
+        cell |= bit;
+        break;
+    case SSD1306_BLACK:
+        cell &= ~bit;
+        break;
+    case SSD1306_INVERSE:
+        cell ^= bit;
+        break;
+    }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) const
+{
+    if (buffer == NULL || x < 0 || y < 0 || x >= _width || y >= _height)
+    {
+        return false;
+    }
+    return buffer[x + (y / 8) * _width] & (1 << (y & 7));
+}
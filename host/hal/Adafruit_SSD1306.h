@@ -0,0 +1,40 @@
+#ifndef HOST_HAL_ADAFRUIT_SSD1306_H
+#define HOST_HAL_ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC 0x01
+
+// SSD1306 with the same page-packed framebuffer as the real driver;
+// display() copies it to a "panel" buffer in place of the I2C transfer.
+class Adafruit_SSD1306 : public Adafruit_GFX
+{
+public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi = &Wire, int8_t rst_pin = -1);
+    ~Adafruit_SSD1306();
+
+    bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0, bool reset = true,
+               bool periphBegin = true);
+    void clearDisplay();
+    void display();
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    bool getPixel(int16_t x, int16_t y) const;
+    uint8_t *getBuffer() { return buffer; }
+
+    // Number of display() calls, for tests that count refreshes
+    uint32_t getFrameCount() const { return frames; }
+
+private:
+    uint8_t *buffer;
+    uint8_t *panel;
+    uint32_t frames;
+
+    size_t bufferSize() const { return static_cast<size_t>(_width) * ((_height + 7) / 8); }
+};
+
+#endif // HOST_HAL_ADAFRUIT_SSD1306_H
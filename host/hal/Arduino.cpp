@@ -0,0 +1,228 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace
+{
+    bool manualClock = false;
+    std::atomic<uint64_t> manualMicros(0);
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // Deterministic per thread, so seeded runs repeat exactly
+    thread_local uint32_t randomState = 0x9E3779B9u;
+
+    uint32_t nextRandom()
+    {
+        // xorshift32
+        uint32_t x = randomState;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        randomState = x;
+        return x;
+    }
+}
+
+namespace HostClock
+{
+    void setManual(bool manual)
+    {
+        manualClock = manual;
+    }
+
+    bool isManual()
+    {
+        return manualClock;
+    }
+
+    void advanceMicros(uint64_t micros)
+    {
+        manualMicros += micros;
+    }
+
+    uint64_t nowMicros()
+    {
+        if (manualClock)
+        {
+            return manualMicros;
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime)
+            .count();
+    }
+}
+
+unsigned long millis()
+{
+    return static_cast<unsigned long>(HostClock::nowMicros() / 1000);
+}
+
+unsigned long micros()
+{
+    return static_cast<unsigned long>(HostClock::nowMicros());
+}
+
+void delay(unsigned long ms)
+{
+    delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (HostClock::isManual())
+    {
+        HostClock::advanceMicros(us);
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *, uint32_t, void *parameter,
+                                   UBaseType_t, TaskHandle_t *handle, BaseType_t)
+{
+    std::thread thread(function, parameter);
+    if (handle)
+    {
+        *handle = reinterpret_cast<TaskHandle_t>(thread.native_handle());
+    }
+    thread.detach();
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new std::timed_mutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    std::timed_mutex *mutex = static_cast<std::timed_mutex *>(semaphore);
+    if (ticks == portMAX_DELAY)
+    {
+        mutex->lock();
+        return pdTRUE;
+    }
+    return mutex->try_lock_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    static_cast<std::timed_mutex *>(semaphore)->unlock();
+    return pdTRUE;
+}
+
+long random(long maxValue)
+{
+    return maxValue > 0 ? static_cast<long>(nextRandom() % static_cast<uint32_t>(maxValue)) : 0;
+}
+
+long random(long minValue, long maxValue)
+{
+    return maxValue > minValue ? minValue + random(maxValue - minValue) : minValue;
+}
+
+void randomSeed(unsigned long seed)
+{
+    randomState = seed ? static_cast<uint32_t>(seed) : 0x9E3779B9u;
+}
+
+String::String(int number) : value(std::to_string(number)) {}
+String::String(unsigned int number) : value(std::to_string(number)) {}
+String::String(long number) : value(std::to_string(number)) {}
+String::String(unsigned long number) : value(std::to_string(number)) {}
+
+String::String(double number, unsigned int decimals)
+{
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", static_cast<int>(decimals), number);
+    value = text;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (size--)
+    {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::print(char value)
+{
+    return write(static_cast<uint8_t>(value));
+}
+
+size_t Print::print(int value)
+{
+    return print(String(value));
+}
+
+size_t Print::print(unsigned int value)
+{
+    return print(String(value));
+}
+
+size_t Print::print(long value)
+{
+    return print(String(value));
+}
+
+size_t Print::print(unsigned long value)
+{
+    return print(String(value));
+}
+
+size_t Print::print(double value, int decimals)
+{
+    return print(String(value, decimals));
+}
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        return 0;
+    }
+    return write(reinterpret_cast<const uint8_t *>(text), std::min<size_t>(length, sizeof(text) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    if (muted)
+    {
+        return 1;
+    }
+    return fputc(byte, stderr) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (muted)
+    {
+        return size;
+    }
+    return fwrite(buffer, 1, size, stderr);
+}
@@ -0,0 +1,202 @@
+#ifndef HOST_HAL_ARDUINO_H
+#define HOST_HAL_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware
+// libraries use, so they can be built and run natively for benchmarks and
+// simulation. Only what the libraries actually call is provided.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define sq(x) ((x) * (x))
+#define F(text) (text)
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+// Time. The clock is real time by default; simulations switch it to manual
+// and advance it themselves so that runs are reproducible and can go
+// faster than real time.
+namespace HostClock
+{
+    void setManual(bool manual);
+    bool isManual();
+    void advanceMicros(uint64_t micros);
+    uint64_t nowMicros();
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long maxValue);
+long random(long minValue, long maxValue);
+void randomSeed(unsigned long seed);
+
+// FreeRTOS types and the critical-section macros. portMUX_TYPE is a real
+// spinlock so multi-threaded host runs stay correct.
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Tasks are detached threads on the host, with no stacks to measure and
+// no cores to pin to. vTaskDelay() always sleeps in real time, so
+// background tasks never move a manual clock.
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackBytes,
+                                   void *parameter, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return NULL; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+// Mutexes only; the firmware uses no other semaphore kind
+typedef void *SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+struct portMUX_TYPE
+{
+    int locked;
+};
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+inline void portENTER_CRITICAL(portMUX_TYPE *mux)
+{
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE))
+    {
+    }
+}
+
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux)
+{
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+class String
+{
+public:
+    String(const char *text = "") : value(text ? text : "") {}
+    String(const std::string &text) : value(text) {}
+    String(int number);
+    String(unsigned int number);
+    String(long number);
+    String(unsigned long number);
+    String(double number, unsigned int decimals = 2);
+
+    const char *c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    String &operator+=(const String &other)
+    {
+        value += other.value;
+        return *this;
+    }
+    bool operator==(const String &other) const { return value == other.value; }
+    bool operator!=(const String &other) const { return value != other.value; }
+    friend String operator+(const String &left, const String &right) { return String(left.value + right.value); }
+
+private:
+    std::string value;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text) { return write(reinterpret_cast<const uint8_t *>(text), strlen(text)); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *text) { return write(text); }
+    size_t print(const String &text) { return write(text.c_str()); }
+    size_t print(char value);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int decimals = 2);
+    size_t println();
+    template <typename T>
+    size_t println(const T &value)
+    {
+        return print(value) + println();
+    }
+    size_t println(double value, int decimals) { return print(value, decimals) + println(); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+// Serial output goes to stderr so benchmark and simulator results on
+// stdout stay machine-readable.
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    void setTxBufferSize(size_t) {}
+    void setRxBufferSize(size_t) {}
+    int availableForWrite() override { return 4096; }
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+
+    // Drops output, for loops that would otherwise log every iteration
+    void setMuted(bool muted) { this->muted = muted; }
+
+private:
+    bool muted = false;
+};
+
+extern HardwareSerial Serial;
+
+// Heap statistics are not tracked on the host
+class EspClass
+{
+public:
+    uint32_t getHeapSize() { return 0; }
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMinFreeHeap() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+    uint32_t getPsramSize() { return 0; }
+    uint32_t getFreePsram() { return 0; }
+    uint32_t getMinFreePsram() { return 0; }
+    uint32_t getMaxAllocPsram() { return 0; }
+};
+
+extern EspClass ESP;
+
+#endif // HOST_HAL_ARDUINO_H
@@ -0,0 +1,148 @@
+#include "FS.h"
+#include "SPIFFS.h"
+#include "LittleFS.h"
+
+fs::FS SPIFFS;
+LittleFSFS LittleFS;
+
+namespace fs
+{
+    File::File(const std::string &path, std::shared_ptr<std::vector<uint8_t>> data, bool writable, bool append)
+        : path(path),
+          data(data),
+          position_(append ? data->size() : 0),
+          writable(writable)
+    {
+    }
+
+    size_t File::write(uint8_t byte)
+    {
+        return write(&byte, 1);
+    }
+
+    size_t File::write(const uint8_t *buffer, size_t size)
+    {
+        if (!data || !writable)
+        {
+            return 0;
+        }
+        if (position_ + size > data->size())
+        {
+            data->resize(position_ + size);
+        }
+        memcpy(data->data() + position_, buffer, size);
+        position_ += size;
+        return size;
+    }
+
+    size_t File::read(uint8_t *buffer, size_t size)
+    {
+        if (!data || position_ >= data->size())
+        {
+            return 0;
+        }
+        size_t count = std::min(size, data->size() - position_);
+        memcpy(buffer, data->data() + position_, count);
+        position_ += count;
+        return count;
+    }
+
+    int File::read()
+    {
+        uint8_t byte;
+        return read(&byte, 1) == 1 ? byte : -1;
+    }
+
+    int File::peek()
+    {
+        return data && position_ < data->size() ? (*data)[position_] : -1;
+    }
+
+    int File::available()
+    {
+        return data && position_ < data->size() ? static_cast<int>(data->size() - position_) : 0;
+    }
+
+    bool File::seek(uint32_t pos, SeekMode mode)
+    {
+        if (!data)
+        {
+            return false;
+        }
+        size_t base = mode == SeekCur ? position_ : (mode == SeekEnd ? data->size() : 0);
+        if (base + pos > data->size())
+        {
+            return false;
+        }
+        position_ = base + pos;
+        return true;
+    }
+
+    bool FS::begin(bool)
+    {
+        return true;
+    }
+
+    File FS::open(const char *path, const char *mode)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = files.find(path);
+        if (mode[0] == 'r')
+        {
+            if (found == files.end())
+            {
+                return File();
+            }
+            return File(path, found->second, false, false);
+        }
+
+        // Writers get a fresh buffer; readers holding the old one keep it
+        bool append = mode[0] == 'a' && found != files.end();
+        auto data = append ? found->second : std::make_shared<std::vector<uint8_t>>();
+        files[path] = data;
+        return File(path, data, true, append);
+    }
+
+    bool FS::exists(const char *path)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return files.count(path) != 0;
+    }
+
+    bool FS::remove(const char *path)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return files.erase(path) != 0;
+    }
+
+    bool FS::rename(const char *from, const char *to)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = files.find(from);
+        if (found == files.end())
+        {
+            return false;
+        }
+        files[to] = found->second;
+        files.erase(from);
+        return true;
+    }
+
+    bool FS::format()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        files.clear();
+        return true;
+    }
+
+    size_t FS::usedBytes()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        size_t used = 0;
+        for (const auto &file : files)
+        {
+            used += file.second->size();
+        }
+        return used;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef HOST_HAL_FS_H
+#define HOST_HAL_FS_H
+
+// In-memory file system with the subset of the Arduino FS API the firmware
+// uses. Files live in a map owned by each FS instance, so a benchmark or
+// simulation can save and load models without touching the disk.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+    enum SeekMode
+    {
+        SeekSet = 0,
+        SeekCur = 1,
+        SeekEnd = 2
+    };
+
+    class File : public Stream
+    {
+    public:
+        File() : position_(0), writable(false) {}
+        File(const std::string &path, std::shared_ptr<std::vector<uint8_t>> data, bool writable, bool append);
+
+        size_t write(uint8_t byte) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+        size_t read(uint8_t *buffer, size_t size);
+        int read() override;
+        int peek() override;
+        int available() override;
+        bool seek(uint32_t pos, SeekMode mode = SeekSet);
+        size_t position() const { return position_; }
+        size_t size() const { return data ? data->size() : 0; }
+        void close() { data.reset(); }
+        const char *name() const { return path.c_str(); }
+        operator bool() const { return data != nullptr; }
+
+    private:
+        std::string path;
+        std::shared_ptr<std::vector<uint8_t>> data;
+        size_t position_;
+        bool writable;
+    };
+
+    class FS
+    {
+    public:
+        bool begin(bool formatOnFail = false);
+        File open(const char *path, const char *mode = FILE_READ);
+        bool exists(const char *path);
+        bool remove(const char *path);
+        bool rename(const char *from, const char *to);
+        bool format();
+        size_t totalBytes() const { return capacity; }
+        size_t usedBytes();
+
+        void setCapacity(size_t bytes) { capacity = bytes; }
+
+    private:
+        std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+        std::mutex lock;
+        size_t capacity = 1536 * 1024;
+    };
+}
+
+using fs::File;
+using fs::FS;
+
+#endif // HOST_HAL_FS_H
@@ -0,0 +1,22 @@
+#ifndef HOST_HAL_LITTLEFS_H
+#define HOST_HAL_LITTLEFS_H
+
+#include <FS.h>
+
+// A second in-memory FS, so LittleFsStorage builds and runs on the host
+class LittleFSFS : public fs::FS
+{
+public:
+    bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = NULL)
+    {
+        (void)basePath;
+        (void)maxOpenFiles;
+        (void)partitionLabel;
+        return fs::FS::begin(formatOnFail);
+    }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // HOST_HAL_LITTLEFS_H
@@ -0,0 +1,64 @@
+#include "MPU9250.h"
+namespace
+{
+    MPU9250::MotionSource *motionSource = NULL;
+
+    void syntheticGait(uint32_t nowUs, MPU9250::Reading &reading)
+    {
+        const float stroke = 2.0f * PI * 2.0f * nowUs * 1e-6f;
+        const float surge = 0.25f * sinf(stroke);
+        const float bounce = 0.03f * sinf(2.0f * stroke);
+        const float wobble = 4.0f * sinf(stroke + 0.5f);
+
+        reading.linearAccel[0] = surge;
+        reading.linearAccel[1] = 0.0f;
+        reading.linearAccel[2] = bounce;
+        reading.accel[0] = surge;
+        reading.accel[1] = 0.0f;
+        reading.accel[2] = 1.0f + bounce;
+        reading.gyro[0] = 0.0f;
+        reading.gyro[1] = 6.0f * cosf(stroke);
+        reading.gyro[2] = 12.0f * cosf(stroke + 0.5f);
+        reading.mag[0] = 30.0f;
+        reading.mag[1] = 0.0f;
+        reading.mag[2] = -40.0f;
+        reading.rpy[0] = 0.0f;
+        reading.rpy[1] = 2.0f * sinf(stroke);
+        reading.rpy[2] = wobble;
+        float halfYaw = wobble * 0.5f * DEG_TO_RAD;
+        reading.quat[0] = cosf(halfYaw);
+        reading.quat[1] = 0.0f;
+        reading.quat[2] = 0.0f;
+        reading.quat[3] = sinf(halfYaw);
+    }
+}
+
+void MPU9250::setMotionSource(MotionSource *source)
+{
+    motionSource = source;
+}
+
+MPU9250::MPU9250()
+{
+    memset(&reading, 0, sizeof(reading));
+    reading.accel[2] = 1.0f;
+    reading.quat[0] = 1.0f;
+    set(accBias, 0, 0, 0);
+    set(gyroBias, 0, 0, 0);
+    set(magBias, 0, 0, 0);
+    set(magScale, 1, 1, 1);
+}
+
+bool MPU9250::update()
+{
+    uint32_t nowUs = micros();
+    if (motionSource)
+    {
+        motionSource->read(nowUs, reading);
+    }
+    else
+    {
+        syntheticGait(nowUs, reading);
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef HOST_HAL_MPU9250_H
+#define HOST_HAL_MPU9250_H
+
+#include <Arduino.h>
+
+// Stand-in for hideakitai/MPU9250. Readings come from a MotionSource; the
+// default one synthesises a crawling gait from the clock (a 2 Hz stroke
+// along X with some vertical bounce and yaw wobble), which is enough to
+// keep AHRS::update() on its moving path. A simulator installs its own
+// source to feed modelled body motion instead.
+class MPU9250
+{
+public:
+    struct Reading
+    {
+        float accel[3];       // g, gravity included
+        float linearAccel[3]; // g, gravity removed
+        float gyro[3];        // deg/s
+        float mag[3];         // uT
+        float rpy[3];         // deg
+        float quat[4];        // w, x, y, z
+    };
+
+    class MotionSource
+    {
+    public:
+        virtual ~MotionSource() {}
+        virtual void read(uint32_t nowUs, Reading &reading) = 0;
+    };
+
+    // Shared by every instance; pass NULL to go back to the synthetic gait
+    static void setMotionSource(MotionSource *source);
+
+    MPU9250();
+
+    bool setup(uint8_t) { return true; }
+    bool update();
+    void calibrateAccelGyro() {}
+    void calibrateMag() {}
+
+    float getRoll() const { return reading.rpy[0]; }
+    float getPitch() const { return reading.rpy[1]; }
+    float getYaw() const { return reading.rpy[2]; }
+    float getAccX() const { return reading.accel[0]; }
+    float getAccY() const { return reading.accel[1]; }
+    float getAccZ() const { return reading.accel[2]; }
+    float getLinearAccX() const { return reading.linearAccel[0]; }
+    float getLinearAccY() const { return reading.linearAccel[1]; }
+    float getLinearAccZ() const { return reading.linearAccel[2]; }
+    float getGyroX() const { return reading.gyro[0]; }
+    float getGyroY() const { return reading.gyro[1]; }
+    float getGyroZ() const { return reading.gyro[2]; }
+    float getMagX() const { return reading.mag[0]; }
+    float getMagY() const { return reading.mag[1]; }
+    float getMagZ() const { return reading.mag[2]; }
+    float getQuaternionW() const { return reading.quat[0]; }
+    float getQuaternionX() const { return reading.quat[1]; }
+    float getQuaternionY() const { return reading.quat[2]; }
+    float getQuaternionZ() const { return reading.quat[3]; }
+    float getTemperature() const { return 25.0f; }
+
+    float getAccBiasX() const { return accBias[0]; }
+    float getAccBiasY() const { return accBias[1]; }
+    float getAccBiasZ() const { return accBias[2]; }
+    float getGyroBiasX() const { return gyroBias[0]; }
+    float getGyroBiasY() const { return gyroBias[1]; }
+    float getGyroBiasZ() const { return gyroBias[2]; }
+    float getMagBiasX() const { return magBias[0]; }
+    float getMagBiasY() const { return magBias[1]; }
+    float getMagBiasZ() const { return magBias[2]; }
+    float getMagScaleX() const { return magScale[0]; }
+    float getMagScaleY() const { return magScale[1]; }
+    float getMagScaleZ() const { return magScale[2]; }
+    void setAccBias(float x, float y, float z) { set(accBias, x, y, z); }
+    void setGyroBias(float x, float y, float z) { set(gyroBias, x, y, z); }
+    void setMagBias(float x, float y, float z) { set(magBias, x, y, z); }
+    void setMagScale(float x, float y, float z) { set(magScale, x, y, z); }
+
+private:
+    Reading reading;
+    float accBias[3];
+    float gyroBias[3];
+    float magBias[3];
+    float magScale[3];
+
+    static void set(float *target, float x, float y, float z)
+    {
+        target[0] = x;
+        target[1] = y;
+        target[2] = z;
+    }
+};
+
+#endif // HOST_HAL_MPU9250_H
@@ -0,0 +1,84 @@
+#include "Preferences.h"
+
+namespace
+{
+    std::map<std::string, std::map<std::string, std::vector<uint8_t>>> &namespaces()
+    {
+        static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> all;
+        return all;
+    }
+}
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+    if (entries != NULL || name == NULL || strlen(name) > MAX_KEY_LENGTH)
+    {
+        return false;
+    }
+    entries = &namespaces()[name];
+    this->readOnly = readOnly;
+    return true;
+}
+
+bool Preferences::clear()
+{
+    if (entries == NULL || readOnly)
+    {
+        return false;
+    }
+    entries->clear();
+    return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (entries == NULL || readOnly)
+    {
+        return false;
+    }
+    return entries->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+    return find(key) != NULL;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+    if (entries == NULL || readOnly || key == NULL || strlen(key) > MAX_KEY_LENGTH ||
+        value == NULL || length == 0)
+    {
+        return 0;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    (*entries)[key].assign(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    const std::vector<uint8_t> *value = find(key);
+    return value ? value->size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t length)
+{
+    const std::vector<uint8_t> *value = find(key);
+    if (value == NULL || buffer == NULL || length < value->size())
+    {
+        return 0;
+    }
+    memcpy(buffer, value->data(), value->size());
+    return value->size();
+}
+
+const std::vector<uint8_t> *Preferences::find(const char *key)
+{
+    if (entries == NULL || key == NULL)
+    {
+        return NULL;
+    }
+    Namespace::const_iterator it = entries->find(key);
+    return it != entries->end() ? &it->second : NULL;
+}
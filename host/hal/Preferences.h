@@ -0,0 +1,60 @@
+#ifndef HOST_HAL_PREFERENCES_H
+#define HOST_HAL_PREFERENCES_H
+
+// In-memory NVS. Namespaces are shared between instances and outlive them,
+// like flash does across Preferences objects on the robot.
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences
+{
+public:
+    static const size_t MAX_KEY_LENGTH = 15;
+
+    Preferences() : entries(NULL), readOnly(false) {}
+
+    bool begin(const char *name, bool readOnly = false);
+    void end() { entries = NULL; }
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putUShort(const char *key, uint16_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putFloat(const char *key, float value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putBytes(const char *key, const void *value, size_t length);
+
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint16_t getUShort(const char *key, uint16_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    float getFloat(const char *key, float defaultValue = 0.0f) { return getValue(key, defaultValue); }
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buffer, size_t length);
+
+private:
+    typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+    Namespace *entries;
+    bool readOnly;
+
+    const std::vector<uint8_t> *find(const char *key);
+
+    template <typename T>
+    T getValue(const char *key, T defaultValue)
+    {
+        const std::vector<uint8_t> *value = find(key);
+        if (value == NULL || value->size() != sizeof(T))
+        {
+            return defaultValue;
+        }
+        T result;
+        memcpy(&result, value->data(), sizeof(T));
+        return result;
+    }
+};
+
+#endif // HOST_HAL_PREFERENCES_H
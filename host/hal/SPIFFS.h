@@ -0,0 +1,8 @@
+#ifndef HOST_HAL_SPIFFS_H
+#define HOST_HAL_SPIFFS_H
+
+#include <FS.h>
+
+extern fs::FS SPIFFS;
+
+#endif // HOST_HAL_SPIFFS_H
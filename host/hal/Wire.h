@@ -0,0 +1,17 @@
+#ifndef HOST_HAL_WIRE_H
+#define HOST_HAL_WIRE_H
+
+#include <Arduino.h>
+
+// No bus on the host; the device fakes talk to their callers directly
+class TwoWire
+{
+public:
+    bool begin() { return true; }
+    bool begin(int, int) { return true; }
+    void setClock(uint32_t) {}
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_HAL_WIRE_H
@@ -0,0 +1,74 @@
+#include "esp_partition.h"
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    const uint32_t kSectorSize = 4096;
+    const uint32_t kPartitionSize = 256 * 1024;
+
+    const esp_partition_t kModelPartition = {
+        ESP_PARTITION_TYPE_DATA, static_cast<esp_partition_subtype_t>(0x40), 0x310000,
+        kPartitionSize, kSectorSize, "rlmodel", false};
+
+    std::vector<uint8_t> &flash()
+    {
+        static std::vector<uint8_t> bytes(kPartitionSize, 0xFF);
+        return bytes;
+    }
+
+    bool inRange(const esp_partition_t *partition, size_t offset, size_t size)
+    {
+        return partition == &kModelPartition && offset <= partition->size && size <= partition->size - offset;
+    }
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                 const char *label)
+{
+    if (type != kModelPartition.type ||
+        (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != kModelPartition.subtype) ||
+        (label != NULL && strcmp(label, kModelPartition.label) != 0))
+    {
+        return NULL;
+    }
+    return &kModelPartition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size)
+{
+    if (dst == NULL || !inRange(partition, offset, size))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, flash().data() + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size)
+{
+    if (src == NULL || !inRange(partition, offset, size))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < size; ++i)
+    {
+        flash()[offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (!inRange(partition, offset, size))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset % kSectorSize != 0 || size % kSectorSize != 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(flash().data() + offset, 0xFF, size);
+    return ESP_OK;
+}
@@ -0,0 +1,103 @@
+#include "CrawlerSim.h"
+#include <algorithm>
+#include <stdlib.h>
+
+namespace
+{
+    // Where a joint gets to in the time left, and how much time that uses
+    int approach(int fromDeg, int toDeg, float &budgetDeg)
+    {
+        int travel = std::min(abs(toDeg - fromDeg), static_cast<int>(budgetDeg));
+        budgetDeg -= static_cast<float>(travel);
+        return toDeg >= fromDeg ? fromDeg + travel : fromDeg - travel;
+    }
+}
+
+CrawlerSim::CrawlerSim() : CrawlerSim(Params())
+{
+}
+
+CrawlerSim::CrawlerSim(const Params &params, uint32_t seed)
+    : params(params),
+      rng(seed),
+      unitNoise(0.0f, 1.0f),
+      mechanics(restingAt(0, 0)),
+      driftCm(0.0f),
+      lastSpeedCms(0.0f)
+{
+}
+
+void CrawlerSim::reset(int downAngleDeg, int upAngleDeg)
+{
+    mechanics = restingAt(downAngleDeg, upAngleDeg);
+    driftCm = 0.0f;
+    lastSpeedCms = 0.0f;
+}
+
+CrawlerSim::Mechanics CrawlerSim::restingAt(int downAngleDeg, int upAngleDeg) const
+{
+    Mechanics resting = {};
+    resting.downDeg = downAngleDeg;
+    resting.upDeg = upAngleDeg;
+    return resting;
+}
+
+float CrawlerSim::contact(float downAngleDeg) const
+{
+    float span = params.contactStartDeg - params.contactFullDeg;
+    return std::min(1.0f, std::max(0.0f, (params.contactStartDeg - downAngleDeg) / span));
+}
+
+float CrawlerSim::expectedDeltaCm(int fromDownDeg, int fromUpDeg, int toDownDeg, int toUpDeg) const
+{
+    // Only the elbow moves the body; it pulls with the grip of the
+    // shoulder angle it ends up at
+    (void)fromDownDeg;
+    float grip = contact(static_cast<float>(toDownDeg));
+    float closed = static_cast<float>(fromUpDeg - toUpDeg);
+    if (closed >= 0.0f)
+    {
+        return params.strideCmPerDeg * closed * grip;
+    }
+    return params.strideCmPerDeg * closed * grip * params.pushBackFraction;
+}
+
+CrawlerSim::Mechanics::Window CrawlerSim::advance(Mechanics &m, int targetDownDeg, int targetUpDeg) const
+{
+    Mechanics::Window window = {0.0f, 0.0f, 0};
+    do
+    {
+        float budgetDeg = params.servoDegPerS * params.intervalS;
+        m.downDeg = approach(m.downDeg, targetDownDeg, budgetDeg);
+        if (m.downDeg == targetDownDeg)
+        {
+            int fromUpDeg = m.upDeg;
+            m.upDeg = approach(m.upDeg, targetUpDeg, budgetDeg);
+            window.deltaCm += expectedDeltaCm(m.downDeg, fromUpDeg, m.downDeg, m.upDeg);
+        }
+        window.seconds += params.intervalS;
+        m.elapsedS += params.intervalS;
+    } while (m.downDeg != targetDownDeg || m.upDeg != targetUpDeg);
+    window.downDeg = m.downDeg;
+    return window;
+}
+
+CrawlerSim::Observation CrawlerSim::step(int targetDownDeg, int targetUpDeg)
+{
+    Mechanics::Window window = advance(mechanics, targetDownDeg, targetUpDeg);
+
+    Observation observation;
+    observation.trueDeltaCm = window.deltaCm;
+    observation.windowS = window.seconds;
+    driftCm += params.driftStepCm * unitNoise(rng);
+    driftCm = std::min(params.maxDriftCm, std::max(-params.maxDriftCm, driftCm));
+    observation.deltaDistanceCm = observation.trueDeltaCm + driftCm + params.noiseCm * unitNoise(rng);
+
+    float speed = observation.deltaDistanceCm / window.seconds;
+    observation.avgSpeedCms = speed;
+    observation.avgAccelerationMps2 = (speed - lastSpeedCms) / 100.0f / window.seconds;
+    lastSpeedCms = speed;
+    observation.pitchDeg = params.pitchFullDeg * contact(static_cast<float>(window.downDeg)) +
+                           params.pitchNoiseDeg * unitNoise(rng);
+    return observation;
+}
@@ -0,0 +1,102 @@
+#ifndef CRAWLER_SIM_H
+#define CRAWLER_SIM_H
+
+// A kinematic stand-in for the crawler, for running Training on the host.
+//
+// The arm has a shoulder ("down" servo) and an elbow ("up" servo). The
+// tip touches the ground below contactStartDeg of shoulder angle and bears
+// full weight below contactFullDeg. Closing the elbow while the tip is on
+// the ground drags the body forward; opening it pushes the body back, by
+// less because the tip slides. Lifted, the elbow moves freely. So the
+// best gait is the four-move cycle lift, open, lower, pull, and opening
+// and closing the elbow on the ground is a weaker local optimum.
+//
+// What Training sees is the distance the AHRS would report: the true
+// progress plus white noise and a slowly wandering bias, as integrated
+// accelerometer readings drift. The body pitches nose-up as the arm takes
+// its weight, which the AHRS pitch shows with a little noise.
+//
+// The servos turn at servoDegPerS and the control pipeline sits between
+// them and Training, as ControlPipeline runs it: ServoControl moves the
+// shoulder first, then the elbow, and the sense task drops ticks while the
+// move is running, so the window stays open until the first tick after it
+// ends. Each step is then one window in which the action just taken moves
+// the arm; a move longer than the interval makes that window span several
+// intervals.
+
+#include <stdint.h>
+#include <random>
+
+class CrawlerSim
+{
+public:
+    struct Params
+    {
+        float strideCmPerDeg = 0.06f;
+        float pushBackFraction = 0.6f;
+        float contactStartDeg = 110.0f;
+        float contactFullDeg = 60.0f;
+        float noiseCm = 0.3f;
+        float driftStepCm = 0.02f;   // random-walk step of the bias
+        float maxDriftCm = 0.5f;
+        float intervalS = 0.5f;
+        float servoDegPerS = 200.0f; // 2 degrees per 10 ms
+        float pitchFullDeg = 8.0f;   // pitch with the arm bearing full weight
+        float pitchNoiseDeg = 1.0f;
+    };
+
+    struct Observation
+    {
+        float deltaDistanceCm;       // as measured
+        float avgSpeedCms;
+        float avgAccelerationMps2;
+        float pitchDeg;
+        float trueDeltaCm;
+        float windowS;               // how long the window ran
+    };
+
+    // Everything that moves the arm, without the noise, so it can be
+    // copied to try out a policy
+    struct Mechanics
+    {
+        struct Window
+        {
+            float deltaCm;
+            float seconds;
+            int downDeg;             // shoulder when it closed, for the pitch
+        };
+
+        int downDeg;
+        int upDeg;
+        float elapsedS;
+    };
+
+    CrawlerSim();
+    explicit CrawlerSim(const Params &params, uint32_t seed = 1);
+
+    void reset(int downAngleDeg, int upAngleDeg);
+    Observation step(int targetDownDeg, int targetUpDeg);
+
+    // Noise-free: carries out a move and returns the window that Training
+    // takes next, which ends at the first tick after the move
+    Mechanics::Window advance(Mechanics &mechanics, int targetDownDeg, int targetUpDeg) const;
+    Mechanics restingAt(int downAngleDeg, int upAngleDeg) const;
+
+    // Noise-free progress of one move
+    float expectedDeltaCm(int fromDownDeg, int fromUpDeg, int toDownDeg, int toUpDeg) const;
+    float contact(float downAngleDeg) const;
+
+    float getElapsedS() const { return mechanics.elapsedS; }
+    const Params &getParams() const { return params; }
+
+private:
+    Params params;
+    std::mt19937 rng;
+    std::normal_distribution<float> unitNoise;
+    Mechanics mechanics;
+    float driftCm;
+    float lastSpeedCms;
+
+};
+
+#endif // CRAWLER_SIM_H
@@ -0,0 +1,386 @@
+#include "SimRun.h"
+#include <Arduino.h>
+#include <RamStorage.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+struct TrainingSimAccess
+{
+    // What the hashed state remembers between steps
+    struct History
+    {
+        int previousAction = Training::kNoAction;
+        int phase = 0;
+
+        void record(int action, float deltaCm)
+        {
+            previousAction = action;
+            phase = deltaCm > Training::kProgressCm ? 0 : std::min(phase + 1, Training::kMaxPhase);
+        }
+    };
+
+    static int greedyAction(const Training &training, int downAngleDeg, int upAngleDeg,
+                            const CrawlerSim::Observation &observation, const History &history)
+    {
+        float speedCms = observation.avgSpeedCms;
+        float pitchDeg = observation.pitchDeg;
+        if (training.network.isActive())
+        {
+            QNetwork::Input input;
+            float qValues[Training::kNumActions];
+            QNetwork::encode(downAngleDeg, upAngleDeg, speedCms, observation.avgAccelerationMps2, input);
+            training.network.values(input, qValues);
+            return Training::findBestAction(qValues);
+        }
+        if (training.hashed != NULL)
+        {
+            int state = training.getNearestStateIndex(downAngleDeg, upAngleDeg);
+            uint32_t key = Training::encodeHashedState(state, history.previousAction, history.phase, pitchDeg);
+            const Training::HashedTable::Entry *entry = training.hashed->peek(key);
+            float qValues[Training::kNumActions];
+            if (entry != NULL)
+            {
+                training.readHashed(*entry, state, qValues);
+            }
+            else
+            {
+                memcpy(qValues, training.qTable[state], sizeof(qValues));
+            }
+            return Training::findBestAction(qValues);
+        }
+        if (training.tiles.isActive())
+        {
+            TileCoder::Features features;
+            float qValues[Training::kNumActions];
+            training.encodeState(downAngleDeg, upAngleDeg, speedCms, features);
+            training.tiles.values(features, qValues);
+            return Training::findBestAction(qValues);
+        }
+        return training.selectBestAction(training.getStateIndex(downAngleDeg, upAngleDeg));
+    }
+
+    static void decodeAction(const Training &training, int action, int downAngleDeg, int upAngleDeg,
+                             int &targetDownDeg, int &targetUpDeg)
+    {
+        training.decodeAction(action, downAngleDeg, upAngleDeg, targetDownDeg, targetUpDeg);
+    }
+
+    static int stateIndex(const Training &training, int downAngleDeg, int upAngleDeg)
+    {
+        return training.getStateIndex(downAngleDeg, upAngleDeg);
+    }
+
+    static int actionCount()
+    {
+        return Training::kNumActions;
+    }
+
+    static size_t valueBytes(const Training &training)
+    {
+        size_t table = sizeof(training.qTable) + sizeof(training.visitCounts);
+        if (training.params.doubleQ)
+        {
+            table += sizeof(training.qSpread);
+        }
+        if (training.hashed != NULL)
+        {
+            return table + Training::HashedTable::memoryBytes();
+        }
+        if (training.network.isActive())
+        {
+            return training.network.getMemoryBytes();
+        }
+        return training.tiles.isActive() ? training.tiles.getMemoryBytes() : table;
+    }
+};
+
+namespace
+{
+    const int kRolloutWarmupSteps = 8;
+    const int kRolloutSteps = 32;
+    const int kStableChecks = 3;
+    // Priors train on other noise than the run they seed
+    const uint32_t kPriorSeedOffset = 1000;
+
+    // Distance per step and per second of the greedy policy, from the
+    // commanded pose, with no measurement noise
+    SimRun::Rate rolloutRate(const Training &training, const CrawlerSim::Params &crawler, int downAngleDeg,
+                             int upAngleDeg)
+    {
+        CrawlerSim::Params params = crawler;
+        params.noiseCm = 0.0f;
+        params.driftStepCm = 0.0f;
+        CrawlerSim sim(params);
+        sim.reset(downAngleDeg, upAngleDeg);
+
+        CrawlerSim::Observation observation = {};
+        observation.pitchDeg = params.pitchFullDeg * sim.contact(static_cast<float>(downAngleDeg));
+        TrainingSimAccess::History history;
+        int down = downAngleDeg;
+        int up = upAngleDeg;
+        float distance = 0.0f;
+        float seconds = 0.0f;
+        for (int i = 0; i < kRolloutWarmupSteps + kRolloutSteps; ++i)
+        {
+            int action = TrainingSimAccess::greedyAction(training, down, up, observation, history);
+            int toDown;
+            int toUp;
+            TrainingSimAccess::decodeAction(training, action, down, up, toDown, toUp);
+            down = toDown;
+            up = toUp;
+            observation = sim.step(down, up);
+            history.record(action, observation.deltaDistanceCm);
+            if (i >= kRolloutWarmupSteps)
+            {
+                distance += observation.trueDeltaCm;
+                seconds += observation.windowS;
+            }
+        }
+        SimRun::Rate rate = {distance / kRolloutSteps, distance / seconds};
+        return rate;
+    }
+
+    // Finds the table policy that walks fastest over the rollout window
+    // from the first angle options, on the noise-free crawler. Moves
+    // longer than the interval stretch their window over several ticks,
+    // so the search follows each policy through the pipeline rather than
+    // solving the table's own model. It only branches at poses a trajectory reaches
+    // before it has picked an action there.
+    class PolicySearch
+    {
+    public:
+        PolicySearch(const Training::Hyperparameters &hyperparameters, const CrawlerSim::Params &params)
+            : crawler(params)
+        {
+            training.configure(hyperparameters);
+            policy.assign(training.getDownActionCount() * training.getUpActionCount(), -1);
+            best.cmPerStep = 0.0f;
+            best.cmPerS = 0.0f;
+        }
+
+        SimRun::Rate run()
+        {
+            int down = training.getDownAngleOption(0);
+            int up = training.getUpAngleOption(0);
+            follow(crawler.restingAt(down, up), down, up, 0, 0.0f, 0.0f);
+            return best;
+        }
+
+    private:
+        Training training;
+        CrawlerSim crawler;
+        std::vector<int> policy;
+        SimRun::Rate best;
+
+        void follow(const CrawlerSim::Mechanics &mechanics, int commandedDown, int commandedUp, int step,
+                    float distance, float seconds)
+        {
+            if (step == kRolloutWarmupSteps + kRolloutSteps)
+            {
+                if (distance / seconds > best.cmPerS)
+                {
+                    best.cmPerStep = distance / kRolloutSteps;
+                    best.cmPerS = distance / seconds;
+                }
+                return;
+            }
+            int state = TrainingSimAccess::stateIndex(training, commandedDown, commandedUp);
+            if (policy[state] >= 0)
+            {
+                act(policy[state], mechanics, commandedDown, commandedUp, step, distance, seconds);
+                return;
+            }
+            for (int action = 0; action < TrainingSimAccess::actionCount(); ++action)
+            {
+                policy[state] = action;
+                act(action, mechanics, commandedDown, commandedUp, step, distance, seconds);
+            }
+            policy[state] = -1;
+        }
+
+        void act(int action, CrawlerSim::Mechanics mechanics, int commandedDown, int commandedUp, int step,
+                 float distance, float seconds)
+        {
+            int targetDown;
+            int targetUp;
+            TrainingSimAccess::decodeAction(training, action, commandedDown, commandedUp, targetDown, targetUp);
+            CrawlerSim::Mechanics::Window window = crawler.advance(mechanics, targetDown, targetUp);
+            if (step >= kRolloutWarmupSteps)
+            {
+                distance += window.deltaCm;
+                seconds += window.seconds;
+            }
+            follow(mechanics, targetDown, targetUp, step + 1, distance, seconds);
+        }
+    };
+}
+
+namespace SimRun
+{
+    const Mode kModes[] = {
+        {"table", Training::VALUE_TABLE, 1, false},
+        {"table-double", Training::VALUE_TABLE, 1, true},
+        {"table-3step", Training::VALUE_TABLE, 3, false},
+        {"table-double-3", Training::VALUE_TABLE, 3, true},
+        {"tiles", Training::VALUE_TILES, 1, false},
+        {"tiles-speed", Training::VALUE_TILES_SPEED, 1, false},
+        {"hashed", Training::VALUE_HASHED, 1, false},
+        {"network", Training::VALUE_NETWORK, 1, false},
+    };
+    const size_t kModeCount = sizeof(kModes) / sizeof(kModes[0]);
+
+    const Mode *findMode(const char *name)
+    {
+        for (size_t i = 0; i < kModeCount; ++i)
+        {
+            if (strcmp(name, kModes[i].name) == 0)
+            {
+                return &kModes[i];
+            }
+        }
+        return NULL;
+    }
+
+    void applyMode(const Mode &mode, Training::Hyperparameters &hyperparameters)
+    {
+        hyperparameters.valueFunction = mode.valueFunction;
+        hyperparameters.returnSteps = mode.returnSteps;
+        hyperparameters.doubleQ = mode.doubleQ;
+    }
+
+    // The longer forearm touches down from 170 degrees and bears fully
+    // from 130. The gait learned on the nominal crawler only walks 69% as
+    // far as the best one for it.
+    CrawlerSim::Params crawlerParams(bool longArm)
+    {
+        CrawlerSim::Params params;
+        if (longArm)
+        {
+            params.contactStartDeg = 170.0f;
+            params.contactFullDeg = 130.0f;
+        }
+        return params;
+    }
+
+    Rate bestRate(const Training::Hyperparameters &hyperparameters, const CrawlerSim::Params &params)
+    {
+        PolicySearch search(hyperparameters, params);
+        return search.run();
+    }
+
+    size_t valueBytes(const Training::Hyperparameters &hyperparameters)
+    {
+        Training training;
+        training.configure(hyperparameters);
+        return TrainingSimAccess::valueBytes(training);
+    }
+
+    void trainPrior(Training &training, const Training::Hyperparameters &hyperparameters,
+                    const CrawlerSim::Params &params, uint32_t seed, int maxSteps)
+    {
+        Training::Hyperparameters cold = hyperparameters;
+        cold.warmStart = 0.0f;
+        training.configure(cold);
+        training.begin();
+        randomSeed(seed);
+        training.startTraining();
+
+        CrawlerSim crawler(params, seed);
+        int down = training.getDownAngleOption(0);
+        int up = training.getUpAngleOption(0);
+        crawler.reset(down, up);
+        CrawlerSim::Observation observation = {};
+        for (int step = 0; step < maxSteps && !training.isEpsilonMin(); ++step)
+        {
+            Training::StepResult decision = training.step(observation.deltaDistanceCm, observation.avgSpeedCms,
+                                                          observation.avgAccelerationMps2, down, up,
+                                                          observation.pitchDeg);
+            down = decision.targetDownAngle;
+            up = decision.targetUpAngle;
+            observation = crawler.step(down, up);
+        }
+        training.stopTraining();
+        training.saveModel();
+    }
+
+    Result runOnce(const Training::Hyperparameters &hyperparameters, uint32_t seed, const Settings &settings,
+                   float targetCms)
+    {
+        RamStorage storage;
+        Training training;
+        training.setStorage(&storage);
+        training.configure(hyperparameters);
+        training.begin();
+        if (hyperparameters.warmStart > 0.0f)
+        {
+            CrawlerSim::Params nominal = crawlerParams(false);
+            nominal.intervalS = settings.crawler.intervalS;
+            nominal.servoDegPerS = settings.crawler.servoDegPerS;
+            Training prior;
+            prior.setStorage(&storage);
+            trainPrior(prior, hyperparameters, nominal, seed + kPriorSeedOffset, settings.steps);
+            training.loadModel();
+        }
+        randomSeed(seed);
+        training.startTraining();
+
+        CrawlerSim crawler(settings.crawler, seed);
+        int down = training.getDownAngleOption(0);
+        int up = training.getUpAngleOption(0);
+        crawler.reset(down, up);
+
+        Result result = {-1, 0.0f, {0.0f, 0.0f}, settings.steps, 0.0f, 0.0};
+        CrawlerSim::Observation observation = {};
+        int stableChecks = 0;
+        int firstStable = -1;
+        float firstStableS = 0.0f;
+        uint64_t stepNs = 0;
+        for (int step = 1; step <= settings.steps; ++step)
+        {
+            auto start = std::chrono::steady_clock::now();
+            Training::StepResult decision = training.step(observation.deltaDistanceCm, observation.avgSpeedCms,
+                                                          observation.avgAccelerationMps2, down, up,
+                                                          observation.pitchDeg);
+            stepNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                          .count();
+            down = decision.targetDownAngle;
+            up = decision.targetUpAngle;
+            observation = crawler.step(down, up);
+            if (training.isEpsilonMin() && step < result.endStep)
+            {
+                result.endStep = step;
+                result.endS = crawler.getElapsedS();
+            }
+
+            if (step % settings.evalEvery != 0)
+            {
+                continue;
+            }
+            result.finalRate = rolloutRate(training, settings.crawler, down, up);
+            if (result.finalRate.cmPerS >= targetCms)
+            {
+                if (stableChecks++ == 0)
+                {
+                    firstStable = step;
+                    firstStableS = crawler.getElapsedS();
+                }
+                if (stableChecks == kStableChecks && result.convergedStep < 0)
+                {
+                    result.convergedStep = firstStable;
+                    result.convergedS = firstStableS;
+                }
+            }
+            else
+            {
+                stableChecks = 0;
+            }
+        }
+        if (result.endStep == settings.steps)
+        {
+            result.endS = crawler.getElapsedS();
+        }
+        result.stepNs = static_cast<double>(stepNs) / settings.steps;
+        return result;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef SIM_RUN_H
+#define SIM_RUN_H
+
+// One training run against CrawlerSim, shared by the simulator
+// (sim_main.cpp) and the hyperparameter sweep (host/sweep).
+//
+// A run trains one simulated crawler from scratch, feeding step() what
+// the control pipeline would: the measured distance, speed, acceleration
+// and pitch of the last window and the commanded joint angles. Every
+// evalEvery steps the greedy policy is rolled out on a noise-free copy of
+// the crawler. A run has converged once that rollout reaches 90% of the
+// best gait's speed and holds it for the next two checks. Steps take one
+// control interval unless the servos fall behind (CrawlerSim.h), so
+// speeds are per second of simulated time as well as per step.
+//
+// Each run keeps its model files in its own RamStorage and its random
+// numbers are per thread, so runs on different threads do not interfere
+// and a seed gives the same run on any thread.
+
+#include <Training.h>
+#include "CrawlerSim.h"
+
+namespace SimRun
+{
+    const float kConvergedFraction = 0.9f;
+
+    struct Mode
+    {
+        const char *name;
+        Training::ValueFunction valueFunction;
+        uint8_t returnSteps;
+        bool doubleQ;
+    };
+
+    // table, table-double, table-3step, table-double-3, tiles,
+    // tiles-speed, hashed and network
+    extern const Mode kModes[];
+    extern const size_t kModeCount;
+
+    const Mode *findMode(const char *name);
+    void applyMode(const Mode &mode, Training::Hyperparameters &hyperparameters);
+
+    struct Settings
+    {
+        CrawlerSim::Params crawler; // what the run trains on
+        int steps = 5000;
+        int evalEvery = 50;
+    };
+
+    struct Rate
+    {
+        float cmPerStep;
+        float cmPerS;
+    };
+
+    struct Result
+    {
+        int convergedStep; // -1 if never
+        float convergedS;  // simulated time by then
+        Rate finalRate;    // of the greedy policy at the end
+        int endStep;       // where epsilon reached its floor and the robot would stop
+        float endS;
+        double stepNs;
+    };
+
+    // The arm after a longer forearm went on, or the nominal one
+    CrawlerSim::Params crawlerParams(bool longArm);
+
+    // Best speed a table policy over the angle options reaches on the
+    // crawler, from the first angle options
+    Rate bestRate(const Training::Hyperparameters &hyperparameters, const CrawlerSim::Params &crawler);
+
+    // Bytes the value function of these hyperparameters keeps
+    size_t valueBytes(const Training::Hyperparameters &hyperparameters);
+
+    // Trains from scratch on the crawler until epsilon reaches its floor,
+    // where the robot would stop, and saves the model as it would
+    void trainPrior(Training &training, const Training::Hyperparameters &hyperparameters,
+                    const CrawlerSim::Params &crawler, uint32_t seed, int maxSteps);
+
+    // With hyperparameters.warmStart above 0, first trains a prior on the
+    // nominal crawler, with other noise, and warm-starts from it.
+    // Converged means reaching targetCms.
+    Result runOnce(const Training::Hyperparameters &hyperparameters, uint32_t seed, const Settings &settings,
+                   float targetCms);
+}
+
+#endif // SIM_RUN_H
@@ -0,0 +1,277 @@
+// Runs Training against CrawlerSim to compare learners on the host.
+//
+// Trains a simulated crawler per seed for each mode and reports how many
+// runs converged and how soon; SimRun.h describes a run.
+//
+// With --warm, each run first trains on the nominal crawler until epsilon
+// reaches its floor, saves that model, then loads it and warm-starts from
+// it on the crawler picked with --crawler. That is the robot that was
+// trained once and has since had its arm changed.
+//
+//     pio run -e native_sim
+//     .pio/build/native_sim/program --seeds 20 --json sim.json
+//
+// Options:
+//     --mode NAME       table, table-double, table-3step, table-double-3,
+//                       tiles, tiles-speed, hashed, network or all
+//                       (default all). The table variants set doubleQ
+//                       and returnSteps.
+//     --explore NAME    epsilon, ucb or softmax (default epsilon)
+//     --seeds N         runs per mode, seeds 1..N (default 20)
+//     --steps N         training steps per run (default 5000)
+//     --eval-every N    steps between greedy rollouts (default 50)
+//     --crawler NAME    nominal or long-arm, the crawler runs train on
+//                       (default nominal)
+//     --warm C          warm-start each run from a model trained on the
+//                       nominal crawler, with warmStart C
+//     --save-prior FILE train one model on the nominal crawler and write
+//                       it as a model file to push to robots, then exit
+//     --json FILE       also write per-mode results as JSON
+
+#include <Arduino.h>
+#include <Training.h>
+#include "SimRun.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        const char *mode = "all";
+        const char *jsonPath = NULL;
+        const char *priorPath = NULL;
+        Training::Exploration exploration = Training::EXPLORE_EPSILON;
+        int seeds = 20;
+        int steps = 5000;
+        int evalEvery = 50;
+        bool longArm = false;
+        float warmStart = 0.0f;
+    };
+
+    struct ModeResult
+    {
+        const char *name;
+        size_t valueBytes;
+        int converged;
+        int runs;
+        double medianConvergedStep;
+        double medianEndStep;
+        double meanFinalRate;
+        double stepNs;
+    };
+
+    ModeResult runMode(const char *name, const Training::Hyperparameters &hyperparameters, const Options &options)
+    {
+        SimRun::Settings settings;
+        settings.crawler = SimRun::crawlerParams(options.longArm);
+        settings.steps = options.steps;
+        settings.evalEvery = options.evalEvery;
+        SimRun::Rate best = SimRun::bestRate(hyperparameters, settings.crawler);
+        float target = SimRun::kConvergedFraction * best.cmPerS;
+
+        ModeResult mode = {};
+        mode.name = name;
+        mode.valueBytes = SimRun::valueBytes(hyperparameters);
+        mode.runs = options.seeds;
+        std::vector<int> convergedSteps;
+        std::vector<int> endSteps;
+        for (int seed = 1; seed <= options.seeds; ++seed)
+        {
+            SimRun::Result run = SimRun::runOnce(hyperparameters, seed, settings, target);
+            if (run.convergedStep >= 0)
+            {
+                convergedSteps.push_back(run.convergedStep);
+            }
+            endSteps.push_back(run.endStep);
+            mode.meanFinalRate += run.finalRate.cmPerStep;
+            mode.stepNs += run.stepNs;
+        }
+        mode.converged = static_cast<int>(convergedSteps.size());
+        mode.meanFinalRate /= options.seeds;
+        mode.stepNs /= options.seeds;
+        if (!convergedSteps.empty())
+        {
+            std::sort(convergedSteps.begin(), convergedSteps.end());
+            mode.medianConvergedStep = convergedSteps[convergedSteps.size() / 2];
+        }
+        else
+        {
+            mode.medianConvergedStep = -1;
+        }
+        std::sort(endSteps.begin(), endSteps.end());
+        mode.medianEndStep = endSteps[endSteps.size() / 2];
+        printf("%-14s %8zu B  converged %2d/%-2d  median step %6.0f  ends %5.0f  final %.3f cm/step (best %.3f)  "
+               "%7.1f ns/step\n",
+               name, mode.valueBytes, mode.converged, mode.runs, mode.medianConvergedStep, mode.medianEndStep,
+               mode.meanFinalRate, best.cmPerStep, mode.stepNs);
+        return mode;
+    }
+
+    const char *const kExplorationNames[] = {"epsilon", "ucb", "softmax"};
+
+    bool parseExploration(const char *value, Training::Exploration &exploration)
+    {
+        for (int i = 0; i <= Training::EXPLORE_SOFTMAX; ++i)
+        {
+            if (strcmp(value, kExplorationNames[i]) == 0)
+            {
+                exploration = static_cast<Training::Exploration>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char *arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+            if (strcmp(arg, "--mode") == 0 && value)
+            {
+                options.mode = value;
+            }
+            else if (strcmp(arg, "--explore") == 0 && value && parseExploration(value, options.exploration))
+            {
+            }
+            else if (strcmp(arg, "--crawler") == 0 && value &&
+                     (strcmp(value, "nominal") == 0 || strcmp(value, "long-arm") == 0))
+            {
+                options.longArm = strcmp(value, "long-arm") == 0;
+            }
+            else if (strcmp(arg, "--warm") == 0 && value && atof(value) > 0.0 && atof(value) < 1.0)
+            {
+                options.warmStart = static_cast<float>(atof(value));
+            }
+            else if (strcmp(arg, "--save-prior") == 0 && value)
+            {
+                options.priorPath = value;
+            }
+            else if (strcmp(arg, "--json") == 0 && value)
+            {
+                options.jsonPath = value;
+            }
+            else if (strcmp(arg, "--seeds") == 0 && value && atoi(value) > 0)
+            {
+                options.seeds = atoi(value);
+            }
+            else if (strcmp(arg, "--steps") == 0 && value && atoi(value) > 0)
+            {
+                options.steps = atoi(value);
+            }
+            else if (strcmp(arg, "--eval-every") == 0 && value && atoi(value) > 0)
+            {
+                options.evalEvery = atoi(value);
+            }
+            else
+            {
+                fprintf(stderr,
+                        "usage: %s [--mode table|table-double|table-3step|table-double-3|tiles|tiles-speed|hashed|"
+                        "network|all] [--explore epsilon|ucb|softmax] [--seeds N] [--steps N] [--eval-every N] "
+                        "[--crawler nominal|long-arm] [--warm C] [--save-prior FILE] [--json FILE]\n",
+                        argv[0]);
+                return false;
+            }
+            ++i;
+        }
+        return true;
+    }
+
+    // Trains one model on the nominal crawler and writes the model file,
+    // which serial_link.py can push to a robot as its warm-start prior
+    bool savePrior(const Training::Hyperparameters &hyperparameters, const Options &options)
+    {
+        Training prior;
+        SimRun::trainPrior(prior, hyperparameters, SimRun::crawlerParams(false), 1, options.steps);
+        std::vector<uint8_t> model(prior.getModelSize());
+        if (model.empty() || prior.readModel(0, model.data(), model.size()) != model.size())
+        {
+            fprintf(stderr, "prior model was not saved\n");
+            return false;
+        }
+        FILE *out = fopen(options.priorPath, "wb");
+        if (out == NULL)
+        {
+            perror(options.priorPath);
+            return false;
+        }
+        bool written = fwrite(model.data(), 1, model.size(), out) == model.size();
+        written = fclose(out) == 0 && written;
+        if (written)
+        {
+            printf("wrote %s: %zu bytes, trained on the nominal crawler\n", options.priorPath, model.size());
+        }
+        return written;
+    }
+
+    void writeJson(FILE *out, const Options &options, const std::vector<ModeResult> &modes)
+    {
+        fprintf(out,
+                "{\n  \"schema\": 1,\n  \"explore\": \"%s\",\n  \"crawler\": \"%s\",\n  \"warm_start\": %.2f,\n"
+                "  \"seeds\": %d,\n  \"steps\": %d,\n",
+                kExplorationNames[options.exploration], options.longArm ? "long-arm" : "nominal", options.warmStart,
+                options.seeds, options.steps);
+        fprintf(out, "  \"modes\": [\n");
+        for (size_t i = 0; i < modes.size(); ++i)
+        {
+            const ModeResult &m = modes[i];
+            fprintf(out,
+                    "    {\"name\": \"%s\", \"value_bytes\": %zu, \"converged\": %d, \"runs\": %d, "
+                    "\"median_converged_step\": %.0f, \"median_end_step\": %.0f, \"final_cm_per_step\": %.4f, "
+                    "\"ns_per_step\": %.1f}%s\n",
+                    m.name, m.valueBytes, m.converged, m.runs, m.medianConvergedStep, m.medianEndStep, m.meanFinalRate,
+                    m.stepNs,
+                    i + 1 < modes.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+    Serial.setMuted(true);
+    HostClock::setManual(true);
+
+    std::vector<ModeResult> results;
+    for (size_t i = 0; i < SimRun::kModeCount; ++i)
+    {
+        const SimRun::Mode &mode = SimRun::kModes[i];
+        if (strcmp(options.mode, "all") == 0 || strcmp(options.mode, mode.name) == 0)
+        {
+            Training::Hyperparameters hyperparameters = Training::defaultHyperparameters();
+            SimRun::applyMode(mode, hyperparameters);
+            hyperparameters.exploration = options.exploration;
+            hyperparameters.warmStart = options.warmStart;
+            if (options.priorPath)
+            {
+                return savePrior(hyperparameters, options) ? 0 : 1;
+            }
+            results.push_back(runMode(mode.name, hyperparameters, options));
+        }
+    }
+    if (results.empty())
+    {
+        fprintf(stderr, "unknown mode %s\n", options.mode);
+        return 2;
+    }
+
+    if (options.jsonPath)
+    {
+        FILE *out = fopen(options.jsonPath, "w");
+        if (out == NULL)
+        {
+            perror(options.jsonPath);
+            return 1;
+        }
+        writeJson(out, options, results);
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,491 @@
+// Sweeps training hyperparameters against CrawlerSim, on every core.
+//
+// Each combination of the values given trains --seeds simulated crawlers
+// from scratch, as the simulator does (host/sim/SimRun.h), and the
+// combinations are ranked by how many runs converged, then by how many
+// minutes of training that took at their control interval. Training
+// counts every step as an episode, so steps to convergence are episodes
+// to convergence. Runs are spread over threads but each is seeded on its
+// own, so the results do not depend on --threads.
+//
+// The interval decides whether a move fits in one step: the simulated
+// servos turn at 200 degrees per second, as ServoControl's smooth moves
+// do, and longer moves hold up the pipeline (CrawlerSim.h). Speeds are
+// therefore per second of simulated time. The measurement noise per step
+// does not change.
+//
+//     pio run -e native_sweep
+//     .pio/build/native_sweep/program --gamma 0.9,0.95,0.99 --alpha-min 0,0.05,0.1
+//     .pio/build/native_sweep/program --random 200 --eps-decay 0.999,0.9999 --interval-ms 300,800
+//
+// Options:
+//     --gamma LIST        discounts to try (default 0.95)
+//     --eps-decay LIST    epsilon decays per step (default 0.9995)
+//     --alpha-min LIST    floors of the table step size (default 0)
+//     --interval-ms LIST  control intervals, rounded down to 2 ms as on
+//                         the robot (default 500)
+//     --random N          instead of the grid, draw N combinations between
+//                         the smallest and largest value of each list;
+//                         epsilon decays are drawn evenly in log(1 - decay)
+//     --sample-seed N     seed for --random (default 1)
+//     --mode NAME         value function, as in sim_main.cpp (default table)
+//     --explore NAME      epsilon, ucb or softmax (default epsilon)
+//     --crawler NAME      nominal or long-arm (default nominal)
+//     --seeds N           runs per combination, seeds 1..N (default 20)
+//     --steps N           training steps per run (default 5000)
+//     --eval-every N      steps between greedy rollouts (default 50)
+//     --threads N         worker threads (default: one per core)
+//     --rank NAME         converged (default), or speed to rank by the
+//                         final greedy speed in cm/s
+//     --top N             print only the best N combinations
+//     --json FILE         also write every combination as JSON
+
+#include <Arduino.h>
+#include <Training.h>
+#include "SimRun.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const uint32_t kIntervalStepMs = 2;
+    // Sweeps this long report progress every tenth
+    const size_t kProgressMinJobs = 500;
+
+    struct Options
+    {
+        std::vector<float> gammas;
+        std::vector<float> epsilonDecays;
+        std::vector<float> alphaMins;
+        std::vector<float> intervalsMs;
+        int randomCount = 0;
+        uint32_t sampleSeed = 1;
+        const SimRun::Mode *mode = &SimRun::kModes[0];
+        Training::Exploration exploration = Training::EXPLORE_EPSILON;
+        bool longArm = false;
+        int seeds = 20;
+        int steps = 5000;
+        int evalEvery = 50;
+        int threads = 0;
+        int top = 0;
+        bool rankBySpeed = false;
+        const char *jsonPath = NULL;
+    };
+
+    struct Combination
+    {
+        float gamma;
+        float epsilonDecay;
+        float alphaMin;
+        uint32_t intervalMs;
+        float targetCms;     // speed that counts as converged
+        float bestCmPerStep; // of the best table policy
+    };
+
+    struct Summary
+    {
+        int converged;
+        double medianConvergedStep; // -1 if no run converged
+        double medianConvergedMinutes;
+        double medianEndStep;
+        double medianEndMinutes;
+        double meanFinalRate;       // greedy cm per step at the end
+        double meanFinalSpeed;      // the same in cm/s
+    };
+
+    const char *const kExplorationNames[] = {"epsilon", "ucb", "softmax"};
+
+    bool parseList(const char *value, std::vector<float> &out)
+    {
+        out.clear();
+        const char *cursor = value;
+        for (;;)
+        {
+            char *end = NULL;
+            float parsed = strtof(cursor, &end);
+            if (end == cursor)
+            {
+                return false;
+            }
+            out.push_back(parsed);
+            if (*end == '\0')
+            {
+                return true;
+            }
+            if (*end != ',')
+            {
+                return false;
+            }
+            cursor = end + 1;
+        }
+    }
+
+    bool parseExploration(const char *value, Training::Exploration &exploration)
+    {
+        for (int i = 0; i <= Training::EXPLORE_SOFTMAX; ++i)
+        {
+            if (strcmp(value, kExplorationNames[i]) == 0)
+            {
+                exploration = static_cast<Training::Exploration>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char *arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+            if (strcmp(arg, "--gamma") == 0 && value && parseList(value, options.gammas))
+            {
+            }
+            else if (strcmp(arg, "--eps-decay") == 0 && value && parseList(value, options.epsilonDecays))
+            {
+            }
+            else if (strcmp(arg, "--alpha-min") == 0 && value && parseList(value, options.alphaMins))
+            {
+            }
+            else if (strcmp(arg, "--interval-ms") == 0 && value && parseList(value, options.intervalsMs))
+            {
+            }
+            else if (strcmp(arg, "--random") == 0 && value && atoi(value) > 0)
+            {
+                options.randomCount = atoi(value);
+            }
+            else if (strcmp(arg, "--sample-seed") == 0 && value)
+            {
+                options.sampleSeed = static_cast<uint32_t>(strtoul(value, NULL, 10));
+            }
+            else if (strcmp(arg, "--mode") == 0 && value && SimRun::findMode(value) != NULL)
+            {
+                options.mode = SimRun::findMode(value);
+            }
+            else if (strcmp(arg, "--explore") == 0 && value && parseExploration(value, options.exploration))
+            {
+            }
+            else if (strcmp(arg, "--crawler") == 0 && value &&
+                     (strcmp(value, "nominal") == 0 || strcmp(value, "long-arm") == 0))
+            {
+                options.longArm = strcmp(value, "long-arm") == 0;
+            }
+            else if (strcmp(arg, "--seeds") == 0 && value && atoi(value) > 0)
+            {
+                options.seeds = atoi(value);
+            }
+            else if (strcmp(arg, "--steps") == 0 && value && atoi(value) > 0)
+            {
+                options.steps = atoi(value);
+            }
+            else if (strcmp(arg, "--eval-every") == 0 && value && atoi(value) > 0)
+            {
+                options.evalEvery = atoi(value);
+            }
+            else if (strcmp(arg, "--threads") == 0 && value && atoi(value) > 0)
+            {
+                options.threads = atoi(value);
+            }
+            else if (strcmp(arg, "--rank") == 0 && value &&
+                     (strcmp(value, "converged") == 0 || strcmp(value, "speed") == 0))
+            {
+                options.rankBySpeed = strcmp(value, "speed") == 0;
+            }
+            else if (strcmp(arg, "--top") == 0 && value && atoi(value) > 0)
+            {
+                options.top = atoi(value);
+            }
+            else if (strcmp(arg, "--json") == 0 && value)
+            {
+                options.jsonPath = value;
+            }
+            else
+            {
+                fprintf(stderr,
+                        "usage: %s [--gamma LIST] [--eps-decay LIST] [--alpha-min LIST] [--interval-ms LIST] "
+                        "[--random N] [--sample-seed N] [--mode NAME] [--explore epsilon|ucb|softmax] "
+                        "[--crawler nominal|long-arm] [--seeds N] [--steps N] [--eval-every N] [--threads N] "
+                        "[--rank converged|speed] [--top N] [--json FILE]\n",
+                        argv[0]);
+                return false;
+            }
+            ++i;
+        }
+        return true;
+    }
+
+    uint32_t roundInterval(float intervalMs)
+    {
+        uint32_t periods = static_cast<uint32_t>(intervalMs) / kIntervalStepMs;
+        return (periods > 0 ? periods : 1) * kIntervalStepMs;
+    }
+
+    Training::Hyperparameters hyperparametersFor(const Options &options, const Combination &combination)
+    {
+        Training::Hyperparameters hyperparameters = Training::defaultHyperparameters();
+        SimRun::applyMode(*options.mode, hyperparameters);
+        hyperparameters.exploration = options.exploration;
+        hyperparameters.gamma = combination.gamma;
+        hyperparameters.epsilonDecay = combination.epsilonDecay;
+        hyperparameters.alphaMin = combination.alphaMin;
+        return hyperparameters;
+    }
+
+    SimRun::Settings settingsFor(const Options &options, const Combination &combination)
+    {
+        SimRun::Settings settings;
+        settings.crawler = SimRun::crawlerParams(options.longArm);
+        settings.crawler.intervalS = combination.intervalMs / 1000.0f;
+        settings.steps = options.steps;
+        settings.evalEvery = options.evalEvery;
+        return settings;
+    }
+
+    std::vector<Combination> gridCombinations(const Options &options)
+    {
+        std::vector<Combination> combinations;
+        for (float gamma : options.gammas)
+        {
+            for (float decay : options.epsilonDecays)
+            {
+                for (float alphaMin : options.alphaMins)
+                {
+                    for (float intervalMs : options.intervalsMs)
+                    {
+                        combinations.push_back({gamma, decay, alphaMin, roundInterval(intervalMs), 0.0f, 0.0f});
+                    }
+                }
+            }
+        }
+        return combinations;
+    }
+
+    float drawBetween(std::mt19937 &rng, const std::vector<float> &values)
+    {
+        float low = *std::min_element(values.begin(), values.end());
+        float high = *std::max_element(values.begin(), values.end());
+        return std::uniform_real_distribution<float>(low, high)(rng);
+    }
+
+    std::vector<Combination> randomCombinations(const Options &options)
+    {
+        std::mt19937 rng(options.sampleSeed);
+        std::vector<float> decayLogs;
+        for (float decay : options.epsilonDecays)
+        {
+            decayLogs.push_back(logf(1.0f - decay));
+        }
+        std::vector<Combination> combinations;
+        for (int i = 0; i < options.randomCount; ++i)
+        {
+            Combination combination = {};
+            combination.gamma = drawBetween(rng, options.gammas);
+            combination.epsilonDecay = 1.0f - expf(drawBetween(rng, decayLogs));
+            combination.alphaMin = drawBetween(rng, options.alphaMins);
+            combination.intervalMs = roundInterval(drawBetween(rng, options.intervalsMs));
+            combinations.push_back(combination);
+        }
+        return combinations;
+    }
+
+    double median(std::vector<double> values)
+    {
+        if (values.empty())
+        {
+            return -1.0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    Summary summarize(const SimRun::Result *runs, int count)
+    {
+        Summary summary = {};
+        std::vector<double> convergedSteps;
+        std::vector<double> convergedSeconds;
+        std::vector<double> endSteps;
+        std::vector<double> endSeconds;
+        for (int i = 0; i < count; ++i)
+        {
+            if (runs[i].convergedStep >= 0)
+            {
+                convergedSteps.push_back(runs[i].convergedStep);
+                convergedSeconds.push_back(runs[i].convergedS);
+            }
+            endSteps.push_back(runs[i].endStep);
+            endSeconds.push_back(runs[i].endS);
+            summary.meanFinalRate += runs[i].finalRate.cmPerStep;
+            summary.meanFinalSpeed += runs[i].finalRate.cmPerS;
+        }
+        summary.converged = static_cast<int>(convergedSteps.size());
+        summary.medianConvergedStep = median(convergedSteps);
+        summary.medianConvergedMinutes = summary.converged > 0 ? median(convergedSeconds) / 60.0 : -1.0;
+        summary.medianEndStep = median(endSteps);
+        summary.medianEndMinutes = median(endSeconds) / 60.0;
+        summary.meanFinalRate /= count;
+        summary.meanFinalSpeed /= count;
+        return summary;
+    }
+
+    // More converged runs first, then sooner in minutes, then faster;
+    // or by speed alone
+    bool ranksBefore(const Summary &a, const Summary &b, bool bySpeed)
+    {
+        if (bySpeed && a.meanFinalSpeed != b.meanFinalSpeed)
+        {
+            return a.meanFinalSpeed > b.meanFinalSpeed;
+        }
+        if (a.converged != b.converged)
+        {
+            return a.converged > b.converged;
+        }
+        if (a.medianConvergedMinutes != b.medianConvergedMinutes)
+        {
+            return a.medianConvergedMinutes < b.medianConvergedMinutes;
+        }
+        return a.meanFinalSpeed > b.meanFinalSpeed;
+    }
+
+    bool isDefault(const Combination &combination)
+    {
+        Training::Hyperparameters defaults = Training::defaultHyperparameters();
+        return fabsf(combination.gamma - defaults.gamma) < 1e-6f &&
+               fabsf(combination.epsilonDecay - defaults.epsilonDecay) < 1e-7f &&
+               fabsf(combination.alphaMin - defaults.alphaMin) < 1e-6f && combination.intervalMs == 500;
+    }
+
+    void writeJson(FILE *out, const Options &options, const std::vector<Combination> &combinations,
+                   const std::vector<Summary> &summaries, const std::vector<size_t> &order)
+    {
+        fprintf(out,
+                "{\n  \"schema\": 1,\n  \"mode\": \"%s\",\n  \"explore\": \"%s\",\n  \"crawler\": \"%s\",\n"
+                "  \"search\": \"%s\",\n  \"seeds\": %d,\n  \"steps\": %d,\n",
+                options.mode->name, kExplorationNames[options.exploration], options.longArm ? "long-arm" : "nominal",
+                options.randomCount > 0 ? "random" : "grid", options.seeds, options.steps);
+        fprintf(out, "  \"combinations\": [\n");
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            const Combination &c = combinations[order[i]];
+            const Summary &s = summaries[order[i]];
+            fprintf(out,
+                    "    {\"gamma\": %.4f, \"eps_decay\": %.6f, \"alpha_min\": %.4f, \"interval_ms\": %u, "
+                    "\"converged\": %d, \"median_converged_step\": %.0f, \"median_converged_minutes\": %.2f, "
+                    "\"median_end_step\": %.0f, \"median_end_minutes\": %.2f, \"final_cm_per_step\": %.4f, \"final_cm_per_s\": %.4f, "
+                    "\"best_cm_per_step\": %.4f}%s\n",
+                    c.gamma, c.epsilonDecay, c.alphaMin, c.intervalMs, s.converged, s.medianConvergedStep,
+                    s.medianConvergedMinutes, s.medianEndStep, s.medianEndMinutes, s.meanFinalRate, s.meanFinalSpeed,
+                    c.bestCmPerStep, i + 1 < order.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    Training::Hyperparameters defaults = Training::defaultHyperparameters();
+    options.gammas.push_back(defaults.gamma);
+    options.epsilonDecays.push_back(defaults.epsilonDecay);
+    options.alphaMins.push_back(defaults.alphaMin);
+    options.intervalsMs.push_back(500.0f);
+    if (!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+    Serial.setMuted(true);
+    HostClock::setManual(true);
+
+    std::vector<Combination> combinations =
+        options.randomCount > 0 ? randomCombinations(options) : gridCombinations(options);
+    for (Combination &combination : combinations)
+    {
+        Training probe;
+        Training::Hyperparameters hyperparameters = hyperparametersFor(options, combination);
+        if (combination.epsilonDecay >= 1.0f || !probe.configure(hyperparameters))
+        {
+            fprintf(stderr, "invalid combination: gamma %g, epsilon decay %g, alpha floor %g\n", combination.gamma,
+                    combination.epsilonDecay, combination.alphaMin);
+            return 2;
+        }
+        SimRun::Rate best = SimRun::bestRate(hyperparameters, settingsFor(options, combination).crawler);
+        combination.targetCms = SimRun::kConvergedFraction * best.cmPerS;
+        combination.bestCmPerStep = best.cmPerStep;
+    }
+
+    // One job per combination and seed, handed out in order
+    const size_t jobs = combinations.size() * options.seeds;
+    std::vector<SimRun::Result> results(jobs);
+    std::atomic<size_t> nextJob(0);
+    std::atomic<size_t> doneJobs(0);
+    int threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, static_cast<int>(jobs)));
+    auto work = [&]()
+    {
+        for (size_t job = nextJob++; job < jobs; job = nextJob++)
+        {
+            const Combination &combination = combinations[job / options.seeds];
+            uint32_t seed = static_cast<uint32_t>(job % options.seeds) + 1;
+            results[job] = SimRun::runOnce(hyperparametersFor(options, combination), seed,
+                                           settingsFor(options, combination), combination.targetCms);
+            size_t done = ++doneJobs;
+            if (jobs >= kProgressMinJobs && done * 10 / jobs != (done - 1) * 10 / jobs)
+            {
+                fprintf(stderr, "%zu/%zu runs\n", done, jobs);
+            }
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<Summary> summaries;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < combinations.size(); ++i)
+    {
+        summaries.push_back(summarize(&results[i * options.seeds], options.seeds));
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return ranksBefore(summaries[a], summaries[b], options.rankBySpeed); });
+
+    printf("%zu combinations x %d seeds of %s on %d threads in %.1f s\n", combinations.size(), options.seeds,
+           options.mode->name, threads, seconds);
+    printf(" gamma  epsDecay  alphaMin  ctrlMs  converged  median step   minutes   ends (min)  final cm/step  cm/s (best)\n");
+    size_t shown = options.top > 0 ? std::min(order.size(), static_cast<size_t>(options.top)) : order.size();
+    for (size_t i = 0; i < shown; ++i)
+    {
+        const Combination &c = combinations[order[i]];
+        const Summary &s = summaries[order[i]];
+        printf("%6.3f  %8.6f  %8.3f  %6u  %4d/%-4d  %11.0f  %8.1f  %5.0f (%4.1f)  %6.3f (%.3f)  %5.2f (%.2f)%s\n",
+               c.gamma, c.epsilonDecay, c.alphaMin, c.intervalMs, s.converged, options.seeds, s.medianConvergedStep,
+               s.medianConvergedMinutes, s.medianEndStep, s.medianEndMinutes, s.meanFinalRate, c.bestCmPerStep,
+               s.meanFinalSpeed, c.targetCms / SimRun::kConvergedFraction, isDefault(c) ? "  (defaults)" : "");
+    }
+
+    if (options.jsonPath)
+    {
+        FILE *out = fopen(options.jsonPath, "w");
+        if (out == NULL)
+        {
+            perror(options.jsonPath);
+            return 1;
+        }
+        writeJson(out, options, combinations, summaries, order);
+        fclose(out);
+    }
+    return 0;
+}
@@ -19,11 +19,9 @@
 
 // Network Configuration
 #define AP_PASSWORD "12345678"
-#define SERIAL_BAUD_RATE 115200
+#define SERIAL_BAUD_RATE 921600
 
-// EEPROM Configuration
-#define EEPROM_SIZE 1
-#define ROBOT_NUM_ADDR 0
+// Robot number range (stored in NVS by ConfigStore)
 #define MIN_ROBOT_NUM 1
 #define MAX_ROBOT_NUM 8
 
@@ -1,17 +1,15 @@
 #include "AHRS.h"
+#include <Profiler.h>
+
+static Profiler::Probe updateProbe("ahrs.update");
 
 AHRS::AHRS() : initialized(false), isStatic(true), stationaryStartTime(0)
 {
-    mpu = new MPU9250();
+    mpu = mpuSlot.construct();
     for (int i = 0; i < 3; i++)
         velocity[i] = position[i] = linearAccel[i] = 0;
 }
 
-AHRS::~AHRS()
-{
-    delete mpu;
-}
-
 bool AHRS::begin()
 {
     Wire.begin();
@@ -31,8 +29,35 @@ void AHRS::calibrate()
     mpu->calibrateMag();
 }
 
+AHRS::Calibration AHRS::getCalibration()
+{
+    Calibration calibration = {};
+    calibration.accelBias[0] = mpu->getAccBiasX();
+    calibration.accelBias[1] = mpu->getAccBiasY();
+    calibration.accelBias[2] = mpu->getAccBiasZ();
+    calibration.gyroBias[0] = mpu->getGyroBiasX();
+    calibration.gyroBias[1] = mpu->getGyroBiasY();
+    calibration.gyroBias[2] = mpu->getGyroBiasZ();
+    calibration.magBias[0] = mpu->getMagBiasX();
+    calibration.magBias[1] = mpu->getMagBiasY();
+    calibration.magBias[2] = mpu->getMagBiasZ();
+    calibration.magScale[0] = mpu->getMagScaleX();
+    calibration.magScale[1] = mpu->getMagScaleY();
+    calibration.magScale[2] = mpu->getMagScaleZ();
+    return calibration;
+}
+
+void AHRS::applyCalibration(const Calibration &calibration)
+{
+    mpu->setAccBias(calibration.accelBias[0], calibration.accelBias[1], calibration.accelBias[2]);
+    mpu->setGyroBias(calibration.gyroBias[0], calibration.gyroBias[1], calibration.gyroBias[2]);
+    mpu->setMagBias(calibration.magBias[0], calibration.magBias[1], calibration.magBias[2]);
+    mpu->setMagScale(calibration.magScale[0], calibration.magScale[1], calibration.magScale[2]);
+}
+
 void AHRS::update()
 {
+    PROFILE_SCOPE(updateProbe);
     if (!initialized || !mpu->update())
         return;
 
@@ -4,17 +4,28 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <MPU9250.h>
+#include <DriverSlot.h>
 #include <math.h>
 
 
 class AHRS
 {
 public:
+    // Sensor biases/scales found by calibrate(), so they can be stored and reapplied
+    struct Calibration
+    {
+        float accelBias[3];
+        float gyroBias[3];
+        float magBias[3];
+        float magScale[3];
+    };
+
     AHRS();
-    ~AHRS();
     bool begin();
     void update();
     void calibrate();
+    Calibration getCalibration();
+    void applyCalibration(const Calibration &calibration);
 
     // Motion detection
     bool isMoving();
@@ -66,6 +77,7 @@ public:
     float getTemperature() { return initialized ? mpu->getTemperature() : 0; }
 
 private:
+    DriverSlot<MPU9250> mpuSlot;
     MPU9250 *mpu;
     bool initialized;
     bool isStatic;
@@ -0,0 +1,113 @@
+#include "BootProfiler.h"
+
+BootProfiler::BootProfiler()
+    : phaseCount(0),
+      concurrent(false),
+      doneBits(NULL),
+      firstStepUs(0),
+      firstStepTraining(false)
+{
+}
+
+void BootProfiler::setConcurrent(bool concurrent)
+{
+    this->concurrent = concurrent;
+    if (concurrent && doneBits == NULL)
+    {
+        doneBits = xEventGroupCreate();
+        if (doneBits == NULL)
+        {
+            Serial.println("Boot: no event group, running phases inline");
+            this->concurrent = false;
+        }
+    }
+}
+
+uint8_t BootProfiler::beginPhase(const char *name)
+{
+    if (phaseCount >= MAX_PHASES)
+    {
+        return NO_PHASE;
+    }
+    Phase &phase = phases[phaseCount];
+    phase.name = name;
+    phase.startUs = micros();
+    phase.endUs = 0;
+    phase.concurrent = false;
+    return phaseCount++;
+}
+
+void BootProfiler::endPhase(uint8_t index)
+{
+    if (index < phaseCount)
+    {
+        phases[index].endUs = micros();
+    }
+}
+
+uint8_t BootProfiler::run(const char *name, PhaseFunction function, void *context, BaseType_t core,
+                          uint32_t stackSize)
+{
+    uint8_t index = beginPhase(name);
+    if (index == NO_PHASE)
+    {
+        function(context);
+        return NO_PHASE;
+    }
+
+    if (concurrent)
+    {
+        Job &job = jobs[index];
+        job.profiler = this;
+        job.index = index;
+        job.function = function;
+        job.context = context;
+        phases[index].concurrent = true;
+        if (xTaskCreatePinnedToCore(phaseTask, name, stackSize, &job, 1, NULL, core) == pdPASS)
+        {
+            return index;
+        }
+        Serial.print("Boot: could not start task for ");
+        Serial.println(name);
+        phases[index].concurrent = false;
+    }
+
+    function(context);
+    endPhase(index);
+    return index;
+}
+
+void BootProfiler::phaseTask(void *parameter)
+{
+    Job *job = static_cast<Job *>(parameter);
+    job->function(job->context);
+    job->profiler->endPhase(job->index);
+    xEventGroupSetBits(job->profiler->doneBits, 1u << job->index);
+    vTaskDelete(NULL);
+}
+
+void BootProfiler::wait(uint8_t index)
+{
+    if (index >= phaseCount || !phases[index].concurrent)
+    {
+        return;
+    }
+    xEventGroupWaitBits(doneBits, 1u << index, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+void BootProfiler::waitAll()
+{
+    for (uint8_t i = 0; i < phaseCount; ++i)
+    {
+        wait(i);
+    }
+}
+
+void BootProfiler::markFirstStep(uint32_t atUs, bool training)
+{
+    if (firstStepUs == 0)
+    {
+        firstStepUs = atUs;
+        firstStepTraining = training;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+
+// Times the phases of setup() and optionally runs them concurrently.
+//
+// In concurrent mode run() starts each phase on its own task and returns
+// at once; wait() blocks until a given phase is done. Otherwise run()
+// executes the phase inline and wait() returns immediately, so setup()
+// can be written once for both modes. Times are micros() since reset.
+class BootProfiler
+{
+public:
+    typedef void (*PhaseFunction)(void *context);
+
+    struct Phase
+    {
+        const char *name;
+        uint32_t startUs;
+        uint32_t endUs;
+        bool concurrent;
+    };
+
+    static const uint8_t MAX_PHASES = 16;
+    static const uint8_t NO_PHASE = 0xFF;
+
+    BootProfiler();
+    void setConcurrent(bool concurrent);
+    bool isConcurrent() const { return concurrent; }
+
+    // Phases run inline on the calling task
+    uint8_t beginPhase(const char *name);
+    void endPhase(uint8_t index);
+
+    // Phases that may run on their own task, pinned to core
+    uint8_t run(const char *name, PhaseFunction function, void *context, BaseType_t core,
+                uint32_t stackSize = 4096);
+    void wait(uint8_t index);
+    void waitAll();
+
+    void markFirstStep(uint32_t atUs, bool training);
+    bool hasFirstStep() const { return firstStepUs != 0; }
+    uint32_t getFirstStepUs() const { return firstStepUs; }
+    bool wasFirstStepTraining() const { return firstStepTraining; }
+
+    uint8_t getPhaseCount() const { return phaseCount; }
+    const Phase &getPhase(uint8_t index) const { return phases[index]; }
+
+private:
+    struct Job
+    {
+        BootProfiler *profiler;
+        uint8_t index;
+        PhaseFunction function;
+        void *context;
+    };
+
+    Phase phases[MAX_PHASES];
+    Job jobs[MAX_PHASES];
+    uint8_t phaseCount;
+    bool concurrent;
+    EventGroupHandle_t doneBits;
+    uint32_t firstStepUs;
+    bool firstStepTraining;
+
+    static void phaseTask(void *parameter);
+};
+
+#endif // BOOT_PROFILER_H
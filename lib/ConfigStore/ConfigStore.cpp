@@ -0,0 +1,423 @@
+#include "ConfigStore.h"
+#include <EEPROM.h>
+#include <stdlib.h>
+
+const char *ConfigStore::NAMESPACE = "rlbot";
+
+namespace
+{
+    const char kKeySchema[] = "schema";
+    const char kKeyRobot[] = "robot";
+    const char kKeyGamma[] = "gamma";
+    const char kKeyEpsilonStart[] = "epsStart";
+    const char kKeyEpsilonMin[] = "epsMin";
+    const char kKeyEpsilonDecay[] = "epsDecay";
+    const char kKeyDownAngles[] = "downAng";
+    const char kKeyUpAngles[] = "upAng";
+    const char kKeyInterval[] = "ctrlMs";
+    const char kKeyCalibration[] = "calib";
+    const char kKeyFeatures[] = "features";
+    const char kKeyBoot[] = "boot";
+    const char kKeyStorage[] = "storage";
+    const char kKeyValueFunction[] = "valueFn";
+    const char kKeyReturnSteps[] = "nStep";
+    const char kKeyDoubleQ[] = "doubleQ";
+    const char kKeyExploration[] = "explore";
+    const char kKeyWarmStart[] = "warm";
+    const char kKeyAlphaMin[] = "alphaMin";
+    const char kKeyServiceCore[] = "netCore";
+    const char kKeyServicePriority[] = "netPrio";
+    const char *const kExplorationNames[] = {"epsilon", "ucb", "softmax"};
+    const char *const kValueFunctionNames[] = {"table", "tiles", "tiles-speed", "hashed", "network"};
+
+    // describe() at its longest: each key with '=' (counted by the key's
+    // terminator), the widest value set() accepts and a newline
+    const size_t kAnglesWidth = 3 * 6 + 2;
+    const size_t kDescribeLength =
+        sizeof(kKeyRobot) + 3 + 1 + sizeof(kKeyGamma) + 6 + 1 + sizeof(kKeyEpsilonStart) + 6 + 1 +
+        sizeof(kKeyEpsilonMin) + 6 + 1 + sizeof(kKeyEpsilonDecay) + 8 + 1 +
+        sizeof(kKeyDownAngles) + kAnglesWidth + 1 + sizeof(kKeyUpAngles) + kAnglesWidth + 1 +
+        sizeof(kKeyValueFunction) + sizeof("tiles-speed") + sizeof(kKeyReturnSteps) + 3 + 1 +
+        sizeof(kKeyDoubleQ) + 1 + 1 + sizeof(kKeyExploration) + sizeof("softmax") +
+        sizeof(kKeyWarmStart) + 4 + 1 + sizeof(kKeyAlphaMin) + 5 + 1 + sizeof(kKeyInterval) + 5 + 1 +
+        sizeof(kKeyCalibration) + sizeof("stored") + sizeof(kKeyFeatures) + 10 + 1 +
+        sizeof(kKeyBoot) + sizeof("full") + sizeof(kKeyStorage) + sizeof("partition") +
+        sizeof(kKeyServiceCore) + 1 + 1 + sizeof(kKeyServicePriority) + 1 + 1 +
+        sizeof("reboot_pending") + 1 + 1;
+
+    // The 1-byte EEPROM region used before the config store existed
+    const size_t kLegacyEepromSize = 1;
+    const int kLegacyRobotAddr = 0;
+
+    bool parseFloat(const char *value, float &out)
+    {
+        char *end = NULL;
+        float parsed = strtof(value, &end);
+        if (end == value || *end != '\0')
+        {
+            return false;
+        }
+        out = parsed;
+        return true;
+    }
+}
+
+ConfigStore::ConfigStore() : cache(defaults()), ready(false), rebootPending(false)
+{
+}
+
+RobotConfig ConfigStore::defaults()
+{
+    RobotConfig config = {};
+    config.robotNumber = 0;
+    config.training = Training::defaultHyperparameters();
+    config.controlIntervalMs = DEFAULT_CONTROL_INTERVAL_MS;
+    config.hasCalibration = false;
+    config.features = DEFAULT_FEATURES;
+    config.bootProfile = BOOT_PROFILE_FULL;
+    config.modelStorage = MODEL_STORAGE_SPIFFS;
+    config.serviceCore = DEFAULT_SERVICE_CORE;
+    config.servicePriority = DEFAULT_SERVICE_PRIORITY;
+    return config;
+}
+
+bool ConfigStore::begin()
+{
+    ready = prefs.begin(NAMESPACE, false);
+    if (!ready)
+    {
+        Serial.println("Config store unavailable, using defaults");
+        return false;
+    }
+
+    if (!prefs.isKey(kKeySchema))
+    {
+        prefs.putUShort(kKeySchema, SCHEMA_VERSION);
+        uint8_t legacy = readLegacyRobotNumber();
+        if (legacy != 0)
+        {
+            prefs.putUChar(kKeyRobot, legacy);
+            Serial.println("Migrated robot number from EEPROM");
+        }
+    }
+
+    load();
+    Serial.println("Config store loaded");
+    return true;
+}
+
+void ConfigStore::load()
+{
+    RobotConfig config = defaults();
+
+    uint8_t robot = prefs.getUChar(kKeyRobot, 0);
+    config.robotNumber = (robot >= MIN_ROBOT_NUMBER && robot <= MAX_ROBOT_NUMBER) ? robot : 0;
+
+    config.training.gamma = prefs.getFloat(kKeyGamma, config.training.gamma);
+    config.training.epsilonStart = prefs.getFloat(kKeyEpsilonStart, config.training.epsilonStart);
+    config.training.epsilonMin = prefs.getFloat(kKeyEpsilonMin, config.training.epsilonMin);
+    config.training.epsilonDecay = prefs.getFloat(kKeyEpsilonDecay, config.training.epsilonDecay);
+
+    int16_t angles[Training::kDownActionCount > Training::kUpActionCount
+                       ? Training::kDownActionCount
+                       : Training::kUpActionCount];
+    if (prefs.getBytesLength(kKeyDownAngles) == sizeof(int16_t) * Training::kDownActionCount &&
+        prefs.getBytes(kKeyDownAngles, angles, sizeof(int16_t) * Training::kDownActionCount))
+    {
+        for (int i = 0; i < Training::kDownActionCount; ++i)
+        {
+            config.training.downAngleOptions[i] = angles[i];
+        }
+    }
+    if (prefs.getBytesLength(kKeyUpAngles) == sizeof(int16_t) * Training::kUpActionCount &&
+        prefs.getBytes(kKeyUpAngles, angles, sizeof(int16_t) * Training::kUpActionCount))
+    {
+        for (int i = 0; i < Training::kUpActionCount; ++i)
+        {
+            config.training.upAngleOptions[i] = angles[i];
+        }
+    }
+
+    uint8_t valueFunction = prefs.getUChar(kKeyValueFunction, Training::VALUE_TABLE);
+    if (valueFunction <= Training::VALUE_NETWORK)
+    {
+        config.training.valueFunction = static_cast<Training::ValueFunction>(valueFunction);
+    }
+    uint8_t returnSteps = prefs.getUChar(kKeyReturnSteps, config.training.returnSteps);
+    if (returnSteps >= 1 && returnSteps <= Training::kMaxReturnSteps)
+    {
+        config.training.returnSteps = returnSteps;
+    }
+    config.training.doubleQ = prefs.getBool(kKeyDoubleQ, config.training.doubleQ);
+    uint8_t exploration = prefs.getUChar(kKeyExploration, Training::EXPLORE_EPSILON);
+    if (exploration <= Training::EXPLORE_SOFTMAX)
+    {
+        config.training.exploration = static_cast<Training::Exploration>(exploration);
+    }
+    config.training.warmStart = prefs.getFloat(kKeyWarmStart, config.training.warmStart);
+    config.training.alphaMin = prefs.getFloat(kKeyAlphaMin, config.training.alphaMin);
+    config.controlIntervalMs = prefs.getUShort(kKeyInterval, config.controlIntervalMs);
+    if (prefs.getBytesLength(kKeyCalibration) == sizeof(AHRS::Calibration))
+    {
+        config.hasCalibration =
+            prefs.getBytes(kKeyCalibration, &config.calibration, sizeof(AHRS::Calibration)) ==
+            sizeof(AHRS::Calibration);
+    }
+    config.features = prefs.getUInt(kKeyFeatures, config.features);
+    config.bootProfile = prefs.getUChar(kKeyBoot, BOOT_PROFILE_FULL) == BOOT_PROFILE_FAST
+                             ? BOOT_PROFILE_FAST
+                             : BOOT_PROFILE_FULL;
+    uint8_t storage = prefs.getUChar(kKeyStorage, MODEL_STORAGE_SPIFFS);
+    config.modelStorage = storage < MODEL_STORAGE_KIND_COUNT ? static_cast<ModelStorageKind>(storage)
+                                                              : MODEL_STORAGE_SPIFFS;
+    uint8_t serviceCore = prefs.getUChar(kKeyServiceCore, config.serviceCore);
+    config.serviceCore = serviceCore <= 1 ? serviceCore : DEFAULT_SERVICE_CORE;
+    uint8_t servicePriority = prefs.getUChar(kKeyServicePriority, config.servicePriority);
+    if (servicePriority >= 1 && servicePriority <= MAX_SERVICE_PRIORITY)
+    {
+        config.servicePriority = servicePriority;
+    }
+
+    cache = config;
+}
+
+uint8_t ConfigStore::readLegacyRobotNumber()
+{
+    if (!EEPROM.begin(kLegacyEepromSize))
+    {
+        return 0;
+    }
+    uint8_t number = EEPROM.read(kLegacyRobotAddr);
+    EEPROM.end();
+    return (number >= MIN_ROBOT_NUMBER && number <= MAX_ROBOT_NUMBER) ? number : 0;
+}
+
+bool ConfigStore::setRobotNumber(uint8_t number)
+{
+    if (number < MIN_ROBOT_NUMBER || number > MAX_ROBOT_NUMBER)
+    {
+        return false;
+    }
+    if (ready && prefs.putUChar(kKeyRobot, number) != sizeof(uint8_t))
+    {
+        return false;
+    }
+    cache.robotNumber = number;
+    rebootPending = true; // SSID and OTA hostname are derived at boot
+    return ready;
+}
+
+bool ConfigStore::setCalibration(const AHRS::Calibration &calibration)
+{
+    if (!ready || prefs.putBytes(kKeyCalibration, &calibration, sizeof(calibration)) != sizeof(calibration))
+    {
+        return false;
+    }
+    cache.calibration = calibration;
+    cache.hasCalibration = true;
+    return true;
+}
+
+bool ConfigStore::parseAngles(const char *value, int *angles, int count)
+{
+    const char *cursor = value;
+    for (int i = 0; i < count; ++i)
+    {
+        char *end = NULL;
+        long angle = strtol(cursor, &end, 10);
+        if (end == cursor || angle < 0 || angle > 180)
+        {
+            return false;
+        }
+        angles[i] = static_cast<int>(angle);
+        cursor = end;
+        if (i < count - 1)
+        {
+            if (*cursor != ',')
+            {
+                return false;
+            }
+            ++cursor;
+        }
+    }
+    return *cursor == '\0';
+}
+
+bool ConfigStore::set(const char *key, const char *value)
+{
+    if (!ready || key == NULL || value == NULL)
+    {
+        return false;
+    }
+
+    float number = 0.0f;
+    bool stored = false;
+    if (strcmp(key, kKeyRobot) == 0)
+    {
+        int robot = atoi(value);
+        return robot >= MIN_ROBOT_NUMBER && robot <= MAX_ROBOT_NUMBER &&
+               setRobotNumber(static_cast<uint8_t>(robot));
+    }
+    else if (strcmp(key, kKeyGamma) == 0)
+    {
+        stored = parseFloat(value, number) && number >= 0.0f && number < 1.0f &&
+                 prefs.putFloat(kKeyGamma, number) == sizeof(float);
+    }
+    else if (strcmp(key, kKeyEpsilonStart) == 0 || strcmp(key, kKeyEpsilonMin) == 0)
+    {
+        if (!parseFloat(value, number) || number < 0.0f || number > 1.0f)
+        {
+            return false;
+        }
+        // Training rejects a schedule that starts below its floor, and every
+        // other stored setting with it, so check against the other end
+        const Training::Hyperparameters training = Training::defaultHyperparameters();
+        bool isStart = strcmp(key, kKeyEpsilonStart) == 0;
+        float start = isStart ? number : prefs.getFloat(kKeyEpsilonStart, training.epsilonStart);
+        float minimum = isStart ? prefs.getFloat(kKeyEpsilonMin, training.epsilonMin) : number;
+        if (start < minimum)
+        {
+            Serial.printf("Config %s rejected: epsStart %.3f is below epsMin %.3f\n", key, start, minimum);
+            return false;
+        }
+        stored = prefs.putFloat(key, number) == sizeof(float);
+    }
+    else if (strcmp(key, kKeyEpsilonDecay) == 0)
+    {
+        stored = parseFloat(value, number) && number > 0.0f && number <= 1.0f &&
+                 prefs.putFloat(kKeyEpsilonDecay, number) == sizeof(float);
+    }
+    else if (strcmp(key, kKeyDownAngles) == 0 || strcmp(key, kKeyUpAngles) == 0)
+    {
+        int count = (strcmp(key, kKeyDownAngles) == 0) ? Training::kDownActionCount : Training::kUpActionCount;
+        int angles[Training::kDownActionCount + Training::kUpActionCount];
+        int16_t packed[Training::kDownActionCount + Training::kUpActionCount];
+        if (parseAngles(value, angles, count))
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                packed[i] = static_cast<int16_t>(angles[i]);
+            }
+            stored = prefs.putBytes(key, packed, sizeof(int16_t) * count) == sizeof(int16_t) * count;
+        }
+    }
+    else if (strcmp(key, kKeyInterval) == 0)
+    {
+        long interval = atol(value);
+        stored = interval >= 50 && interval <= 10000 &&
+                 prefs.putUShort(kKeyInterval, static_cast<uint16_t>(interval)) == sizeof(uint16_t);
+    }
+    else if (strcmp(key, kKeyFeatures) == 0)
+    {
+        char *end = NULL;
+        unsigned long features = strtoul(value, &end, 0);
+        stored = end != value && *end == '\0' &&
+                 prefs.putUInt(kKeyFeatures, static_cast<uint32_t>(features)) == sizeof(uint32_t);
+    }
+    else if (strcmp(key, kKeyBoot) == 0)
+    {
+        bool fast = strcmp(value, "fast") == 0;
+        stored = (fast || strcmp(value, "full") == 0) &&
+                 prefs.putUChar(kKeyBoot, fast ? BOOT_PROFILE_FAST : BOOT_PROFILE_FULL) == sizeof(uint8_t);
+    }
+    else if (strcmp(key, kKeyValueFunction) == 0)
+    {
+        for (uint8_t i = 0; i <= Training::VALUE_NETWORK && !stored; ++i)
+        {
+            stored = strcmp(value, kValueFunctionNames[i]) == 0 &&
+                     prefs.putUChar(kKeyValueFunction, i) == sizeof(uint8_t);
+        }
+    }
+    else if (strcmp(key, kKeyReturnSteps) == 0)
+    {
+        long steps = atol(value);
+        stored = steps >= 1 && steps <= Training::kMaxReturnSteps &&
+                 prefs.putUChar(kKeyReturnSteps, static_cast<uint8_t>(steps)) == sizeof(uint8_t);
+    }
+    else if (strcmp(key, kKeyDoubleQ) == 0)
+    {
+        bool on = strcmp(value, "1") == 0;
+        stored = (on || strcmp(value, "0") == 0) && prefs.putBool(kKeyDoubleQ, on) == sizeof(bool);
+    }
+    else if (strcmp(key, kKeyExploration) == 0)
+    {
+        for (uint8_t i = 0; i <= Training::EXPLORE_SOFTMAX && !stored; ++i)
+        {
+            stored = strcmp(value, kExplorationNames[i]) == 0 &&
+                     prefs.putUChar(kKeyExploration, i) == sizeof(uint8_t);
+        }
+    }
+    else if (strcmp(key, kKeyWarmStart) == 0)
+    {
+        stored = parseFloat(value, number) && number >= 0.0f && number < 1.0f &&
+                 prefs.putFloat(kKeyWarmStart, number) == sizeof(float);
+    }
+    else if (strcmp(key, kKeyAlphaMin) == 0)
+    {
+        stored = parseFloat(value, number) && number >= 0.0f && number <= 1.0f &&
+                 prefs.putFloat(kKeyAlphaMin, number) == sizeof(float);
+    }
+    else if (strcmp(key, kKeyStorage) == 0)
+    {
+        ModelStorageKind kind;
+        stored = ModelStorage::parseKind(value, kind) &&
+                 prefs.putUChar(kKeyStorage, kind) == sizeof(uint8_t);
+    }
+    else if (strcmp(key, kKeyServiceCore) == 0)
+    {
+        bool core1 = strcmp(value, "1") == 0;
+        stored = (core1 || strcmp(value, "0") == 0) &&
+                 prefs.putUChar(kKeyServiceCore, core1 ? 1 : 0) == sizeof(uint8_t);
+    }
+    else if (strcmp(key, kKeyServicePriority) == 0)
+    {
+        long priority = atol(value);
+        stored = priority >= 1 && priority <= MAX_SERVICE_PRIORITY &&
+                 prefs.putUChar(kKeyServicePriority, static_cast<uint8_t>(priority)) == sizeof(uint8_t);
+    }
+    else if (strcmp(key, kKeyCalibration) == 0 && strcmp(value, "clear") == 0)
+    {
+        stored = prefs.remove(kKeyCalibration);
+    }
+
+    if (stored)
+    {
+        rebootPending = true;
+    }
+    return stored;
+}
+
+size_t ConfigStore::describe(char *buffer, size_t size) const
+{
+    static_assert(Training::kDownActionCount == 3 && Training::kUpActionCount == 3,
+                  "describe() prints three angles per joint");
+    static_assert(kDescribeLength < DESCRIBE_SIZE, "DESCRIBE_SIZE no longer fits every key");
+    const Training::Hyperparameters &t = cache.training;
+    int written = snprintf(buffer, size,
+                           "%s=%u\n%s=%.4f\n%s=%.4f\n%s=%.4f\n%s=%.6f\n"
+                           "%s=%d,%d,%d\n%s=%d,%d,%d\n%s=%s\n%s=%u\n%s=%d\n%s=%s\n%s=%.2f\n%s=%.3f\n"
+                           "%s=%u\n%s=%s\n%s=0x%08X\n%s=%s\n%s=%s\n%s=%u\n%s=%u\n"
+                           "reboot_pending=%d\n",
+                           kKeyRobot, cache.robotNumber,
+                           kKeyGamma, t.gamma,
+                           kKeyEpsilonStart, t.epsilonStart,
+                           kKeyEpsilonMin, t.epsilonMin,
+                           kKeyEpsilonDecay, t.epsilonDecay,
+                           kKeyDownAngles, t.downAngleOptions[0], t.downAngleOptions[1], t.downAngleOptions[2],
+                           kKeyUpAngles, t.upAngleOptions[0], t.upAngleOptions[1], t.upAngleOptions[2],
+                           kKeyValueFunction, kValueFunctionNames[t.valueFunction],
+                           kKeyReturnSteps, t.returnSteps,
+                           kKeyDoubleQ, t.doubleQ ? 1 : 0,
+                           kKeyExploration, kExplorationNames[t.exploration],
+                           kKeyWarmStart, t.warmStart,
+                           kKeyAlphaMin, t.alphaMin,
+                           kKeyInterval, cache.controlIntervalMs,
+                           kKeyCalibration, cache.hasCalibration ? "stored" : "none",
+                           kKeyFeatures, static_cast<unsigned>(cache.features),
+                           kKeyBoot, cache.bootProfile == BOOT_PROFILE_FAST ? "fast" : "full",
+                           kKeyStorage, ModelStorage::kindName(cache.modelStorage),
+                           kKeyServiceCore, cache.serviceCore,
+                           kKeyServicePriority, cache.servicePriority,
+                           rebootPending ? 1 : 0);
+    return written < 0 ? 0 : static_cast<size_t>(written);
+}
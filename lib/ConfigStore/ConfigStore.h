@@ -0,0 +1,93 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <AHRS.h>
+#include <Training.h>
+
+// Feature toggles; the defaults reproduce the original boot sequence.
+enum ConfigFeature : uint32_t
+{
+    FEATURE_TRAINING = 1u << 0,
+    FEATURE_ANGLE_SWEEP = 1u << 1,
+    FEATURE_HEALTH_CHECK = 1u << 2,
+    FEATURE_WAVE_DEMO = 1u << 3,
+    FEATURE_REUSE_CALIBRATION = 1u << 4,
+    FEATURE_PAUSE_NETWORK_DURING_TICKS = 1u << 5,
+    FEATURE_TRANSITION_LOG = 1u << 6,
+};
+
+// How setup() brings the robot up. FULL is the original sequence with
+// splash screens and the demos enabled in features; FAST initialises in
+// parallel, skips the demos and reuses a stored calibration when present.
+enum BootProfile : uint8_t
+{
+    BOOT_PROFILE_FULL = 0,
+    BOOT_PROFILE_FAST = 1,
+};
+
+struct RobotConfig
+{
+    uint8_t robotNumber; // 0 until provisioned
+    Training::Hyperparameters training;
+    uint16_t controlIntervalMs;
+    bool hasCalibration;
+    AHRS::Calibration calibration;
+    uint32_t features;
+    BootProfile bootProfile;
+    ModelStorageKind modelStorage; // where Training keeps the model
+    uint8_t serviceCore;           // for Network::startServiceTask()
+    uint8_t servicePriority;
+};
+
+// NVS-backed key/value configuration. Everything is read once in begin();
+// get() then serves the cached copy without touching flash or the heap.
+class ConfigStore
+{
+public:
+    static const uint8_t MIN_ROBOT_NUMBER = 1;
+    static const uint8_t MAX_ROBOT_NUMBER = 8;
+    static const size_t DESCRIBE_SIZE = 384;
+
+    ConfigStore();
+    bool begin();
+    const RobotConfig &get() const { return cache; }
+    bool isEnabled(ConfigFeature feature) const { return (cache.features & feature) != 0; }
+    bool hasRobotNumber() const { return cache.robotNumber != 0; }
+
+    // Setters persist immediately. The robot number and calibration also
+    // update the cache; everything else takes effect on the next boot.
+    bool setRobotNumber(uint8_t number);
+    bool setCalibration(const AHRS::Calibration &calibration);
+    bool set(const char *key, const char *value);
+    // Writes one key=value line per setting and returns the full length,
+    // which is DESCRIBE_SIZE or more only if the listing was cut short
+    size_t describe(char *buffer, size_t size) const;
+    bool isRebootPending() const { return rebootPending; }
+
+private:
+    Preferences prefs;
+    RobotConfig cache;
+    bool ready;
+    bool rebootPending;
+
+    static const char *NAMESPACE;
+    static const uint16_t SCHEMA_VERSION = 1;
+    static const uint16_t DEFAULT_CONTROL_INTERVAL_MS = 500;
+    // Network::SERVICE_TASK_CORE and SERVICE_TASK_PRIORITY. Above the sense
+    // task's priority the service task could starve the control pipeline.
+    static const uint8_t DEFAULT_SERVICE_CORE = 0;
+    static const uint8_t DEFAULT_SERVICE_PRIORITY = 1;
+    static const uint8_t MAX_SERVICE_PRIORITY = 4;
+    static const uint32_t DEFAULT_FEATURES = FEATURE_TRAINING | FEATURE_ANGLE_SWEEP |
+                                             FEATURE_HEALTH_CHECK | FEATURE_WAVE_DEMO |
+                                             FEATURE_TRANSITION_LOG;
+
+    static RobotConfig defaults();
+    void load();
+    uint8_t readLegacyRobotNumber();
+    bool parseAngles(const char *value, int *angles, int count);
+};
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,385 @@
+#include "ControlPipeline.h"
+#include <Network.h>
+#include <MemoryReport.h>
+
+ControlPipeline::ControlPipeline(AHRS *ahrs, ServoControl *servoControl, Training *training)
+    : ahrs(ahrs),
+      servoControl(servoControl),
+      training(training),
+      network(NULL),
+      controlIntervalMs(500),
+      streamSamples(false),
+      autoSaved(false),
+      pendingCommand(MODEL_COMMAND_NONE),
+      stepInFlight(false),
+      senseTask(NULL),
+      policyTask(NULL),
+      actuateTask(NULL),
+      statsMux(portMUX_INITIALIZER_UNLOCKED),
+      stats(),
+      commandedDownAngle(0),
+      commandedUpAngle(0)
+{
+}
+
+void ControlPipeline::attachNetwork(Network *network)
+{
+    this->network = network;
+}
+
+void ControlPipeline::setControlInterval(uint16_t intervalMs)
+{
+    controlIntervalMs = intervalMs;
+}
+
+void ControlPipeline::setSampleStreaming(bool enabled)
+{
+    streamSamples = enabled;
+}
+
+void ControlPipeline::rearmAutoSave()
+{
+    autoSaved = false;
+}
+
+#if !RLBOT_INFERENCE_ONLY
+void ControlPipeline::startTraining()
+{
+    runBetweenSteps(MODEL_COMMAND_START_TRAINING);
+}
+
+void ControlPipeline::resetModel()
+{
+    runBetweenSteps(MODEL_COMMAND_CLEAR);
+    // Flash work stays off the policy task
+    training->removeModelFiles();
+    Serial.println("Training model reset");
+}
+#endif
+
+void ControlPipeline::runBetweenSteps(ModelCommand command)
+{
+    pendingCommand = command;
+    if (policyTask == NULL)
+    {
+        applyModelCommand();
+        return;
+    }
+    xTaskNotifyGive(policyTask);
+    while (pendingCommand != MODEL_COMMAND_NONE)
+    {
+        vTaskDelay(1);
+    }
+}
+
+void ControlPipeline::applyModelCommand()
+{
+#if !RLBOT_INFERENCE_ONLY
+    switch (pendingCommand)
+    {
+    case MODEL_COMMAND_START_TRAINING:
+        training->startTraining();
+        break;
+    case MODEL_COMMAND_CLEAR:
+        training->clearModel();
+        break;
+    default:
+        break;
+    }
+#endif
+    pendingCommand = MODEL_COMMAND_NONE;
+}
+
+void ControlPipeline::start()
+{
+    commandedDownAngle = servoControl->getCurrentDownAngle();
+    commandedUpAngle = servoControl->getCurrentUpAngle();
+
+    // Consumers first, so every producer has a handle to notify
+    xTaskCreatePinnedToCore(actuateTaskFunction, "Actuate", kActuateStack, this,
+                            ACTUATE_TASK_PRIORITY, &actuateTask, TASK_CORE);
+    xTaskCreatePinnedToCore(policyTaskFunction, "Policy", kPolicyStack, this,
+                            POLICY_TASK_PRIORITY, &policyTask, TASK_CORE);
+    xTaskCreatePinnedToCore(senseTaskFunction, "Sense", kSenseStack, this,
+                            SENSE_TASK_PRIORITY, &senseTask, TASK_CORE);
+    MemoryReport::watchTask("Actuate", actuateTask, kActuateStack);
+    MemoryReport::watchTask("Policy", policyTask, kPolicyStack);
+    MemoryReport::watchTask("Sense", senseTask, kSenseStack);
+}
+
+bool ControlPipeline::popReport(Decision &decision)
+{
+    return reportQueue.pop(decision);
+}
+
+bool ControlPipeline::popSample(Sample &sample)
+{
+    return sampleQueue.pop(sample);
+}
+
+void ControlPipeline::takeStats(Stats &out)
+{
+    portENTER_CRITICAL(&statsMux);
+    out = stats;
+    stats = Stats();
+    portEXIT_CRITICAL(&statsMux);
+
+    out.controlPeriodUs = getControlPeriodMs() * 1000;
+    out.featureDepth = featureQueue.takeHighWater();
+    out.actionDepth = actionQueue.takeHighWater();
+    out.reportDepth = reportQueue.takeHighWater();
+}
+
+void ControlPipeline::record(StageTiming &timing, uint32_t elapsedUs)
+{
+    portENTER_CRITICAL(&statsMux);
+    ++timing.count;
+    timing.totalUs += elapsedUs;
+    if (elapsedUs > timing.maxUs)
+    {
+        timing.maxUs = elapsedUs;
+    }
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void ControlPipeline::senseTaskFunction(void *parameter)
+{
+    static_cast<ControlPipeline *>(parameter)->runSense();
+}
+
+void ControlPipeline::policyTaskFunction(void *parameter)
+{
+    static_cast<ControlPipeline *>(parameter)->runPolicy();
+}
+
+void ControlPipeline::actuateTaskFunction(void *parameter)
+{
+    static_cast<ControlPipeline *>(parameter)->runActuate();
+}
+
+void ControlPipeline::recordTick(uint32_t latenessUs, uint32_t missed, bool accepted)
+{
+    portENTER_CRITICAL(&statsMux);
+    stats.ticks += accepted ? 1 : 0;
+    stats.droppedTicks += missed + (accepted ? 0 : 1);
+    if (latenessUs > stats.maxLatenessUs)
+    {
+        stats.maxLatenessUs = latenessUs;
+    }
+    stats.lateness.add(latenessUs);
+    portEXIT_CRITICAL(&statsMux);
+}
+
+uint32_t ControlPipeline::getControlPeriodMs() const
+{
+    uint32_t periods = controlIntervalMs / SENSE_PERIOD_MS;
+    return (periods > 0 ? periods : 1) * SENSE_PERIOD_MS;
+}
+
+void ControlPipeline::runSense()
+{
+    const uint32_t periodsPerTick = getControlPeriodMs() / SENSE_PERIOD_MS;
+    senseScheduler.start(SENSE_PERIOD_MS);
+
+    // Sense periods are counted on the scheduler's grid, skipped ones
+    // included, so control ticks stay whole multiples of the interval
+    uint32_t period = 0;
+    uint32_t nextTickPeriod = periodsPerTick;
+    uint32_t windowStartUs = micros();
+    float startPos[3] = {ahrs->getPositionX(), ahrs->getPositionY(), ahrs->getPositionZ()};
+    float speedSumCms = 0.0f;
+    float accelSumMps2 = 0.0f;
+    uint32_t sampleCount = 0;
+
+    for (;;)
+    {
+        PeriodicScheduler::Wake wake = senseScheduler.wait();
+        uint32_t nowUs = micros();
+        period += wake.skipped + 1;
+        if (wake.overrun)
+        {
+            portENTER_CRITICAL(&statsMux);
+            ++stats.senseOverruns;
+            portEXIT_CRITICAL(&statsMux);
+        }
+
+        ahrs->update();
+
+        float speedCms = ahrs->getSpeed() * 100.0f;
+        float accelX = ahrs->getLinearAccelX();
+        float accelY = ahrs->getLinearAccelY();
+        float accelZ = ahrs->getLinearAccelZ();
+        speedSumCms += speedCms;
+        accelSumMps2 += sqrt(accelX * accelX + accelY * accelY + accelZ * accelZ);
+        ++sampleCount;
+
+        if (streamSamples)
+        {
+            Sample sample = {nowUs, {accelX, accelY, accelZ}, speedCms};
+            if (!sampleQueue.push(sample))
+            {
+                portENTER_CRITICAL(&statsMux);
+                ++stats.droppedSamples;
+                portEXIT_CRITICAL(&statsMux);
+            }
+        }
+
+        if (static_cast<int32_t>(period - nextTickPeriod) < 0)
+        {
+            continue;
+        }
+
+        // Ticks whose deadline passed entirely inside an overrun are lost
+        uint32_t periodsLate = period - nextTickPeriod;
+        uint32_t missedTicks = periodsLate / periodsPerTick;
+        uint32_t latenessUs = (periodsLate % periodsPerTick) * SENSE_PERIOD_MS * 1000 + wake.latenessUs;
+        nextTickPeriod += (missedTicks + 1) * periodsPerTick;
+
+        float pos[3] = {ahrs->getPositionX(), ahrs->getPositionY(), ahrs->getPositionZ()};
+        float dX = pos[0] - startPos[0];
+        float dY = pos[1] - startPos[1];
+        float dZ = pos[2] - startPos[2];
+
+        Features features;
+        features.windowEndUs = nowUs;
+        features.windowMs = (nowUs - windowStartUs) / 1000;
+        features.deltaDistanceCm = sqrt(dX * dX + dY * dY + dZ * dZ) * 100.0f;
+        features.avgSpeedCms = speedSumCms / sampleCount;
+        features.avgAccelMps2 = accelSumMps2 / sampleCount;
+        features.pitchDeg = ahrs->getPitch();
+
+        // The last step's move is still running: drop this tick and let
+        // the window run on, so it covers all of that move
+        if (stepInFlight)
+        {
+            recordTick(latenessUs, missedTicks, false);
+            continue;
+        }
+        stepInFlight = true;
+        featureQueue.push(features);
+        xTaskNotifyGive(policyTask);
+        recordTick(latenessUs, missedTicks, true);
+
+        windowStartUs = nowUs;
+        memcpy(startPos, pos, sizeof(startPos));
+        speedSumCms = 0.0f;
+        accelSumMps2 = 0.0f;
+        sampleCount = 0;
+    }
+}
+
+void ControlPipeline::runPolicy()
+{
+    for (;;)
+    {
+        if (pendingCommand != MODEL_COMMAND_NONE)
+        {
+            applyModelCommand();
+        }
+
+        Features features;
+        if (!featureQueue.pop(features))
+        {
+            ulTaskNotifyTake(pdTRUE, kIdleWaitTicks);
+            continue;
+        }
+
+        uint32_t startUs = micros();
+        record(stats.featureWait, startUs - features.windowEndUs);
+
+        Decision decision = decide(features);
+        decision.decidedUs = micros();
+        record(stats.policy, decision.decidedUs - startUs);
+
+        if (decision.actionChosen)
+        {
+            actionQueue.push(decision);
+            xTaskNotifyGive(actuateTask);
+        }
+        else
+        {
+            stepInFlight = false;
+        }
+        if (!reportQueue.push(decision))
+        {
+            portENTER_CRITICAL(&statsMux);
+            ++stats.droppedReports;
+            portEXIT_CRITICAL(&statsMux);
+        }
+    }
+}
+
+ControlPipeline::Decision ControlPipeline::decide(const Features &features)
+{
+    Decision decision = {};
+    decision.features = features;
+    decision.training = training->isTraining();
+
+#if !RLBOT_INFERENCE_ONLY
+    if (decision.training)
+    {
+        decision.result = training->step(
+            features.deltaDistanceCm,
+            features.avgSpeedCms,
+            features.avgAccelMps2,
+            commandedDownAngle,
+            commandedUpAngle,
+            features.pitchDeg);
+        decision.actionChosen = true;
+        if (!autoSaved && training->isEpsilonMin())
+        {
+            // Saved by the checkpoint task; flash writes would stall the tick
+            training->stopTraining();
+            training->requestSave();
+            autoSaved = true;
+        }
+    }
+#endif
+    if (!decision.training && training->hasLearnedBehavior())
+    {
+        decision.result = training->infer(
+            features.deltaDistanceCm,
+            features.avgSpeedCms,
+            features.avgAccelMps2,
+            commandedDownAngle,
+            commandedUpAngle,
+            features.pitchDeg);
+        decision.actionChosen = true;
+    }
+
+    if (decision.actionChosen)
+    {
+        commandedDownAngle = decision.result.targetDownAngle;
+        commandedUpAngle = decision.result.targetUpAngle;
+    }
+    return decision;
+}
+
+void ControlPipeline::runActuate()
+{
+    for (;;)
+    {
+        Decision decision;
+        if (!actionQueue.pop(decision))
+        {
+            ulTaskNotifyTake(pdTRUE, kIdleWaitTicks);
+            continue;
+        }
+        uint32_t startUs = micros();
+        record(stats.actionWait, startUs - decision.decidedUs);
+
+        if (network)
+        {
+            network->beginControlTick();
+        }
+        servoControl->moveDownSmooth(decision.result.targetDownAngle);
+        servoControl->moveUpSmooth(decision.result.targetUpAngle);
+        if (network)
+        {
+            network->endControlTick();
+        }
+
+        record(stats.actuate, micros() - startUs);
+        stepInFlight = false;
+    }
+}
@@ -0,0 +1,178 @@
+#ifndef CONTROL_PIPELINE_H
+#define CONTROL_PIPELINE_H
+
+#include <Arduino.h>
+#include <AHRS.h>
+#include <ServoControl.h>
+#include <Training.h>
+#include <SpscQueue.h>
+#include "PeriodicScheduler.h"
+
+class Network;
+
+// Control loop split into FreeRTOS tasks joined by SPSC queues:
+//
+//   sense   -> features -> policy -> actions -> actuate
+//                                  -> reports -> loop() (display, telemetry)
+//
+// The sense task integrates the IMU on a fixed sensing period and closes a
+// feature window on a control tick; ticks sit on a fixed grid of whole
+// control intervals, so their period does not drift with the work done in
+// between. The policy task turns each window into the next action, which
+// the actuate task carries out. The policy is given the pose the servos
+// have been commanded to, which is where the last move left them.
+//
+// Only one step is in flight at a time: from the tick that closes a window
+// until the servo move chosen from it has finished, further ticks are
+// counted as dropped and the open window carries on. Each window then
+// covers exactly one move, the one step() credits its reward to, even
+// when a move takes longer than the control interval.
+class ControlPipeline
+{
+public:
+    struct Features
+    {
+        uint32_t windowEndUs;
+        uint32_t windowMs;
+        float deltaDistanceCm;
+        float avgSpeedCms;
+        float avgAccelMps2;
+        float pitchDeg;
+    };
+
+    struct Decision
+    {
+        Features features;
+        Training::StepResult result;
+        bool actionChosen;
+        bool training;
+        uint32_t decidedUs;
+    };
+
+    struct Sample
+    {
+        uint32_t timeUs;
+        float linearAccel[3];
+        float speedCms;
+    };
+
+    struct StageTiming
+    {
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t totalUs;
+
+        uint32_t meanUs() const { return count ? static_cast<uint32_t>(totalUs / count) : 0; }
+    };
+
+    // Timings are in microseconds. Depths are the deepest each queue got.
+    struct Stats
+    {
+        uint32_t controlPeriodUs;
+        uint32_t ticks;            // control ticks handed to the policy
+        uint32_t droppedTicks;     // lost to an overrun or to a step still in flight
+        uint32_t senseOverruns;    // sense iterations that ran past their deadline
+        uint32_t maxLatenessUs;    // worst control tick wakeup past its deadline
+        JitterHistogram lateness;  // control tick wakeup lateness
+        StageTiming featureWait;   // window closed -> policy picked it up
+        StageTiming policy;        // Training::step/infer and autosave
+        StageTiming actionWait;    // decision made -> servo move started
+        StageTiming actuate;       // servo move
+        uint8_t featureDepth;
+        uint8_t actionDepth;
+        uint8_t reportDepth;
+        uint32_t droppedReports;
+        uint32_t droppedSamples;
+    };
+
+    static const UBaseType_t SENSE_TASK_PRIORITY = 4;
+    static const UBaseType_t ACTUATE_TASK_PRIORITY = 3;
+    static const UBaseType_t POLICY_TASK_PRIORITY = 2;
+    static const BaseType_t TASK_CORE = 1;
+    static const uint32_t SENSE_PERIOD_MS = 2;
+
+    ControlPipeline(AHRS *ahrs, ServoControl *servoControl, Training *training);
+    void attachNetwork(Network *network);
+    void setControlInterval(uint16_t intervalMs);
+    void setSampleStreaming(bool enabled);
+
+    // Call once setup() is done with the AHRS and servos; from then on they
+    // belong to the pipeline tasks.
+    void start();
+
+    // Rounded to whole sense periods
+    uint32_t getControlPeriodMs() const;
+
+    // Consumer side for loop()
+    bool popReport(Decision &decision);
+    bool popSample(Sample &sample);
+    void takeStats(Stats &stats);
+
+    // Save the model again the next time epsilon bottoms out
+    void rearmAutoSave();
+
+#if !RLBOT_INFERENCE_ONLY
+    // For loop(): these rewrite the whole model, so the policy task runs
+    // them between two decisions, where no step() is under way, and the
+    // call waits until it has. Before start() they run on the caller.
+    void startTraining();
+    void resetModel();
+#endif
+
+private:
+    static const uint32_t kSenseStack = 4096;
+    static const uint32_t kPolicyStack = 8192;
+    static const uint32_t kActuateStack = 3072;
+    static const TickType_t kIdleWaitTicks = pdMS_TO_TICKS(20);
+
+    enum ModelCommand : uint8_t
+    {
+        MODEL_COMMAND_NONE,
+        MODEL_COMMAND_START_TRAINING,
+        MODEL_COMMAND_CLEAR
+    };
+
+    AHRS *ahrs;
+    ServoControl *servoControl;
+    Training *training;
+    Network *network;
+    volatile uint16_t controlIntervalMs;
+    volatile bool streamSamples;
+    volatile bool autoSaved;
+    volatile ModelCommand pendingCommand;
+    // Set by the sense task when it hands over a window, cleared once the
+    // move chosen from it has finished or no move was chosen
+    volatile bool stepInFlight;
+
+    TaskHandle_t senseTask;
+    TaskHandle_t policyTask;
+    TaskHandle_t actuateTask;
+    PeriodicScheduler senseScheduler;
+
+    SpscQueue<Features, 2> featureQueue;
+    SpscQueue<Decision, 2> actionQueue;
+    SpscQueue<Decision, 9> reportQueue;
+    SpscQueue<Sample, 65> sampleQueue;
+
+    portMUX_TYPE statsMux;
+    Stats stats;
+
+    // Policy-side view of the pose the servos will end up in
+    int commandedDownAngle;
+    int commandedUpAngle;
+
+    static void senseTaskFunction(void *parameter);
+    static void policyTaskFunction(void *parameter);
+    static void actuateTaskFunction(void *parameter);
+
+    void runSense();
+    void runBetweenSteps(ModelCommand command);
+    void applyModelCommand();
+    void runPolicy();
+    void runActuate();
+    Decision decide(const Features &features);
+    void recordTick(uint32_t latenessUs, uint32_t missed, bool accepted);
+    void record(StageTiming &timing, uint32_t elapsedUs);
+};
+
+#endif // CONTROL_PIPELINE_H
@@ -0,0 +1,71 @@
+#include "PeriodicScheduler.h"
+
+PeriodicScheduler::PeriodicScheduler()
+    : periodTicks(1),
+      lastWakeTick(0),
+      periodUs(1000),
+      deadlineUs(0)
+{
+}
+
+void PeriodicScheduler::start(uint32_t periodMs)
+{
+    periodTicks = pdMS_TO_TICKS(periodMs);
+    if (periodTicks == 0)
+    {
+        periodTicks = 1;
+    }
+    periodUs = periodTicks * portTICK_PERIOD_MS * 1000;
+
+    // Line the microsecond deadline up with a tick edge so lateness is
+    // measured from when the scheduler could have woken us at the earliest
+    vTaskDelay(1);
+    lastWakeTick = xTaskGetTickCount();
+    deadlineUs = micros();
+}
+
+PeriodicScheduler::Wake PeriodicScheduler::wait()
+{
+    Wake wake = {0, 0, false};
+
+    TickType_t now = xTaskGetTickCount();
+    TickType_t behind = now - lastWakeTick;
+    if (behind >= periodTicks)
+    {
+        wake.overrun = true;
+        // Drop the periods that are already gone; the current one still runs
+        wake.skipped = behind / periodTicks - 1;
+        lastWakeTick += wake.skipped * periodTicks;
+        deadlineUs += wake.skipped * periodUs;
+    }
+
+    xTaskDelayUntil(&lastWakeTick, periodTicks);
+    deadlineUs += periodUs;
+
+    int32_t lateness = static_cast<int32_t>(micros() - deadlineUs);
+    wake.latenessUs = lateness > 0 ? lateness : 0;
+    return wake;
+}
+
+uint32_t PeriodicScheduler::getPeriodMs() const
+{
+    return periodUs / 1000;
+}
+
+void JitterHistogram::add(uint32_t latenessUs)
+{
+    uint8_t bucket = 0;
+    while (bucket < kBuckets - 1 && latenessUs >= bucketEdgeUs(bucket))
+    {
+        ++bucket;
+    }
+    if (counts[bucket] < UINT16_MAX)
+    {
+        ++counts[bucket];
+    }
+}
+
+uint32_t JitterHistogram::bucketEdgeUs(uint8_t bucket)
+{
+    return kFirstEdgeUs << bucket;
+}
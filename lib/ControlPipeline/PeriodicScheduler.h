@@ -0,0 +1,47 @@
+#ifndef PERIODIC_SCHEDULER_H
+#define PERIODIC_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Fixed-period wakeups for a FreeRTOS task, built on xTaskDelayUntil.
+//
+// Deadlines sit on a fixed grid measured from start(), so time spent in
+// the task body never pushes later periods back. If the body overruns by
+// one or more whole periods, those periods are skipped rather than run
+// back-to-back, and wait() reports how many were lost.
+class PeriodicScheduler
+{
+public:
+    struct Wake
+    {
+        uint32_t latenessUs; // how far past its deadline this wakeup was
+        uint32_t skipped;    // whole periods lost to an overrun
+        bool overrun;        // the previous body ran past this deadline
+    };
+
+    PeriodicScheduler();
+    void start(uint32_t periodMs);
+    Wake wait();
+    uint32_t getPeriodMs() const;
+
+private:
+    TickType_t periodTicks;
+    TickType_t lastWakeTick;
+    uint32_t periodUs;
+    uint32_t deadlineUs;
+};
+
+// Lateness histogram with power-of-two bucket edges: bucket 0 is under
+// 64 us, each following bucket doubles, the last one is open ended.
+struct JitterHistogram
+{
+    static const uint8_t kBuckets = 8;
+    static const uint32_t kFirstEdgeUs = 64;
+
+    uint16_t counts[kBuckets];
+
+    void add(uint32_t latenessUs);
+    static uint32_t bucketEdgeUs(uint8_t bucket);
+};
+
+#endif // PERIODIC_SCHEDULER_H
@@ -1,13 +1,11 @@
 #include "Display.h"
+#include <Profiler.h>
 
-Display::Display() : cursorX(0), cursorY(0)
-{
-    oled = new Adafruit_SSD1306(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
-}
+static Profiler::Probe refreshProbe("display.refresh");
 
-Display::~Display()
+Display::Display() : cursorX(0), cursorY(0)
 {
-    delete oled;
+    oled = oledSlot.construct(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 }
 
 void Display::begin()
@@ -108,6 +106,7 @@ void Display::display()
 
 void Display::refresh()
 {
+    PROFILE_SCOPE(refreshProbe);
     oled->display();
 }
 
@@ -5,12 +5,12 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <DriverSlot.h>
 
 class Display
 {
 public:
     Display();
-    ~Display();
     void begin();
     void clear();
     void print(const char *text, uint8_t x = 0, uint8_t y = 0);
@@ -24,6 +24,7 @@ public:
     void drawProgressBar(uint8_t percentage);
 
 private:
+    DriverSlot<Adafruit_SSD1306> oledSlot;
     Adafruit_SSD1306 *oled;
     uint8_t cursorX;
     uint8_t cursorY;
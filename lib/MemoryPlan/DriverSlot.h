@@ -0,0 +1,72 @@
+#ifndef DRIVER_SLOT_H
+#define DRIVER_SLOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+
+// Storage for a driver object that has to be built after its owner, e.g.
+// because its constructor needs arguments the owner only knows later.
+//
+// With RLBOT_STATIC_ALLOC (the default) the object is built with placement
+// new in storage inside the slot, so a slot in a global lands in .bss and
+// the firmware's layout is fixed at link time. With -D RLBOT_STATIC_ALLOC=0
+// the slot falls back to new/delete, which keeps the old behaviour for
+// comparison. Call sites look the same either way:
+//
+//     DriverSlot<MPU9250> mpuSlot;
+//     mpu = mpuSlot.construct();
+//
+// A slot holds at most one object; construct() on a full slot destroys the
+// old one first.
+#ifndef RLBOT_STATIC_ALLOC
+#define RLBOT_STATIC_ALLOC 1
+#endif
+
+template <typename T>
+class DriverSlot
+{
+public:
+    DriverSlot() : object(NULL) {}
+    ~DriverSlot() { destroy(); }
+
+    template <typename... Args>
+    T *construct(Args &&...args)
+    {
+        destroy();
+#if RLBOT_STATIC_ALLOC
+        object = new (storage) T(std::forward<Args>(args)...);
+#else
+        object = new T(std::forward<Args>(args)...);
+#endif
+        return object;
+    }
+
+    void destroy()
+    {
+        if (object == NULL)
+        {
+            return;
+        }
+#if RLBOT_STATIC_ALLOC
+        object->~T();
+#else
+        delete object;
+#endif
+        object = NULL;
+    }
+
+    T *get() const { return object; }
+
+private:
+    DriverSlot(const DriverSlot &) = delete;
+    DriverSlot &operator=(const DriverSlot &) = delete;
+
+#if RLBOT_STATIC_ALLOC
+    alignas(T) uint8_t storage[sizeof(T)];
+#endif
+    T *object;
+};
+
+#endif // DRIVER_SLOT_H
@@ -0,0 +1,65 @@
+#include "MemoryReport.h"
+
+namespace MemoryReport
+{
+    namespace
+    {
+        struct WatchedTask
+        {
+            const char *name;
+            TaskHandle_t handle;
+            uint32_t stackBytes;
+        };
+
+        WatchedTask tasks[kMaxTasks];
+        uint8_t taskCount = 0;
+        portMUX_TYPE tasksMux = portMUX_INITIALIZER_UNLOCKED;
+    }
+
+    void watchTask(const char *name, TaskHandle_t handle, uint32_t stackBytes)
+    {
+        if (handle == NULL)
+        {
+            return;
+        }
+        portENTER_CRITICAL(&tasksMux);
+        if (taskCount < kMaxTasks)
+        {
+            tasks[taskCount].name = name;
+            tasks[taskCount].handle = handle;
+            tasks[taskCount].stackBytes = stackBytes;
+            ++taskCount;
+        }
+        portEXIT_CRITICAL(&tasksMux);
+    }
+
+    void dump(LineSink sink)
+    {
+        char line[128];
+        snprintf(line, sizeof(line), "mem heap size=%u free=%u min_free=%u max_block=%u",
+                 ESP.getHeapSize(), ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+        sink(line);
+
+        if (ESP.getPsramSize() > 0)
+        {
+            snprintf(line, sizeof(line), "mem psram size=%u free=%u min_free=%u max_block=%u",
+                     ESP.getPsramSize(), ESP.getFreePsram(), ESP.getMinFreePsram(), ESP.getMaxAllocPsram());
+            sink(line);
+        }
+
+        snprintf(line, sizeof(line), "mem drivers %s", RLBOT_STATIC_ALLOC ? "static" : "heap");
+        sink(line);
+
+        for (uint8_t i = 0; i < taskCount; ++i)
+        {
+            const WatchedTask &task = tasks[i];
+            // ESP-IDF reports the high-water mark in bytes, not words
+            uint32_t freeMin = uxTaskGetStackHighWaterMark(task.handle);
+            uint32_t used = task.stackBytes > freeMin ? task.stackBytes - freeMin : 0;
+            snprintf(line, sizeof(line), "mem task %-11s stack=%u used_max=%u free_min=%u (%u%%)",
+                     task.name, task.stackBytes, used, freeMin,
+                     task.stackBytes ? used * 100 / task.stackBytes : 0);
+            sink(line);
+        }
+    }
+}
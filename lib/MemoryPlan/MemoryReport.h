@@ -0,0 +1,28 @@
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <Arduino.h>
+#include "DriverSlot.h"
+
+// Heap and stack headroom, for sizing buffers and task stacks.
+//
+// Tasks register themselves when they are created; the report then shows
+// each task's stack size next to the most of it ever used, taken from the
+// FreeRTOS high-water mark. Heap figures cover internal RAM and, when the
+// board has it, PSRAM: the low-water mark of free memory since boot and the
+// largest block that could still be allocated in one piece.
+//
+// Stack high-water marks only grow, so a report taken after the robot has
+// trained for a while is worth more than one taken at boot. Only register
+// tasks that run until reset; a deleted task leaves a dangling handle.
+namespace MemoryReport
+{
+    static const uint8_t kMaxTasks = 12;
+
+    void watchTask(const char *name, TaskHandle_t handle, uint32_t stackBytes);
+
+    typedef void (*LineSink)(const char *line);
+    void dump(LineSink sink);
+}
+
+#endif // MEMORY_REPORT_H
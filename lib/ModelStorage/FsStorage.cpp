@@ -0,0 +1,89 @@
+#include "FsStorage.h"
+#include <SPIFFS.h>
+#include <LittleFS.h>
+
+bool FsStorage::exists(const char *name)
+{
+    return fs.exists(name);
+}
+
+size_t FsStorage::size(const char *name)
+{
+    if (!fs.exists(name))
+    {
+        return 0;
+    }
+    File file = fs.open(name, FILE_READ);
+    size_t bytes = file ? file.size() : 0;
+    file.close();
+    return bytes;
+}
+
+size_t FsStorage::read(const char *name, size_t offset, uint8_t *buffer, size_t length)
+{
+    File file = fs.open(name, FILE_READ);
+    if (!file)
+    {
+        return 0;
+    }
+    size_t bytes = 0;
+    if (file.seek(offset))
+    {
+        bytes = file.read(buffer, length);
+    }
+    file.close();
+    stats.bytesRead += bytes;
+    return bytes;
+}
+
+bool FsStorage::write(const char *name, const uint8_t *data, size_t length)
+{
+    return store(name, FILE_WRITE, data, length);
+}
+
+bool FsStorage::append(const char *name, const uint8_t *data, size_t length)
+{
+    return store(name, FILE_APPEND, data, length);
+}
+
+bool FsStorage::store(const char *name, const char *mode, const uint8_t *data, size_t length)
+{
+    File file = fs.open(name, mode);
+    if (!file)
+    {
+        return false;
+    }
+    size_t written = length > 0 ? file.write(data, length) : 0;
+    file.close();
+    stats.bytesWritten += written;
+    return written == length;
+}
+
+bool FsStorage::remove(const char *name)
+{
+    return fs.exists(name) && fs.remove(name);
+}
+
+bool FsStorage::rename(const char *from, const char *to)
+{
+    // LittleFS would replace the target, SPIFFS refuses; make both refuse
+    return !fs.exists(to) && fs.rename(from, to);
+}
+
+SpiffsStorage::SpiffsStorage() : FsStorage(SPIFFS)
+{
+}
+
+bool SpiffsStorage::begin()
+{
+    return SPIFFS.begin(true);
+}
+
+LittleFsStorage::LittleFsStorage() : FsStorage(LittleFS)
+{
+}
+
+bool LittleFsStorage::begin()
+{
+    return LittleFS.begin(true);
+}
@@ -0,0 +1,50 @@
+#ifndef FS_STORAGE_H
+#define FS_STORAGE_H
+
+#include "ModelStorage.h"
+#include <FS.h>
+
+// Files on an Arduino file system. SPIFFS and LittleFS both mount the
+// "spiffs" partition, so switching between them formats it; pull the model
+// first. Wear is left to the file system and only bytes are counted.
+class FsStorage : public ModelStorage
+{
+public:
+    bool exists(const char *name) override;
+    size_t size(const char *name) override;
+    size_t read(const char *name, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *name, const uint8_t *data, size_t length) override;
+    bool append(const char *name, const uint8_t *data, size_t length) override;
+    bool remove(const char *name) override;
+    bool rename(const char *from, const char *to) override;
+
+protected:
+    explicit FsStorage(fs::FS &fs) : fs(fs) {}
+
+    fs::FS &fs;
+
+private:
+    bool store(const char *name, const char *mode, const uint8_t *data, size_t length);
+};
+
+// SPIFFS formats the partition when it cannot be mounted, which is what a
+// fresh board needs but also what a corrupted one gets.
+class SpiffsStorage : public FsStorage
+{
+public:
+    SpiffsStorage();
+    const char *getName() const override { return "spiffs"; }
+    bool begin() override;
+};
+
+// LittleFS is journaling and copy-on-write, so a power cut during a write
+// cannot corrupt the file system, and rewrites of small files are cheaper.
+class LittleFsStorage : public FsStorage
+{
+public:
+    LittleFsStorage();
+    const char *getName() const override { return "littlefs"; }
+    bool begin() override;
+};
+
+#endif // FS_STORAGE_H
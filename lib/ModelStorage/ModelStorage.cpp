@@ -0,0 +1,54 @@
+#include "ModelStorage.h"
+#include "FsStorage.h"
+#include "NvsStorage.h"
+#include "PartitionStorage.h"
+#include "RamStorage.h"
+
+namespace
+{
+    const char *const kKindNames[MODEL_STORAGE_KIND_COUNT] = {"spiffs", "littlefs", "nvs", "partition", "ram"};
+}
+
+ModelStorage *ModelStorage::get(ModelStorageKind kind)
+{
+    // Built on first use; none of them touch flash before begin()
+    static SpiffsStorage spiffs;
+    static LittleFsStorage littleFs;
+    static NvsStorage nvs;
+    static PartitionStorage partition;
+    static RamStorage ram;
+
+    switch (kind)
+    {
+    case MODEL_STORAGE_SPIFFS:
+        return &spiffs;
+    case MODEL_STORAGE_LITTLEFS:
+        return &littleFs;
+    case MODEL_STORAGE_NVS:
+        return &nvs;
+    case MODEL_STORAGE_PARTITION:
+        return &partition;
+    case MODEL_STORAGE_RAM:
+        return &ram;
+    default:
+        return NULL;
+    }
+}
+
+const char *ModelStorage::kindName(ModelStorageKind kind)
+{
+    return kind < MODEL_STORAGE_KIND_COUNT ? kKindNames[kind] : "unknown";
+}
+
+bool ModelStorage::parseKind(const char *name, ModelStorageKind &kind)
+{
+    for (uint8_t i = 0; i < MODEL_STORAGE_KIND_COUNT; ++i)
+    {
+        if (strcmp(name, kKindNames[i]) == 0)
+        {
+            kind = static_cast<ModelStorageKind>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,71 @@
+#ifndef MODEL_STORAGE_H
+#define MODEL_STORAGE_H
+
+#include <Arduino.h>
+
+// Where Training keeps its model, checkpoint and journal.
+//
+// Files are small named blobs ("/training.bin") that are written whole,
+// appended to, read at an offset, renamed and removed; that is all the
+// model and checkpoint code needs, and it maps onto a file system, NVS or
+// a raw flash partition alike. Backends are not thread-safe; Training
+// serialises every access with its storage lock.
+//
+// Each backend counts the bytes it wrote and, where it manages flash
+// itself, the sectors it erased, so StorageBench can report the wear a
+// checkpoint costs.
+enum ModelStorageKind : uint8_t
+{
+    MODEL_STORAGE_SPIFFS = 0,
+    MODEL_STORAGE_LITTLEFS = 1,
+    MODEL_STORAGE_NVS = 2,
+    MODEL_STORAGE_PARTITION = 3,
+    MODEL_STORAGE_RAM = 4,
+    MODEL_STORAGE_KIND_COUNT
+};
+
+class ModelStorage
+{
+public:
+    struct Stats
+    {
+        uint32_t bytesWritten;
+        uint32_t bytesRead;
+        uint32_t sectorErases;
+    };
+
+    virtual ~ModelStorage() {}
+
+    virtual const char *getName() const = 0;
+    virtual bool begin() = 0;
+
+    // False for backends that lose everything on reset
+    virtual bool isDurable() const { return true; }
+
+    virtual bool exists(const char *name) = 0;
+    virtual size_t size(const char *name) = 0;
+    virtual size_t read(const char *name, size_t offset, uint8_t *buffer, size_t length) = 0;
+
+    // write() replaces the contents and append() adds to the end; both
+    // create a missing file. An empty file may read back as missing.
+    virtual bool write(const char *name, const uint8_t *data, size_t length) = 0;
+    virtual bool append(const char *name, const uint8_t *data, size_t length) = 0;
+    virtual bool remove(const char *name) = 0;
+
+    // Fails if the target exists
+    virtual bool rename(const char *from, const char *to) = 0;
+
+    const Stats &getStats() const { return stats; }
+
+    // One shared instance per kind; NULL for an unknown kind
+    static ModelStorage *get(ModelStorageKind kind);
+    static const char *kindName(ModelStorageKind kind);
+    static bool parseKind(const char *name, ModelStorageKind &kind);
+
+protected:
+    ModelStorage() : stats() {}
+
+    Stats stats;
+};
+
+#endif // MODEL_STORAGE_H
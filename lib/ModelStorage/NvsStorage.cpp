@@ -0,0 +1,124 @@
+#include "NvsStorage.h"
+#include <new>
+
+const char *NvsStorage::NAMESPACE = "rlmodel";
+
+NvsStorage::NvsStorage() : ready(false)
+{
+}
+
+bool NvsStorage::begin()
+{
+    if (!ready)
+    {
+        ready = prefs.begin(NAMESPACE, false);
+    }
+    return ready;
+}
+
+const char *NvsStorage::keyFor(const char *name)
+{
+    const char *key = name[0] == '/' ? name + 1 : name;
+    return strlen(key) <= 15 ? key : NULL;
+}
+
+uint8_t *NvsStorage::load(const char *key, size_t extra, size_t &length)
+{
+    length = prefs.getBytesLength(key);
+    uint8_t *blob = new (std::nothrow) uint8_t[length + extra + 1];
+    if (blob != NULL && length > 0 && prefs.getBytes(key, blob, length) != length)
+    {
+        delete[] blob;
+        return NULL;
+    }
+    stats.bytesRead += length;
+    return blob;
+}
+
+bool NvsStorage::exists(const char *name)
+{
+    const char *key = keyFor(name);
+    return ready && key != NULL && prefs.isKey(key);
+}
+
+size_t NvsStorage::size(const char *name)
+{
+    return exists(name) ? prefs.getBytesLength(keyFor(name)) : 0;
+}
+
+size_t NvsStorage::read(const char *name, size_t offset, uint8_t *buffer, size_t length)
+{
+    if (!exists(name))
+    {
+        return 0;
+    }
+    size_t blobLength = 0;
+    uint8_t *blob = load(keyFor(name), 0, blobLength);
+    if (blob == NULL || offset >= blobLength)
+    {
+        delete[] blob;
+        return 0;
+    }
+    size_t bytes = min(length, blobLength - offset);
+    memcpy(buffer, blob + offset, bytes);
+    delete[] blob;
+    return bytes;
+}
+
+bool NvsStorage::write(const char *name, const uint8_t *data, size_t length)
+{
+    const char *key = keyFor(name);
+    if (!ready || key == NULL || length > MAX_FILE_SIZE)
+    {
+        return false;
+    }
+    if (length == 0)
+    {
+        // NVS cannot store an empty blob
+        return !prefs.isKey(key) || prefs.remove(key);
+    }
+    size_t written = prefs.putBytes(key, data, length);
+    stats.bytesWritten += written;
+    return written == length;
+}
+
+bool NvsStorage::append(const char *name, const uint8_t *data, size_t length)
+{
+    if (!exists(name))
+    {
+        return write(name, data, length);
+    }
+    size_t blobLength = 0;
+    uint8_t *blob = load(keyFor(name), length, blobLength);
+    if (blob == NULL)
+    {
+        return false;
+    }
+    memcpy(blob + blobLength, data, length);
+    bool ok = write(name, blob, blobLength + length);
+    delete[] blob;
+    return ok;
+}
+
+bool NvsStorage::remove(const char *name)
+{
+    return exists(name) && prefs.remove(keyFor(name));
+}
+
+bool NvsStorage::rename(const char *from, const char *to)
+{
+    if (!exists(from) || keyFor(to) == NULL || exists(to))
+    {
+        return false;
+    }
+    size_t length = 0;
+    uint8_t *blob = load(keyFor(from), 0, length);
+    if (blob == NULL)
+    {
+        return false;
+    }
+    // Written before the old key goes, so a power cut leaves a copy
+    bool ok = write(to, blob, length) && prefs.remove(keyFor(from));
+    delete[] blob;
+    return ok;
+}
@@ -0,0 +1,39 @@
+#ifndef NVS_STORAGE_H
+#define NVS_STORAGE_H
+
+#include "ModelStorage.h"
+#include <Preferences.h>
+
+// Files as blobs in their own NVS namespace, next to the robot config.
+// NVS writes are power-safe and wear-levelled across its pages, but a blob
+// can only be replaced whole: every append rewrites the file, and reads
+// at an offset load all of it. Names lose their leading '/' and must then
+// fit in an NVS key (15 characters).
+class NvsStorage : public ModelStorage
+{
+public:
+    static const size_t MAX_FILE_SIZE = 32 * 1024;
+
+    NvsStorage();
+    const char *getName() const override { return "nvs"; }
+    bool begin() override;
+
+    bool exists(const char *name) override;
+    size_t size(const char *name) override;
+    size_t read(const char *name, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *name, const uint8_t *data, size_t length) override;
+    bool append(const char *name, const uint8_t *data, size_t length) override;
+    bool remove(const char *name) override;
+    bool rename(const char *from, const char *to) override;
+
+private:
+    static const char *NAMESPACE;
+
+    Preferences prefs;
+    bool ready;
+
+    static const char *keyFor(const char *name);
+    uint8_t *load(const char *key, size_t extra, size_t &length);
+};
+
+#endif // NVS_STORAGE_H
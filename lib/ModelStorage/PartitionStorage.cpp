@@ -0,0 +1,445 @@
+#include "PartitionStorage.h"
+
+namespace
+{
+    const uint32_t kSlotMagic = 0x524C5331; // "RLS1"
+    const uint32_t kErased = 0xFFFFFFFF;
+
+    // Offsets within a slot's metadata sector
+    const uint32_t kHeaderOffset = 0;
+    const uint32_t kRenameOffset = 64;
+    const uint32_t kDeletedOffset = 96;
+    const uint32_t kLengthLogOffset = 128;
+
+    struct SlotHeader
+    {
+        uint32_t magic;
+        uint32_t generation;
+        char name[24];
+        uint32_t check;
+    };
+
+    struct RenameRecord
+    {
+        char name[24];
+        uint32_t check;
+    };
+
+    // The inverse catches an entry torn by a power cut
+    struct LengthEntry
+    {
+        uint32_t length;
+        uint32_t inverse;
+    };
+
+    const uint16_t kLengthEntries = (4096 - kLengthLogOffset) / sizeof(LengthEntry);
+
+    uint32_t checksum(const void *data, size_t length)
+    {
+        // FNV-1a
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        uint32_t hash = 2166136261u;
+        while (length--)
+        {
+            hash = (hash ^ *bytes++) * 16777619u;
+        }
+        return hash;
+    }
+
+    bool isErased(const void *data, size_t length)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (bytes[i] != 0xFF)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+const char *PartitionStorage::PARTITION_LABEL = "rlmodel";
+
+PartitionStorage::PartitionStorage()
+    : partition(NULL),
+      slotSize(0),
+      slotCount(0),
+      nextSlot(0),
+      lastGeneration(0)
+{
+    memset(slots, 0, sizeof(slots));
+}
+
+bool PartitionStorage::begin()
+{
+    if (partition != NULL)
+    {
+        return true;
+    }
+    const esp_partition_t *found =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+    if (found == NULL)
+    {
+        Serial.println("No \"rlmodel\" partition for model storage");
+        return false;
+    }
+
+    slotSize = (found->size / SLOT_COUNT) & ~(SECTOR_SIZE - 1);
+    if (slotSize < 2 * SECTOR_SIZE)
+    {
+        Serial.println("Model storage partition too small");
+        return false;
+    }
+    partition = found;
+    slotCount = SLOT_COUNT;
+
+    int newest = -1;
+    for (uint8_t slot = 0; slot < slotCount; ++slot)
+    {
+        scanSlot(slot);
+        if (!slots[slot].live)
+        {
+            continue;
+        }
+        // A replace cut short leaves two generations of one file
+        int other = findSlot(slots[slot].name);
+        if (other >= 0 && other != slot)
+        {
+            dropSlot(slots[other].generation < slots[slot].generation ? other : slot);
+        }
+        if (slots[slot].live && slots[slot].generation > lastGeneration)
+        {
+            lastGeneration = slots[slot].generation;
+            newest = slot;
+        }
+    }
+    nextSlot = newest >= 0 ? (newest + 1) % slotCount : 0;
+    return true;
+}
+
+void PartitionStorage::scanSlot(uint8_t slot)
+{
+    Slot &state = slots[slot];
+    memset(&state, 0, sizeof(state));
+    uint32_t base = slotOffset(slot);
+
+    SlotHeader header;
+    uint32_t deleted = 0;
+    esp_partition_read(partition, base + kHeaderOffset, &header, sizeof(header));
+    esp_partition_read(partition, base + kDeletedOffset, &deleted, sizeof(deleted));
+    if (header.magic != kSlotMagic || header.check != checksum(&header, offsetof(SlotHeader, check)) ||
+        deleted != kErased)
+    {
+        return;
+    }
+    state.generation = header.generation;
+    memcpy(state.name, header.name, MAX_NAME_LENGTH);
+
+    RenameRecord rename;
+    esp_partition_read(partition, base + kRenameOffset, &rename, sizeof(rename));
+    if (!isErased(&rename, sizeof(rename)))
+    {
+        // A torn rename record still uses up the one rename in place
+        state.renamed = true;
+        if (rename.check == checksum(rename.name, sizeof(rename.name)))
+        {
+            memcpy(state.name, rename.name, MAX_NAME_LENGTH);
+        }
+    }
+
+    LengthEntry entries[16];
+    bool haveLength = false;
+    for (uint16_t first = 0; first < kLengthEntries; first += 16)
+    {
+        uint16_t count = min<uint16_t>(16, kLengthEntries - first);
+        esp_partition_read(partition, base + kLengthLogOffset + first * sizeof(LengthEntry), entries,
+                           count * sizeof(LengthEntry));
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            if (isErased(&entries[i], sizeof(LengthEntry)))
+            {
+                state.live = haveLength;
+                return;
+            }
+            if (entries[i].inverse == ~entries[i].length && entries[i].length <= capacity())
+            {
+                state.length = entries[i].length;
+                haveLength = true;
+            }
+            state.nextLengthEntry = first + i + 1;
+        }
+    }
+    state.live = haveLength;
+}
+
+int PartitionStorage::findSlot(const char *name) const
+{
+    for (uint8_t slot = 0; slot < slotCount; ++slot)
+    {
+        if (slots[slot].live && strcmp(slots[slot].name, name) == 0)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+int PartitionStorage::takeFreeSlot(int except)
+{
+    for (uint8_t i = 0; i < slotCount; ++i)
+    {
+        uint8_t slot = (nextSlot + i) % slotCount;
+        if (!slots[slot].live && slot != except)
+        {
+            nextSlot = (slot + 1) % slotCount;
+            memset(&slots[slot], 0, sizeof(slots[slot]));
+            return slot;
+        }
+    }
+    Serial.println("Model storage partition has no free slot");
+    return -1;
+}
+
+bool PartitionStorage::erase(uint32_t offset, uint32_t length)
+{
+    if (esp_partition_erase_range(partition, offset, length) != ESP_OK)
+    {
+        return false;
+    }
+    stats.sectorErases += length / SECTOR_SIZE;
+    return true;
+}
+
+bool PartitionStorage::program(uint32_t offset, const void *data, size_t length)
+{
+    if (esp_partition_write(partition, offset, data, length) != ESP_OK)
+    {
+        return false;
+    }
+    stats.bytesWritten += length;
+    return true;
+}
+
+bool PartitionStorage::ensureErased(uint8_t slot, uint32_t from, uint32_t to)
+{
+    uint32_t data = slotOffset(slot) + SECTOR_SIZE;
+    uint32_t firstWholeSector = (from + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+
+    // The tail of a partly used sector was erased with it, unless an
+    // append was cut short there; check rather than trust it
+    uint8_t chunk[64];
+    for (uint32_t offset = from; offset < min(to, firstWholeSector); offset += sizeof(chunk))
+    {
+        uint32_t count = min<uint32_t>(sizeof(chunk), min(to, firstWholeSector) - offset);
+        esp_partition_read(partition, data + offset, chunk, count);
+        if (!isErased(chunk, count))
+        {
+            return false;
+        }
+    }
+
+    if (to > firstWholeSector)
+    {
+        uint32_t end = (to + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+        return erase(data + firstWholeSector, end - firstWholeSector);
+    }
+    return true;
+}
+
+bool PartitionStorage::writeLength(uint8_t slot, uint32_t length)
+{
+    Slot &state = slots[slot];
+    LengthEntry entry = {length, ~length};
+    uint32_t offset = slotOffset(slot) + kLengthLogOffset + state.nextLengthEntry * sizeof(LengthEntry);
+    ++state.nextLengthEntry;
+    if (!program(offset, &entry, sizeof(entry)))
+    {
+        return false;
+    }
+    state.length = length;
+    return true;
+}
+
+bool PartitionStorage::commitSlot(uint8_t slot, const char *name)
+{
+    SlotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kSlotMagic;
+    header.generation = ++lastGeneration;
+    strncpy(header.name, name, MAX_NAME_LENGTH);
+    header.check = checksum(&header, offsetof(SlotHeader, check));
+    if (!program(slotOffset(slot) + kHeaderOffset, &header, sizeof(header)))
+    {
+        return false;
+    }
+    Slot &state = slots[slot];
+    state.live = true;
+    state.generation = header.generation;
+    memcpy(state.name, header.name, MAX_NAME_LENGTH);
+    state.name[MAX_NAME_LENGTH] = '\0';
+    return true;
+}
+
+void PartitionStorage::dropSlot(uint8_t slot)
+{
+    uint32_t deleted = 0;
+    program(slotOffset(slot) + kDeletedOffset, &deleted, sizeof(deleted));
+    slots[slot].live = false;
+}
+
+bool PartitionStorage::copyToNewSlot(uint8_t from, const char *name, const uint8_t *extra, size_t extraLength)
+{
+    uint32_t oldLength = slots[from].length;
+    uint32_t total = oldLength + extraLength;
+    int slot = total <= capacity() ? takeFreeSlot(from) : -1;
+    if (slot < 0 || !erase(slotOffset(slot), SECTOR_SIZE + ((total + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1))))
+    {
+        return false;
+    }
+
+    uint32_t source = slotOffset(from) + SECTOR_SIZE;
+    uint32_t target = slotOffset(slot) + SECTOR_SIZE;
+    uint8_t chunk[256];
+    for (uint32_t offset = 0; offset < oldLength; offset += sizeof(chunk))
+    {
+        uint32_t count = min<uint32_t>(sizeof(chunk), oldLength - offset);
+        esp_partition_read(partition, source + offset, chunk, count);
+        stats.bytesRead += count;
+        if (!program(target + offset, chunk, count))
+        {
+            return false;
+        }
+    }
+    if (extraLength > 0 && !program(target + oldLength, extra, extraLength))
+    {
+        return false;
+    }
+
+    char newName[MAX_NAME_LENGTH + 1];
+    strncpy(newName, name, MAX_NAME_LENGTH);
+    newName[MAX_NAME_LENGTH] = '\0';
+    if (!writeLength(slot, total) || !commitSlot(slot, newName))
+    {
+        return false;
+    }
+    dropSlot(from);
+    return true;
+}
+
+bool PartitionStorage::exists(const char *name)
+{
+    return findSlot(name) >= 0;
+}
+
+size_t PartitionStorage::size(const char *name)
+{
+    int slot = findSlot(name);
+    return slot >= 0 ? slots[slot].length : 0;
+}
+
+size_t PartitionStorage::read(const char *name, size_t offset, uint8_t *buffer, size_t length)
+{
+    int slot = findSlot(name);
+    if (slot < 0 || offset >= slots[slot].length)
+    {
+        return 0;
+    }
+    size_t bytes = min(length, static_cast<size_t>(slots[slot].length - offset));
+    if (esp_partition_read(partition, slotOffset(slot) + SECTOR_SIZE + offset, buffer, bytes) != ESP_OK)
+    {
+        return 0;
+    }
+    stats.bytesRead += bytes;
+    return bytes;
+}
+
+bool PartitionStorage::write(const char *name, const uint8_t *data, size_t length)
+{
+    if (partition == NULL || strlen(name) > MAX_NAME_LENGTH || length > capacity())
+    {
+        return false;
+    }
+    int old = findSlot(name);
+    int slot = takeFreeSlot(-1);
+    if (slot < 0 || !erase(slotOffset(slot), SECTOR_SIZE + ((length + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1))))
+    {
+        return false;
+    }
+    if (length > 0 && !program(slotOffset(slot) + SECTOR_SIZE, data, length))
+    {
+        return false;
+    }
+    if (!writeLength(slot, length) || !commitSlot(slot, name))
+    {
+        return false;
+    }
+    if (old >= 0)
+    {
+        dropSlot(old);
+    }
+    return true;
+}
+
+bool PartitionStorage::append(const char *name, const uint8_t *data, size_t length)
+{
+    int slot = findSlot(name);
+    if (slot < 0)
+    {
+        return write(name, data, length);
+    }
+    Slot &state = slots[slot];
+    if (length == 0)
+    {
+        return true;
+    }
+    if (state.length + length > capacity())
+    {
+        return false;
+    }
+    // Out of length entries, or garbage from a torn append in the way:
+    // move the file to a fresh slot with the new bytes on the end
+    if (state.nextLengthEntry >= kLengthEntries || !ensureErased(slot, state.length, state.length + length))
+    {
+        return copyToNewSlot(slot, state.name, data, length);
+    }
+    return program(slotOffset(slot) + SECTOR_SIZE + state.length, data, length) &&
+           writeLength(slot, state.length + length);
+}
+
+bool PartitionStorage::remove(const char *name)
+{
+    int slot = findSlot(name);
+    if (slot < 0)
+    {
+        return false;
+    }
+    dropSlot(slot);
+    return true;
+}
+
+bool PartitionStorage::rename(const char *from, const char *to)
+{
+    int slot = findSlot(from);
+    if (slot < 0 || findSlot(to) >= 0 || strlen(to) > MAX_NAME_LENGTH)
+    {
+        return false;
+    }
+    if (slots[slot].renamed)
+    {
+        return copyToNewSlot(slot, to, NULL, 0);
+    }
+
+    RenameRecord record;
+    memset(&record, 0, sizeof(record));
+    strncpy(record.name, to, MAX_NAME_LENGTH);
+    record.check = checksum(record.name, sizeof(record.name));
+    slots[slot].renamed = true;
+    if (!program(slotOffset(slot) + kRenameOffset, &record, sizeof(record)))
+    {
+        return false;
+    }
+    memcpy(slots[slot].name, record.name, sizeof(slots[slot].name));
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef PARTITION_STORAGE_H
+#define PARTITION_STORAGE_H
+
+#include "ModelStorage.h"
+#include <esp_partition.h>
+
+// Files straight on a raw data partition labelled "rlmodel", with no file
+// system in between. The partition is split into SLOT_COUNT equal slots,
+// each holding one file:
+//
+//     sector 0   header (name, generation), rename record, deleted flag,
+//                then a log of lengths, one entry per write or append
+//     sector 1.. file data
+//
+// Flash bits can only be cleared without an erase, so every change is a
+// new record in erased space: an append writes its bytes and then a new
+// length, a rename fills in the rename record, a remove clears the flag.
+// Replacing a file writes a new slot with a higher generation before the
+// old one is dropped, and new slots are taken round-robin to spread wear.
+// A power cut at any point leaves the old file or the new one; begin()
+// drops whichever loses.
+//
+// The default partition tables have no such partition; add one, e.g.
+//     rlmodel, data, 0x40, , 256K
+// to a custom partitions.csv.
+class PartitionStorage : public ModelStorage
+{
+public:
+    static const uint8_t SLOT_COUNT = 8;
+    static const uint8_t MAX_NAME_LENGTH = 23;
+
+    PartitionStorage();
+    const char *getName() const override { return "partition"; }
+    bool begin() override;
+
+    bool exists(const char *name) override;
+    size_t size(const char *name) override;
+    size_t read(const char *name, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *name, const uint8_t *data, size_t length) override;
+    bool append(const char *name, const uint8_t *data, size_t length) override;
+    bool remove(const char *name) override;
+    bool rename(const char *from, const char *to) override;
+
+private:
+    static const uint32_t SECTOR_SIZE = 4096;
+    static const char *PARTITION_LABEL;
+
+    struct Slot
+    {
+        bool live;
+        bool renamed;
+        uint32_t generation;
+        uint32_t length;
+        uint16_t nextLengthEntry;
+        char name[MAX_NAME_LENGTH + 1];
+    };
+
+    const esp_partition_t *partition;
+    uint32_t slotSize;
+    uint8_t slotCount;
+    uint8_t nextSlot;
+    uint32_t lastGeneration;
+    Slot slots[SLOT_COUNT];
+
+    uint32_t slotOffset(uint8_t slot) const { return slot * slotSize; }
+    uint32_t capacity() const { return slotSize - SECTOR_SIZE; }
+
+    int findSlot(const char *name) const;
+    int takeFreeSlot(int except);
+    void scanSlot(uint8_t slot);
+    bool erase(uint32_t offset, uint32_t length);
+    bool program(uint32_t offset, const void *data, size_t length);
+    bool ensureErased(uint8_t slot, uint32_t from, uint32_t to);
+    bool writeLength(uint8_t slot, uint32_t length);
+    bool commitSlot(uint8_t slot, const char *name);
+    void dropSlot(uint8_t slot);
+    bool copyToNewSlot(uint8_t from, const char *name, const uint8_t *extra, size_t extraLength);
+};
+
+#endif // PARTITION_STORAGE_H
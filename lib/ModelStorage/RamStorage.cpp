@@ -0,0 +1,151 @@
+#include "RamStorage.h"
+#include <new>
+
+RamStorage::RamStorage()
+{
+    memset(entries, 0, sizeof(entries));
+}
+
+RamStorage::~RamStorage()
+{
+    for (Entry &entry : entries)
+    {
+        delete[] entry.data;
+    }
+}
+
+RamStorage::Entry *RamStorage::find(const char *name)
+{
+    for (Entry &entry : entries)
+    {
+        if (entry.name[0] != '\0' && strcmp(entry.name, name) == 0)
+        {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+RamStorage::Entry *RamStorage::create(const char *name)
+{
+    if (strlen(name) > MAX_NAME_LENGTH)
+    {
+        return NULL;
+    }
+    for (Entry &entry : entries)
+    {
+        if (entry.name[0] == '\0')
+        {
+            strcpy(entry.name, name);
+            entry.size = 0;
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+bool RamStorage::reserve(Entry &entry, size_t capacity)
+{
+    if (capacity <= entry.capacity)
+    {
+        return true;
+    }
+    // Grow in 1 KB steps so a journal is not copied on every append
+    size_t rounded = (capacity + 1023) & ~static_cast<size_t>(1023);
+    uint8_t *grown = new (std::nothrow) uint8_t[rounded];
+    if (grown == NULL)
+    {
+        return false;
+    }
+    if (entry.size > 0)
+    {
+        memcpy(grown, entry.data, entry.size);
+    }
+    delete[] entry.data;
+    entry.data = grown;
+    entry.capacity = rounded;
+    return true;
+}
+
+bool RamStorage::exists(const char *name)
+{
+    return find(name) != NULL;
+}
+
+size_t RamStorage::size(const char *name)
+{
+    Entry *entry = find(name);
+    return entry ? entry->size : 0;
+}
+
+size_t RamStorage::read(const char *name, size_t offset, uint8_t *buffer, size_t length)
+{
+    Entry *entry = find(name);
+    if (entry == NULL || offset >= entry->size)
+    {
+        return 0;
+    }
+    size_t bytes = min(length, entry->size - offset);
+    memcpy(buffer, entry->data + offset, bytes);
+    stats.bytesRead += bytes;
+    return bytes;
+}
+
+bool RamStorage::write(const char *name, const uint8_t *data, size_t length)
+{
+    Entry *entry = find(name);
+    if (entry == NULL)
+    {
+        entry = create(name);
+    }
+    if (entry == NULL)
+    {
+        return false;
+    }
+    entry->size = 0;
+    return append(name, data, length);
+}
+
+bool RamStorage::append(const char *name, const uint8_t *data, size_t length)
+{
+    Entry *entry = find(name);
+    if (entry == NULL)
+    {
+        entry = create(name);
+    }
+    if (entry == NULL || !reserve(*entry, entry->size + length))
+    {
+        return false;
+    }
+    if (length > 0)
+    {
+        memcpy(entry->data + entry->size, data, length);
+    }
+    entry->size += length;
+    stats.bytesWritten += length;
+    return true;
+}
+
+bool RamStorage::remove(const char *name)
+{
+    Entry *entry = find(name);
+    if (entry == NULL)
+    {
+        return false;
+    }
+    // Keep the buffer for the next file created in this entry
+    entry->name[0] = '\0';
+    entry->size = 0;
+    return true;
+}
+
+bool RamStorage::rename(const char *from, const char *to)
+{
+    Entry *entry = find(from);
+    if (entry == NULL || find(to) != NULL || strlen(to) > MAX_NAME_LENGTH)
+    {
+        return false;
+    }
+    strcpy(entry->name, to);
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef RAM_STORAGE_H
+#define RAM_STORAGE_H
+
+#include "ModelStorage.h"
+
+// Files in heap memory. Nothing survives a reset, so checkpoints are
+// pointless, but saves cost no flash time or wear: useful for benchmarks,
+// the host simulator, and training runs that are pulled over the network
+// before power-off.
+class RamStorage : public ModelStorage
+{
+public:
+    static const uint8_t MAX_FILES = 8;
+    static const uint8_t MAX_NAME_LENGTH = 23;
+
+    RamStorage();
+    ~RamStorage() override;
+    const char *getName() const override { return "ram"; }
+    bool begin() override { return true; }
+    bool isDurable() const override { return false; }
+
+    bool exists(const char *name) override;
+    size_t size(const char *name) override;
+    size_t read(const char *name, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *name, const uint8_t *data, size_t length) override;
+    bool append(const char *name, const uint8_t *data, size_t length) override;
+    bool remove(const char *name) override;
+    bool rename(const char *from, const char *to) override;
+
+private:
+    struct Entry
+    {
+        char name[MAX_NAME_LENGTH + 1];
+        uint8_t *data;
+        size_t size;
+        size_t capacity;
+    };
+
+    Entry entries[MAX_FILES];
+
+    Entry *find(const char *name);
+    Entry *create(const char *name);
+    bool reserve(Entry &entry, size_t capacity);
+};
+
+#endif // RAM_STORAGE_H
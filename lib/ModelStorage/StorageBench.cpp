@@ -0,0 +1,120 @@
+#include "StorageBench.h"
+#include <algorithm>
+
+namespace StorageBench
+{
+    namespace
+    {
+        const char kModelPath[] = "/bench.bin";
+        const char kTempPath[] = "/bench.tmp";
+        const char kJournalPath[] = "/bench.jnl";
+
+        // A version 3 model of the default 9 x 6 table, and the journal
+        // records two control ticks add: two cells and a progress record
+        const size_t kModelBytes = 532;
+        const size_t kJournalHeaderBytes = 12;
+        const size_t kAppendBytes = 3 * 16;
+        const uint8_t kAppendsPerMinute = 60;
+        const uint8_t kMaxRounds = 16;
+
+        uint32_t median(uint32_t *values, uint8_t count)
+        {
+            std::sort(values, values + count);
+            return values[count / 2];
+        }
+    }
+
+    bool run(ModelStorage &storage, LineSink sink, uint8_t rounds)
+    {
+        char line[160];
+        if (!storage.begin())
+        {
+            snprintf(line, sizeof(line), "storage %s unavailable", storage.getName());
+            sink(line);
+            return false;
+        }
+        rounds = constrain(rounds, 1, kMaxRounds);
+
+        uint8_t model[kModelBytes];
+        uint8_t loaded[kModelBytes];
+        uint8_t records[kAppendBytes];
+        for (size_t i = 0; i < sizeof(model); ++i)
+        {
+            model[i] = static_cast<uint8_t>(i * 31 + 7);
+        }
+        memset(records, 0x5A, sizeof(records));
+
+        uint32_t saveUs[kMaxRounds];
+        uint32_t loadUs[kMaxRounds];
+        uint64_t appendTotalUs = 0;
+        uint32_t appendMaxUs = 0;
+        uint32_t saveBytes = 0;
+        uint32_t saveErases = 0;
+        uint32_t journalBytes = 0;
+        uint32_t journalErases = 0;
+        bool ok = true;
+
+        for (uint8_t round = 0; ok && round < rounds; ++round)
+        {
+            model[0] = round;
+            ModelStorage::Stats before = storage.getStats();
+            uint32_t start = micros();
+            ok = storage.write(kTempPath, model, sizeof(model));
+            if (storage.exists(kModelPath))
+            {
+                storage.remove(kModelPath);
+            }
+            ok = ok && storage.rename(kTempPath, kModelPath) &&
+                 storage.write(kJournalPath, records, kJournalHeaderBytes);
+            saveUs[round] = micros() - start;
+            ModelStorage::Stats after = storage.getStats();
+            saveBytes += after.bytesWritten - before.bytesWritten;
+            saveErases += after.sectorErases - before.sectorErases;
+
+            start = micros();
+            ok = ok && storage.size(kModelPath) == sizeof(loaded) &&
+                 storage.read(kModelPath, 0, loaded, sizeof(loaded)) == sizeof(loaded) &&
+                 memcmp(model, loaded, sizeof(model)) == 0;
+            loadUs[round] = micros() - start;
+
+            before = storage.getStats();
+            for (uint8_t i = 0; ok && i < kAppendsPerMinute; ++i)
+            {
+                start = micros();
+                ok = storage.append(kJournalPath, records, sizeof(records));
+                uint32_t elapsed = micros() - start;
+                appendTotalUs += elapsed;
+                appendMaxUs = max(appendMaxUs, elapsed);
+            }
+            after = storage.getStats();
+            journalBytes += after.bytesWritten - before.bytesWritten;
+            journalErases += after.sectorErases - before.sectorErases;
+        }
+
+        const char *const paths[] = {kModelPath, kTempPath, kJournalPath};
+        for (const char *path : paths)
+        {
+            if (storage.exists(path))
+            {
+                storage.remove(path);
+            }
+        }
+
+        if (!ok)
+        {
+            snprintf(line, sizeof(line), "storage %s failed", storage.getName());
+            sink(line);
+            return false;
+        }
+
+        snprintf(line, sizeof(line),
+                 "storage %s save_us=%u load_us=%u append_us=%u append_max_us=%u "
+                 "ckpt_bytes=%u ckpt_erases=%u jnl_min_bytes=%u jnl_min_erases=%u%s",
+                 storage.getName(), median(saveUs, rounds), median(loadUs, rounds),
+                 static_cast<unsigned>(appendTotalUs / (rounds * kAppendsPerMinute)), appendMaxUs,
+                 saveBytes / rounds, saveErases / rounds, journalBytes / rounds, journalErases / rounds,
+                 storage.isDurable() ? "" : " (not durable)");
+        sink(line);
+        return true;
+    }
+}
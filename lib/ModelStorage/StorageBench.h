@@ -0,0 +1,25 @@
+#ifndef STORAGE_BENCH_H
+#define STORAGE_BENCH_H
+
+#include "ModelStorage.h"
+
+// Checkpoint cost of a storage backend, for choosing one on real flash.
+//
+// Each round replays what Training does: save a model the size of the
+// default table through a temporary file and a rename, load it back, then
+// journal a minute of training at the default 500 ms tick, one append per
+// second. One line per backend reports median save and load times, mean
+// and worst append times, and the bytes and erased sectors that a
+// checkpoint and a minute of journal cost. Erases are only known for
+// backends that manage flash themselves; file systems and NVS report 0.
+//
+// Runs on scratch files ("/bench.*"), so it is safe next to a live model
+// as long as the caller holds the storage lock.
+namespace StorageBench
+{
+    typedef void (*LineSink)(const char *line);
+
+    bool run(ModelStorage &storage, LineSink sink, uint8_t rounds = 5);
+}
+
+#endif // STORAGE_BENCH_H
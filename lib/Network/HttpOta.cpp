@@ -0,0 +1,212 @@
+#include "HttpOta.h"
+#include "StatusNotice.h"
+
+static const char* STATE_NAMES[] = {"idle", "receiving", "complete", "failed"};
+
+HttpOta::HttpOta(StatusNotice* notice)
+    : server(NULL), notice(notice), state(IDLE), compressed(false), chunkOk(false),
+      uploadBytes(0), receivedBytes(0), imageBytes(0), writtenBytes(0), inflateDone(false),
+      inflator(NULL), window(NULL), windowOffset(0), lastPercent(0) {
+    session[0] = '\0';
+}
+
+void HttpOta::attach(WebServer& server) {
+    this->server = &server;
+    server.on("/ota/status", HTTP_GET, [this]() { handleStatus(); });
+    server.on("/ota/begin", HTTP_POST, [this]() { handleBegin(); });
+    server.on("/ota/chunk", HTTP_PUT,
+              [this]() { handleChunkDone(); },
+              [this]() { handleChunkBody(); });
+    server.on("/ota/commit", HTTP_POST, [this]() { handleCommit(); });
+}
+
+void HttpOta::sendStatus(int code) {
+    char text[160];
+    snprintf(text, sizeof(text), "state=%s session=%s offset=%u size=%u written=%u image=%u\n",
+             STATE_NAMES[state], session, (unsigned)receivedBytes, (unsigned)uploadBytes,
+             (unsigned)writtenBytes, (unsigned)imageBytes);
+    server->send(code, "text/plain", text);
+}
+
+void HttpOta::handleStatus() {
+    sendStatus(200);
+}
+
+void HttpOta::handleBegin() {
+    String requested = server->arg("session");
+    if (state == RECEIVING && requested.length() > 0 && requested == session) {
+        Serial.printf("OTA resume at %u\n", (unsigned)receivedBytes);
+        sendStatus(200);
+        return;
+    }
+
+    if (state == RECEIVING) {
+        Update.abort();
+    }
+    reset();
+
+    String md5 = server->arg("md5");
+    String encoding = server->arg("encoding");
+    uploadBytes = strtoul(server->arg("size").c_str(), NULL, 10);
+    imageBytes = strtoul(server->arg("image").c_str(), NULL, 10);
+    compressed = encoding == "zlib";
+    if (requested.length() == 0 || requested.length() >= sizeof(session) || md5.length() != 32 ||
+        uploadBytes == 0 || imageBytes == 0 || (!compressed && encoding != "raw")) {
+        server->send(400, "text/plain", "Bad OTA parameters\n");
+        return;
+    }
+
+    if (compressed && !allocateInflator()) {
+        server->send(500, "text/plain", "Out of memory\n");
+        return;
+    }
+    if (!Update.begin(imageBytes) || !Update.setMD5(md5.c_str())) {
+        fail(Update.errorString());
+        sendStatus(500);
+        return;
+    }
+
+    strncpy(session, requested.c_str(), sizeof(session) - 1);
+    session[sizeof(session) - 1] = '\0';
+    state = RECEIVING;
+    Serial.printf("OTA begin: %u bytes (%s), image %u bytes\n",
+                  (unsigned)uploadBytes, compressed ? "zlib" : "raw", (unsigned)imageBytes);
+    if (notice) {
+        notice->postProgress(0);
+    }
+    sendStatus(200);
+}
+
+void HttpOta::handleChunkBody() {
+    HTTPRaw& raw = server->raw();
+    if (raw.status == RAW_START) {
+        // A chunk is only accepted at the exact resume offset.
+        chunkOk = state == RECEIVING && server->arg("session") == session &&
+                  strtoul(server->arg("offset").c_str(), NULL, 10) == receivedBytes;
+    } else if (raw.status == RAW_WRITE && chunkOk) {
+        chunkOk = consume(raw.buf, raw.currentSize);
+    }
+}
+
+void HttpOta::handleChunkDone() {
+    sendStatus(chunkOk ? 200 : (state == RECEIVING ? 409 : 400));
+}
+
+void HttpOta::handleCommit() {
+    bool finished = state == RECEIVING && receivedBytes == uploadBytes &&
+                    writtenBytes == imageBytes && (!compressed || inflateDone);
+    if (!finished) {
+        sendStatus(409);
+        return;
+    }
+
+    if (!Update.end(true)) {
+        fail(Update.errorString());
+        sendStatus(500);
+        return;
+    }
+
+    state = COMPLETE;
+    sendStatus(200);
+    Serial.println("OTA image verified, rebooting");
+    if (notice) {
+        notice->post("OTA Update Done");
+    }
+    delay(500);
+    ESP.restart();
+}
+
+bool HttpOta::consume(const uint8_t* data, size_t length) {
+    if (receivedBytes + length > uploadBytes) {
+        fail("upload larger than announced");
+        return false;
+    }
+
+    if (!compressed) {
+        if (!writeImage(data, length)) {
+            return false;
+        }
+        receivedBytes += length;
+    } else {
+        bool lastInput = receivedBytes + length == uploadBytes;
+        size_t consumed = 0;
+        while (!inflateDone) {
+            size_t inBytes = length - consumed;
+            size_t outBytes = TINFL_LZ_DICT_SIZE - windowOffset;
+            mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER | (lastInput ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+            tinfl_status status = tinfl_decompress(inflator, data + consumed, &inBytes, window,
+                                                   window + windowOffset, &outBytes, flags);
+            consumed += inBytes;
+            if (outBytes > 0) {
+                if (!writeImage(window + windowOffset, outBytes)) {
+                    return false;
+                }
+                windowOffset = (windowOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+            }
+            if (status == TINFL_STATUS_DONE) {
+                inflateDone = true;
+            } else if (status < 0) {
+                fail("corrupt compressed stream");
+                return false;
+            } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && consumed == length) {
+                break;
+            }
+        }
+        receivedBytes += length;
+    }
+
+    uint8_t percent = uploadBytes ? (receivedBytes * 100 / uploadBytes) : 0;
+    if (notice && percent != lastPercent) {
+        notice->postProgress(percent);
+    }
+    lastPercent = percent;
+    return true;
+}
+
+bool HttpOta::writeImage(const uint8_t* data, size_t length) {
+    if (writtenBytes + length > imageBytes) {
+        fail("image larger than announced");
+        return false;
+    }
+    if (Update.write(const_cast<uint8_t*>(data), length) != length) {
+        fail(Update.errorString());
+        return false;
+    }
+    writtenBytes += length;
+    return true;
+}
+
+bool HttpOta::allocateInflator() {
+    // Only held while an update is in flight (~43 KB).
+    inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+    window = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+    if (!inflator || !window) {
+        reset();
+        return false;
+    }
+    tinfl_init(inflator);
+    return true;
+}
+
+void HttpOta::reset() {
+    free(inflator);
+    free(window);
+    inflator = NULL;
+    window = NULL;
+    windowOffset = 0;
+    inflateDone = false;
+    state = IDLE;
+    session[0] = '\0';
+    uploadBytes = receivedBytes = imageBytes = writtenBytes = 0;
+    lastPercent = 0;
+}
+
+void HttpOta::fail(const char* reason) {
+    Serial.printf("OTA failed: %s\n", reason);
+    Update.abort();
+    if (notice) {
+        notice->post("OTA Error");
+    }
+    reset();
+    state = FAILED;
+}
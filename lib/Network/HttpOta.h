@@ -0,0 +1,60 @@
+#ifndef HTTP_OTA_H
+#define HTTP_OTA_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <Update.h>
+#if __has_include(<esp32s3/rom/miniz.h>)
+#include <esp32s3/rom/miniz.h>
+#else
+#include <rom/miniz.h>
+#endif
+
+class StatusNotice;
+
+// Firmware updates over HTTP, next to the espota path of ArduinoOTA.
+// Images may be zlib-compressed and are sent in offset-addressed chunks, so
+// a dropped connection resumes where it stopped instead of starting over.
+//
+//   POST /ota/begin?session=S&size=N&image=M&md5=H&encoding=zlib|raw
+//   PUT  /ota/chunk?session=S&offset=O   (body: next bytes of the upload)
+//   GET  /ota/status
+//   POST /ota/commit                     (verifies MD5 and reboots)
+class HttpOta {
+public:
+    HttpOta(StatusNotice* notice);
+    void attach(WebServer& server);
+
+private:
+    enum State { IDLE, RECEIVING, COMPLETE, FAILED };
+
+    WebServer* server;
+    StatusNotice* notice;
+    State state;
+    char session[33];
+    bool compressed;
+    bool chunkOk;
+    size_t uploadBytes;   // bytes the host sends (compressed size)
+    size_t receivedBytes; // resume offset into the upload
+    size_t imageBytes;    // decompressed firmware size
+    size_t writtenBytes;  // firmware bytes handed to Update
+    bool inflateDone;
+    tinfl_decompressor* inflator;
+    uint8_t* window;
+    size_t windowOffset;
+    uint8_t lastPercent;
+
+    void handleStatus();
+    void handleBegin();
+    void handleChunkBody();
+    void handleChunkDone();
+    void handleCommit();
+    void sendStatus(int code);
+    bool consume(const uint8_t* data, size_t length);
+    bool writeImage(const uint8_t* data, size_t length);
+    bool allocateInflator();
+    void reset();
+    void fail(const char* reason);
+};
+
+#endif // HTTP_OTA_H
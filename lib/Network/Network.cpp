@@ -1,25 +1,38 @@
 #include "Network.h"
 #include "../Display/Display.h"
+#include "../Training/Training.h"
+#include "../ConfigStore/ConfigStore.h"
+#include "../MemoryPlan/MemoryReport.h"
 
 const char* Network::BASE_SSID = "ESP32-AP-";
 const char* Network::BASE_OTA_HOSTNAME = "ESP32-OTA-";
 const char* Network::AP_PASSWORD = "12345678";
 
-Network::Network(Display* display) : display(display), robotNumber(0), otaTaskHandle(NULL) {
+Network::Network(Display* display, ConfigStore* config)
+    : display(display), config(config), training(NULL), httpServer(HTTP_SERVER_PORT), httpOta(&notice), modelUpload(0), modelUploadOk(false),
+      robotNumber(0), robotNumberResolved(false), serviceTaskHandle(NULL), pauseDuringTicks(false), controlTickActive(false) {
 }
 
-void Network::begin() {
-    // Initialize EEPROM
-    EEPROM.begin(EEPROM_SIZE);
-    
-    // Read or set robot number
+void Network::resolveRobotNumber() {
     robotNumber = readRobotNumber();
+    robotNumberResolved = true;
+}
+
+void Network::begin() {
+    if (!robotNumberResolved) {
+        resolveRobotNumber();
+    }
     snprintf(ssid, sizeof(ssid), "%s%d", BASE_SSID, robotNumber);
     snprintf(otaHostname, sizeof(otaHostname), "%s%d", BASE_OTA_HOSTNAME, robotNumber);
     
-    // Setup AP and OTA
+    // Setup AP, OTA and model transfer
     setupAP();
     setupOTA();
+    setupHttpServer();
+}
+
+void Network::attachTraining(Training* training) {
+    this->training = training;
 }
 
 void Network::setupAP() {
@@ -37,34 +50,23 @@ void Network::setupOTA() {
     
     ArduinoOTA.onStart([this]() {
         Serial.println("OTA Start");
-        if (display) {
-            display->clear();
-            display->print("OTA Update Start");
-        }
+        notice.post("OTA Update Start");
     });
     
     ArduinoOTA.onEnd([this]() {
         Serial.println("\nOTA End");
-        if (display) {
-            display->clear();
-            display->print("OTA Update Done");
-        }
+        notice.post("OTA Update Done");
     });
     
     ArduinoOTA.onProgress([this](unsigned int progress, unsigned int total) {
         uint8_t percentage = total > 0 ? (progress * 100 / total) : 0;
         Serial.printf("Progress: %u%%\r", percentage);
-        if (display) {
-            display->drawProgressBar(percentage);
-        }
+        notice.postProgress(percentage);
     });
     
     ArduinoOTA.onError([this](ota_error_t error) {
         Serial.printf("Error[%u]: ", error);
-        if (display) {
-            display->clear();
-            display->print("OTA Error");
-        }
+        notice.post("OTA Error");
         if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
         else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
         else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
@@ -77,64 +79,209 @@ void Network::setupOTA() {
     Serial.println(otaHostname);
 }
 
-void Network::startOTATask() {
+void Network::setupHttpServer() {
+    httpServer.on("/model", HTTP_GET, [this]() { handleModelDownload(); });
+    httpServer.on("/model", HTTP_POST,
+                   [this]() { handleModelUploadDone(); },
+                   [this]() { handleModelUpload(); });
+    httpServer.on("/config", HTTP_GET, [this]() { handleConfigGet(); });
+    httpServer.on("/config", HTTP_POST, [this]() { handleConfigSet(); });
+    httpOta.attach(httpServer);
+    httpServer.begin();
+    MDNS.addService("http", "tcp", HTTP_SERVER_PORT);
+    Serial.print("HTTP server on port ");
+    Serial.println(HTTP_SERVER_PORT);
+}
+
+void Network::handleModelDownload() {
+    size_t size = training ? training->getModelSize() : 0;
+    if (size == 0) {
+        httpServer.send(404, "text/plain", "No model\n");
+        return;
+    }
+    httpServer.setContentLength(size);
+    httpServer.send(200, "application/octet-stream", "");
+
+    uint8_t chunk[MODEL_CHUNK_SIZE];
+    size_t offset = 0;
+    while (offset < size) {
+        size_t bytes = training->readModel(offset, chunk, min(sizeof(chunk), size - offset));
+        if (bytes == 0) {
+            break;
+        }
+        httpServer.sendContent(reinterpret_cast<const char*>(chunk), bytes);
+        offset += bytes;
+    }
+}
+
+void Network::handleModelUpload() {
+    HTTPUpload& upload = httpServer.upload();
+    if (!training) {
+        modelUploadOk = false;
+        return;
+    }
+
+    if (upload.status == UPLOAD_FILE_START) {
+        Serial.println("Model upload start");
+        training->abortModelUpload(modelUpload);
+        modelUpload = training->beginModelUpload();
+        modelUploadOk = modelUpload != 0;
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        if (modelUploadOk) {
+            modelUploadOk = training->writeModelUpload(modelUpload, upload.buf, upload.currentSize);
+        }
+    } else if (upload.status == UPLOAD_FILE_END) {
+        if (modelUploadOk) {
+            modelUploadOk = training->finishModelUpload(modelUpload);
+        }
+        modelUpload = 0;
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        training->abortModelUpload(modelUpload);
+        modelUpload = 0;
+        modelUploadOk = false;
+    }
+}
+
+void Network::handleModelUploadDone() {
+    if (!modelUploadOk) {
+        httpServer.send(400, "text/plain", "Model rejected\n");
+        return;
+    }
+    httpServer.send(200, "text/plain", "Model installed\n");
+    notice.post("Model installed");
+}
+
+void Network::handleConfigGet() {
+    if (!config) {
+        httpServer.send(404, "text/plain", "No config store\n");
+        return;
+    }
+    char text[ConfigStore::DESCRIBE_SIZE];
+    size_t length = config->describe(text, sizeof(text));
+    if (length == 0 || length >= sizeof(text)) {
+        Serial.printf("Config listing needs %u bytes\n", static_cast<unsigned>(length));
+        httpServer.send(500, "text/plain", "Config listing truncated\n");
+        return;
+    }
+    httpServer.send(200, "text/plain", text);
+}
+
+void Network::handleConfigSet() {
+    // POST /config?gamma=0.9&ctrlMs=400
+    if (!config || httpServer.args() == 0) {
+        httpServer.send(400, "text/plain", "Nothing to set\n");
+        return;
+    }
+    for (int i = 0; i < httpServer.args(); ++i) {
+        String key = httpServer.argName(i);
+        if (key == "plain") {
+            continue;
+        }
+        if (!config->set(key.c_str(), httpServer.arg(i).c_str())) {
+            httpServer.send(400, "text/plain", "Invalid value for " + key + "\n");
+            return;
+        }
+    }
+    httpServer.send(200, "text/plain", "Saved, reboot to apply\n");
+}
+
+void Network::startServiceTask(UBaseType_t priority, BaseType_t core) {
     xTaskCreatePinnedToCore(
-        otaTaskFunction,
-        "OTATask",
-        4096,
-        NULL,
-        1,
-        &otaTaskHandle,
-        1
+        serviceTaskFunction,
+        "NetService",
+        SERVICE_TASK_STACK,
+        this,
+        priority,
+        &serviceTaskHandle,
+        core
     );
+    MemoryReport::watchTask("NetService", serviceTaskHandle, SERVICE_TASK_STACK);
+}
+
+void Network::setPauseDuringTicks(bool pause) {
+    pauseDuringTicks = pause;
+}
+
+void Network::beginControlTick() {
+    controlTickActive = true;
+}
+
+void Network::endControlTick() {
+    controlTickActive = false;
+    if (pauseDuringTicks) {
+        notifyService();
+    }
+}
+
+void Network::notifyService() {
+    if (serviceTaskHandle) {
+        xTaskNotifyGive(serviceTaskHandle);
+    }
 }
 
-void Network::otaTaskFunction(void* parameter) {
+bool Network::showNotice() {
+    return display && notice.render(*display);
+}
+
+void Network::serviceOnce() {
+    ArduinoOTA.handle();
+    httpServer.handleClient();
+}
+
+void Network::serviceTaskFunction(void* parameter) {
+    Network* network = static_cast<Network*>(parameter);
     for (;;) {
-        ArduinoOTA.handle();
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        // Paused work is picked up as soon as endControlTick() notifies us.
+        if (!(network->pauseDuringTicks && network->controlTickActive)) {
+            network->serviceOnce();
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SERVICE_POLL_INTERVAL_MS));
     }
 }
 
 uint8_t Network::readRobotNumber() {
-    uint8_t number = EEPROM.read(ROBOT_NUM_ADDR);
-    if (number < 1 || number > 8) {
-        Serial.println("Invalid or uninitialized robot number. Please set number (1-8).");
+    if (config && config->hasRobotNumber()) {
+        return config->get().robotNumber;
+    }
+
+    Serial.println("Invalid or uninitialized robot number. Please set number (1-8).");
+    if (display) {
+        display->clear();
+        display->print("Set Robot Num:");
+        display->setCursor(0, 16);
+        display->print("1-8");
+        display->refresh();
+    }
+
+    // Wait a bounded time for input so an unprovisioned robot still boots
+    unsigned long start = millis();
+    while (!Serial.available() && millis() - start < PROVISION_TIMEOUT_MS) {
+        delay(100);
+    }
+
+    if (!Serial.available()) {
+        Serial.println("No robot number entered. Using 1 until provisioned.");
+        return DEFAULT_ROBOT_NUMBER;
+    }
+
+    long number = Serial.parseInt();
+    if (config && number >= ConfigStore::MIN_ROBOT_NUMBER && number <= ConfigStore::MAX_ROBOT_NUMBER &&
+        config->setRobotNumber(static_cast<uint8_t>(number))) {
+        Serial.print("Saved robot number: ");
+        Serial.println(number);
         if (display) {
             display->clear();
-            display->print("Set Robot Num:");
+            display->print("Robot Num Set:");
             display->setCursor(0, 16);
-            display->print("1-8");
-        }
-        
-        while (!Serial.available()) {
-            delay(100);
-        }
-        
-        number = Serial.parseInt();
-        if (number >= 1 && number <= 8) {
-            saveRobotNumber(number);
-            if (display) {
-                display->clear();
-                display->print("Robot Num Set:");
-                display->setCursor(0, 16);
-                display->print(number);
-            }
-            delay(2000);
-        } else {
-            Serial.println("Invalid input. Defaulting to robot number 1.");
-            number = 1;
-            saveRobotNumber(number);
+            display->print(number);
+            display->refresh();
         }
+        delay(2000);
+        return number;
     }
-    return number;
-}
 
-void Network::saveRobotNumber(uint8_t number) {
-    EEPROM.write(ROBOT_NUM_ADDR, number);
-    EEPROM.commit();
-    Serial.print("Saved robot number: ");
-    Serial.println(number);
+    Serial.println("Invalid input. Using 1 until provisioned.");
+    return DEFAULT_ROBOT_NUMBER;
 }
 
 uint8_t Network::getRobotNumber() {
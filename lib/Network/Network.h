@@ -4,40 +4,81 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <ArduinoOTA.h>
-#include <EEPROM.h>
 #include <ESPmDNS.h>
+#include <WebServer.h>
+#include "HttpOta.h"
+#include "StatusNotice.h"
 
-// Forward declaration
+// Forward declarations
 class Display;
+class Training;
+class ConfigStore;
 
 class Network {
 public:
-    Network(Display* display);
+    Network(Display* display, ConfigStore* config);
+    // Reads the robot number from config, or asks for it on Serial and the
+    // display and stores it. begin() does this unless it was done already,
+    // so a begin() on another task should come after it.
+    void resolveRobotNumber();
     void begin();
-    void startOTATask();
+    void attachTraining(Training* training);
+    void startServiceTask(UBaseType_t priority = SERVICE_TASK_PRIORITY,
+                          BaseType_t core = SERVICE_TASK_CORE);
+    void setPauseDuringTicks(bool pause);
+    void beginControlTick();
+    void endControlTick();
+    void notifyService();
+    // Loop task only: draws what the service task posted (OTA progress,
+    // model installed) and returns true while that should stay on screen
+    bool showNotice();
     uint8_t getRobotNumber();
     const char* getSSID();
     const char* getHostname();
     
-    static void otaTaskFunction(void* parameter);
+    static void serviceTaskFunction(void* parameter);
+
+    // Networking runs on core 0, away from the Arduino loop() on core 1.
+    static const UBaseType_t SERVICE_TASK_PRIORITY = 1;
+    static const BaseType_t SERVICE_TASK_CORE = 0;
 
 private:
     Display* display;
+    ConfigStore* config;
+    Training* training;
+    StatusNotice notice;
+    WebServer httpServer;
+    HttpOta httpOta;
+    uint32_t modelUpload;
+    bool modelUploadOk;
     uint8_t robotNumber;
+    bool robotNumberResolved;
     char ssid[32];
     char otaHostname[32];
-    TaskHandle_t otaTaskHandle;
+    TaskHandle_t serviceTaskHandle;
+    volatile bool pauseDuringTicks;
+    volatile bool controlTickActive;
     
-    static const uint8_t EEPROM_SIZE = 1;
-    static const uint8_t ROBOT_NUM_ADDR = 0;
+    static const uint32_t PROVISION_TIMEOUT_MS = 15000;
+    static const uint8_t DEFAULT_ROBOT_NUMBER = 1;
     static const char* BASE_SSID;
     static const char* BASE_OTA_HOSTNAME;
     static const char* AP_PASSWORD;
+    static const uint16_t HTTP_SERVER_PORT = 80;
+    static const uint32_t SERVICE_TASK_STACK = 8192;
+    static const uint32_t SERVICE_POLL_INTERVAL_MS = 10;
+    static const size_t MODEL_CHUNK_SIZE = 1024;
     
     void setupAP();
     void setupOTA();
+    void setupHttpServer();
+    void handleModelDownload();
+    void handleModelUpload();
+    void handleModelUploadDone();
+    void handleConfigGet();
+    void handleConfigSet();
+    void serviceOnce();
     uint8_t readRobotNumber();
-    void saveRobotNumber(uint8_t number);
 };
 
 #endif // NETWORK_H
@@ -0,0 +1,48 @@
+#include "StatusNotice.h"
+#include "../Display/Display.h"
+
+StatusNotice::StatusNotice()
+    : mux(portMUX_INITIALIZER_UNLOCKED), text(NULL), percent(0), sequence(0), drawnSequence(0), postedMs(0) {
+}
+
+void StatusNotice::post(const char* text) {
+    publish(text, 0);
+}
+
+void StatusNotice::postProgress(uint8_t percent) {
+    publish(NULL, percent);
+}
+
+void StatusNotice::publish(const char* text, uint8_t percent) {
+    unsigned long nowMs = millis();
+    portENTER_CRITICAL(&mux);
+    this->text = text;
+    this->percent = percent;
+    ++sequence;
+    postedMs = nowMs;
+    portEXIT_CRITICAL(&mux);
+}
+
+bool StatusNotice::render(Display& display) {
+    portENTER_CRITICAL(&mux);
+    const char* shownText = text;
+    uint8_t shownPercent = percent;
+    uint32_t shownSequence = sequence;
+    unsigned long shownMs = postedMs;
+    portEXIT_CRITICAL(&mux);
+
+    if (shownSequence == 0) {
+        return false;
+    }
+    if (shownSequence != drawnSequence) {
+        drawnSequence = shownSequence;
+        if (shownText) {
+            display.clear();
+            display.print(shownText);
+            display.refresh();
+        } else {
+            display.drawProgressBar(shownPercent);
+        }
+    }
+    return millis() - shownMs < HOLD_MS;
+}
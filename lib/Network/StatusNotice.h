@@ -0,0 +1,37 @@
+#ifndef STATUS_NOTICE_H
+#define STATUS_NOTICE_H
+
+#include <Arduino.h>
+
+class Display;
+
+// What the network service task wants on the OLED. The display shares the
+// I2C bus with the loop task on core 1, so the service task on core 0 only
+// posts a line or an OTA percentage here and the report stage draws it.
+class StatusNotice {
+public:
+    StatusNotice();
+
+    // Any task. text must outlive the notice (a string literal).
+    void post(const char* text);
+    void postProgress(uint8_t percent);
+
+    // Loop task only. Draws the newest notice if it has not been drawn yet
+    // and returns true while one was posted in the last HOLD_MS, so the
+    // caller leaves the screen to it.
+    bool render(Display& display);
+
+private:
+    static const unsigned long HOLD_MS = 3000;
+
+    portMUX_TYPE mux;
+    const char* text; // NULL for a progress bar
+    uint8_t percent;
+    uint32_t sequence;
+    uint32_t drawnSequence;
+    unsigned long postedMs;
+
+    void publish(const char* text, uint8_t percent);
+};
+
+#endif // STATUS_NOTICE_H
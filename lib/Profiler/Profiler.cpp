@@ -0,0 +1,185 @@
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+namespace Profiler
+{
+    namespace
+    {
+        Probe *probes = NULL;
+
+        const size_t kLineSize = 192;
+
+        double toMicros(uint64_t ticks)
+        {
+            return static_cast<double>(ticks) / ticksPerMicrosecond();
+        }
+
+        unsigned long long toNanos(uint64_t ticks)
+        {
+            return ticks * 1000 / ticksPerMicrosecond();
+        }
+    }
+
+#ifdef ARDUINO
+    uint32_t now()
+    {
+        return ESP.getCycleCount();
+    }
+
+    uint32_t ticksPerMicrosecond()
+    {
+        return getCpuFrequencyMhz();
+    }
+#else
+    uint32_t now()
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    uint32_t ticksPerMicrosecond()
+    {
+        return 1000;
+    }
+#endif
+
+    Probe::Probe(const char *name)
+        : name(name),
+          count(0),
+          maxTicks(0),
+          totalTicks(0),
+          next(probes)
+    {
+        memset(buckets, 0, sizeof(buckets));
+        probes = this;
+    }
+
+    void Probe::record(uint32_t ticks)
+    {
+        ++buckets[bucketFor(ticks)];
+        ++count;
+        totalTicks += ticks;
+        if (ticks > maxTicks)
+        {
+            maxTicks = ticks;
+        }
+    }
+
+    void Probe::reset()
+    {
+        count = 0;
+        maxTicks = 0;
+        totalTicks = 0;
+        memset(buckets, 0, sizeof(buckets));
+    }
+
+    uint16_t Probe::bucketFor(uint32_t ticks)
+    {
+        if (ticks < kSubBuckets)
+        {
+            return ticks;
+        }
+        uint8_t msb = 31 - __builtin_clz(ticks);
+        uint8_t exponent = msb - kSubBucketBits + 1;
+        uint8_t sub = (ticks >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+        return exponent * kSubBuckets + sub;
+    }
+
+    uint32_t Probe::bucketLowerTicks(uint16_t bucket)
+    {
+        if (bucket < kSubBuckets)
+        {
+            return bucket;
+        }
+        uint8_t exponent = bucket / kSubBuckets;
+        uint8_t sub = bucket % kSubBuckets;
+        return static_cast<uint32_t>(kSubBuckets + sub) << (exponent - 1);
+    }
+
+    uint32_t Probe::percentileTicks(uint8_t percentile) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        uint64_t target = (static_cast<uint64_t>(count) * percentile + 99) / 100;
+        uint64_t seen = 0;
+        for (uint16_t bucket = 0; bucket < kBuckets; ++bucket)
+        {
+            seen += buckets[bucket];
+            if (seen >= target && seen > 0)
+            {
+                return bucketLowerTicks(bucket);
+            }
+        }
+        return maxTicks;
+    }
+
+    Probe *firstProbe()
+    {
+        return probes;
+    }
+
+    void resetAll()
+    {
+        for (Probe *probe = probes; probe; probe = probe->getNext())
+        {
+            probe->reset();
+        }
+    }
+
+    void dump(LineSink sink)
+    {
+        char line[kLineSize];
+        for (Probe *probe = probes; probe; probe = probe->getNext())
+        {
+            uint32_t count = probe->getCount();
+            if (count == 0)
+            {
+                continue;
+            }
+
+            snprintf(line, sizeof(line),
+                     "prof %s n=%u mean=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f us",
+                     probe->getName(),
+                     static_cast<unsigned>(count),
+                     toMicros(probe->getTotalTicks() / count),
+                     toMicros(probe->percentileTicks(50)),
+                     toMicros(probe->percentileTicks(90)),
+                     toMicros(probe->percentileTicks(99)),
+                     toMicros(probe->getMaxTicks()));
+            sink(line);
+
+            // Bucket lower edges in ns, wrapped so each line fits one log frame
+            int length = snprintf(line, sizeof(line), "hist %s", probe->getName());
+            for (uint16_t bucket = 0; bucket < kBuckets; ++bucket)
+            {
+                uint32_t bucketCount = probe->getBucketCount(bucket);
+                if (bucketCount == 0)
+                {
+                    continue;
+                }
+                char pair[32];
+                int pairLength = snprintf(pair, sizeof(pair), " %llu:%u",
+                                          toNanos(Probe::bucketLowerTicks(bucket)),
+                                          static_cast<unsigned>(bucketCount));
+                if (length + pairLength >= static_cast<int>(sizeof(line)))
+                {
+                    sink(line);
+                    length = snprintf(line, sizeof(line), "hist %s", probe->getName());
+                }
+                memcpy(line + length, pair, pairLength + 1);
+                length += pairLength;
+            }
+            sink(line);
+        }
+    }
+}
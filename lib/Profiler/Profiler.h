@@ -0,0 +1,101 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hot-path latency probes.
+//
+// A Probe is a static object that registers itself on construction and
+// owns a fixed log-linear histogram of durations: eight linear sub-buckets
+// per power of two, so any reading is within 12.5% of its bucket's lower
+// edge and the memory never grows. Time comes from the CPU cycle counter
+// on target and std::chrono on the host.
+//
+//     static Profiler::Probe refreshProbe("display.refresh");
+//     void Display::refresh()
+//     {
+//         PROFILE_SCOPE(refreshProbe);
+//         ...
+//     }
+//
+// Each probe should be hit from one task only; samples from a second task
+// can be lost but never corrupt the histogram. The cycle counter is per
+// core, which is fine as long as that task is pinned. Time spent
+// preempted inside a scope is counted, so a probe measures wall time.
+//
+// Build with -D RLBOT_PROFILER=0 to compile the timing out of every scope.
+#ifndef RLBOT_PROFILER
+#define RLBOT_PROFILER 1
+#endif
+
+namespace Profiler
+{
+    static const uint8_t kSubBucketBits = 3;
+    static const uint8_t kSubBuckets = 1 << kSubBucketBits;
+    static const uint16_t kBuckets = (32 - kSubBucketBits + 1) * kSubBuckets;
+
+    uint32_t now();
+    uint32_t ticksPerMicrosecond();
+
+    class Probe
+    {
+    public:
+        explicit Probe(const char *name);
+
+        void record(uint32_t ticks);
+        void reset();
+
+        const char *getName() const { return name; }
+        uint32_t getCount() const { return count; }
+        uint32_t getMaxTicks() const { return maxTicks; }
+        uint64_t getTotalTicks() const { return totalTicks; }
+        uint32_t getBucketCount(uint16_t bucket) const { return buckets[bucket]; }
+
+        // Lower edge of the bucket holding the given percentile (0-100)
+        uint32_t percentileTicks(uint8_t percentile) const;
+
+        Probe *getNext() const { return next; }
+
+        static uint16_t bucketFor(uint32_t ticks);
+        static uint32_t bucketLowerTicks(uint16_t bucket);
+
+    private:
+        const char *name;
+        uint32_t count;
+        uint32_t maxTicks;
+        uint64_t totalTicks;
+        uint32_t buckets[kBuckets];
+        Probe *next;
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(Probe &probe) : probe(probe), start(now()) {}
+        ~Scope() { probe.record(now() - start); }
+
+    private:
+        Probe &probe;
+        uint32_t start;
+    };
+
+    Probe *firstProbe();
+    void resetAll();
+
+    // For every probe with samples: a summary line with count, mean,
+    // percentiles and max in microseconds, then its non-empty buckets as
+    // "lower_ns:count" pairs. The sink gets one NUL-terminated line at a time.
+    typedef void (*LineSink)(const char *line);
+    void dump(LineSink sink);
+}
+
+#if RLBOT_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(probe) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(probe)
+#else
+#define PROFILE_SCOPE(probe) ((void)0)
+#endif
+
+#endif // PROFILER_H
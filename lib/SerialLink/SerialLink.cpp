@@ -0,0 +1,376 @@
+#include "SerialLink.h"
+#include <Training.h>
+
+SerialLink::SerialLink(HardwareSerial &port)
+    : port(port),
+      training(NULL),
+      commandHandler(NULL),
+      rxLength(0),
+      rxOverflow(false),
+      txSequence(0),
+      streamingSamples(false),
+      modelUpload(0),
+      modelUploadOffset(0)
+{
+}
+
+void SerialLink::begin()
+{
+    // Room for a burst of samples without blocking loop() on the UART
+    port.setTxBufferSize(2048);
+    port.begin(BAUD_RATE);
+}
+
+void SerialLink::attachTraining(Training *training)
+{
+    this->training = training;
+}
+
+void SerialLink::setCommandHandler(CommandHandler handler)
+{
+    commandHandler = handler;
+}
+
+void SerialLink::poll()
+{
+    while (port.available() > 0)
+    {
+        int value = port.read();
+        if (value < 0)
+        {
+            break;
+        }
+
+        uint8_t byte = static_cast<uint8_t>(value);
+        if (byte != 0)
+        {
+            if (rxLength < sizeof(rxBuffer))
+            {
+                rxBuffer[rxLength++] = byte;
+            }
+            else
+            {
+                rxOverflow = true;
+            }
+            continue;
+        }
+
+        if (rxLength > 0 && !rxOverflow)
+        {
+            uint8_t frame[MAX_FRAME];
+            size_t frameLength = cobsDecode(rxBuffer, rxLength, frame);
+            if (frameLength >= 4)
+            {
+                uint16_t expected = frame[frameLength - 2] | (frame[frameLength - 1] << 8);
+                if (crc16(frame, frameLength - 2) == expected)
+                {
+                    handleFrame(frame, frameLength - 2);
+                }
+            }
+        }
+        rxLength = 0;
+        rxOverflow = false;
+    }
+}
+
+void SerialLink::sendTelemetry(const Telemetry &telemetry)
+{
+    sendFrame(MSG_TELEMETRY, &telemetry, sizeof(telemetry), false);
+}
+
+bool SerialLink::sendSample(const Sample &sample)
+{
+    if (!streamingSamples)
+    {
+        return false;
+    }
+    return sendFrame(MSG_SAMPLE, &sample, sizeof(sample), true);
+}
+
+void SerialLink::sendSchedulerStats(const SchedulerStats &stats)
+{
+    sendFrame(MSG_SCHEDULER, &stats, sizeof(stats), false);
+}
+
+void SerialLink::sendLog(const char *text)
+{
+    size_t length = strlen(text);
+    sendFrame(MSG_LOG, text, length < MAX_PAYLOAD ? length : MAX_PAYLOAD, false);
+}
+
+bool SerialLink::sendFrame(uint8_t type, const void *payload, size_t length, bool dropIfBusy)
+{
+    if (length > MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    uint8_t frame[MAX_FRAME];
+    frame[0] = type;
+    frame[1] = txSequence;
+    memcpy(frame + 2, payload, length);
+    uint16_t crc = crc16(frame, length + 2);
+    frame[length + 2] = crc & 0xFF;
+    frame[length + 3] = crc >> 8;
+
+    uint8_t encoded[MAX_ENCODED + 2];
+    encoded[0] = 0;
+    size_t encodedLength = cobsEncode(frame, length + 4, encoded + 1);
+    encoded[encodedLength + 1] = 0;
+
+    if (dropIfBusy && port.availableForWrite() < static_cast<int>(encodedLength + 2))
+    {
+        return false;
+    }
+
+    port.write(encoded, encodedLength + 2);
+    ++txSequence;
+    return true;
+}
+
+void SerialLink::sendAck(uint8_t type, uint8_t seq, uint8_t status)
+{
+    uint8_t payload[3] = {type, seq, status};
+    sendFrame(MSG_ACK, payload, sizeof(payload), false);
+}
+
+void SerialLink::handleFrame(const uint8_t *frame, size_t length)
+{
+    uint8_t type = frame[0];
+    uint8_t seq = frame[1];
+    const uint8_t *payload = frame + 2;
+    size_t payloadLength = length - 2;
+    uint32_t value = 0;
+    if (payloadLength >= sizeof(value))
+    {
+        memcpy(&value, payload, sizeof(value));
+    }
+
+    switch (type)
+    {
+    case MSG_COMMAND:
+        handleCommand(seq, payload, payloadLength);
+        break;
+
+    case MSG_MODEL_BEGIN:
+        // A new begin from the host restarts its own upload; one from the
+        // HTTP side is refused by Training until it finishes
+        if (training != NULL)
+        {
+            training->abortModelUpload(modelUpload);
+            modelUpload = training->beginModelUpload();
+        }
+        modelUploadOffset = 0;
+        sendAck(type, seq, modelUpload != 0 ? ACK_OK : ACK_FAILED);
+        break;
+
+    case MSG_MODEL_CHUNK:
+    {
+        // Chunks must arrive in order; a resend of the last one is acknowledged again.
+        bool ok = modelUpload != 0 && payloadLength > sizeof(value);
+        size_t dataLength = ok ? payloadLength - sizeof(value) : 0;
+        if (ok && value == modelUploadOffset)
+        {
+            ok = training->writeModelUpload(modelUpload, payload + sizeof(value), dataLength);
+            modelUploadOffset += dataLength;
+            modelUpload = ok ? modelUpload : 0;
+        }
+        else if (ok && value + dataLength != modelUploadOffset)
+        {
+            ok = false;
+        }
+        sendAck(type, seq, ok ? ACK_OK : ACK_FAILED);
+        break;
+    }
+
+    case MSG_MODEL_END:
+    {
+        bool ok = modelUpload != 0 && value == modelUploadOffset && training->finishModelUpload(modelUpload);
+        if (!ok && training != NULL)
+        {
+            training->abortModelUpload(modelUpload);
+        }
+        modelUpload = 0;
+        sendAck(type, seq, ok ? ACK_OK : ACK_FAILED);
+        break;
+    }
+
+    case MSG_MODEL_REQUEST:
+        if (!sendModel())
+        {
+            sendAck(type, seq, ACK_FAILED);
+        }
+        break;
+
+#if !RLBOT_INFERENCE_ONLY
+    case MSG_TRANSITIONS_REQUEST:
+        if (!sendTransitions(payloadLength > 0 && payload[0] == 1))
+        {
+            sendAck(type, seq, ACK_FAILED);
+        }
+        break;
+#endif
+
+    default:
+        sendAck(type, seq, ACK_UNSUPPORTED);
+        break;
+    }
+}
+
+void SerialLink::handleCommand(uint8_t seq, const uint8_t *payload, size_t length)
+{
+    if (length < 1)
+    {
+        sendAck(MSG_COMMAND, seq, ACK_UNSUPPORTED);
+        return;
+    }
+
+    uint8_t command = payload[0];
+    bool ok = false;
+    if (command == CMD_STREAM_SAMPLES_ON || command == CMD_STREAM_SAMPLES_OFF)
+    {
+        streamingSamples = command == CMD_STREAM_SAMPLES_ON;
+        ok = true;
+    }
+    else if (commandHandler)
+    {
+        ok = commandHandler(command);
+    }
+    sendAck(MSG_COMMAND, seq, ok ? ACK_OK : ACK_FAILED);
+}
+
+bool SerialLink::sendModel()
+{
+    if (!training || training->getModelSize() == 0)
+    {
+        return false;
+    }
+
+    uint8_t payload[sizeof(uint32_t) + MODEL_CHUNK_SIZE];
+    uint32_t offset = 0;
+    for (;;)
+    {
+        size_t bytes = training->readModel(offset, payload + sizeof(offset), MODEL_CHUNK_SIZE);
+        if (bytes == 0)
+        {
+            break;
+        }
+        memcpy(payload, &offset, sizeof(offset));
+        sendFrame(MSG_MODEL_CHUNK, payload, sizeof(offset) + bytes, false);
+        offset += bytes;
+    }
+    sendFrame(MSG_MODEL_END, &offset, sizeof(offset), false);
+    return true;
+}
+
+#if !RLBOT_INFERENCE_ONLY
+bool SerialLink::sendTransitions(bool previous)
+{
+    uint8_t payload[sizeof(uint32_t) + MODEL_CHUNK_SIZE];
+    uint32_t offset = 0;
+    uint32_t firstGeneration = 0;
+    for (;;)
+    {
+        uint32_t generation = 0;
+        size_t bytes = training ? training->readTransitions(previous, offset, payload + sizeof(offset),
+                                                           MODEL_CHUNK_SIZE, generation)
+                                : 0;
+        if (offset == 0)
+        {
+            firstGeneration = generation;
+        }
+        else if (generation != firstGeneration)
+        {
+            // The log rotated or was cleared between two chunks, so the
+            // rest would come from another file; the host pulls again
+            return false;
+        }
+        if (bytes == 0)
+        {
+            break;
+        }
+        memcpy(payload, &offset, sizeof(offset));
+        sendFrame(MSG_MODEL_CHUNK, payload, sizeof(offset) + bytes, false);
+        offset += bytes;
+    }
+    if (offset == 0)
+    {
+        return false;
+    }
+    sendFrame(MSG_MODEL_END, &offset, sizeof(offset), false);
+    return true;
+}
+#endif
+
+size_t SerialLink::cobsEncode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t readIndex = 0;
+    size_t writeIndex = 1;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+
+    while (readIndex < length)
+    {
+        if (input[readIndex] == 0)
+        {
+            output[codeIndex] = code;
+            code = 1;
+            codeIndex = writeIndex++;
+            ++readIndex;
+            continue;
+        }
+
+        output[writeIndex++] = input[readIndex++];
+        if (++code == 0xFF)
+        {
+            output[codeIndex] = code;
+            code = 1;
+            codeIndex = writeIndex++;
+        }
+    }
+
+    output[codeIndex] = code;
+    return writeIndex;
+}
+
+size_t SerialLink::cobsDecode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t readIndex = 0;
+    size_t writeIndex = 0;
+
+    while (readIndex < length)
+    {
+        uint8_t code = input[readIndex];
+        if (code == 0 || readIndex + code > length)
+        {
+            return 0;
+        }
+        ++readIndex;
+
+        for (uint8_t i = 1; i < code; ++i)
+        {
+            output[writeIndex++] = input[readIndex++];
+        }
+        if (code != 0xFF && readIndex != length)
+        {
+            output[writeIndex++] = 0;
+        }
+    }
+
+    return writeIndex;
+}
+
+uint16_t SerialLink::crc16(const uint8_t *data, size_t length)
+{
+    // CRC-16/CCITT-FALSE
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,149 @@
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <Arduino.h>
+
+class Training;
+
+// Binary host link over the USB serial port.
+//
+// Frame on the wire: 0x00, COBS(type, seq, payload..., crc16), 0x00
+// The leading delimiter keeps stray text printed by other modules from
+// running into a frame; the host drops whatever fails the CRC.
+class SerialLink
+{
+public:
+    enum MessageType : uint8_t
+    {
+        MSG_TELEMETRY = 0x01,     // robot -> host, Telemetry
+        MSG_COMMAND = 0x02,       // host -> robot, uint8 Command
+        MSG_ACK = 0x03,           // robot -> host, {type, seq, AckStatus}
+        MSG_MODEL_BEGIN = 0x04,   // host -> robot, uint32 size
+        MSG_MODEL_CHUNK = 0x05,   // both ways, uint32 offset + bytes
+        MSG_MODEL_END = 0x06,     // both ways, uint32 size
+        MSG_MODEL_REQUEST = 0x07, // host -> robot
+        MSG_LOG = 0x08,           // robot -> host, text
+        MSG_SAMPLE = 0x09,        // robot -> host, Sample
+        MSG_SCHEDULER = 0x0A,     // robot -> host, SchedulerStats
+        // host -> robot, uint8 0 for the transition log, 1 for the one it
+        // replaced; answered with MSG_MODEL_CHUNK and MSG_MODEL_END frames,
+        // or ACK_FAILED when there is no log or it rotated during the pull
+        MSG_TRANSITIONS_REQUEST = 0x0B,
+    };
+
+    enum Command : uint8_t
+    {
+        CMD_START_TRAINING = 1,
+        CMD_STOP_TRAINING = 2,
+        CMD_RESET_MODEL = 3,
+        CMD_LOAD_MODEL = 4,
+        CMD_SAVE_MODEL = 5,
+        CMD_STREAM_SAMPLES_ON = 6,
+        CMD_STREAM_SAMPLES_OFF = 7,
+        CMD_PROFILE_DUMP = 8,     // hot-path histograms as MSG_LOG lines
+        CMD_PROFILE_RESET = 9,
+        CMD_MEMORY_REPORT = 10,   // heap and task stack headroom as MSG_LOG lines
+        CMD_STORAGE_BENCH = 11,   // checkpoint cost per storage backend as MSG_LOG lines
+        CMD_EXPLORE_EPSILON = 12, // exploration until reboot; explore in the config store persists it
+        CMD_EXPLORE_UCB = 13,
+        CMD_EXPLORE_SOFTMAX = 14,
+        CMD_CLEAR_TRANSITIONS = 15, // removes both transition logs
+    };
+
+    enum AckStatus : uint8_t
+    {
+        ACK_OK = 0,
+        ACK_FAILED = 1,
+        ACK_UNSUPPORTED = 2,
+    };
+
+    enum TelemetryFlags : uint8_t
+    {
+        TELEMETRY_TRAINING = 1 << 0,
+        TELEMETRY_ACTION_CHOSEN = 1 << 1,
+        TELEMETRY_DOWN_ACTION = 1 << 2,
+    };
+
+    struct __attribute__((packed)) Telemetry
+    {
+        uint32_t timeMs;
+        float deltaDistanceCm;
+        float avgSpeedCms;
+        float avgAccelMps2;
+        float reward;
+        float epsilon;
+        uint32_t episodes;
+        int8_t actionIndex;
+        uint8_t targetDownAngle;
+        uint8_t targetUpAngle;
+        uint8_t flags;
+    };
+
+    struct __attribute__((packed)) Sample
+    {
+        uint32_t timeUs;
+        float linearAccel[3];
+        float speedCms;
+    };
+
+    // Control tick timing since the previous report. Bucket i of the
+    // lateness histogram counts wakeups under 64 << i us; the last bucket
+    // is open ended.
+    struct __attribute__((packed)) SchedulerStats
+    {
+        uint32_t timeMs;
+        uint32_t periodUs;
+        uint32_t ticks;
+        uint32_t droppedTicks;
+        uint32_t overruns;
+        uint32_t maxLatenessUs;
+        uint16_t latenessHistogram[8];
+    };
+
+    // Returns true if the command was carried out.
+    typedef bool (*CommandHandler)(uint8_t command);
+
+    static const unsigned long BAUD_RATE = 921600;
+
+    SerialLink(HardwareSerial &port);
+    void begin();
+    void attachTraining(Training *training);
+    void setCommandHandler(CommandHandler handler);
+    void poll();
+
+    void sendTelemetry(const Telemetry &telemetry);
+    bool sendSample(const Sample &sample);
+    void sendSchedulerStats(const SchedulerStats &stats);
+    void sendLog(const char *text);
+    bool isStreamingSamples() const { return streamingSamples; }
+
+    static size_t cobsEncode(const uint8_t *input, size_t length, uint8_t *output);
+    static size_t cobsDecode(const uint8_t *input, size_t length, uint8_t *output);
+    static uint16_t crc16(const uint8_t *data, size_t length);
+
+private:
+    static const size_t MAX_PAYLOAD = 224;
+    static const size_t MODEL_CHUNK_SIZE = 192;
+    static const size_t MAX_FRAME = MAX_PAYLOAD + 4; // type, seq, crc16
+    static const size_t MAX_ENCODED = MAX_FRAME + (MAX_FRAME / 254) + 1;
+
+    HardwareSerial &port;
+    Training *training;
+    CommandHandler commandHandler;
+    uint8_t rxBuffer[MAX_ENCODED];
+    size_t rxLength;
+    bool rxOverflow;
+    uint8_t txSequence;
+    bool streamingSamples;
+    uint32_t modelUpload;
+    uint32_t modelUploadOffset;
+
+    bool sendFrame(uint8_t type, const void *payload, size_t length, bool dropIfBusy);
+    void handleFrame(const uint8_t *frame, size_t length);
+    void handleCommand(uint8_t seq, const uint8_t *payload, size_t length);
+    void sendAck(uint8_t type, uint8_t seq, uint8_t status);
+    bool sendModel();
+    bool sendTransitions(bool previous);
+};
+
+#endif // SERIAL_LINK_H
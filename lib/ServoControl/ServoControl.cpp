@@ -1,4 +1,8 @@
 #include "ServoControl.h"
+#include <Profiler.h>
+
+static Profiler::Probe moveDownProbe("servo.down");
+static Profiler::Probe moveUpProbe("servo.up");
 
 ServoControl::ServoControl(uint8_t pinDown, uint8_t pinUp) 
     : pinDown(pinDown), pinUp(pinUp), 
@@ -25,11 +29,13 @@ void ServoControl::moveUp(int angle) {
 }
 
 void ServoControl::moveDownSmooth(int targetAngle, int stepDelay) {
+    PROFILE_SCOPE(moveDownProbe);
     targetAngle = constrain(targetAngle, 0, 180);
     moveServoSmooth(servoDown, currentDownAngle, targetAngle, stepDelay);
 }
 
 void ServoControl::moveUpSmooth(int targetAngle, int stepDelay) {
+    PROFILE_SCOPE(moveUpProbe);
     targetAngle = constrain(targetAngle, 0, 180);
     moveServoSmooth(servoUp, currentUpAngle, targetAngle, stepDelay);
 }
@@ -0,0 +1,81 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Bounded single-producer/single-consumer ring buffer.
+//
+// push() may only be called from one task and pop() from one other task;
+// no locks are taken, so either side can run on either core. One slot is
+// kept free to tell full from empty, so the queue holds Capacity - 1 items.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+    SpscQueue() : head(0), tail(0), highWater(0)
+    {
+    }
+
+    bool push(const T &item)
+    {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t nextTail = advance(currentTail);
+        if (nextTail == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        items[currentTail] = item;
+        tail.store(nextTail, std::memory_order_release);
+
+        size_t depth = size();
+        if (depth > highWater.load(std::memory_order_relaxed))
+        {
+            highWater.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[currentHead];
+        head.store(advance(currentHead), std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const
+    {
+        size_t currentHead = head.load(std::memory_order_acquire);
+        size_t currentTail = tail.load(std::memory_order_acquire);
+        return (currentTail + Capacity - currentHead) % Capacity;
+    }
+
+    bool isFull() const
+    {
+        return advance(tail.load(std::memory_order_acquire)) == head.load(std::memory_order_acquire);
+    }
+
+    // Deepest the queue has been since the last call
+    size_t takeHighWater()
+    {
+        return highWater.exchange(size(), std::memory_order_relaxed);
+    }
+
+    static size_t capacity() { return Capacity - 1; }
+
+private:
+    static size_t advance(size_t index) { return (index + 1) % Capacity; }
+
+    T items[Capacity];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<size_t> highWater;
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,32 @@
+#ifndef COMPILED_GAIT_H
+#define COMPILED_GAIT_H
+
+#include <stdint.h>
+
+// A table policy distilled into the poses it walks through.
+//
+// Every action sets one servo to one of its angle options, and the robot
+// starts at the first option of each, so the greedy policy only ever
+// visits option pairs, in a fixed order: a lead-in, then a cycle it
+// repeats forever. Replaying that order gives the same servo targets that
+// Training::infer() would, without a state lookup or an argmax per step.
+//
+// tools/gait_compiler.py writes one from a model file as a header of
+// constexpr keyframes; Training can also distil one from the table it has
+// loaded.
+struct GaitKeyframe
+{
+    uint8_t action;
+    uint8_t downAngleDeg;
+    uint8_t upAngleDeg;
+};
+
+struct CompiledGait
+{
+    const GaitKeyframe *frames;
+    uint8_t frameCount;
+    // Where replay continues after the last frame
+    uint8_t loopStart;
+};
+
+#endif // COMPILED_GAIT_H
@@ -0,0 +1,187 @@
+#include "ModelCheckpointer.h"
+#include <MemoryReport.h>
+
+#if !RLBOT_INFERENCE_ONLY
+ModelCheckpointer::ModelCheckpointer(Training *training)
+    : training(training),
+      task(NULL),
+      droppedUpdates(0),
+      droppedTransitions(0),
+      pendingUpdates(0),
+      lastDropped(0),
+      stats()
+{
+}
+
+bool ModelCheckpointer::start(bool logTransitions, UBaseType_t priority, BaseType_t core)
+{
+    if (task != NULL)
+    {
+        return true;
+    }
+    if (xTaskCreatePinnedToCore(taskFunction, "Checkpoint", kTaskStack, this, priority, &task, core) != pdPASS)
+    {
+        Serial.println("Checkpoint task failed to start");
+        return false;
+    }
+    MemoryReport::watchTask("Checkpoint", task, kTaskStack);
+    training->setUpdateHandler(onUpdate, this);
+    if (logTransitions)
+    {
+        training->setTransitionHandler(onTransition, this);
+    }
+    return true;
+}
+
+ModelCheckpointer::Stats ModelCheckpointer::getStats() const
+{
+    Stats copy = stats;
+    copy.dropped = droppedUpdates;
+    copy.transitionsDropped = droppedTransitions;
+    return copy;
+}
+
+void ModelCheckpointer::onUpdate(void *context, const Training::CellUpdate &update)
+{
+    ModelCheckpointer *self = static_cast<ModelCheckpointer *>(context);
+    if (!self->updates.push(update))
+    {
+        // The next checkpoint covers it
+        self->droppedUpdates = self->droppedUpdates + 1;
+    }
+}
+
+void ModelCheckpointer::onTransition(void *context, const TransitionLog::Record &record)
+{
+    ModelCheckpointer *self = static_cast<ModelCheckpointer *>(context);
+    if (!self->transitions.push(record))
+    {
+        self->droppedTransitions = self->droppedTransitions + 1;
+    }
+}
+
+void ModelCheckpointer::taskFunction(void *parameter)
+{
+    static_cast<ModelCheckpointer *>(parameter)->run();
+}
+
+void ModelCheckpointer::run()
+{
+    unsigned long lastFlushMs = millis();
+    unsigned long lastCheckpointMs = lastFlushMs;
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(kPollIntervalMs));
+
+        if (training->takeSaveRequest())
+        {
+            flush();
+            // The saved model covers everything journaled so far, like a
+            // checkpoint does
+            if (training->saveModel())
+            {
+                ++stats.checkpoints;
+                pendingUpdates = 0;
+                lastCheckpointMs = millis();
+            }
+            else
+            {
+                ++stats.failures;
+            }
+        }
+
+        unsigned long nowMs = millis();
+        if (nowMs - lastFlushMs < kFlushIntervalMs)
+        {
+            continue;
+        }
+        flush();
+        flushTransitions();
+        lastFlushMs = nowMs;
+
+        uint32_t dropped = droppedUpdates;
+        bool lost = dropped != lastDropped;
+        lastDropped = dropped;
+        bool due = pendingUpdates > 0 && nowMs - lastCheckpointMs >= kCheckpointIntervalMs;
+        if (lost || due || training->getJournalBytes() >= kMaxJournalBytes)
+        {
+            checkpoint();
+            lastCheckpointMs = nowMs;
+        }
+    }
+}
+
+void ModelCheckpointer::flush()
+{
+    Training::CellUpdate batch[kBatchSize];
+    size_t count = 0;
+    for (;;)
+    {
+        bool more = updates.pop(batch[count]);
+        if (more)
+        {
+            ++count;
+        }
+        if (count == kBatchSize || (!more && count > 0))
+        {
+            if (training->appendJournal(batch, count))
+            {
+                stats.journaled += count;
+                pendingUpdates += count;
+            }
+            else
+            {
+                ++stats.failures;
+            }
+            count = 0;
+        }
+        if (!more)
+        {
+            return;
+        }
+    }
+}
+
+void ModelCheckpointer::flushTransitions()
+{
+    TransitionLog::Record batch[kBatchSize];
+    size_t count = 0;
+    for (;;)
+    {
+        bool more = transitions.pop(batch[count]);
+        if (more)
+        {
+            ++count;
+        }
+        if (count == kBatchSize || (!more && count > 0))
+        {
+            if (training->appendTransitions(batch, count))
+            {
+                stats.transitionsLogged += count;
+            }
+            else
+            {
+                ++stats.failures;
+            }
+            count = 0;
+        }
+        if (!more)
+        {
+            return;
+        }
+    }
+}
+
+void ModelCheckpointer::checkpoint()
+{
+    if (training->compactJournal())
+    {
+        ++stats.checkpoints;
+        pendingUpdates = 0;
+    }
+    else
+    {
+        ++stats.failures;
+    }
+}
+#endif
@@ -0,0 +1,70 @@
+#ifndef MODEL_CHECKPOINTER_H
+#define MODEL_CHECKPOINTER_H
+
+#include <Arduino.h>
+#include <SpscQueue.h>
+#include "Training.h"
+
+#if !RLBOT_INFERENCE_ONLY
+// Background writer for Training's crash-safe checkpoints.
+//
+// Training::step() hands every changed Q-table cell to this class through
+// a lock-free queue and returns; all flash I/O happens in a low-priority
+// task on core 0. The task appends the queued cells to the journal about
+// once a second. It compacts the journal into a fresh checkpoint every few
+// minutes, or sooner when the journal grows large or the queue overflowed.
+// It also performs the save that Training::requestSave() asks for when a
+// run ends. A power cut loses at most the last second of training.
+//
+// With logTransitions, step()'s transitions go through a second queue and
+// are appended to Training's transition log on the same schedule.
+class ModelCheckpointer
+{
+public:
+    struct Stats
+    {
+        uint32_t journaled;
+        uint32_t dropped;
+        uint32_t checkpoints;
+        uint32_t failures;
+        uint32_t transitionsLogged;
+        uint32_t transitionsDropped;
+    };
+
+    explicit ModelCheckpointer(Training *training);
+
+    bool start(bool logTransitions, UBaseType_t priority = TASK_PRIORITY, BaseType_t core = TASK_CORE);
+    Stats getStats() const;
+
+    static const UBaseType_t TASK_PRIORITY = 1;
+    static const BaseType_t TASK_CORE = 0;
+
+private:
+    static const uint32_t kTaskStack = 4096;
+    static const uint32_t kPollIntervalMs = 100;
+    static const uint32_t kFlushIntervalMs = 1000;
+    static const uint32_t kCheckpointIntervalMs = 5 * 60 * 1000;
+    static const size_t kMaxJournalBytes = 16 * 1024;
+    static const size_t kBatchSize = 16;
+
+    Training *training;
+    TaskHandle_t task;
+    SpscQueue<Training::CellUpdate, 129> updates;
+    SpscQueue<TransitionLog::Record, 33> transitions;
+    volatile uint32_t droppedUpdates;
+    volatile uint32_t droppedTransitions;
+    uint32_t pendingUpdates;
+    uint32_t lastDropped;
+    Stats stats;
+
+    static void onUpdate(void *context, const Training::CellUpdate &update);
+    static void onTransition(void *context, const TransitionLog::Record &record);
+    static void taskFunction(void *parameter);
+    void run();
+    void flush();
+    void flushTransitions();
+    void checkpoint();
+};
+#endif
+
+#endif // MODEL_CHECKPOINTER_H
@@ -0,0 +1,164 @@
+#include "ModelFormat.h"
+#include <string.h>
+
+namespace ModelFormat
+{
+    size_t fileSize(uint16_t stateCount, uint16_t actionCount)
+    {
+        return sizeof(Header) + static_cast<size_t>(stateCount) * actionCount * 8 + sizeof(Trailer);
+    }
+
+    void initHeader(Header &header, uint8_t downOptionCount, uint8_t upOptionCount)
+    {
+        memset(&header, 0, sizeof(header));
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.headerSize = sizeof(Header);
+        header.downOptionCount = downOptionCount;
+        header.upOptionCount = upOptionCount;
+        header.stateCount = downOptionCount * upOptionCount;
+        header.actionCount = downOptionCount + upOptionCount;
+        header.qOffset = sizeof(Header);
+        header.visitsOffset = header.qOffset + header.stateCount * header.actionCount * sizeof(float);
+        header.fileSize = fileSize(header.stateCount, header.actionCount);
+    }
+
+    uint32_t crc32(uint32_t crc, const void *data, size_t length)
+    {
+        // Reflected 0xEDB88320, same as zlib's crc32(); a nibble table
+        // keeps it fast without spending 1 KB of flash on a byte table
+        static const uint32_t kNibbles[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+        };
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        crc = ~crc;
+        while (length--)
+        {
+            crc ^= *bytes++;
+            crc = kNibbles[crc & 0x0F] ^ (crc >> 4);
+            crc = kNibbles[crc & 0x0F] ^ (crc >> 4);
+        }
+        return ~crc;
+    }
+
+    View::View()
+        : error(NULL),
+          header(NULL),
+          qTable(NULL),
+          visitCounts(NULL),
+          version(0),
+          crc(0),
+          stateCount(0),
+          actionCount(0)
+    {
+    }
+
+    bool View::fail(const char *message)
+    {
+        error = message;
+        header = NULL;
+        qTable = NULL;
+        visitCounts = NULL;
+        return false;
+    }
+
+    bool View::open(const void *data, size_t length)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        if (reinterpret_cast<uintptr_t>(bytes) % sizeof(uint32_t) != 0)
+        {
+            return fail("model image is not aligned");
+        }
+        if (length < sizeof(LegacyHeader))
+        {
+            return fail("model file is incomplete");
+        }
+
+        const LegacyHeader *legacy = reinterpret_cast<const LegacyHeader *>(bytes);
+        if (legacy->magic != kMagic)
+        {
+            return fail("bad model magic");
+        }
+
+        size_t qOffset = 0;
+        size_t visitsOffset = 0;
+        size_t bodySize = 0;
+        bool trailerRequired = true;
+        if (legacy->version == kVersion)
+        {
+            if (length < sizeof(Header))
+            {
+                return fail("model file is incomplete");
+            }
+            const Header *candidate = reinterpret_cast<const Header *>(bytes);
+            size_t cells = static_cast<size_t>(candidate->stateCount) * candidate->actionCount;
+            if (candidate->downOptionCount == 0 || candidate->downOptionCount > kMaxAngleOptions ||
+                candidate->upOptionCount == 0 || candidate->upOptionCount > kMaxAngleOptions ||
+                candidate->stateCount != candidate->downOptionCount * candidate->upOptionCount ||
+                candidate->actionCount != candidate->downOptionCount + candidate->upOptionCount)
+            {
+                return fail("model table shape is invalid");
+            }
+            if (candidate->headerSize < sizeof(Header) || candidate->qOffset < candidate->headerSize ||
+                candidate->qOffset % sizeof(uint32_t) != 0 ||
+                candidate->visitsOffset != candidate->qOffset + cells * sizeof(float) ||
+                candidate->fileSize != candidate->visitsOffset + cells * sizeof(uint32_t) + sizeof(Trailer))
+            {
+                return fail("model header sizes are inconsistent");
+            }
+            if (candidate->fileSize != length)
+            {
+                return fail(length < candidate->fileSize ? "model file is incomplete" : "model file too large");
+            }
+            header = candidate;
+            stateCount = candidate->stateCount;
+            actionCount = candidate->actionCount;
+            qOffset = candidate->qOffset;
+            visitsOffset = candidate->visitsOffset;
+            bodySize = candidate->fileSize - sizeof(Trailer);
+        }
+        else if (legacy->version == kLegacyVersion)
+        {
+            size_t cells = static_cast<size_t>(legacy->stateCount) * legacy->actionCount;
+            if (legacy->stateCount == 0 || legacy->stateCount > kMaxStates || legacy->actionCount == 0 ||
+                legacy->actionCount > kMaxActions || legacy->payloadSize != cells * 8)
+            {
+                return fail("model table shape is invalid");
+            }
+            bodySize = sizeof(LegacyHeader) + legacy->payloadSize;
+            // Files saved before the CRC was added end right after the tables
+            trailerRequired = false;
+            if (length != bodySize && length != bodySize + sizeof(Trailer))
+            {
+                return fail(length < bodySize ? "model file is incomplete" : "model file too large");
+            }
+            header = NULL;
+            stateCount = legacy->stateCount;
+            actionCount = legacy->actionCount;
+            qOffset = sizeof(LegacyHeader);
+            visitsOffset = qOffset + cells * sizeof(float);
+        }
+        else
+        {
+            return fail("unsupported model version");
+        }
+
+        crc = crc32(0, bytes, bodySize);
+        if (trailerRequired || length > bodySize)
+        {
+            Trailer trailer;
+            memcpy(&trailer, bytes + bodySize, sizeof(trailer));
+            if (trailer != crc)
+            {
+                return fail("model CRC mismatch");
+            }
+        }
+
+        version = legacy->version;
+        qTable = reinterpret_cast<const float *>(bytes + qOffset);
+        visitCounts = reinterpret_cast<const uint32_t *>(bytes + visitsOffset);
+        error = NULL;
+        return true;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef MODEL_FORMAT_H
+#define MODEL_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Training model files, version 3.
+//
+//     offset 0            Header (96 bytes)
+//     header.qOffset      float    q[stateCount][actionCount]
+//     header.visitsOffset uint32_t visits[stateCount][actionCount]
+//     fileSize - 4        uint32_t CRC-32 (zlib) of every byte before it
+//
+// A model describes itself: the angle options that define its states and
+// actions, the hyperparameters it was trained with and how far training
+// got. States are down-option-major (state = down * upCount + up); actions
+// are the down options followed by the up options.
+//
+// Every field sits at a multiple of its size and the tables start on a
+// 4-byte boundary, so a whole file that is loaded or memory-mapped at an
+// aligned address can be read in place through a View, without copying
+// the tables out. The layout is little-endian, which both the ESP32-S3 and
+// the host tools are. tools/rlmodel.py mirrors it.
+//
+// Version 2 files are a 20-byte header (magic, version, stateCount,
+// actionCount, payloadSize) followed by the same two tables and, in later
+// files, the same CRC. They carry no angle options and only load into the
+// firmware's default layout; `rlmodel.py convert` upgrades them.
+namespace ModelFormat
+{
+    static const uint32_t kMagic = 0x524C4D31; // "RLM1"
+    static const uint32_t kVersion = 3;
+    static const uint32_t kLegacyVersion = 2;
+    static const uint8_t kMaxAngleOptions = 8;
+    static const uint32_t kMaxStates = kMaxAngleOptions * kMaxAngleOptions;
+    static const uint32_t kMaxActions = kMaxAngleOptions * 2;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t fileSize;
+        uint16_t stateCount;
+        uint16_t actionCount;
+        uint16_t downOptionCount;
+        uint16_t upOptionCount;
+        uint32_t qOffset;
+        uint32_t visitsOffset;
+
+        // Training progress when the model was written
+        uint32_t totalEpisodes;
+        uint32_t trainingSeconds;
+        float epsilon;
+
+        float gamma;
+        float epsilonStart;
+        float epsilonMin;
+        float epsilonDecay;
+        int16_t downAngles[kMaxAngleOptions];
+        int16_t upAngles[kMaxAngleOptions];
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 96, "ModelFormat::Header layout changed");
+
+    struct LegacyHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t stateCount;
+        uint32_t actionCount;
+        uint32_t payloadSize;
+    };
+
+    typedef uint32_t Trailer;
+
+    // Size of a version 3 file with the given table shape
+    size_t fileSize(uint16_t stateCount, uint16_t actionCount);
+
+    // Largest file either version can have, for sizing uploads and buffers
+    static const size_t kMaxFileSize = sizeof(Header) + kMaxStates * kMaxActions * 8 + sizeof(Trailer);
+
+    // Fills in magic, version, sizes and table offsets for the given
+    // option counts; the caller fills in the rest
+    void initHeader(Header &header, uint8_t downOptionCount, uint8_t upOptionCount);
+
+    uint32_t crc32(uint32_t crc, const void *data, size_t length);
+
+    // A checked model image. open() verifies the header, the sizes and the
+    // CRC; after that the accessors read straight from the image, which
+    // must stay valid and unchanged for as long as the View is used.
+    class View
+    {
+    public:
+        View();
+
+        bool open(const void *data, size_t length);
+        const char *getError() const { return error; }
+
+        uint32_t getVersion() const { return version; }
+        uint32_t getCrc() const { return crc; }
+        uint16_t getStateCount() const { return stateCount; }
+        uint16_t getActionCount() const { return actionCount; }
+
+        // NULL for version 2 images, which have no header of this kind
+        const Header *getHeader() const { return header; }
+
+        float q(int state, int action) const { return qTable[state * actionCount + action]; }
+        uint32_t visits(int state, int action) const { return visitCounts[state * actionCount + action]; }
+
+    private:
+        const char *error;
+        const Header *header;
+        const float *qTable;
+        const uint32_t *visitCounts;
+        uint32_t version;
+        uint32_t crc;
+        uint16_t stateCount;
+        uint16_t actionCount;
+
+        bool fail(const char *message);
+    };
+}
+
+#endif // MODEL_FORMAT_H
@@ -0,0 +1,199 @@
+#include "QNetwork.h"
+#include <math.h>
+#include <new>
+
+namespace
+{
+    const size_t kWeightCount = QNetwork::kHidden * QNetwork::kInputs + QNetwork::kMaxOutputs * QNetwork::kHidden +
+                                QNetwork::kMaxOutputs;
+    const size_t kAlignBytes = 16;
+    const uint32_t kInitSeed = 0x2545F491;
+
+    static_assert(QNetwork::kInputs % 4 == 0 && QNetwork::kHidden % 4 == 0, "Kernels work in groups of four");
+
+    // sum(a[i] * b[i]) over n floats, n a multiple of 4
+    inline float dot(const float *__restrict a, const float *__restrict b, int n)
+    {
+        float sum0 = 0.0f;
+        float sum1 = 0.0f;
+        float sum2 = 0.0f;
+        float sum3 = 0.0f;
+        for (int i = 0; i < n; i += 4)
+        {
+            sum0 += a[i] * b[i];
+            sum1 += a[i + 1] * b[i + 1];
+            sum2 += a[i + 2] * b[i + 2];
+            sum3 += a[i + 3] * b[i + 3];
+        }
+        return (sum0 + sum1) + (sum2 + sum3);
+    }
+
+    // y[i] += scale * x[i] over n floats, n a multiple of 4
+    inline void axpy(float scale, const float *__restrict x, float *__restrict y, int n)
+    {
+        for (int i = 0; i < n; i += 4)
+        {
+            y[i] += scale * x[i];
+            y[i + 1] += scale * x[i + 1];
+            y[i + 2] += scale * x[i + 2];
+            y[i + 3] += scale * x[i + 3];
+        }
+    }
+
+    // xorshift32, so the initial weights do not depend on, or disturb, the
+    // exploration sequence from random()
+    float nextUniform(uint32_t &state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 24) * 2.0f - 1.0f;
+    }
+}
+
+QNetwork::QNetwork()
+    : weights(NULL),
+      allocation(NULL),
+      outputCount(0)
+{
+}
+
+QNetwork::~QNetwork()
+{
+    end();
+}
+
+bool QNetwork::begin(int outputCount)
+{
+    end();
+    if (outputCount < 1 || outputCount > kMaxOutputs)
+    {
+        return false;
+    }
+
+    uint8_t *raw = new (std::nothrow) uint8_t[kWeightCount * sizeof(float) + kAlignBytes];
+    if (raw == NULL)
+    {
+        return false;
+    }
+    allocation = raw;
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + kAlignBytes - 1) & ~(uintptr_t)(kAlignBytes - 1);
+    weights = reinterpret_cast<float *>(aligned);
+    this->outputCount = outputCount;
+    clear();
+    return true;
+}
+
+void QNetwork::end()
+{
+    delete[] static_cast<uint8_t *>(allocation);
+    allocation = NULL;
+    weights = NULL;
+}
+
+size_t QNetwork::getParameterCount() const
+{
+    return isActive() ? kHidden * kInputs + outputCount * (kHidden + 1) : 0;
+}
+
+size_t QNetwork::getMemoryBytes() const
+{
+    return isActive() ? kWeightCount * sizeof(float) + kAlignBytes : 0;
+}
+
+void QNetwork::encode(float downAngleDeg, float upAngleDeg, float speedCms, float accelerationMps2, Input &input)
+{
+    // Angles to [-1, 1], with their squares and product so a few hidden
+    // units can already tell the corners of the pose space apart
+    float down = constrain(downAngleDeg, 0.0f, 180.0f) / 90.0f - 1.0f;
+    float up = constrain(upAngleDeg, 0.0f, 180.0f) / 90.0f - 1.0f;
+    input.x[0] = down;
+    input.x[1] = up;
+    input.x[2] = down * up;
+    input.x[3] = down * down;
+    input.x[4] = up * up;
+    input.x[5] = constrain(speedCms / kMaxSpeedCms, -1.0f, 1.0f);
+    input.x[6] = constrain(accelerationMps2 / kMaxAccelerationMps2, -1.0f, 1.0f);
+    input.x[7] = 1.0f;
+}
+
+void QNetwork::forwardHidden(const Input &input, float *hidden) const
+{
+    memset(hidden, 0, kHidden * sizeof(float));
+    const float *row = hiddenWeights();
+    for (int i = 0; i < kInputs; ++i, row += kHidden)
+    {
+        axpy(input.x[i], row, hidden, kHidden);
+    }
+    for (int unit = 0; unit < kHidden; ++unit)
+    {
+        hidden[unit] = hidden[unit] > 0.0f ? hidden[unit] : 0.0f;
+    }
+}
+
+float QNetwork::value(const Input &input, int output) const
+{
+    alignas(16) float hidden[kHidden];
+    forwardHidden(input, hidden);
+    return outputBiases()[output] + dot(outputWeights() + output * kHidden, hidden, kHidden);
+}
+
+void QNetwork::values(const Input &input, float *out) const
+{
+    alignas(16) float hidden[kHidden];
+    forwardHidden(input, hidden);
+    const float *row = outputWeights();
+    const float *bias = outputBiases();
+    for (int output = 0; output < outputCount; ++output, row += kHidden)
+    {
+        out[output] = bias[output] + dot(row, hidden, kHidden);
+    }
+}
+
+void QNetwork::update(const Input &input, int output, float delta)
+{
+    alignas(16) float hidden[kHidden];
+    forwardHidden(input, hidden);
+
+    // Hidden gradients use the output row from before its own step
+    float *outputRow = outputWeights() + output * kHidden;
+    alignas(16) float gradient[kHidden];
+    for (int unit = 0; unit < kHidden; ++unit)
+    {
+        gradient[unit] = hidden[unit] > 0.0f ? outputRow[unit] : 0.0f;
+    }
+
+    // A gradient step of size rate moves the output by rate times the
+    // squared gradient norm, so dividing by it makes the move delta
+    float norm = 1.0f + dot(hidden, hidden, kHidden) +
+                 dot(input.x, input.x, kInputs) * dot(gradient, gradient, kHidden);
+    float rate = delta / norm;
+    for (int unit = 0; unit < kHidden; ++unit)
+    {
+        gradient[unit] *= rate;
+    }
+    float *row = hiddenWeights();
+    for (int i = 0; i < kInputs; ++i, row += kHidden)
+    {
+        axpy(input.x[i], gradient, row, kHidden);
+    }
+    axpy(rate, hidden, outputRow, kHidden);
+    outputBiases()[output] += rate;
+}
+
+void QNetwork::clear()
+{
+    if (!weights)
+    {
+        return;
+    }
+    // He-style uniform range for ReLU units
+    uint32_t state = kInitSeed;
+    float range = sqrtf(6.0f / kInputs);
+    float *row = hiddenWeights();
+    for (int i = 0; i < kHidden * kInputs; ++i)
+    {
+        row[i] = range * nextUniform(state);
+    }
+    memset(outputWeights(), 0, (kMaxOutputs * kHidden + kMaxOutputs) * sizeof(float));
+}
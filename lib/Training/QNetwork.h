@@ -0,0 +1,74 @@
+#ifndef Q_NETWORK_H
+#define Q_NETWORK_H
+
+#include <Arduino.h>
+
+// Action values from a small two-layer perceptron over the joint angles,
+// speed and acceleration.
+//
+// kInputs inputs feed kHidden ReLU units, which feed one linear output per
+// action. The last input is a constant 1, which stands in for the hidden
+// biases, so the first layer is a plain matrix-vector product. Learning is
+// a semi-gradient step on the output of the action taken, scaled by the
+// gradient's norm so that a large error cannot throw the weights off.
+//
+// All weights sit in one 16-byte aligned block: a row of kHidden weights
+// per input, then a row per output. The hidden layer is kInputs scaled row
+// additions and each output a dot product, both over contiguous, aligned
+// floats. The kernels are unrolled by four: the host compiler vectorises
+// them, and on the ESP32-S3 independent sums keep the FPU's multiply-add
+// pipeline full. The S3's PIE vector unit only has integer lanes, so float
+// weights do not go through it.
+class QNetwork
+{
+public:
+    static constexpr int kInputs = 8;
+    static constexpr int kHidden = 32;
+    static constexpr int kMaxOutputs = 8;
+    static constexpr float kMaxSpeedCms = 20.0f;
+    static constexpr float kMaxAccelerationMps2 = 2.0f;
+
+    struct Input
+    {
+        alignas(16) float x[kInputs];
+    };
+
+    QNetwork();
+    ~QNetwork();
+
+    // Allocates and initialises the weights; false if outputCount is too
+    // large or the heap is short. end() frees them again.
+    bool begin(int outputCount);
+    void end();
+    bool isActive() const { return weights != NULL; }
+    size_t getParameterCount() const;
+    size_t getMemoryBytes() const;
+
+    static void encode(float downAngleDeg, float upAngleDeg, float speedCms, float accelerationMps2,
+                       Input &input);
+    float value(const Input &input, int output) const;
+    void values(const Input &input, float *out) const;
+
+    // Moves the output for input by about delta, with one gradient step
+    // scaled by the gradient's norm, as TileCoder::update() does
+    void update(const Input &input, int output, float delta);
+
+    // Back to the initial weights: a fixed random first layer and zero
+    // outputs
+    void clear();
+
+private:
+    QNetwork(const QNetwork &) = delete;
+    QNetwork &operator=(const QNetwork &) = delete;
+
+    float *weights;
+    void *allocation;
+    int outputCount;
+
+    float *hiddenWeights() const { return weights; }
+    float *outputWeights() const { return weights + kHidden * kInputs; }
+    float *outputBiases() const { return outputWeights() + kMaxOutputs * kHidden; }
+    void forwardHidden(const Input &input, float *hidden) const;
+};
+
+#endif // Q_NETWORK_H
@@ -0,0 +1,173 @@
+#ifndef SPARSE_Q_TABLE_H
+#define SPARSE_Q_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Fixed-capacity Q-table for state spaces too large to store densely,
+// where only a small part is ever visited.
+//
+// States are 32-bit codes; each entry holds one state's action values and
+// visit counts. Open addressing with linear probing keeps entries in one
+// flat array. A key always sits within kMaxProbe slots of its home slot,
+// so lookups are O(1) worst case. When all kMaxProbe slots are taken, the
+// insert evicts the entry in that window that is least worth keeping: the
+// one unused longest relative to how often it was visited. Nothing is
+// ever removed on its own, so no tombstones are needed.
+template <size_t Actions, size_t Capacity>
+class SparseQTable
+{
+public:
+    static_assert(Capacity >= 16 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    static const uint32_t kEmptyKey = 0xFFFFFFFFu;
+    static const size_t kMaxProbe = 8;
+    static const uint16_t kMaxVisits = 0xFFFF;
+
+    struct Entry
+    {
+        uint32_t key;
+        uint32_t lastUsed;
+        float q[Actions];
+        uint16_t visits[Actions];
+    };
+
+    struct Stats
+    {
+        uint32_t lookups;
+        uint32_t hits;
+        uint32_t inserts;
+        uint32_t evictions;
+    };
+
+    SparseQTable() { clear(); }
+
+    void clear()
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+        {
+            entries[i].key = kEmptyKey;
+        }
+        used = 0;
+        clock = 0;
+        stats = Stats();
+    }
+
+    // The entry for key, or NULL; marks it as used
+    Entry *find(uint32_t key)
+    {
+        ++stats.lookups;
+        Entry *entry = locate(key);
+        if (entry)
+        {
+            ++stats.hits;
+            entry->lastUsed = ++clock;
+        }
+        return entry;
+    }
+
+    // Like find(), without touching the entry or the statistics
+    const Entry *peek(uint32_t key) const
+    {
+        return const_cast<SparseQTable *>(this)->locate(key);
+    }
+
+    // The entry for key, created from initialQ with no visits if missing.
+    // Never fails; a full probe window gives up its weakest entry.
+    Entry *insert(uint32_t key, const float *initialQ)
+    {
+        Entry *entry = find(key);
+        if (entry)
+        {
+            return entry;
+        }
+
+        size_t home = slotFor(key);
+        Entry *victim = NULL;
+        uint32_t victimScore = 0;
+        for (size_t probe = 0; probe < kMaxProbe; ++probe)
+        {
+            Entry &candidate = entries[(home + probe) & (Capacity - 1)];
+            if (candidate.key == kEmptyKey)
+            {
+                victim = &candidate;
+                ++used;
+                break;
+            }
+            uint32_t score = (clock - candidate.lastUsed) / (1 + totalVisits(candidate));
+            if (victim == NULL || score > victimScore)
+            {
+                victim = &candidate;
+                victimScore = score;
+            }
+        }
+        if (victim->key != kEmptyKey)
+        {
+            ++stats.evictions;
+        }
+
+        ++stats.inserts;
+        victim->key = key;
+        victim->lastUsed = ++clock;
+        memcpy(victim->q, initialQ, sizeof(victim->q));
+        memset(victim->visits, 0, sizeof(victim->visits));
+        return victim;
+    }
+
+    static void visit(Entry &entry, size_t action)
+    {
+        if (entry.visits[action] < kMaxVisits)
+        {
+            ++entry.visits[action];
+        }
+    }
+
+    size_t size() const { return used; }
+    const Stats &getStats() const { return stats; }
+    static constexpr size_t capacity() { return Capacity; }
+    static constexpr size_t memoryBytes() { return sizeof(SparseQTable); }
+
+private:
+    Entry entries[Capacity];
+    size_t used;
+    uint32_t clock;
+    Stats stats;
+
+    static size_t slotFor(uint32_t key)
+    {
+        // Fibonacci hashing spreads the packed fields over all slots
+        uint32_t hash = key * 2654435761u;
+        return (hash ^ (hash >> 16)) & (Capacity - 1);
+    }
+
+    Entry *locate(uint32_t key)
+    {
+        size_t home = slotFor(key);
+        for (size_t probe = 0; probe < kMaxProbe; ++probe)
+        {
+            Entry &entry = entries[(home + probe) & (Capacity - 1)];
+            if (entry.key == key)
+            {
+                return &entry;
+            }
+            if (entry.key == kEmptyKey)
+            {
+                return NULL;
+            }
+        }
+        return NULL;
+    }
+
+    static uint32_t totalVisits(const Entry &entry)
+    {
+        uint32_t total = 0;
+        for (size_t action = 0; action < Actions; ++action)
+        {
+            total += entry.visits[action];
+        }
+        return total;
+    }
+};
+
+#endif // SPARSE_Q_TABLE_H
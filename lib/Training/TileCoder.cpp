@@ -0,0 +1,146 @@
+#include "TileCoder.h"
+#include <math.h>
+#include <new>
+
+namespace
+{
+    const int kAngleCells = TileCoder::kAngleTiles + 1;
+    const float kAngleTileWidth = 180.0f / TileCoder::kAngleTiles;
+    const float kSpeedTileWidth = TileCoder::kMaxSpeedCms / TileCoder::kSpeedTiles;
+    const size_t kLineBytes = 32;
+
+    // Grid t is shifted by t * kDisplacement[d] / kTilings tiles along
+    // dimension d. Odd, unequal steps keep the grids from lining up on the
+    // diagonals, which uniform offsets would do.
+    const int kDisplacement[3] = {1, 3, 5};
+
+    int cell(float value, float tileWidth, int tiles, int tiling, int dimension)
+    {
+        float offset = static_cast<float>((tiling * kDisplacement[dimension]) % TileCoder::kTilings) /
+                       TileCoder::kTilings;
+        int index = static_cast<int>(floorf(value / tileWidth + offset));
+        return constrain(index, 0, tiles);
+    }
+}
+
+TileCoder::TileCoder()
+    : weights(NULL),
+      allocation(NULL),
+      actionCount(0),
+      speedCells(1),
+      featuresPerTiling(0),
+      featureCount(0)
+{
+}
+
+TileCoder::~TileCoder()
+{
+    end();
+}
+
+bool TileCoder::begin(int actionCount, bool useSpeed)
+{
+    end();
+    if (actionCount < 1 || actionCount > kMaxActions)
+    {
+        return false;
+    }
+
+    int speedCells = useSpeed ? kSpeedTiles + 1 : 1;
+    uint16_t perTiling = static_cast<uint16_t>(kAngleCells * kAngleCells * speedCells);
+    size_t floats = static_cast<size_t>(perTiling) * kTilings * kRowStride;
+
+    // Over-allocate by a line and round up, so every row starts on one
+    uint8_t *raw = new (std::nothrow) uint8_t[floats * sizeof(float) + kLineBytes];
+    if (raw == NULL)
+    {
+        return false;
+    }
+    allocation = raw;
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + kLineBytes - 1) & ~(uintptr_t)(kLineBytes - 1);
+    weights = reinterpret_cast<float *>(aligned);
+    this->actionCount = actionCount;
+    this->speedCells = speedCells;
+    featuresPerTiling = perTiling;
+    featureCount = static_cast<uint16_t>(perTiling * kTilings);
+    clear();
+    return true;
+}
+
+void TileCoder::end()
+{
+    delete[] static_cast<uint8_t *>(allocation);
+    allocation = NULL;
+    weights = NULL;
+    featuresPerTiling = 0;
+    featureCount = 0;
+}
+
+size_t TileCoder::getMemoryBytes() const
+{
+    return isActive() ? static_cast<size_t>(featureCount) * kRowStride * sizeof(float) + kLineBytes : 0;
+}
+
+void TileCoder::encode(float downAngleDeg, float upAngleDeg, float speedCms, Features &features) const
+{
+    float down = constrain(downAngleDeg, 0.0f, 180.0f);
+    float up = constrain(upAngleDeg, 0.0f, 180.0f);
+    float speed = constrain(speedCms, 0.0f, kMaxSpeedCms);
+    for (int tiling = 0; tiling < kTilings; ++tiling)
+    {
+        int index = cell(down, kAngleTileWidth, kAngleTiles, tiling, 0) * kAngleCells +
+                    cell(up, kAngleTileWidth, kAngleTiles, tiling, 1);
+        if (speedCells > 1)
+        {
+            index = index * speedCells + cell(speed, kSpeedTileWidth, kSpeedTiles, tiling, 2);
+        }
+        features.index[tiling] = static_cast<uint16_t>(tiling * featuresPerTiling + index);
+    }
+}
+
+float TileCoder::value(const Features &features, int action) const
+{
+    float sum = 0.0f;
+    for (int tiling = 0; tiling < kTilings; ++tiling)
+    {
+        sum += weights[features.index[tiling] * kRowStride + action];
+    }
+    return sum;
+}
+
+void TileCoder::values(const Features &features, float *out) const
+{
+    float sum[kRowStride] = {};
+    for (int tiling = 0; tiling < kTilings; ++tiling)
+    {
+        const float *row = weights + features.index[tiling] * kRowStride;
+        for (int action = 0; action < kRowStride; ++action)
+        {
+            sum[action] += row[action];
+        }
+    }
+    memcpy(out, sum, actionCount * sizeof(float));
+}
+
+void TileCoder::update(const Features &features, int action, float delta)
+{
+    float step = delta / kTilings;
+    for (int tiling = 0; tiling < kTilings; ++tiling)
+    {
+        weights[features.index[tiling] * kRowStride + action] += step;
+    }
+}
+
+void TileCoder::clear()
+{
+    clear(0, featureCount);
+}
+
+void TileCoder::clear(size_t first, size_t count)
+{
+    if (weights && first < featureCount)
+    {
+        count = count < featureCount - first ? count : featureCount - first;
+        memset(weights + first * kRowStride, 0, count * kRowStride * sizeof(float));
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TILE_CODER_H
+#define TILE_CODER_H
+
+#include <Arduino.h>
+
+// Linear action values over continuous joint angles, and optionally the
+// measured speed, by tile coding.
+//
+// kTilings overlapping grids, each offset by a fraction of a tile, cover
+// the input space. An input falls in exactly one tile per grid, so it has
+// kTilings active features, and Q(s, a) is the sum of their weights for
+// action a. Updates touch only those kTilings weights. Inputs closer than
+// a tile width share some tiles, which is what lets values learned at
+// one pose carry over to poses in between.
+//
+// Weights sit in one flat array, one row of kRowStride floats per
+// feature, so the weights of all actions for a feature share a 32-byte
+// line and the sum for every action is a short contiguous loop.
+class TileCoder
+{
+public:
+    static constexpr int kTilings = 8;
+    static constexpr int kAngleTiles = 6;   // across 0-180 degrees, per grid
+    static constexpr int kSpeedTiles = 4;   // across 0-kMaxSpeedCms, per grid
+    static constexpr float kMaxSpeedCms = 20.0f;
+    static constexpr int kRowStride = 8;    // floats per feature row
+    static constexpr int kMaxActions = kRowStride;
+
+    struct Features
+    {
+        uint16_t index[kTilings];
+    };
+
+    TileCoder();
+    ~TileCoder();
+
+    // Allocates zeroed weights; false if actionCount is too large or the
+    // heap is short. end() frees them again.
+    bool begin(int actionCount, bool useSpeed);
+    void end();
+    bool isActive() const { return weights != NULL; }
+    bool usesSpeed() const { return speedCells > 1; }
+    size_t getFeatureCount() const { return featureCount; }
+    size_t getMemoryBytes() const;
+
+    void encode(float downAngleDeg, float upAngleDeg, float speedCms, Features &features) const;
+    float value(const Features &features, int action) const;
+    void values(const Features &features, float *out) const;
+
+    // Moves Q(features, action) by delta, spread evenly over the active
+    // weights
+    void update(const Features &features, int action, float delta);
+    void clear();
+    // Zeroes count feature rows from first, so a large coder can be
+    // cleared a piece at a time
+    void clear(size_t first, size_t count);
+
+private:
+    TileCoder(const TileCoder &) = delete;
+    TileCoder &operator=(const TileCoder &) = delete;
+
+    float *weights;
+    void *allocation;
+    int actionCount;
+    int speedCells;
+    uint16_t featuresPerTiling;
+    uint16_t featureCount;
+};
+
+#endif // TILE_CODER_H
@@ -1,21 +1,167 @@
 #include "Training.h"
-#include <FS.h>
-#include <SPIFFS.h>
+#include "ModelFormat.h"
+#include <Profiler.h>
+#include <new>
 
 namespace
 {
     const char kModelPath[] = "/training.bin";
-    const uint32_t kModelMagic = 0x524C4D31; // "RLM1"
-    const uint32_t kModelVersion = 2;
+    const char kStagedModelPath[] = "/training.tmp";
+    const char kSavedModelPath[] = "/training.new";
+    const char kCheckpointPath[] = "/checkpoint.bin";
+    const char kCheckpointTempPath[] = "/checkpoint.tmp";
+    const char kJournalPath[] = "/checkpoint.jnl";
+    const char kTransitionLogPath[] = "/transitions.bin";
+    const char kPreviousTransitionLogPath[] = "/transitions.old";
+    const uint32_t kJournalMagic = 0x524C4A31; // "RLJ1"
+    const uint32_t kJournalVersion = 1;
+
+#if !RLBOT_INFERENCE_ONLY
+    Profiler::Probe stepProbe("training.step");
+#endif
+    Profiler::Probe inferProbe("training.infer");
+
+#if !RLBOT_INFERENCE_ONLY
+    // exp(-x) for x in [0, kExpRange), kExpStepsPerUnit entries per unit.
+    // Softmax weights are exp(-(best Q - Q) / temperature), so x is never
+    // negative, and past kExpRange the weight is small enough to be 0.
+    const int kExpStepsPerUnit = 32;
+    const int kExpRange = 8;
+    const int kExpTableSize = kExpRange * kExpStepsPerUnit;
+
+    struct ExpTable
+    {
+        float values[kExpTableSize];
+
+        ExpTable()
+        {
+            for (int i = 0; i < kExpTableSize; ++i)
+            {
+                values[i] = expf(-static_cast<float>(i) / kExpStepsPerUnit);
+            }
+        }
+    };
+
+    const ExpTable expTable;
 
-    struct ModelHeader
+    // Model files and checkpoints both use the layout in ModelFormat.h.
+    // The journal extends the checkpoint whose CRC is in its header (0 for
+    // an all-zero table) with fixed-size records, each with its own CRC so
+    // a write torn by a power cut ends the replay instead of corrupting it.
+    struct JournalHeader
     {
         uint32_t magic;
         uint32_t version;
-        uint32_t stateCount;
-        uint32_t actionCount;
-        uint32_t payloadSize;
+        uint32_t baseCrc;
+    };
+
+    enum JournalRecordType : uint8_t
+    {
+        JOURNAL_CELL = 1,     // first = Q value bits, second = visit count
+        JOURNAL_PROGRESS = 2, // first = episodes, second = epsilon bits
+    };
+
+    struct JournalRecord
+    {
+        uint8_t type;
+        uint8_t state;
+        uint8_t action;
+        uint8_t reserved;
+        uint32_t first;
+        uint32_t second;
+        uint32_t crc;
     };
+#endif
+
+    using ModelFormat::crc32;
+
+    // Reads a whole model file into a word-aligned buffer for a
+    // ModelFormat::View; the caller delete[]s it
+    uint32_t *readModelImage(ModelStorage &storage, const char *path, size_t &length)
+    {
+        length = storage.size(path);
+        if (length == 0)
+        {
+            Serial.println("Failed to open model file for reading");
+            return NULL;
+        }
+        if (length > ModelFormat::kMaxFileSize)
+        {
+            Serial.println("Training model file too large");
+            return NULL;
+        }
+
+        uint32_t *image = new (std::nothrow) uint32_t[(length + 3) / 4 + 1];
+        if (image == NULL)
+        {
+            Serial.println("No memory to load training model");
+            return NULL;
+        }
+        size_t read = storage.read(path, 0, reinterpret_cast<uint8_t *>(image), length);
+        if (read != length)
+        {
+            Serial.println("Failed to read training model data");
+            delete[] image;
+            return NULL;
+        }
+        return image;
+    }
+
+#if !RLBOT_INFERENCE_ONLY
+    int findNearestAngle(const int *options, int count, int angle)
+    {
+        int nearest = 0;
+        for (int i = 1; i < count; ++i)
+        {
+            if (abs(options[i] - angle) < abs(options[nearest] - angle))
+            {
+                nearest = i;
+            }
+        }
+        return nearest;
+    }
+#endif
+
+    int findAngle(const int *options, int count, int angle)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (options[i] == angle)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+#if !RLBOT_INFERENCE_ONLY
+    uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsFloat(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    JournalRecord makeRecord(JournalRecordType type, uint8_t state, uint8_t action, uint32_t first,
+                             uint32_t second)
+    {
+        JournalRecord record = {};
+        record.type = type;
+        record.state = state;
+        record.action = action;
+        record.first = first;
+        record.second = second;
+        record.crc = crc32(0, &record, offsetof(JournalRecord, crc));
+        return record;
+    }
+#endif
 }
 
 const int Training::kDownAngleOptions[Training::kDownActionCount] = {140, 90, 45};
@@ -24,39 +170,275 @@ const int Training::kUpAngleOptions[Training::kUpActionCount] = {40, 90, 125};
 Training::Training()
     : trainingActive(false),
       modelLoaded(false),
-      fsReady(false),
-      hasLastStep(false),
-      lastAction(0),
-      lastState(0),
+      storageReady(false),
       totalEpisodes(0),
       trainingStartMs(0),
       accumulatedTrainingMs(0),
-      currentEpsilon(kEpsilonStart)
+      currentEpsilon(kEpsilonStart),
+      params(defaultHyperparameters()),
+      gait(),
+      gaitCompiledIn(false),
+      replayingGait(false),
+      gaitIndex(0),
+      modelMux(portMUX_INITIALIZER_UNLOCKED),
+      storage(ModelStorage::get(MODEL_STORAGE_SPIFFS)),
+      uploadToken(0),
+      lastUploadToken(0),
+      uploadWrittenMs(0),
+      uploadBytes(0),
+#if !RLBOT_INFERENCE_ONLY
+      hasLastStep(false),
+      lastAction(0),
+      lastState(0),
+      pendingStart(0),
+      pendingCount(0),
+      lastFeatures(),
+      hashed(NULL),
+      lastInput(),
+      refreshCell(0),
+      lastKey(0),
+      previousAction(kNoAction),
+      progressPhase(0),
+      transitionRunStart(false),
+      updateHandler(NULL),
+      updateContext(NULL),
+      updateSequence(0),
+      snapshotSequence(0),
+      snapshotCrc(0),
+      journalBytes(0),
+      saveRequested(false),
+      transitionHandler(NULL),
+      transitionContext(NULL),
+      transitionLogChecked(false),
+      transitionLogGeneration(0),
+      valueLock(NULL),
+#endif
+      storageLock(NULL)
 {
     resetQTable();
 }
 
+Training::~Training()
+{
+#if !RLBOT_INFERENCE_ONLY
+    delete hashed;
+#endif
+}
+
+void Training::setStorage(ModelStorage *storage)
+{
+    if (storage != NULL)
+    {
+        this->storage = storage;
+    }
+}
+
+ModelStorage *Training::getStorage() const
+{
+    return storage;
+}
+
 void Training::begin()
 {
     randomSeed(micros());
     resetQTable();
-    fsReady = SPIFFS.begin(true);
-    if (!fsReady)
+    if (storageLock == NULL)
+    {
+        storageLock = xSemaphoreCreateMutex();
+    }
+#if !RLBOT_INFERENCE_ONLY
+    if (valueLock == NULL)
+    {
+        valueLock = xSemaphoreCreateMutex();
+    }
+#endif
+    storageReady = storage->begin();
+    if (!storageReady)
+    {
+        Serial.print("Training storage unavailable: ");
+        Serial.println(storage->getName());
+    }
+    else
     {
-        Serial.println("Training FS mount failed");
+        recoverStagedModel();
     }
     Serial.println("Training module initialized");
 }
 
+Training::Hyperparameters Training::defaultHyperparameters()
+{
+    Hyperparameters defaults = {};
+    defaults.gamma = kGamma;
+    defaults.epsilonStart = kEpsilonStart;
+    defaults.epsilonMin = kEpsilonMin;
+    defaults.epsilonDecay = kEpsilonDecay;
+    for (int i = 0; i < kDownActionCount; ++i)
+    {
+        defaults.downAngleOptions[i] = kDownAngleOptions[i];
+    }
+    for (int i = 0; i < kUpActionCount; ++i)
+    {
+        defaults.upAngleOptions[i] = kUpAngleOptions[i];
+    }
+    defaults.valueFunction = VALUE_TABLE;
+    defaults.returnSteps = 1;
+    defaults.doubleQ = false;
+    defaults.exploration = EXPLORE_EPSILON;
+    defaults.warmStart = 0.0f;
+    defaults.alphaMin = 0.0f;
+    return defaults;
+}
+
+bool Training::configure(const Hyperparameters &hyperparameters)
+{
+    bool valid = hyperparameters.gamma >= 0.0f && hyperparameters.gamma < 1.0f &&
+                 hyperparameters.epsilonMin >= 0.0f &&
+                 hyperparameters.epsilonStart >= hyperparameters.epsilonMin &&
+                 hyperparameters.epsilonStart <= 1.0f &&
+                 hyperparameters.epsilonDecay > 0.0f && hyperparameters.epsilonDecay <= 1.0f &&
+                 hyperparameters.valueFunction <= VALUE_NETWORK &&
+                 hyperparameters.returnSteps >= 1 && hyperparameters.returnSteps <= kMaxReturnSteps &&
+                 hyperparameters.exploration <= EXPLORE_SOFTMAX &&
+                 hyperparameters.warmStart >= 0.0f && hyperparameters.warmStart < 1.0f &&
+                 hyperparameters.alphaMin >= 0.0f && hyperparameters.alphaMin <= 1.0f;
+    for (int i = 0; i < kDownActionCount; ++i)
+    {
+        valid = valid && hyperparameters.downAngleOptions[i] >= 0 && hyperparameters.downAngleOptions[i] <= 180;
+    }
+    for (int i = 0; i < kUpActionCount; ++i)
+    {
+        valid = valid && hyperparameters.upAngleOptions[i] >= 0 && hyperparameters.upAngleOptions[i] <= 180;
+    }
+
+    if (!valid)
+    {
+        Serial.println("Training hyperparameters rejected, keeping defaults");
+        return false;
+    }
+
+    params = hyperparameters;
+    currentEpsilon = params.epsilonStart;
+#if RLBOT_INFERENCE_ONLY
+    if (params.valueFunction != VALUE_TABLE)
+    {
+        // Model files hold the table whatever learned it, so act on that
+        Serial.println("Inference-only build, using the Q-table");
+        params.valueFunction = VALUE_TABLE;
+    }
+    return true;
+#else
+    return applyValueFunction();
+#endif
+}
+
+#if !RLBOT_INFERENCE_ONLY
+bool Training::applyValueFunction()
+{
+    if (params.valueFunction != VALUE_HASHED)
+    {
+        delete hashed;
+        hashed = NULL;
+    }
+    if (params.valueFunction != VALUE_TILES && params.valueFunction != VALUE_TILES_SPEED)
+    {
+        tiles.end();
+    }
+    if (params.valueFunction != VALUE_NETWORK)
+    {
+        network.end();
+    }
+
+    if (params.valueFunction == VALUE_TABLE)
+    {
+        return true;
+    }
+    if (params.valueFunction == VALUE_HASHED)
+    {
+        if (hashed != NULL)
+        {
+            return true;
+        }
+        hashed = new (std::nothrow) HashedTable();
+        if (hashed == NULL)
+        {
+            Serial.println("No memory for the hashed Q-table, using the Q-table");
+            params.valueFunction = VALUE_TABLE;
+            return false;
+        }
+        Serial.printf("Training with hashed states (%u entries, %u bytes)\n",
+                      static_cast<unsigned>(HashedTable::capacity()),
+                      static_cast<unsigned>(HashedTable::memoryBytes()));
+        return true;
+    }
+    if (params.valueFunction == VALUE_NETWORK)
+    {
+        if (network.isActive())
+        {
+            return true;
+        }
+        if (!network.begin(kNumActions))
+        {
+            Serial.println("No memory for the Q-network, using the Q-table");
+            params.valueFunction = VALUE_TABLE;
+            return false;
+        }
+        fitNetwork();
+        Serial.printf("Training with a %d-%d-%d Q-network (%u bytes)\n", QNetwork::kInputs, QNetwork::kHidden,
+                      kNumActions, static_cast<unsigned>(network.getMemoryBytes()));
+        return true;
+    }
+
+    bool useSpeed = params.valueFunction == VALUE_TILES_SPEED;
+    if (tiles.isActive() && tiles.usesSpeed() == useSpeed)
+    {
+        return true;
+    }
+    if (!tiles.begin(kNumActions, useSpeed))
+    {
+        Serial.println("No memory for tile weights, using the Q-table");
+        params.valueFunction = VALUE_TABLE;
+        return false;
+    }
+    fitTiles();
+    Serial.printf("Training with %u tile features (%u bytes)\n", static_cast<unsigned>(tiles.getFeatureCount()),
+                  static_cast<unsigned>(tiles.getMemoryBytes()));
+    return true;
+}
+#endif
+
+const Training::Hyperparameters &Training::getHyperparameters() const
+{
+    return params;
+}
+
+#if !RLBOT_INFERENCE_ONLY
+bool Training::setExploration(Exploration exploration)
+{
+    if (exploration > EXPLORE_SOFTMAX)
+    {
+        return false;
+    }
+    portENTER_CRITICAL(&modelMux);
+    params.exploration = exploration;
+    portEXIT_CRITICAL(&modelMux);
+    return true;
+}
+
 void Training::startTraining()
 {
     Serial.println("Training started");
+    replayingGait = false;
     trainingActive = true;
     hasLastStep = false;
-    currentEpsilon = kEpsilonStart;
+    resetHistory();
+    currentEpsilon = params.epsilonStart;
     totalEpisodes = 0;
     accumulatedTrainingMs = 0;
     trainingStartMs = millis();
+    if (modelLoaded && params.warmStart > 0.0f)
+    {
+        applyWarmStart();
+    }
 }
 
 void Training::stopTraining()
@@ -68,49 +450,236 @@ void Training::stopTraining()
     }
     trainingActive = false;
 }
+#endif
 
 bool Training::isTraining()
 {
     return trainingActive;
 }
 
+#if !RLBOT_INFERENCE_ONLY
 Training::StepResult Training::step(float deltaDistanceCm, float avgSpeedCms, float avgAccelerationMps2,
-                                    int downAngleDeg, int upAngleDeg)
+                                    int downAngleDeg, int upAngleDeg, float pitchDeg)
 {
+    PROFILE_SCOPE(stepProbe);
     StepResult result = {};
 
-    (void)avgSpeedCms;
-    (void)avgAccelerationMps2;
-
     if (!trainingActive)
     {
         return result;
     }
 
-    int currentState = getStateIndex(downAngleDeg, upAngleDeg);
+    bool useTiles = tiles.isActive();
+    bool useHashed = hashed != NULL;
+    bool useNetwork = network.isActive();
+    bool useReturns = !useTiles && !useHashed && !useNetwork && (params.returnSteps > 1 || params.doubleQ);
+    TileCoder::Features features;
+    QNetwork::Input input;
+    uint32_t currentKey = 0;
+    int currentState;
     float reward = computeReward(deltaDistanceCm);
+    if (useTiles)
+    {
+        // The table cell only tracks visits and the saved projection
+        currentState = getNearestStateIndex(downAngleDeg, upAngleDeg);
+        encodeState(downAngleDeg, upAngleDeg, avgSpeedCms, features);
+    }
+    else if (useNetwork)
+    {
+        currentState = getNearestStateIndex(downAngleDeg, upAngleDeg);
+        QNetwork::encode(downAngleDeg, upAngleDeg, avgSpeedCms, avgAccelerationMps2, input);
+    }
+    else if (useHashed)
+    {
+        currentState = getNearestStateIndex(downAngleDeg, upAngleDeg);
+        advancePhase(reward);
+        currentKey = encodeHashedState(currentState, previousAction, progressPhase, pitchDeg);
+    }
+    else
+    {
+        currentState = getStateIndex(downAngleDeg, upAngleDeg);
+    }
+    bool logTransition = hasLastStep && transitionHandler != NULL;
+    TransitionLog::Record transition;
+    if (logTransition)
+    {
+        TransitionLog::makeRecord(transition, lastState, lastAction, currentState,
+                                  transitionRunStart ? TransitionLog::kRunStart : 0, deltaDistanceCm, avgSpeedCms,
+                                  avgAccelerationMps2, pitchDeg);
+    }
+    transitionRunStart = !hasLastStep;
+    bool updated = hasLastStep;
+    int updatedState = lastState;
+    int updatedAction = lastAction;
+    CellUpdate update = {};
+    CellUpdate refresh = {};
+    float qValues[kNumActions];
+
+    // The tiles and the network learn under the value lock alone, and the
+    // model lock below only publishes what they give the table and the
+    // journal. valueLock stays held until then, so a snapshot never sees
+    // weights newer than the table.
+    bool useWeights = useTiles || useNetwork;
+    float projected = 0.0f;
+    int refreshState = 0;
+    int refreshAction = 0;
+    float refreshed = 0.0f;
+    if (useWeights)
+    {
+        lockValues();
+        if (hasLastStep)
+        {
+            portENTER_CRITICAL(&modelMux);
+            float alpha = learningRate(visitCounts[lastState][lastAction]);
+            portEXIT_CRITICAL(&modelMux);
+            if (useTiles)
+            {
+                tiles.values(features, qValues);
+                float maxQ = qValues[findBestAction(qValues)];
+                float tdError = reward + (params.gamma * maxQ) - tiles.value(lastFeatures, lastAction);
+                // Shared weights keep moving as neighbours learn, so the
+                // step size never decays all the way as it does for a
+                // table cell
+                tiles.update(lastFeatures, lastAction, max(alpha, kTileAlphaMin) * tdError);
+            }
+            else
+            {
+                network.values(input, qValues);
+                float maxQ = qValues[findBestAction(qValues)];
+                float tdError = reward + (params.gamma * maxQ) - network.value(lastInput, lastAction);
+                network.update(lastInput, lastAction, kNetworkRate * tdError);
+            }
+            if (updateHandler)
+            {
+                // Only the journal reads the table between snapshots
+                projected = projectValue(lastState, lastAction);
+            }
+            if (useNetwork && updateHandler)
+            {
+                // The shared weights move every cell a little; re-project
+                // one more per step, so the journal keeps up with all of
+                // them
+                refreshCell = (refreshCell + 1) % (kNumStates * kNumActions);
+                refreshState = refreshCell / kNumActions;
+                refreshAction = refreshCell % kNumActions;
+                refreshed = projectValue(refreshState, refreshAction);
+            }
+        }
+        // After the update, which may have moved weights this pose shares
+        if (useTiles)
+        {
+            tiles.values(features, qValues);
+        }
+        else
+        {
+            network.values(input, qValues);
+        }
+    }
 
+    portENTER_CRITICAL(&modelMux);
+    if (useHashed)
+    {
+        // Copied, since making room for the last state below may evict it
+        readHashed(*hashed->insert(currentKey, qTable[currentState]), currentState, qValues);
+    }
     if (hasLastStep)
     {
-        float maxQ = computeMaxQ(currentState);
-        float lastQ = computeQ(lastState, lastAction);
-        float tdError = reward + (kGamma * maxQ) - lastQ;
+        float alpha = learningRate(visitCounts[lastState][lastAction]);
+        if (useWeights)
+        {
+            if (updateHandler)
+            {
+                qTable[lastState][lastAction] = projected;
+            }
+        }
+        else if (useReturns)
+        {
+            updated = learnReturn(currentState, reward, updatedState, updatedAction);
+        }
+        else
+        {
+            HashedTable::Entry *last = NULL;
+            if (useHashed)
+            {
+                last = hashed->insert(lastKey, qTable[lastState]);
+                if (last->visits[lastAction] < kHashedMinVisits)
+                {
+                    // Start learning from what the table knows by now
+                    last->q[lastAction] = qTable[lastState][lastAction];
+                }
+                float hashedAlpha = learningRate(last->visits[lastAction]);
+                float target = reward + (params.gamma * qValues[findBestAction(qValues)]);
+                last->q[lastAction] += hashedAlpha * (target - last->q[lastAction]);
+                HashedTable::visit(*last, lastAction);
+            }
+            // With hashed states too: new entries start from this cell, and
+            // it is what gets saved
+            float maxQ = computeMaxQ(currentState);
+            float lastQ = computeQ(lastState, lastAction);
+            float tdError = reward + (params.gamma * maxQ) - lastQ;
+            qTable[lastState][lastAction] += alpha * tdError;
+            if (useHashed && lastKey == currentKey)
+            {
+                readHashed(*last, currentState, qValues);
+            }
+        }
+        if (updated)
+        {
+            visitCounts[updatedState][updatedAction] += 1;
+
+            update.sequence = ++updateSequence;
+            update.state = updatedState;
+            update.action = updatedAction;
+            update.q = qTable[updatedState][updatedAction];
+            update.visits = visitCounts[updatedState][updatedAction];
+        }
+
+        if (useNetwork && updateHandler)
+        {
+            qTable[refreshState][refreshAction] = refreshed;
+            refresh.sequence = ++updateSequence;
+            refresh.state = refreshState;
+            refresh.action = refreshAction;
+            refresh.q = refreshed;
+            refresh.visits = visitCounts[refreshState][refreshAction];
+        }
+    }
 
-        float alpha = 1.0f / (1.0f + static_cast<float>(visitCounts[lastState][lastAction]));
-        qTable[lastState][lastAction] += alpha * tdError;
-        visitCounts[lastState][lastAction] += 1;
+    int actionIndex;
+    if (useTiles)
+    {
+        actionIndex = selectActionFrom(qValues, currentState);
+        lastFeatures = features;
+    }
+    else if (useNetwork)
+    {
+        actionIndex = selectActionFrom(qValues, currentState);
+        lastInput = input;
+    }
+    else if (useHashed)
+    {
+        actionIndex = selectActionFrom(qValues, currentState);
+        lastKey = currentKey;
+    }
+    else
+    {
+        actionIndex = selectAction(currentState);
+    }
+    lastState = currentState;
+    lastAction = actionIndex;
+    previousAction = actionIndex;
+    hasLastStep = true;
+    portEXIT_CRITICAL(&modelMux);
+    if (useWeights)
+    {
+        unlockValues();
     }
 
-    int actionIndex = selectAction(currentState);
     int targetDownAngle = 0;
     int targetUpAngle = 0;
     decodeAction(actionIndex, downAngleDeg, upAngleDeg, targetDownAngle, targetUpAngle);
     decayEpsilon();
 
-    lastState = currentState;
-    lastAction = actionIndex;
-    hasLastStep = true;
-
     result.actionIndex = actionIndex;
     result.targetDownAngle = targetDownAngle;
     result.targetUpAngle = targetUpAngle;
@@ -118,24 +687,102 @@ Training::StepResult Training::step(float deltaDistanceCm, float avgSpeedCms, fl
 
     totalEpisodes++;
 
+    if (updated && updateHandler)
+    {
+        update.episodes = totalEpisodes;
+        update.epsilon = currentEpsilon;
+        updateHandler(updateContext, update);
+        if (refresh.sequence != 0)
+        {
+            refresh.episodes = totalEpisodes;
+            refresh.epsilon = currentEpsilon;
+            updateHandler(updateContext, refresh);
+        }
+    }
+    if (logTransition)
+    {
+        transitionHandler(transitionContext, transition);
+    }
+
     return result;
 }
+#endif
 
 Training::StepResult Training::infer(float deltaDistanceCm, float avgSpeedCms, float avgAccelerationMps2,
-                                     int downAngleDeg, int upAngleDeg)
+                                     int downAngleDeg, int upAngleDeg, float pitchDeg)
 {
+    PROFILE_SCOPE(inferProbe);
     StepResult result = {};
 
-    (void)avgSpeedCms;
-    (void)avgAccelerationMps2;
+    if (replayingGait)
+    {
+        const GaitKeyframe &frame = gait.frames[gaitIndex];
+        gaitIndex = gaitIndex + 1 < gait.frameCount ? gaitIndex + 1 : gait.loopStart;
+        result.actionIndex = frame.action;
+        result.targetDownAngle = frame.downAngleDeg;
+        result.targetUpAngle = frame.upAngleDeg;
+        result.reward = computeReward(deltaDistanceCm);
+        return result;
+    }
 
     if (!modelLoaded)
     {
         return result;
     }
 
-    int currentState = getStateIndex(downAngleDeg, upAngleDeg);
-    int actionIndex = selectBestAction(currentState);
+    int actionIndex;
+#if !RLBOT_INFERENCE_ONLY
+    if (tiles.isActive())
+    {
+        TileCoder::Features features;
+        float qValues[kNumActions];
+        encodeState(downAngleDeg, upAngleDeg, avgSpeedCms, features);
+        lockValues();
+        tiles.values(features, qValues);
+        unlockValues();
+        actionIndex = findBestAction(qValues);
+    }
+    else if (network.isActive())
+    {
+        QNetwork::Input input;
+        float qValues[kNumActions];
+        QNetwork::encode(downAngleDeg, upAngleDeg, avgSpeedCms, avgAccelerationMps2, input);
+        lockValues();
+        network.values(input, qValues);
+        unlockValues();
+        actionIndex = findBestAction(qValues);
+    }
+    else if (hashed != NULL)
+    {
+        // States this run has not seen yet act as their table state
+        float qValues[kNumActions];
+        int currentState = getNearestStateIndex(downAngleDeg, upAngleDeg);
+        advancePhase(computeReward(deltaDistanceCm));
+        uint32_t key = encodeHashedState(currentState, previousAction, progressPhase, pitchDeg);
+        portENTER_CRITICAL(&modelMux);
+        const HashedTable::Entry *entry = hashed->peek(key);
+        if (entry != NULL)
+        {
+            readHashed(*entry, currentState, qValues);
+        }
+        else
+        {
+            memcpy(qValues, qTable[currentState], sizeof(qValues));
+        }
+        portEXIT_CRITICAL(&modelMux);
+        actionIndex = findBestAction(qValues);
+    }
+    else
+#endif
+    {
+        int currentState = getStateIndex(downAngleDeg, upAngleDeg);
+        portENTER_CRITICAL(&modelMux);
+        actionIndex = selectBestAction(currentState);
+        portEXIT_CRITICAL(&modelMux);
+    }
+#if !RLBOT_INFERENCE_ONLY
+    previousAction = actionIndex;
+#endif
     int targetDownAngle = 0;
     int targetUpAngle = 0;
     decodeAction(actionIndex, downAngleDeg, upAngleDeg, targetDownAngle, targetUpAngle);
@@ -153,6 +800,11 @@ uint32_t Training::getTotalEpisodes() const
     return totalEpisodes;
 }
 
+float Training::getEpsilon() const
+{
+    return currentEpsilon;
+}
+
 float Training::getTotalTrainingSeconds() const
 {
     unsigned long totalMs = accumulatedTrainingMs;
@@ -191,176 +843,940 @@ int Training::getDownAngleOption(int index) const
 {
     if (index < 0 || index >= kDownActionCount)
     {
-        return kDownAngleOptions[0];
+        return params.downAngleOptions[0];
     }
-    return kDownAngleOptions[index];
+    return params.downAngleOptions[index];
 }
 
 int Training::getUpAngleOption(int index) const
 {
     if (index < 0 || index >= kUpActionCount)
     {
-        return kUpAngleOptions[0];
+        return params.upAngleOptions[0];
+    }
+    return params.upAngleOptions[index];
+}
+
+void Training::setCompiledGait(const CompiledGait &gait)
+{
+    if (gait.frames == NULL || gait.frameCount == 0 || gait.loopStart >= gait.frameCount)
+    {
+        Serial.println("Compiled gait rejected");
+        return;
     }
-    return kUpAngleOptions[index];
+    replayingGait = false;
+    this->gait = gait;
+    gaitCompiledIn = true;
 }
 
-void Training::executeLearnedBehavior()
+bool Training::executeLearnedBehavior()
 {
-    Serial.println("Executing learned behavior (implementation pending)");
+    if (trainingActive)
+    {
+        Serial.println("Gait replay refused while training");
+        return false;
+    }
+    if (!gaitCompiledIn && !distilGait())
+    {
+        return false;
+    }
+    gaitIndex = 0;
+    replayingGait = true;
+    Serial.printf("Replaying %s gait: %u keyframes, cycle from %u\n", gaitCompiledIn ? "compiled" : "learned",
+                  gait.frameCount, gait.loopStart);
+    return true;
 }
 
 bool Training::hasLearnedBehavior()
 {
-    return modelLoaded;
+    // A compiled gait only counts while it replays: once training or a
+    // reset has ended the replay, infer() has nothing to act on
+    return modelLoaded || replayingGait;
+}
+
+bool Training::isReplayingGait() const
+{
+    return replayingGait;
 }
 
-void Training::saveModel()
+#if !RLBOT_INFERENCE_ONLY
+bool Training::saveModel()
 {
-    if (!fsReady)
+    if (!storageReady)
     {
-        Serial.println("Model save skipped (filesystem unavailable)");
+        Serial.println("Model save skipped (storage unavailable)");
         modelLoaded = false;
-        return;
+        return false;
     }
 
-    File file = SPIFFS.open(kModelPath, FILE_WRITE);
-    if (!file)
+    // Written beside the old model and renamed over it, so a power cut
+    // leaves one complete model or the other
+    lockStorage();
+    SnapshotInfo info = {};
+    bool saved = writeSnapshot(kSavedModelPath, info) && replaceFile(kSavedModelPath, kModelPath);
+    if (saved && !trainingActive)
     {
-        Serial.println("Failed to open model file for writing");
-        modelLoaded = false;
-        return;
+        // The run is over and the model file holds all of it
+        storage->remove(kCheckpointPath);
+        storage->remove(kJournalPath);
+        snapshotSequence = info.sequence;
+        journalBytes = 0;
     }
+    unlockStorage();
 
-    ModelHeader header = {};
-    header.magic = kModelMagic;
-    header.version = kModelVersion;
-    header.stateCount = kNumStates;
-    header.actionCount = kNumActions;
-    header.payloadSize = sizeof(qTable) + sizeof(visitCounts);
-
-    size_t headerBytes = file.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
-    size_t qBytes = file.write(reinterpret_cast<const uint8_t *>(qTable), sizeof(qTable));
-    size_t countBytes = file.write(reinterpret_cast<const uint8_t *>(visitCounts), sizeof(visitCounts));
-    file.close();
-
-    if (headerBytes != sizeof(header) || qBytes != sizeof(qTable) || countBytes != sizeof(visitCounts))
+    if (!saved)
     {
         Serial.println("Failed to write training model");
         modelLoaded = false;
-        return;
+        return false;
     }
 
     Serial.println("Training model saved");
     modelLoaded = true;
+    return true;
 }
+#endif
 
 bool Training::modelFileExists()
 {
-    if (!fsReady)
+    if (!storageReady)
     {
         return false;
     }
 
-    return SPIFFS.exists(kModelPath);
+    return storage->exists(kModelPath);
 }
 
 bool Training::loadModel()
 {
-    if (!fsReady)
+    if (!storageReady)
     {
-        Serial.println("Model load skipped (filesystem unavailable)");
+        Serial.println("Model load skipped (storage unavailable)");
         modelLoaded = false;
         return false;
     }
 
-    if (!SPIFFS.exists(kModelPath))
+    if (!storage->exists(kModelPath))
     {
         Serial.println("No training model file found");
         modelLoaded = false;
         return false;
     }
 
-    File file = SPIFFS.open(kModelPath, FILE_READ);
-    if (!file)
+    lockStorage();
+    bool loaded = loadModelFrom(kModelPath);
+    unlockStorage();
+    if (!loaded)
     {
-        Serial.println("Failed to open model file for reading");
         modelLoaded = false;
         return false;
     }
 
-    if (file.size() < (sizeof(ModelHeader) + sizeof(qTable) + sizeof(visitCounts)))
+    Serial.println("Training model loaded");
+    return true;
+}
+
+bool Training::loadModelFrom(const char *path, uint32_t *crc)
+{
+    size_t length = 0;
+    uint32_t *image = readModelImage(*storage, path, length);
+    if (image == NULL)
     {
-        Serial.println("Training model file is incomplete");
-        file.close();
-        modelLoaded = false;
         return false;
     }
 
-    ModelHeader header = {};
-    size_t headerBytes = file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header));
-    if (headerBytes != sizeof(header))
+    ModelFormat::View view;
+    if (!view.open(image, length))
     {
-        Serial.println("Failed to read model header");
-        file.close();
-        modelLoaded = false;
+        Serial.print("Training model rejected: ");
+        Serial.println(view.getError());
+        delete[] image;
         return false;
     }
 
-    if (header.magic != kModelMagic || header.version != kModelVersion ||
-        header.stateCount != kNumStates || header.actionCount != kNumActions ||
-        header.payloadSize != (sizeof(qTable) + sizeof(visitCounts)))
+    // Build a staging copy so a running step() never sees a half-loaded table.
+    float stagedQ[kNumStates][kNumActions];
+    uint32_t stagedCounts[kNumStates][kNumActions];
+    int mappedCells = importModel(view, stagedQ, stagedCounts);
+    const ModelFormat::Header *header = view.getHeader();
+    uint32_t episodes = header ? header->totalEpisodes : 0;
+    float epsilon = header ? header->epsilon : params.epsilonStart;
+    uint32_t trainedSeconds = header ? header->trainingSeconds : 0;
+    delete[] image;
+
+    if (mappedCells == 0)
     {
-        Serial.println("Training model header mismatch");
-        file.close();
-        modelLoaded = false;
+        Serial.println("Training model does not match this robot's angle options");
         return false;
     }
-
-    size_t qBytes = file.read(reinterpret_cast<uint8_t *>(qTable), sizeof(qTable));
-    size_t countBytes = file.read(reinterpret_cast<uint8_t *>(visitCounts), sizeof(visitCounts));
-    file.close();
-
-    if (qBytes != sizeof(qTable) || countBytes != sizeof(visitCounts))
+    if (mappedCells < kNumStates * kNumActions)
     {
-        Serial.println("Failed to read training model data");
-        modelLoaded = false;
-        return false;
+        Serial.printf("Training model remapped, %d of %d cells kept\n", mappedCells, kNumStates * kNumActions);
     }
 
+    portENTER_CRITICAL(&modelMux);
+    memcpy(qTable, stagedQ, sizeof(qTable));
+#if !RLBOT_INFERENCE_ONLY
+    memcpy(visitCounts, stagedCounts, sizeof(visitCounts));
     hasLastStep = false;
+    resetHistory();
+#endif
     modelLoaded = true;
-    Serial.println("Training model loaded");
-    return true;
-}
+    replayingGait = false;
+    portEXIT_CRITICAL(&modelMux);
+#if !RLBOT_INFERENCE_ONLY
+    reseedFromTable();
+#endif
 
-void Training::resetModel()
-{
-    resetQTable();
-    if (fsReady && SPIFFS.exists(kModelPath))
+    if (!trainingActive)
     {
-        SPIFFS.remove(kModelPath);
+        // Progress of the run that produced the model, for the status screen
+        totalEpisodes = episodes;
+        currentEpsilon = epsilon;
+        accumulatedTrainingMs = static_cast<unsigned long>(trainedSeconds) * 1000UL;
     }
+    if (crc)
+    {
+        *crc = view.getCrc();
+    }
+    return true;
+}
+
+int Training::importModel(const ModelFormat::View &view, float (&stagedQ)[kNumStates][kNumActions],
+                          uint32_t (&stagedCounts)[kNumStates][kNumActions]) const
+{
+    memset(stagedQ, 0, sizeof(stagedQ));
+    memset(stagedCounts, 0, sizeof(stagedCounts));
+
+    const ModelFormat::Header *header = view.getHeader();
+    if (header == NULL)
+    {
+        // Version 2 files only record the table size, so they can only
+        // have been written with this layout
+        if (view.getStateCount() != kNumStates || view.getActionCount() != kNumActions)
+        {
+            return 0;
+        }
+        for (int state = 0; state < kNumStates; ++state)
+        {
+            for (int action = 0; action < kNumActions; ++action)
+            {
+                stagedQ[state][action] = view.q(state, action);
+                stagedCounts[state][action] = view.visits(state, action);
+            }
+        }
+        return kNumStates * kNumActions;
+    }
+
+    // Match the file's angle options to ours, so a model trained with a
+    // different set keeps every cell whose angles still exist
+    int downMap[ModelFormat::kMaxAngleOptions];
+    int upMap[ModelFormat::kMaxAngleOptions];
+    for (int i = 0; i < header->downOptionCount; ++i)
+    {
+        downMap[i] = findAngle(params.downAngleOptions, kDownActionCount, header->downAngles[i]);
+    }
+    for (int i = 0; i < header->upOptionCount; ++i)
+    {
+        upMap[i] = findAngle(params.upAngleOptions, kUpActionCount, header->upAngles[i]);
+    }
+
+    int mapped = 0;
+    for (int fileState = 0; fileState < header->stateCount; ++fileState)
+    {
+        int down = downMap[fileState / header->upOptionCount];
+        int up = upMap[fileState % header->upOptionCount];
+        if (down < 0 || up < 0)
+        {
+            continue;
+        }
+        int state = down * kUpActionCount + up;
+        for (int fileAction = 0; fileAction < header->actionCount; ++fileAction)
+        {
+            int action = fileAction < header->downOptionCount
+                             ? downMap[fileAction]
+                             : upMap[fileAction - header->downOptionCount];
+            if (action < 0)
+            {
+                continue;
+            }
+            if (fileAction >= header->downOptionCount)
+            {
+                action += kDownActionCount;
+            }
+            stagedQ[state][action] = view.q(fileState, fileAction);
+            stagedCounts[state][action] = view.visits(fileState, fileAction);
+            ++mapped;
+        }
+    }
+    return mapped;
+}
+
+bool Training::validateModelFile(const char *path)
+{
+    size_t length = 0;
+    uint32_t *image = readModelImage(*storage, path, length);
+    if (image == NULL)
+    {
+        return false;
+    }
+
+    ModelFormat::View view;
+    bool valid = view.open(image, length);
+    delete[] image;
+    if (!valid)
+    {
+        Serial.print("Training model rejected: ");
+        Serial.println(view.getError());
+    }
+    return valid;
+}
+
+void Training::recoverStagedModel()
+{
+    // A swap interrupted between removing the old file and renaming the
+    // new one leaves only the new file behind; finish it here. If both
+    // are present the swap never started, and the old file wins.
+    static const char *const replacements[][2] = {
+        {kStagedModelPath, kModelPath},
+        {kSavedModelPath, kModelPath},
+        {kCheckpointTempPath, kCheckpointPath},
+    };
+    for (const auto &replacement : replacements)
+    {
+        const char *from = replacement[0];
+        const char *to = replacement[1];
+        if (!storage->exists(from))
+        {
+            continue;
+        }
+        if (!storage->exists(to) && validateModelFile(from))
+        {
+            storage->rename(from, to);
+            Serial.print("Recovered ");
+            Serial.println(to);
+            continue;
+        }
+        storage->remove(from);
+    }
+}
+
+bool Training::replaceFile(const char *from, const char *to)
+{
+    if (storage->exists(to))
+    {
+        storage->remove(to);
+    }
+    return storage->rename(from, to);
+}
+
+void Training::lockStorage()
+{
+    if (storageLock)
+    {
+        xSemaphoreTake(storageLock, portMAX_DELAY);
+    }
+}
+
+void Training::unlockStorage()
+{
+    if (storageLock)
+    {
+        xSemaphoreGive(storageLock);
+    }
+}
+
+#if !RLBOT_INFERENCE_ONLY
+void Training::lockValues()
+{
+    if (valueLock)
+    {
+        xSemaphoreTake(valueLock, portMAX_DELAY);
+    }
+}
+
+void Training::unlockValues()
+{
+    if (valueLock)
+    {
+        xSemaphoreGive(valueLock);
+    }
+}
+#endif
+
+#if !RLBOT_INFERENCE_ONLY
+bool Training::writeSnapshot(const char *path, SnapshotInfo &info)
+{
+    // The whole file, built in memory so it goes out in one write
+    struct
+    {
+        ModelFormat::Header header;
+        float q[kNumStates][kNumActions];
+        uint32_t counts[kNumStates][kNumActions];
+        ModelFormat::Trailer trailer;
+    } image;
+    static_assert(sizeof(image) == sizeof(ModelFormat::Header) + sizeof(qTable) + sizeof(visitCounts) +
+                                       sizeof(ModelFormat::Trailer),
+                  "snapshot image must not be padded");
+
+    // The tiles or network are projected under the value lock only; step()
+    // cannot move them before the projection reaches the table
+    lockValues();
+    bool projected = projectValues(image.q);
+    portENTER_CRITICAL(&modelMux);
+    if (projected)
+    {
+        memcpy(qTable, image.q, sizeof(qTable));
+    }
+    else
+    {
+        memcpy(image.q, qTable, sizeof(image.q));
+    }
+    memcpy(image.counts, visitCounts, sizeof(image.counts));
+    info.sequence = updateSequence;
+    info.episodes = totalEpisodes;
+    info.epsilon = currentEpsilon;
+    portEXIT_CRITICAL(&modelMux);
+    unlockValues();
+
+    ModelFormat::Header &header = image.header;
+    ModelFormat::initHeader(header, kDownActionCount, kUpActionCount);
+    header.totalEpisodes = info.episodes;
+    header.trainingSeconds = static_cast<uint32_t>(getTotalTrainingSeconds());
+    header.epsilon = info.epsilon;
+    header.gamma = params.gamma;
+    header.epsilonStart = params.epsilonStart;
+    header.epsilonMin = params.epsilonMin;
+    header.epsilonDecay = params.epsilonDecay;
+    for (int i = 0; i < kDownActionCount; ++i)
+    {
+        header.downAngles[i] = params.downAngleOptions[i];
+    }
+    for (int i = 0; i < kUpActionCount; ++i)
+    {
+        header.upAngles[i] = params.upAngleOptions[i];
+    }
+
+    image.trailer = crc32(0, &image, offsetof(decltype(image), trailer));
+    info.crc = image.trailer;
+
+    if (!storage->write(path, reinterpret_cast<const uint8_t *>(&image), sizeof(image)))
+    {
+        Serial.print("Failed to write ");
+        Serial.println(path);
+        storage->remove(path);
+        return false;
+    }
+    return true;
+}
+
+bool Training::writeCheckpoint()
+{
+    SnapshotInfo info = {};
+    if (!writeSnapshot(kCheckpointTempPath, info) || !replaceFile(kCheckpointTempPath, kCheckpointPath))
+    {
+        Serial.println("Failed to write training checkpoint");
+        journalBytes = 0;
+        return false;
+    }
+    snapshotCrc = info.crc;
+    snapshotSequence = info.sequence;
+    return startJournal(info);
+}
+
+bool Training::startJournal(const SnapshotInfo &info)
+{
+    struct
+    {
+        JournalHeader header;
+        JournalRecord progress;
+    } start;
+    start.header = {kJournalMagic, kJournalVersion, info.crc};
+    start.progress = makeRecord(JOURNAL_PROGRESS, 0, 0, info.episodes, floatBits(info.epsilon));
+
+    // A journal that failed to start is rebuilt, with a new checkpoint,
+    // on the next append
+    if (!storage->write(kJournalPath, reinterpret_cast<const uint8_t *>(&start), sizeof(start)))
+    {
+        Serial.println("Failed to start training journal");
+        journalBytes = 0;
+        return false;
+    }
+    journalBytes = sizeof(start);
+    return true;
+}
+
+bool Training::replayJournal(uint32_t baseCrc, uint32_t &episodes, float &epsilon)
+{
+    JournalHeader header = {};
+    size_t offset = storage->read(kJournalPath, 0, reinterpret_cast<uint8_t *>(&header), sizeof(header));
+    if (offset != sizeof(header) || header.magic != kJournalMagic || header.version != kJournalVersion ||
+        header.baseCrc != baseCrc)
+    {
+        // Missing, or left over from an older checkpoint that already has it
+        return false;
+    }
+
+    bool haveProgress = false;
+    bool torn = false;
+    uint32_t applied = 0;
+    // Read in batches; some backends load the whole file on every read
+    JournalRecord records[32];
+    size_t bytes;
+    while (!torn && (bytes = storage->read(kJournalPath, offset, reinterpret_cast<uint8_t *>(records),
+                                            sizeof(records))) >= sizeof(JournalRecord))
+    {
+        size_t count = bytes / sizeof(JournalRecord);
+        offset += count * sizeof(JournalRecord);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const JournalRecord &record = records[i];
+            if (record.crc != crc32(0, &record, offsetof(JournalRecord, crc)))
+            {
+                Serial.println("Training journal ends in a torn record");
+                torn = true;
+                break;
+            }
+            if (record.type == JOURNAL_CELL && record.state < kNumStates && record.action < kNumActions)
+            {
+                portENTER_CRITICAL(&modelMux);
+                qTable[record.state][record.action] = bitsFloat(record.first);
+                visitCounts[record.state][record.action] = record.second;
+                portEXIT_CRITICAL(&modelMux);
+                ++applied;
+            }
+            else if (record.type == JOURNAL_PROGRESS)
+            {
+                episodes = record.first;
+                epsilon = bitsFloat(record.second);
+                haveProgress = true;
+            }
+        }
+    }
+
+    Serial.printf("Replayed %u journal updates\n", static_cast<unsigned>(applied));
+    return haveProgress;
+}
+
+void Training::setUpdateHandler(UpdateHandler handler, void *context)
+{
+    updateContext = context;
+    updateHandler = handler;
+}
+
+bool Training::resumeTraining()
+{
+    if (!storageReady || !storage->exists(kCheckpointPath))
+    {
+        return false;
+    }
+
+    lockStorage();
+    uint32_t crc = 0;
+    bool resumed = loadModelFrom(kCheckpointPath, &crc);
+    // The checkpoint's own progress, unless the journal carries it further
+    uint32_t episodes = totalEpisodes;
+    float epsilon = currentEpsilon;
+    if (resumed && !replayJournal(crc, episodes, epsilon))
+    {
+        // A cut between renaming a checkpoint into place and starting its
+        // journal leaves none, or the last one's; the checkpoint has it all
+        Serial.println("No journal for this checkpoint, resuming from it alone");
+    }
+    // A checkpoint continues its own run rather than seeding a new one
+    modelLoaded = false;
+    if (resumed)
+    {
+        // loadModelFrom() restored the training time; startTraining() clears it
+        unsigned long trainedMs = accumulatedTrainingMs;
+        startTraining();
+        accumulatedTrainingMs = trainedMs;
+        totalEpisodes = episodes;
+        currentEpsilon = epsilon;
+        reseedFromTable();
+        // Fold the replayed updates into a fresh checkpoint, so appends
+        // never follow a torn record
+        writeCheckpoint();
+    }
+    else
+    {
+        resetQTable();
+    }
+    replayingGait = false;
+    unlockStorage();
+
+    if (resumed)
+    {
+        Serial.printf("Training resumed at episode %u\n", static_cast<unsigned>(episodes));
+    }
+    return resumed;
+}
+
+void Training::requestSave()
+{
+    saveRequested = true;
+}
+
+bool Training::takeSaveRequest()
+{
+    if (!saveRequested)
+    {
+        return false;
+    }
+    saveRequested = false;
+    return true;
+}
+
+bool Training::appendJournal(const CellUpdate *updates, size_t count)
+{
+    if (!storageReady)
+    {
+        return false;
+    }
+
+    lockStorage();
+    // No journal yet: checkpoint the table first. Updates the checkpoint
+    // already covers are skipped below.
+    bool ok = journalBytes != 0 || writeCheckpoint();
+    if (ok)
+    {
+        // Appended in batches, with the progress record in the last one
+        JournalRecord batch[17];
+        size_t batched = 0;
+        const CellUpdate *last = NULL;
+        for (size_t i = 0; ok && i <= count; ++i)
+        {
+            if (i < count && static_cast<int32_t>(updates[i].sequence - snapshotSequence) > 0)
+            {
+                const CellUpdate &update = updates[i];
+                batch[batched++] = makeRecord(JOURNAL_CELL, update.state, update.action, floatBits(update.q),
+                                              update.visits);
+                last = &update;
+            }
+            if (i == count && last)
+            {
+                batch[batched++] = makeRecord(JOURNAL_PROGRESS, 0, 0, last->episodes, floatBits(last->epsilon));
+            }
+            if (batched > 0 && (batched == sizeof(batch) / sizeof(batch[0]) - 1 || i == count))
+            {
+                ok = storage->append(kJournalPath, reinterpret_cast<const uint8_t *>(batch),
+                                     batched * sizeof(JournalRecord));
+                journalBytes += ok ? batched * sizeof(JournalRecord) : 0;
+                batched = 0;
+            }
+        }
+    }
+    unlockStorage();
+    return ok;
+}
+
+bool Training::compactJournal()
+{
+    if (!storageReady)
+    {
+        return false;
+    }
+    lockStorage();
+    bool ok = writeCheckpoint();
+    unlockStorage();
+    return ok;
+}
+
+size_t Training::getJournalBytes() const
+{
+    return journalBytes;
+}
+
+void Training::setTransitionHandler(TransitionHandler handler, void *context)
+{
+    transitionContext = context;
+    transitionHandler = handler;
+}
+
+bool Training::appendTransitions(const TransitionLog::Record *records, size_t count)
+{
+    if (!storageReady)
+    {
+        return false;
+    }
+
+    TransitionLog::Header header;
+    TransitionLog::initHeader(header, params.downAngleOptions, kDownActionCount, params.upAngleOptions,
+                              kUpActionCount);
+    size_t bytes = count * sizeof(TransitionLog::Record);
+
+    lockStorage();
+    size_t logBytes = storage->exists(kTransitionLogPath) ? storage->size(kTransitionLogPath) : 0;
+    // Start a new log when this one is full, ends in a record torn by a
+    // power cut, or, checked once per boot, was written with other angle
+    // options
+    bool startLog = logBytes < sizeof(header) || logBytes + bytes > kMaxTransitionLogBytes ||
+                    (logBytes - sizeof(header)) % sizeof(TransitionLog::Record) != 0;
+    if (!startLog && !transitionLogChecked)
+    {
+        TransitionLog::Header stored;
+        startLog = storage->read(kTransitionLogPath, 0, reinterpret_cast<uint8_t *>(&stored), sizeof(stored)) !=
+                       sizeof(stored) ||
+                   memcmp(&stored, &header, sizeof(header)) != 0;
+    }
+    bool ok = true;
+    if (startLog && logBytes > 0)
+    {
+        // The full log stays readable until the next one fills up
+        if (storage->exists(kPreviousTransitionLogPath))
+        {
+            storage->remove(kPreviousTransitionLogPath);
+        }
+        ok = storage->rename(kTransitionLogPath, kPreviousTransitionLogPath);
+    }
+    if (startLog)
+    {
+        ++transitionLogGeneration;
+    }
+    if (ok && startLog)
+    {
+        ok = storage->write(kTransitionLogPath, reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    }
+    transitionLogChecked = ok;
+    ok = ok && storage->append(kTransitionLogPath, reinterpret_cast<const uint8_t *>(records), bytes);
+    unlockStorage();
+    return ok;
+}
+
+size_t Training::readTransitions(bool previous, size_t offset, uint8_t *buffer, size_t length, uint32_t &generation)
+{
+    if (!storageReady)
+    {
+        return 0;
+    }
+    const char *path = previous ? kPreviousTransitionLogPath : kTransitionLogPath;
+    lockStorage();
+    size_t bytes = storage->exists(path) ? storage->read(path, offset, buffer, length) : 0;
+    generation = transitionLogGeneration;
+    unlockStorage();
+    return bytes;
+}
+
+void Training::clearTransitions()
+{
+    if (!storageReady)
+    {
+        return;
+    }
+    lockStorage();
+    const char *const paths[] = {kTransitionLogPath, kPreviousTransitionLogPath};
+    for (const char *path : paths)
+    {
+        if (storage->exists(path))
+        {
+            storage->remove(path);
+        }
+    }
+    transitionLogChecked = false;
+    ++transitionLogGeneration;
+    unlockStorage();
+    Serial.println("Transition log cleared");
+}
+#endif
+
+size_t Training::getModelSize()
+{
+    if (!storageReady)
+    {
+        return 0;
+    }
+    lockStorage();
+    size_t size = storage->size(kModelPath);
+    unlockStorage();
+    return size;
+}
+
+size_t Training::readModel(size_t offset, uint8_t *buffer, size_t length)
+{
+    if (!storageReady)
+    {
+        return 0;
+    }
+    lockStorage();
+    size_t bytes = storage->read(kModelPath, offset, buffer, length);
+    unlockStorage();
+    return bytes;
+}
+
+uint32_t Training::beginModelUpload()
+{
+    if (!storageReady)
+    {
+        Serial.println("Model upload rejected (storage unavailable)");
+        return 0;
+    }
+
+    lockStorage();
+    if (uploadToken != 0 && millis() - uploadWrittenMs < kUploadIdleMs)
+    {
+        unlockStorage();
+        Serial.println("Model upload rejected (another upload is in progress)");
+        return 0;
+    }
+    // Truncating the staging file also drops an abandoned upload, whose
+    // token stops working here
+    bool opened = storage->write(kStagedModelPath, NULL, 0);
+    uploadToken = 0;
+    if (opened)
+    {
+        lastUploadToken = lastUploadToken + 1 != 0 ? lastUploadToken + 1 : 1;
+        uploadToken = lastUploadToken;
+    }
+    uploadWrittenMs = millis();
+    uploadBytes = 0;
+    uint32_t upload = uploadToken;
+    unlockStorage();
+    if (!opened)
+    {
+        Serial.println("Failed to open staged model file");
+    }
+    return upload;
+}
+
+bool Training::writeModelUpload(uint32_t upload, const uint8_t *data, size_t length)
+{
+    lockStorage();
+    if (upload == 0 || upload != uploadToken)
+    {
+        unlockStorage();
+        return false;
+    }
+
+    // Anything past the largest header, tables and CRC cannot be a valid model.
+    bool ok = uploadBytes + length <= ModelFormat::kMaxFileSize;
+    if (!ok)
+    {
+        Serial.println("Model upload too large");
+    }
+    else if (!(ok = storage->append(kStagedModelPath, data, length)))
+    {
+        Serial.println("Failed to write staged model");
+    }
+    if (ok)
+    {
+        uploadBytes += length;
+        uploadWrittenMs = millis();
+    }
+    else
+    {
+        dropUpload();
+    }
+    unlockStorage();
+    return ok;
+}
+
+bool Training::finishModelUpload(uint32_t upload)
+{
+    lockStorage();
+    if (upload == 0 || upload != uploadToken)
+    {
+        unlockStorage();
+        return false;
+    }
+    uploadToken = 0;
+
+    // Swap the table in memory first, then replace the file; a power loss
+    // in between is repaired by recoverStagedModel() on the next boot.
+    if (!loadModelFrom(kStagedModelPath))
+    {
+        storage->remove(kStagedModelPath);
+        unlockStorage();
+        Serial.println("Uploaded model rejected");
+        return false;
+    }
+
+    bool replaced = replaceFile(kStagedModelPath, kModelPath);
+    unlockStorage();
+    if (!replaced)
+    {
+        Serial.println("Failed to replace training model file");
+        return false;
+    }
+
+    Serial.println("Uploaded training model installed");
+    return true;
+}
+
+void Training::abortModelUpload(uint32_t upload)
+{
+    lockStorage();
+    if (upload != 0 && upload == uploadToken)
+    {
+        dropUpload();
+    }
+    unlockStorage();
+}
+
+// With the storage lock held
+void Training::dropUpload()
+{
+    uploadToken = 0;
+    uploadBytes = 0;
+    storage->remove(kStagedModelPath);
+}
+
+#if !RLBOT_INFERENCE_ONLY
+void Training::resetModel()
+{
+    clearModel();
+    removeModelFiles();
     Serial.println("Training model reset");
+}
+
+void Training::clearModel()
+{
+    resetQTable();
     modelLoaded = false;
+    replayingGait = false;
     hasLastStep = false;
+    resetHistory();
+}
+
+void Training::removeModelFiles()
+{
+    if (storageReady)
+    {
+        lockStorage();
+        const char *const paths[] = {kModelPath, kCheckpointPath, kJournalPath};
+        for (const char *path : paths)
+        {
+            if (storage->exists(path))
+            {
+                storage->remove(path);
+            }
+        }
+        snapshotSequence = updateSequence;
+        journalBytes = 0;
+        unlockStorage();
+    }
 }
 
 bool Training::isEpsilonMin() const
 {
-    return currentEpsilon <= kEpsilonMin;
+    return currentEpsilon <= params.epsilonMin;
 }
+#endif
 
 void Training::resetQTable()
 {
-    for (int state = 0; state < kNumStates; ++state)
+    memset(qTable, 0, sizeof(qTable));
+#if !RLBOT_INFERENCE_ONLY
+    memset(qSpread, 0, sizeof(qSpread));
+    memset(visitCounts, 0, sizeof(visitCounts));
+    lockValues();
+    tiles.clear();
+    network.clear();
+    unlockValues();
+    if (hashed != NULL)
     {
-        for (int action = 0; action < kNumActions; ++action)
-        {
-            qTable[state][action] = 0.0f;
-            visitCounts[state][action] = 0;
-        }
+        hashed->clear();
     }
+#endif
 }
 
 int Training::getStateIndex(int downAngleDeg, int upAngleDeg) const
@@ -370,11 +1786,20 @@ int Training::getStateIndex(int downAngleDeg, int upAngleDeg) const
     return (downIndex * kUpActionCount) + upIndex;
 }
 
+#if !RLBOT_INFERENCE_ONLY
+int Training::getNearestStateIndex(int downAngleDeg, int upAngleDeg) const
+{
+    int downIndex = findNearestAngle(params.downAngleOptions, kDownActionCount, downAngleDeg);
+    int upIndex = findNearestAngle(params.upAngleOptions, kUpActionCount, upAngleDeg);
+    return (downIndex * kUpActionCount) + upIndex;
+}
+#endif
+
 int Training::findDownIndex(int downAngleDeg) const
 {
     for (int i = 0; i < kDownActionCount; ++i)
     {
-        if (kDownAngleOptions[i] == downAngleDeg)
+        if (params.downAngleOptions[i] == downAngleDeg)
         {
             return i;
         }
@@ -386,7 +1811,7 @@ int Training::findUpIndex(int upAngleDeg) const
 {
     for (int i = 0; i < kUpActionCount; ++i)
     {
-        if (kUpAngleOptions[i] == upAngleDeg)
+        if (params.upAngleOptions[i] == upAngleDeg)
         {
             return i;
         }
@@ -399,6 +1824,13 @@ float Training::computeQ(int stateIndex, int actionIndex) const
     return qTable[stateIndex][actionIndex];
 }
 
+#if !RLBOT_INFERENCE_ONLY
+float Training::learningRate(uint32_t visits) const
+{
+    float alpha = 1.0f / (1.0f + static_cast<float>(visits));
+    return alpha > params.alphaMin ? alpha : params.alphaMin;
+}
+
 float Training::computeMaxQ(int stateIndex) const
 {
     float bestQ = computeQ(stateIndex, 0);
@@ -413,16 +1845,67 @@ float Training::computeMaxQ(int stateIndex) const
     return bestQ;
 }
 
-int Training::selectAction(int stateIndex)
+// Queues the last step's transition and, once returnSteps of them are
+// waiting, updates the oldest towards its n-step return. Returns whether a
+// cell was updated, and which. Called with the model lock held.
+bool Training::learnReturn(int currentState, float reward, int &stateIndex, int &actionIndex)
 {
-    int roll = random(0, 10000);
-    if (roll < static_cast<int>(currentEpsilon * 10000.0f))
+    Transition &added = pending[(pendingStart + pendingCount) % kMaxReturnSteps];
+    added.state = static_cast<uint8_t>(lastState);
+    added.action = static_cast<uint8_t>(lastAction);
+    added.reward = reward;
+    if (++pendingCount < params.returnSteps)
     {
-        return random(0, kNumActions);
+        return false;
+    }
+
+    float target = 0.0f;
+    float discount = 1.0f;
+    for (int i = 0; i < pendingCount; ++i)
+    {
+        target += discount * pending[(pendingStart + i) % kMaxReturnSteps].reward;
+        discount *= params.gamma;
+    }
+    stateIndex = pending[pendingStart].state;
+    actionIndex = pending[pendingStart].action;
+    pendingStart = (pendingStart + 1) % kMaxReturnSteps;
+    --pendingCount;
+
+    float alpha = learningRate(visitCounts[stateIndex][actionIndex]);
+    if (!params.doubleQ)
+    {
+        target += discount * computeMaxQ(currentState);
+        qTable[stateIndex][actionIndex] += alpha * (target - qTable[stateIndex][actionIndex]);
+        return true;
+    }
+
+    // One estimate, picked at random, learns; its best action at the next
+    // state is valued by the other. Moving one estimate by change moves
+    // their mean and their spread by half of it each.
+    float side = random(0, 2) == 0 ? 1.0f : -1.0f;
+    const float *mean = qTable[currentState];
+    const float *spread = qSpread[currentState];
+    int best = 0;
+    for (int action = 1; action < kNumActions; ++action)
+    {
+        if (mean[action] + side * spread[action] > mean[best] + side * spread[best])
+        {
+            best = action;
+        }
     }
+    target += discount * (mean[best] - side * spread[best]);
+    float estimate = qTable[stateIndex][actionIndex] + side * qSpread[stateIndex][actionIndex];
+    float change = alpha * (target - estimate);
+    qTable[stateIndex][actionIndex] += 0.5f * change;
+    qSpread[stateIndex][actionIndex] += 0.5f * side * change;
+    return true;
+}
 
-    return selectBestAction(stateIndex);
+int Training::selectAction(int stateIndex)
+{
+    return selectActionFrom(qTable[stateIndex], stateIndex);
 }
+#endif
 
 int Training::selectBestAction(int stateIndex) const
 {
@@ -441,24 +1924,371 @@ int Training::selectBestAction(int stateIndex) const
     return bestAction;
 }
 
+#if !RLBOT_INFERENCE_ONLY
+void Training::encodeState(int downAngleDeg, int upAngleDeg, float speedCms, TileCoder::Features &features) const
+{
+    tiles.encode(static_cast<float>(downAngleDeg), static_cast<float>(upAngleDeg), speedCms, features);
+}
+
+uint32_t Training::encodeHashedState(int stateIndex, int previousAction, int phase, float pitchDeg)
+{
+    int maxBucket = (1 << kPitchBits) - 1;
+    int pitchBucket = static_cast<int>(floorf(pitchDeg / kPitchBucketDeg)) + (1 << (kPitchBits - 1));
+    pitchBucket = constrain(pitchBucket, 0, maxBucket);
+
+    uint32_t key = static_cast<uint32_t>(pitchBucket);
+    key = (key << kPhaseBits) | static_cast<uint32_t>(phase);
+    key = (key << kActionBits) | static_cast<uint32_t>(previousAction);
+    key = (key << kStateBits) | static_cast<uint32_t>(stateIndex);
+    return key;
+}
+
+// Steps since the last one that moved the body forward, which stands in
+// for the gait phase
+void Training::advancePhase(float reward)
+{
+    progressPhase = reward > kProgressCm ? 0 : min(progressPhase + 1, kMaxPhase);
+}
+
+void Training::resetHistory()
+{
+    previousAction = kNoAction;
+    progressPhase = 0;
+    pendingStart = 0;
+    pendingCount = 0;
+}
+
+void Training::readHashed(const HashedTable::Entry &entry, int stateIndex, float *qValues) const
+{
+    for (int action = 0; action < kNumActions; ++action)
+    {
+        qValues[action] = entry.visits[action] < kHashedMinVisits ? qTable[stateIndex][action] : entry.q[action];
+    }
+}
+
+// stateIndex is the table cell whose visit counts stand for this state
+int Training::selectActionFrom(const float *qValues, int stateIndex)
+{
+    if (params.exploration == EXPLORE_UCB)
+    {
+        return selectUcbAction(qValues, stateIndex);
+    }
+    if (params.exploration == EXPLORE_SOFTMAX)
+    {
+        return selectSoftmaxAction(qValues);
+    }
+
+    int roll = random(0, 10000);
+    if (roll < static_cast<int>(currentEpsilon * 10000.0f))
+    {
+        return random(0, kNumActions);
+    }
+
+    return findBestAction(qValues);
+}
+
+int Training::selectUcbAction(const float *qValues, int stateIndex) const
+{
+    const uint32_t *visits = visitCounts[stateIndex];
+    uint32_t stateVisits = 0;
+    for (int action = 0; action < kNumActions; ++action)
+    {
+        if (visits[action] == 0)
+        {
+            return action;
+        }
+        stateVisits += visits[action];
+    }
+
+    float logVisits = logf(static_cast<float>(stateVisits));
+    float scale = kUcbScale / (1.0f - params.gamma);
+    int bestAction = 0;
+    float bestScore = 0.0f;
+    for (int action = 0; action < kNumActions; ++action)
+    {
+        float score = qValues[action] + scale * sqrtf(logVisits / static_cast<float>(visits[action]));
+        if (action == 0 || score > bestScore)
+        {
+            bestAction = action;
+            bestScore = score;
+        }
+    }
+    return bestAction;
+}
+
+int Training::selectSoftmaxAction(const float *qValues)
+{
+    int bestAction = findBestAction(qValues);
+    float temperature = kSoftmaxTemperature * currentEpsilon / (1.0f - params.gamma);
+    if (temperature <= 0.0f)
+    {
+        return bestAction;
+    }
+
+    // Weights relative to the best action, so they stay in (0, 1]
+    float stepsPerQ = kExpStepsPerUnit / temperature;
+    float weights[kNumActions];
+    float total = 0.0f;
+    for (int action = 0; action < kNumActions; ++action)
+    {
+        float index = (qValues[bestAction] - qValues[action]) * stepsPerQ + 0.5f;
+        weights[action] = index < kExpTableSize ? expTable.values[static_cast<int>(index)] : 0.0f;
+        total += weights[action];
+    }
+
+    float roll = static_cast<float>(random(0, 10000)) * (total / 10000.0f);
+    for (int action = 0; action < kNumActions; ++action)
+    {
+        roll -= weights[action];
+        if (roll < 0.0f)
+        {
+            return action;
+        }
+    }
+    return bestAction;
+}
+
+int Training::findBestAction(const float *qValues)
+{
+    int bestAction = 0;
+    for (int action = 1; action < kNumActions; ++action)
+    {
+        if (qValues[action] > qValues[bestAction])
+        {
+            bestAction = action;
+        }
+    }
+    return bestAction;
+}
+
+// The tiles' or network's value at an option pair. With speed in the tile
+// state, it is the mean over the centres of the speed tiles; the network
+// is taken at rest.
+float Training::projectValue(int stateIndex, int actionIndex) const
+{
+    int down = params.downAngleOptions[stateIndex / kUpActionCount];
+    int up = params.upAngleOptions[stateIndex % kUpActionCount];
+    if (network.isActive())
+    {
+        QNetwork::Input input;
+        QNetwork::encode(down, up, 0.0f, 0.0f, input);
+        return network.value(input, actionIndex);
+    }
+    int speeds = tiles.usesSpeed() ? TileCoder::kSpeedTiles : 1;
+    float sum = 0.0f;
+    for (int i = 0; i < speeds; ++i)
+    {
+        TileCoder::Features features;
+        float speed = (i + 0.5f) * TileCoder::kMaxSpeedCms / TileCoder::kSpeedTiles;
+        encodeState(down, up, speed, features);
+        sum += tiles.value(features, actionIndex);
+    }
+    return sum / speeds;
+}
+
+// Every cell's projectValue(), into values; false, with values untouched,
+// when the table is the model. The caller holds the value lock.
+bool Training::projectValues(float (&values)[kNumStates][kNumActions]) const
+{
+    if (network.isActive())
+    {
+        for (int state = 0; state < kNumStates; ++state)
+        {
+            QNetwork::Input input;
+            QNetwork::encode(params.downAngleOptions[state / kUpActionCount],
+                             params.upAngleOptions[state % kUpActionCount], 0.0f, 0.0f, input);
+            network.values(input, values[state]);
+        }
+        return true;
+    }
+    if (!tiles.isActive())
+    {
+        return false;
+    }
+    for (int state = 0; state < kNumStates; ++state)
+    {
+        for (int action = 0; action < kNumActions; ++action)
+        {
+            values[state][action] = projectValue(state, action);
+        }
+    }
+    return true;
+}
+
+// Sets the tiles so that projectValue() gives back the table, as far as
+// shared tiles allow; a few passes settle the overlap. Like fitNetwork(),
+// it takes the value lock for one state at a time, and the model lock
+// only to copy that state's row of the table.
+void Training::fitTiles()
+{
+    if (!tiles.isActive())
+    {
+        return;
+    }
+    for (size_t first = 0; first < tiles.getFeatureCount(); first += kTileClearRows)
+    {
+        lockValues();
+        tiles.clear(first, kTileClearRows);
+        unlockValues();
+    }
+    int speeds = tiles.usesSpeed() ? TileCoder::kSpeedTiles : 1;
+    for (int pass = 0; pass < kTileFitPasses; ++pass)
+    {
+        for (int state = 0; state < kNumStates; ++state)
+        {
+            int down = params.downAngleOptions[state / kUpActionCount];
+            int up = params.upAngleOptions[state % kUpActionCount];
+            float target[kNumActions];
+            portENTER_CRITICAL(&modelMux);
+            memcpy(target, qTable[state], sizeof(target));
+            portEXIT_CRITICAL(&modelMux);
+            lockValues();
+            for (int i = 0; i < speeds; ++i)
+            {
+                TileCoder::Features features;
+                float speed = (i + 0.5f) * TileCoder::kMaxSpeedCms / TileCoder::kSpeedTiles;
+                encodeState(down, up, speed, features);
+                for (int action = 0; action < kNumActions; ++action)
+                {
+                    tiles.update(features, action, target[action] - tiles.value(features, action));
+                }
+            }
+            unlockValues();
+        }
+    }
+}
+
+// Trains the network towards the table at the option pairs, at rest. One
+// state at a time under the value lock, so infer() is never held up for
+// the whole fit, and the model lock only to copy that state's row.
+void Training::fitNetwork()
+{
+    if (!network.isActive())
+    {
+        return;
+    }
+    lockValues();
+    network.clear();
+    unlockValues();
+    for (int pass = 0; pass < kNetworkFitPasses; ++pass)
+    {
+        for (int state = 0; state < kNumStates; ++state)
+        {
+            QNetwork::Input input;
+            QNetwork::encode(params.downAngleOptions[state / kUpActionCount],
+                             params.upAngleOptions[state % kUpActionCount], 0.0f, 0.0f, input);
+            float target[kNumActions];
+            portENTER_CRITICAL(&modelMux);
+            memcpy(target, qTable[state], sizeof(target));
+            portEXIT_CRITICAL(&modelMux);
+            lockValues();
+            for (int action = 0; action < kNumActions; ++action)
+            {
+                float error = target[action] - network.value(input, action);
+                network.update(input, action, kNetworkFitRate * error);
+            }
+            unlockValues();
+        }
+    }
+}
+
+// After the table changed underneath: tiles and network are fitted to it
+// again, and hashed states start over from it. Takes the locks for a
+// piece of the work at a time.
+void Training::reseedFromTable()
+{
+    portENTER_CRITICAL(&modelMux);
+    if (hashed != NULL)
+    {
+        hashed->clear();
+    }
+    memset(qSpread, 0, sizeof(qSpread));
+    portEXIT_CRITICAL(&modelMux);
+    fitTiles();
+    fitNetwork();
+}
+
+// Turns the loaded model into a prior for the run startTraining() just
+// began. A cell's learning rate is 1 / (1 + visits), so capping the visits
+// it brings along at round(warmStart * kWarmMaxVisits) keeps the first new
+// reward moving it by at least 1/5 (1/3 at warmStart 0.5, 1/4 at 0.75), and
+// cells the prior never tried still learn at full rate.
+void Training::applyWarmStart()
+{
+    float confidence = params.warmStart;
+    portENTER_CRITICAL(&modelMux);
+    for (int state = 0; state < kNumStates; ++state)
+    {
+        for (int action = 0; action < kNumActions; ++action)
+        {
+            uint32_t visits = visitCounts[state][action];
+            visits = visits < kWarmMaxVisits ? visits : kWarmMaxVisits;
+            visitCounts[state][action] = static_cast<uint32_t>(visits * confidence + 0.5f);
+        }
+    }
+    currentEpsilon = max(params.epsilonMin, params.epsilonStart * (1.0f - confidence));
+    portEXIT_CRITICAL(&modelMux);
+    Serial.printf("Training warm-started, confidence %.2f, epsilon %.2f\n", confidence, currentEpsilon);
+}
+#endif
+
+// Follows the greedy table policy from the first option pair until it
+// comes back to a state it has already visited. Mirrors
+// tools/gait_compiler.py.
+bool Training::distilGait()
+{
+    if (!modelLoaded || params.valueFunction != VALUE_TABLE)
+    {
+        Serial.println("No table policy to distil a gait from");
+        return false;
+    }
+
+    int8_t visitedAt[kNumStates];
+    memset(visitedAt, -1, sizeof(visitedAt));
+    int downAngle = params.downAngleOptions[0];
+    int upAngle = params.upAngleOptions[0];
+    uint8_t count = 0;
+    portENTER_CRITICAL(&modelMux);
+    int state = getStateIndex(downAngle, upAngle);
+    while (visitedAt[state] < 0)
+    {
+        visitedAt[state] = static_cast<int8_t>(count);
+        int action = selectBestAction(state);
+        decodeAction(action, downAngle, upAngle, downAngle, upAngle);
+        GaitKeyframe &frame = distilledFrames[count++];
+        frame.action = static_cast<uint8_t>(action);
+        frame.downAngleDeg = static_cast<uint8_t>(downAngle);
+        frame.upAngleDeg = static_cast<uint8_t>(upAngle);
+        state = getStateIndex(downAngle, upAngle);
+    }
+    portEXIT_CRITICAL(&modelMux);
+
+    gait.frames = distilledFrames;
+    gait.frameCount = count;
+    gait.loopStart = static_cast<uint8_t>(visitedAt[state]);
+    return true;
+}
+
+#if !RLBOT_INFERENCE_ONLY
 void Training::decayEpsilon()
 {
-    if (currentEpsilon > kEpsilonMin)
+    if (currentEpsilon > params.epsilonMin)
     {
-        currentEpsilon *= kEpsilonDecay;
-        if (currentEpsilon < kEpsilonMin)
+        currentEpsilon *= params.epsilonDecay;
+        if (currentEpsilon < params.epsilonMin)
         {
-            currentEpsilon = kEpsilonMin;
+            currentEpsilon = params.epsilonMin;
         }
     }
 }
+#endif
 
 void Training::decodeAction(int actionIndex, int currentDownAngle, int currentUpAngle,
                             int &targetDownAngle, int &targetUpAngle) const
 {
     if (actionIndex < kDownActionCount)
     {
-        targetDownAngle = kDownAngleOptions[actionIndex];
+        targetDownAngle = params.downAngleOptions[actionIndex];
         targetUpAngle = currentUpAngle;
         return;
     }
@@ -469,7 +2299,7 @@ void Training::decodeAction(int actionIndex, int currentDownAngle, int currentUp
         upIndex = 0;
     }
     targetDownAngle = currentDownAngle;
-    targetUpAngle = kUpAngleOptions[upIndex];
+    targetUpAngle = params.upAngleOptions[upIndex];
 }
 
 float Training::computeReward(float deltaDistanceCm) const
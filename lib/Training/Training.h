@@ -2,9 +2,108 @@
 #define TRAINING_H
 
 #include <Arduino.h>
+#include <ModelStorage.h>
+#include "CompiledGait.h"
+
+// Build with -D RLBOT_INFERENCE_ONLY to leave learning out of the firmware.
+// Such a robot loads a model, or replays a compiled gait, and acts on the
+// table greedily: there is no step(), no visit counts, no exploration, no
+// checkpoints and no value function other than the table.
+#ifndef RLBOT_INFERENCE_ONLY
+#define RLBOT_INFERENCE_ONLY 0
+#endif
+
+#if !RLBOT_INFERENCE_ONLY
+#include "QNetwork.h"
+#include "SparseQTable.h"
+#include "TileCoder.h"
+#include "TransitionLog.h"
+#endif
+
+namespace ModelFormat
+{
+    class View;
+}
 
 class Training {
 public:
+    static constexpr int kDownActionCount = 3;
+    static constexpr int kUpActionCount = 3;
+
+    // How Q(s, a) is represented while learning. The table has one cell
+    // per angle option pair and maps any other pose to the first one. Tiles
+    // (see TileCoder) take the commanded angles as they are, and with
+    // VALUE_TILES_SPEED the measured speed too. Model files always hold the
+    // table; in tile modes it is the tiles' value at each option pair, and
+    // loading a model fits the tiles back to it.
+    //
+    // VALUE_HASHED adds history to the table state: the previous action,
+    // how many steps ago the body last moved forward, and the pitch bucket.
+    // Those states live in a SparseQTable, seeded from the plain table,
+    // which keeps learning alongside and is what gets saved.
+    //
+    // VALUE_NETWORK learns a QNetwork over the angles, speed and
+    // acceleration. Like the tiles, it is saved as its values at the option
+    // pairs, here at rest, and fitted back to them on load.
+    enum ValueFunction : uint8_t
+    {
+        VALUE_TABLE = 0,
+        VALUE_TILES = 1,
+        VALUE_TILES_SPEED = 2,
+        VALUE_HASHED = 3,
+        VALUE_NETWORK = 4,
+    };
+
+    // How training picks actions. Epsilon-greedy tries a uniformly random
+    // action with probability epsilon. UCB1 takes the action whose value
+    // plus a bonus for being rarely tried is highest, so untried actions go
+    // first. Softmax draws actions in proportion to exp(Q / temperature),
+    // with the temperature following the epsilon schedule, so near-equal
+    // actions share the tries and clearly worse ones are rarely taken.
+    enum Exploration : uint8_t
+    {
+        EXPLORE_EPSILON = 0,
+        EXPLORE_UCB = 1,
+        EXPLORE_SOFTMAX = 2,
+    };
+
+    // Longest n-step return the table can learn from
+    static constexpr int kMaxReturnSteps = 8;
+
+    struct Hyperparameters
+    {
+        float gamma;
+        float epsilonStart;
+        float epsilonMin;
+        float epsilonDecay;
+        int downAngleOptions[kDownActionCount];
+        int upAngleOptions[kUpActionCount];
+        ValueFunction valueFunction;
+
+        // Table only: each cell learns from the rewards of the next
+        // returnSteps steps, then the value of the state they lead to. With
+        // doubleQ, that value comes from two estimates, one picking the
+        // action and the other valuing it, which keeps a noisy reward from
+        // pushing the maximum up.
+        uint8_t returnSteps;
+        bool doubleQ;
+        Exploration exploration;
+
+        // How much to trust a model loaded before startTraining(), from 0
+        // to below 1. At 0 training starts over from epsilonStart, with the
+        // loaded values counting as no experience. Above 0 the loaded model
+        // is a prior: exploration starts lower, and each table cell counts
+        // as up to warmStart * kWarmMaxVisits visits, so new rewards move
+        // the cells the prior is sure of more slowly.
+        float warmStart;
+
+        // Table cells learn at 1 / (1 + visits), which settles each one on
+        // the mean of all its rewards. Above 0, the step size stops falling
+        // at alphaMin, so recent rewards keep more weight and a cell can
+        // follow a slow change such as a wearing tip.
+        float alphaMin;
+    };
+
     struct StepResult
     {
         int actionIndex;
@@ -13,17 +112,57 @@ public:
         float reward;
     };
 
+#if !RLBOT_INFERENCE_ONLY
+
+    // The Q-table cell a training step changed, with the progress counters
+    // after that step. Sequence numbers only grow, so a checkpoint can tell
+    // updates already covered by a snapshot from newer ones.
+    struct CellUpdate
+    {
+        uint32_t sequence;
+        uint8_t state;
+        uint8_t action;
+        float q;
+        uint32_t visits;
+        uint32_t episodes;
+        float epsilon;
+    };
+
+    // Called from step(), outside the model lock; must not block
+    typedef void (*UpdateHandler)(void *context, const CellUpdate &update);
+
+    // One real step for the transition log; called like UpdateHandler
+    typedef void (*TransitionHandler)(void *context, const TransitionLog::Record &record);
+#endif
+
     Training();
+    ~Training();
+
+    // Where models and checkpoints live; SPIFFS unless set before begin()
+    void setStorage(ModelStorage *storage);
+    ModelStorage *getStorage() const;
     void begin();
+    static Hyperparameters defaultHyperparameters();
+    bool configure(const Hyperparameters &hyperparameters);
+    const Hyperparameters &getHyperparameters() const;
+#if !RLBOT_INFERENCE_ONLY
+    // Takes effect from the next step, without resetting anything
+    bool setExploration(Exploration exploration);
 
+    // startTraining() and clearModel() rewrite the whole model without
+    // taking the model lock, so once a control pipeline runs they belong
+    // on its policy task, between steps (ControlPipeline::applyModelCommand)
     void startTraining();
     void stopTraining();
-    bool isTraining();
     StepResult step(float deltaDistanceCm, float avgSpeedCms, float avgAccelerationMps2,
-                    int downAngleDeg, int upAngleDeg);
+                    int downAngleDeg, int upAngleDeg, float pitchDeg = 0.0f);
+#endif
+    // Always false in an inference-only build
+    bool isTraining();
     StepResult infer(float deltaDistanceCm, float avgSpeedCms, float avgAccelerationMps2,
-                     int downAngleDeg, int upAngleDeg);
+                     int downAngleDeg, int upAngleDeg, float pitchDeg = 0.0f);
     uint32_t getTotalEpisodes() const;
+    float getEpsilon() const;
     float getTotalTrainingSeconds() const;
     const char *getActionLabel(int actionIndex) const;
     bool isDownAction(int actionIndex) const;
@@ -33,53 +172,256 @@ public:
     int getUpAngleOption(int index) const;
     bool modelFileExists();
     
-    void executeLearnedBehavior();
+    // Gait replay (see CompiledGait.h). executeLearnedBehavior() makes
+    // infer() replay the gait given to setCompiledGait(), or else one
+    // distilled from the loaded table; training, a reset or another load
+    // end it. Only the table's policy can be distilled, since the other
+    // value functions also look at speed or history. hasLearnedBehavior()
+    // is true while a model is loaded or a gait replays.
+    void setCompiledGait(const CompiledGait &gait);
+    bool executeLearnedBehavior();
     bool hasLearnedBehavior();
+    bool isReplayingGait() const;
 
-    void saveModel();
     bool loadModel();
+#if !RLBOT_INFERENCE_ONLY
+    bool saveModel();
+    // clearModel() and then removeModelFiles()
     void resetModel();
+    void clearModel();
+    void removeModelFiles();
     bool isEpsilonMin() const;
 
+    // Crash-safe checkpoints. Snapshots are written to a temporary file and
+    // renamed into place, and carry a CRC. Between snapshots, changed cells
+    // are appended to a journal that resumeTraining() replays on top of the
+    // snapshot it was started from. ModelCheckpointer does the writing from
+    // a background task.
+    void setUpdateHandler(UpdateHandler handler, void *context);
+    bool resumeTraining();
+    void requestSave();
+    bool takeSaveRequest();
+    bool appendJournal(const CellUpdate *updates, size_t count);
+    bool compactJournal();
+    size_t getJournalBytes() const;
+
+    // The transition log (see TransitionLog.h): every step that training
+    // learns from, kept for offline training on the host. The handler gets
+    // each one from step(); ModelCheckpointer appends them in batches. A log
+    // that would grow past kMaxTransitionLogBytes, which every backend can
+    // hold, is kept as the previous log and a new one is started.
+    // readTransitions() also returns the logs' generation, which changes
+    // whenever they rotate or are cleared, so a reader that spans several
+    // calls can tell that it was handed pieces of two different logs.
+    void setTransitionHandler(TransitionHandler handler, void *context);
+    bool appendTransitions(const TransitionLog::Record *records, size_t count);
+    size_t readTransitions(bool previous, size_t offset, uint8_t *buffer, size_t length, uint32_t &generation);
+    void clearTransitions();
+#endif
+
+    // Every storage access holds this lock, so anything else using the
+    // same backend (StorageBench) must take it too.
+    void lockStorage();
+    void unlockStorage();
+
+    // Model transfer: read the stored model out, or stage an uploaded one
+    // and swap it in once the header has been validated. Serial and HTTP
+    // uploads share the staging file, so only one runs at a time:
+    // beginModelUpload() returns a token for it, or 0 while another is
+    // under way, and the other calls only act on the upload their token
+    // names. An upload that has not been written to for kUploadIdleMs is
+    // taken to be abandoned, and the next begin replaces it.
+    size_t getModelSize();
+    size_t readModel(size_t offset, uint8_t *buffer, size_t length);
+    uint32_t beginModelUpload();
+    bool writeModelUpload(uint32_t upload, const uint8_t *data, size_t length);
+    bool finishModelUpload(uint32_t upload);
+    void abortModelUpload(uint32_t upload);
+
 private:
-    static constexpr int kDownActionCount = 3;
-    static constexpr int kUpActionCount = 3;
+    // Lets the host benchmarks time the private action-selection helpers,
+    // the simulator follow the greedy policy while training runs, and the
+    // tests compare tables
+    friend struct TrainingBenchAccess;
+    friend struct TrainingSimAccess;
+    friend struct TrainingTestAccess;
+
+    // Defaults for Hyperparameters; configure() replaces them at runtime.
     static const int kDownAngleOptions[kDownActionCount];
     static const int kUpAngleOptions[kUpActionCount];
     static constexpr int kNumActions = kDownActionCount + kUpActionCount;
     static constexpr int kNumStates = kDownActionCount * kUpActionCount;
 
+    static constexpr unsigned long kUploadIdleMs = 10000;
     static constexpr float kGamma = 0.95f;
     static constexpr float kAlpha = 1.0f / kNumActions;
     static constexpr float kEpsilonStart = 1.0f;
     static constexpr float kEpsilonMin = 0.1f;
     static constexpr float kEpsilonDecay = 0.9995f;
-    
+    static constexpr float kTileAlphaMin = 0.2f;
+    static constexpr int kTileFitPasses = 4;
+    static constexpr size_t kTileClearRows = 128; // 4 KB per value lock
+    static constexpr float kNetworkRate = 0.2f;
+    static constexpr float kNetworkFitRate = 0.5f;
+    static constexpr int kNetworkFitPasses = 100;
+    // Most visits a warm-started cell keeps, at full confidence
+    static constexpr uint32_t kWarmMaxVisits = 4;
+    // UCB1 bonus per unit of sqrt(ln(state visits) / action visits), and
+    // the softmax temperature at epsilon 1, both in reward per step. They
+    // are divided by 1 - gamma to match the scale of the Q-values.
+    static constexpr float kUcbScale = 0.6f;
+    static constexpr float kSoftmaxTemperature = 0.4f;
+
+    // Hashed state codes: table state, previous action (kNoAction before
+    // the first), steps since progress and pitch bucket, in that order
+    // from the low bits. 8192 codes; 512 entries cover the ones a run
+    // actually visits in about 22 KB.
+    static constexpr int kStateBits = 4;
+    static constexpr int kActionBits = 3;
+    static constexpr int kPhaseBits = 3;
+    static constexpr int kPitchBits = 3;
+    static constexpr int kNoAction = (1 << kActionBits) - 1;
+    static constexpr int kMaxPhase = (1 << kPhaseBits) - 1;
+    static constexpr float kProgressCm = 0.5f;
+    static constexpr float kPitchBucketDeg = 5.0f;
+    static constexpr size_t kHashedCapacity = 512;
+    // Until an action has been tried this often in a hashed state, that
+    // state defers to its table state for it
+    static constexpr uint16_t kHashedMinVisits = 8;
+    // Under NvsStorage::MAX_FILE_SIZE and a partition slot, 2044 steps
+    static constexpr size_t kMaxTransitionLogBytes = 24 * 1024;
+
     bool trainingActive;
     bool modelLoaded;
-    bool fsReady;
-    bool hasLastStep;
-    int lastAction;
-    int lastState;
+    bool storageReady;
     uint32_t totalEpisodes;
     unsigned long trainingStartMs;
     unsigned long accumulatedTrainingMs;
     float currentEpsilon;
+    Hyperparameters params;
     float qTable[kNumStates][kNumActions];
+    // A greedy walk visits each state at most once before it repeats
+    GaitKeyframe distilledFrames[kNumStates];
+    CompiledGait gait;
+    bool gaitCompiledIn;
+    volatile bool replayingGait;
+    uint8_t gaitIndex;
+    portMUX_TYPE modelMux;
+    ModelStorage *storage;
+    // The upload in progress, 0 for none; all three under storageLock
+    uint32_t uploadToken;
+    uint32_t lastUploadToken;
+    unsigned long uploadWrittenMs;
+    size_t uploadBytes;
+
+#if !RLBOT_INFERENCE_ONLY
+    typedef SparseQTable<kNumActions, kHashedCapacity> HashedTable;
+
+    // A step that has not been learned from yet, while its n-step return
+    // is still being collected
+    struct Transition
+    {
+        uint8_t state;
+        uint8_t action;
+        float reward;
+    };
+
+    struct SnapshotInfo
+    {
+        uint32_t crc;
+        uint32_t sequence;
+        uint32_t episodes;
+        float epsilon;
+    };
+
+    bool hasLastStep;
+    int lastAction;
+    int lastState;
     uint32_t visitCounts[kNumStates][kNumActions];
+    // With doubleQ the two estimates are qTable + qSpread and
+    // qTable - qSpread, so everything that reads qTable sees their mean.
+    // The spread is not saved; both start from the table again on load.
+    float qSpread[kNumStates][kNumActions];
+    Transition pending[kMaxReturnSteps];
+    int pendingStart;
+    int pendingCount;
+    // The tile and network weights are guarded by valueLock, a mutex, not
+    // by modelMux: their updates and projections take too long to run with
+    // interrupts off. Take valueLock before modelMux, never inside it.
+    TileCoder tiles;
+    TileCoder::Features lastFeatures;
+    HashedTable *hashed;
+    QNetwork network;
+    QNetwork::Input lastInput;
+    int refreshCell;
+    uint32_t lastKey;
+    int previousAction;
+    int progressPhase;
+    bool transitionRunStart;
+
+    UpdateHandler updateHandler;
+    void *updateContext;
+    uint32_t updateSequence;
+    uint32_t snapshotSequence;
+    uint32_t snapshotCrc;
+    size_t journalBytes;
+    volatile bool saveRequested;
+    TransitionHandler transitionHandler;
+    void *transitionContext;
+    bool transitionLogChecked;
+    uint32_t transitionLogGeneration;
+    SemaphoreHandle_t valueLock;
+#endif
+    SemaphoreHandle_t storageLock;
 
     void resetQTable();
+    void dropUpload();
+    bool loadModelFrom(const char *path, uint32_t *crc = NULL);
+    bool validateModelFile(const char *path);
+    int importModel(const ModelFormat::View &view, float (&stagedQ)[kNumStates][kNumActions],
+                    uint32_t (&stagedCounts)[kNumStates][kNumActions]) const;
+    void recoverStagedModel();
+    bool replaceFile(const char *from, const char *to);
     int getStateIndex(int downAngleDeg, int upAngleDeg) const;
     int findDownIndex(int downAngleDeg) const;
     int findUpIndex(int upAngleDeg) const;
     float computeQ(int stateIndex, int actionIndex) const;
-    float computeMaxQ(int stateIndex) const;
-    int selectAction(int stateIndex);
     int selectBestAction(int stateIndex) const;
-    void decayEpsilon();
+    bool distilGait();
     void decodeAction(int actionIndex, int currentDownAngle, int currentUpAngle,
                       int &targetDownAngle, int &targetUpAngle) const;
     float computeReward(float deltaDistanceCm) const;
+
+#if !RLBOT_INFERENCE_ONLY
+    bool writeSnapshot(const char *path, SnapshotInfo &info);
+    bool writeCheckpoint();
+    bool startJournal(const SnapshotInfo &info);
+    bool replayJournal(uint32_t baseCrc, uint32_t &episodes, float &epsilon);
+    int getNearestStateIndex(int downAngleDeg, int upAngleDeg) const;
+    bool applyValueFunction();
+    void encodeState(int downAngleDeg, int upAngleDeg, float speedCms, TileCoder::Features &features) const;
+    int selectActionFrom(const float *qValues, int stateIndex);
+    int selectUcbAction(const float *qValues, int stateIndex) const;
+    int selectSoftmaxAction(const float *qValues);
+    static int findBestAction(const float *qValues);
+    static uint32_t encodeHashedState(int stateIndex, int previousAction, int phase, float pitchDeg);
+    void advancePhase(float reward);
+    void readHashed(const HashedTable::Entry &entry, int stateIndex, float *qValues) const;
+    void resetHistory();
+    void lockValues();
+    void unlockValues();
+    float projectValue(int stateIndex, int actionIndex) const;
+    bool projectValues(float (&values)[kNumStates][kNumActions]) const;
+    void fitTiles();
+    void fitNetwork();
+    void reseedFromTable();
+    void applyWarmStart();
+    float learningRate(uint32_t visits) const;
+    float computeMaxQ(int stateIndex) const;
+    bool learnReturn(int currentState, float reward, int &stateIndex, int &actionIndex);
+    int selectAction(int stateIndex);
+    void decayEpsilon();
+#endif
 };
 
 #endif // TRAINING_H
@@ -0,0 +1,69 @@
+#include "TransitionLog.h"
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    template <typename T>
+    T toFixed(float value, float scale, float limit)
+    {
+        float scaled = roundf(value * scale);
+        if (!(scaled > -limit))
+        {
+            // Also catches NaN
+            scaled = -limit;
+        }
+        else if (scaled > limit)
+        {
+            scaled = limit;
+        }
+        return static_cast<T>(scaled);
+    }
+
+    uint8_t checkByte(const TransitionLog::Record &record)
+    {
+        return static_cast<uint8_t>(ModelFormat::crc32(0, &record, offsetof(TransitionLog::Record, check)));
+    }
+}
+
+namespace TransitionLog
+{
+    void initHeader(Header &header, const int *downAngles, uint8_t downOptionCount, const int *upAngles,
+                    uint8_t upOptionCount)
+    {
+        memset(&header, 0, sizeof(header));
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.headerSize = sizeof(Header);
+        header.recordSize = sizeof(Record);
+        header.downOptionCount = downOptionCount;
+        header.upOptionCount = upOptionCount;
+        for (uint8_t i = 0; i < downOptionCount && i < ModelFormat::kMaxAngleOptions; ++i)
+        {
+            header.downAngles[i] = static_cast<int16_t>(downAngles[i]);
+        }
+        for (uint8_t i = 0; i < upOptionCount && i < ModelFormat::kMaxAngleOptions; ++i)
+        {
+            header.upAngles[i] = static_cast<int16_t>(upAngles[i]);
+        }
+    }
+
+    void makeRecord(Record &record, int state, int action, int nextState, uint8_t flags, float deltaDistanceCm,
+                    float avgSpeedCms, float avgAccelerationMps2, float pitchDeg)
+    {
+        record.state = static_cast<uint8_t>(state);
+        record.action = static_cast<uint8_t>(action);
+        record.nextState = static_cast<uint8_t>(nextState);
+        record.flags = flags;
+        record.deltaDistance = toFixed<int16_t>(deltaDistanceCm, kDistanceScale, 32767.0f);
+        record.speed = toFixed<int16_t>(avgSpeedCms, kSpeedScale, 32767.0f);
+        record.acceleration = toFixed<int16_t>(avgAccelerationMps2, kAccelerationScale, 32767.0f);
+        record.pitch = toFixed<int8_t>(pitchDeg, kPitchScale, 127.0f);
+        record.check = checkByte(record);
+    }
+
+    bool isIntact(const Record &record)
+    {
+        return record.check == checkByte(record);
+    }
+}
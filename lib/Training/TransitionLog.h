@@ -0,0 +1,80 @@
+#ifndef TRANSITION_LOG_H
+#define TRANSITION_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ModelFormat.h"
+
+// Logs of the transitions a robot trained on, version 1, so the host can
+// learn from the same real steps again (tools/offline_train.py).
+//
+//     offset 0            Header (48 bytes)
+//     header.headerSize   Record[], 12 bytes each, to the end of the file
+//
+// The header holds the angle options that the state and action indices
+// refer to, numbered as in ModelFormat.h. Records are appended in batches
+// as training runs. Each ends in the low byte of the CRC-32 of the bytes
+// before it, so a record torn by a power cut ends the log rather than
+// adding a made-up step. Distances, speeds, accelerations and pitch are
+// fixed point, so 24 KB hold 17 minutes of training at the default 500 ms
+// interval. Little-endian, as the model files; tools/offline_train.py
+// mirrors it.
+namespace TransitionLog
+{
+    static const uint32_t kMagic = 0x524C5431; // "RLT1"
+    static const uint32_t kVersion = 1;
+
+    // Fixed-point units per cm, cm/s, m/s^2 and degree
+    static const float kDistanceScale = 100.0f;
+    static const float kSpeedScale = 100.0f;
+    static const float kAccelerationScale = 1000.0f;
+    static const float kPitchScale = 2.0f;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint16_t headerSize;
+        uint16_t recordSize;
+        uint8_t downOptionCount;
+        uint8_t upOptionCount;
+        uint16_t reserved;
+        int16_t downAngles[ModelFormat::kMaxAngleOptions];
+        int16_t upAngles[ModelFormat::kMaxAngleOptions];
+    };
+
+    static_assert(sizeof(Header) == 48, "TransitionLog::Header layout changed");
+
+    enum RecordFlags : uint8_t
+    {
+        // The step before this one was not logged (training had just
+        // started, resumed or loaded a model), so this record does not
+        // follow on from the previous one
+        kRunStart = 1 << 0,
+    };
+
+    struct Record
+    {
+        uint8_t state;
+        uint8_t action;
+        uint8_t nextState;
+        uint8_t flags;
+        int16_t deltaDistance; // what the action moved the body, the reward
+        int16_t speed;         // average over the interval
+        int16_t acceleration;
+        int8_t pitch;
+        uint8_t check;
+    };
+
+    static_assert(sizeof(Record) == 12, "TransitionLog::Record layout changed");
+
+    void initHeader(Header &header, const int *downAngles, uint8_t downOptionCount, const int *upAngles,
+                    uint8_t upOptionCount);
+
+    // Fills in every field, saturating the fixed-point ones, and the check
+    void makeRecord(Record &record, int state, int action, int nextState, uint8_t flags, float deltaDistanceCm,
+                    float avgSpeedCms, float avgAccelerationMps2, float pitchDeg);
+    bool isIntact(const Record &record);
+}
+
+#endif // TRANSITION_LOG_H
@@ -4,112 +4,186 @@
 #include <ServoControl.h>
 #include <Network.h>
 #include <Training.h>
+#if !RLBOT_INFERENCE_ONLY
+#include <ModelCheckpointer.h>
+#endif
 #include <HealthCheck.h>
+#include <ConfigStore.h>
+#include <SerialLink.h>
+#include <ControlPipeline.h>
+#include <BootProfiler.h>
+#include <Profiler.h>
+#include <MemoryReport.h>
+#include <StorageBench.h>
+#ifdef RLBOT_COMPILED_GAIT
+#include <LearnedGait.h> // written by tools/gait_compiler.py
+#endif
 
 // Pin definitions
 const uint8_t SERVO_PIN_DOWN = 16;
 const uint8_t SERVO_PIN_UP = 15;
 
 // Global objects
+ConfigStore config;
 Display display;
 AHRS ahrs;
 ServoControl servoControl(SERVO_PIN_DOWN, SERVO_PIN_UP);
+DriverSlot<Network> networkSlot;
 Network *network;
 Training training;
+#if !RLBOT_INFERENCE_ONLY
+ModelCheckpointer checkpointer(&training);
+#endif
 HealthCheck healthCheck(&display, &ahrs, &servoControl);
+SerialLink serialLink(Serial);
+ControlPipeline pipeline(&ahrs, &servoControl, &training);
+BootProfiler bootProfiler;
 
-// Phase 3 training controls
-static const bool kTrainingEnabled = true;
+static Profiler::Probe reportProbe("loop.report");
 
-// Interval tracking for training display
-static unsigned long lastMeasurement = 0;
-static float lastPosX = 0.0f;
-static float lastPosY = 0.0f;
-static float lastPosZ = 0.0f;
-static float speedSumCms = 0.0f;
-static float accelSumMps2 = 0.0f;
-static uint32_t sampleCount = 0;
-static bool modelSaved = false;
+static bool fullBoot = true;
 
-static void resetIntervalTracking(unsigned long now)
+enum ModelStartup
 {
-    lastMeasurement = now;
-    lastPosX = ahrs.getPositionX();
-    lastPosY = ahrs.getPositionY();
-    lastPosZ = ahrs.getPositionZ();
-    speedSumCms = 0.0f;
-    accelSumMps2 = 0.0f;
-    sampleCount = 0;
-}
+    MODEL_STARTUP_TRAINING,
+    MODEL_STARTUP_LOADED,
+    MODEL_STARTUP_MISSING,
+    MODEL_STARTUP_LOAD_FAILED,
+};
+static volatile ModelStartup modelStartup = MODEL_STARTUP_TRAINING;
 
-void setup()
+static const unsigned long kStatsReportIntervalMs = 5000;
+static unsigned long lastStatsReportMs = 0;
+
+static void reportPipelineStats(unsigned long nowMs)
 {
-    Serial.begin(115200);
-    delay(1000);
+    if (nowMs - lastStatsReportMs < kStatsReportIntervalMs)
+    {
+        return;
+    }
+    lastStatsReportMs = nowMs;
+
+    ControlPipeline::Stats stats;
+    pipeline.takeStats(stats);
+
+    SerialLink::SchedulerStats scheduler = {};
+    scheduler.timeMs = nowMs;
+    scheduler.periodUs = stats.controlPeriodUs;
+    scheduler.ticks = stats.ticks;
+    scheduler.droppedTicks = stats.droppedTicks;
+    scheduler.overruns = stats.senseOverruns;
+    scheduler.maxLatenessUs = stats.maxLatenessUs;
+    static_assert(sizeof(scheduler.latenessHistogram) == sizeof(stats.lateness.counts),
+                  "SchedulerStats histogram must match JitterHistogram");
+    memcpy(scheduler.latenessHistogram, stats.lateness.counts, sizeof(scheduler.latenessHistogram));
+    serialLink.sendSchedulerStats(scheduler);
+
+    char text[160];
+    snprintf(text, sizeof(text),
+             "Stage us mean/max: feat-wait %u/%u policy %u/%u act-wait %u/%u actuate %u/%u",
+             stats.featureWait.meanUs(), stats.featureWait.maxUs,
+             stats.policy.meanUs(), stats.policy.maxUs,
+             stats.actionWait.meanUs(), stats.actionWait.maxUs,
+             stats.actuate.meanUs(), stats.actuate.maxUs);
+    serialLink.sendLog(text);
+
+    snprintf(text, sizeof(text),
+             "Queue depth max: features %u actions %u reports %u; dropped reports %u samples %u",
+             stats.featureDepth, stats.actionDepth, stats.reportDepth,
+             stats.droppedReports, stats.droppedSamples);
+    serialLink.sendLog(text);
+
+#if !RLBOT_INFERENCE_ONLY
+    ModelCheckpointer::Stats checkpoints = checkpointer.getStats();
+    snprintf(text, sizeof(text),
+             "Checkpoint: journaled %u dropped %u checkpoints %u failures %u; transitions logged %u dropped %u",
+             checkpoints.journaled, checkpoints.dropped, checkpoints.checkpoints, checkpoints.failures,
+             checkpoints.transitionsLogged, checkpoints.transitionsDropped);
+    serialLink.sendLog(text);
+#endif
+}
 
-    display.begin();
-    display.clear();
-    display.print("RL Robot V2", 0, 0);
-    display.setCursor(0, 16);
-    display.print("Booting...");
-    display.refresh();
-    delay(1000);
+static void sendLogLine(const char *line)
+{
+    serialLink.sendLog(line);
+}
 
-    network = new Network(&display);
-    network->begin();
-    network->startOTATask();
+// Benchmarks the active storage under the training lock, then whichever
+// other backends can be tried without disturbing it. SPIFFS and LittleFS
+// share the data partition and mounting the other one would format it.
+static bool runStorageBench()
+{
+    if (training.isTraining())
+    {
+        serialLink.sendLog("storage bench refused while training");
+        return false;
+    }
 
-    int robotNum = network->getRobotNumber();
-    display.clear();
-    display.print("Robot ID:", 0, 0);
-    display.print(robotNum, 70, 0);
-    display.setCursor(0, 16);
-    display.print("Setup...");
-    display.refresh();
-    delay(1000);
+    ModelStorage *active = training.getStorage();
+    training.lockStorage();
+    bool ok = StorageBench::run(*active, sendLogLine);
+    training.unlockStorage();
 
-    display.clear();
-    display.print("Init AHRS...", 0, 0);
-    if (ahrs.begin())
+    static const ModelStorageKind kOthers[] = {MODEL_STORAGE_NVS, MODEL_STORAGE_PARTITION, MODEL_STORAGE_RAM};
+    for (ModelStorageKind kind : kOthers)
     {
-        display.setCursor(0, 16);
-        display.print("AHRS OK");
-        display.refresh();
+        ModelStorage *storage = ModelStorage::get(kind);
+        if (storage != active)
+        {
+            StorageBench::run(*storage, sendLogLine);
+        }
     }
-    else
+    return ok;
+}
+
+static bool handleHostCommand(uint8_t command)
+{
+    switch (command)
     {
-        display.setCursor(0, 16);
-        display.print("AHRS FAIL");
-        display.refresh();
-        while (1)
-            ; // Stop if sensor fails
+#if !RLBOT_INFERENCE_ONLY
+    case SerialLink::CMD_START_TRAINING:
+        pipeline.startTraining();
+        pipeline.rearmAutoSave();
+        return true;
+    case SerialLink::CMD_STOP_TRAINING:
+        training.stopTraining();
+        return true;
+    case SerialLink::CMD_RESET_MODEL:
+        pipeline.resetModel();
+        return true;
+    case SerialLink::CMD_SAVE_MODEL:
+        training.saveModel();
+        return training.hasLearnedBehavior();
+    case SerialLink::CMD_EXPLORE_EPSILON:
+        return training.setExploration(Training::EXPLORE_EPSILON);
+    case SerialLink::CMD_EXPLORE_UCB:
+        return training.setExploration(Training::EXPLORE_UCB);
+    case SerialLink::CMD_EXPLORE_SOFTMAX:
+        return training.setExploration(Training::EXPLORE_SOFTMAX);
+    case SerialLink::CMD_CLEAR_TRANSITIONS:
+        training.clearTransitions();
+        return true;
+#endif
+    case SerialLink::CMD_LOAD_MODEL:
+        return training.loadModel();
+    case SerialLink::CMD_PROFILE_DUMP:
+        Profiler::dump(sendLogLine);
+        return true;
+    case SerialLink::CMD_PROFILE_RESET:
+        Profiler::resetAll();
+        return true;
+    case SerialLink::CMD_MEMORY_REPORT:
+        MemoryReport::dump(sendLogLine);
+        return true;
+    case SerialLink::CMD_STORAGE_BENCH:
+        return runStorageBench();
+    default:
+        return false;
     }
-    delay(500);
-
-    display.clear();
-    display.print("Init Servos...", 0, 0);
-    servoControl.begin();
-    servoControl.moveDownSmooth(140);
-    servoControl.moveUpSmooth(40);
-    display.setCursor(0, 16);
-    display.print("Servos OK");
-    display.refresh();
-    delay(500);
-
-    display.clear();
-    display.print("Calibrating...", 0, 0);
-    display.setCursor(0, 16);
-    display.print("Keep Still!");
-    display.refresh();
-    Serial.println("Calibrating...");
-    ahrs.calibrate();
-    delay(500);
-
-    display.clear();
-    display.print("Setup Complete", 0, 0);
-    display.refresh();
-    delay(1000);
+}
 
+static void runAngleSweep()
+{
     display.clear();
     display.refresh();
     display.setCursor(0, 0);
@@ -134,43 +208,10 @@ void setup()
         }
     }
     display.println("Angle sweep done");
+}
 
-    training.begin();
-    if (kTrainingEnabled)
-    {
-        training.startTraining();
-        modelSaved = false;
-    }
-    else
-    {
-        if (!training.modelFileExists())
-        {
-            display.clear();
-            display.print("Model missing", 0, 0);
-            display.setCursor(0, 16);
-            display.print("Fallback train");
-            display.refresh();
-            delay(1500);
-
-            training.startTraining();
-            modelSaved = false;
-        }
-        else if (!training.loadModel())
-        {
-            display.clear();
-            display.print("Model load err", 0, 0);
-            display.setCursor(0, 16);
-            display.print("Fallback train");
-            display.refresh();
-            delay(1500);
-
-            training.startTraining();
-            modelSaved = false;
-        }
-    }
-
-    healthCheck.run();
-
+static void runWaveDemo()
+{
     display.clear();
     display.setCursor(0, 0);
     display.print("Hello World");
@@ -196,143 +237,348 @@ void setup()
     }
     servoControl.moveUpSmooth(90, 8);
     delay(500);
+}
 
-    servoControl.moveUpSmooth(40);
-    servoControl.moveDownSmooth(140);
-    ahrs.resetPosition();
-    resetIntervalTracking(millis());
+static void showStatus(const char *title, const char *detail, unsigned long fullBootHoldMs)
+{
+    display.clear();
+    display.print(title, 0, 0);
+    if (detail)
+    {
+        display.setCursor(0, 16);
+        display.print(detail);
+    }
+    display.refresh();
+    if (fullBoot)
+    {
+        delay(fullBootHoldMs);
+    }
 }
 
-void loop()
+// Boot phases that may run on their own task. They must not touch the
+// display or the IMU, which share the I2C bus with the main task, so the
+// robot number is resolved before the network phase starts.
+static void initNetwork(void *)
+{
+    network->attachTraining(&training);
+    network->begin();
+    network->setPauseDuringTicks(config.isEnabled(FEATURE_PAUSE_NETWORK_DURING_TICKS));
+}
+
+static void initServos(void *)
 {
-    ahrs.update();
+    servoControl.begin();
+    servoControl.moveDownSmooth(training.getDownAngleOption(0));
+    servoControl.moveUpSmooth(training.getUpAngleOption(0));
+}
 
-    unsigned long currentTime = millis();
-    if (lastMeasurement == 0)
+static void prepareModel(void *)
+{
+    training.begin();
+#ifdef RLBOT_COMPILED_GAIT
+    training.setCompiledGait(LearnedGait::kGait);
+#endif
+    if (config.isEnabled(FEATURE_TRAINING) && !RLBOT_INFERENCE_ONLY)
     {
-        resetIntervalTracking(currentTime);
+        modelStartup = MODEL_STARTUP_TRAINING;
     }
+#ifdef RLBOT_COMPILED_GAIT
+    else if (training.executeLearnedBehavior())
+    {
+        // The gait is in flash, so no model file is needed
+        modelStartup = MODEL_STARTUP_LOADED;
+        return;
+    }
+#endif
+    else if (!training.modelFileExists())
+    {
+        modelStartup = MODEL_STARTUP_MISSING;
+    }
+    else if (!training.loadModel())
+    {
+        modelStartup = MODEL_STARTUP_LOAD_FAILED;
+    }
+    else
+    {
+        modelStartup = MODEL_STARTUP_LOADED;
+        // A table policy walks a fixed cycle of poses; replay it instead
+        // of deciding every step. Other value functions keep using infer().
+        training.executeLearnedBehavior();
+        return;
+    }
+#if !RLBOT_INFERENCE_ONLY
+    // Pick up a run that a reset or power cut interrupted
+    if (!training.resumeTraining())
+    {
+        // With warmStart set, the stored model seeds the new run instead
+        // of being relearned from scratch
+        if (modelStartup == MODEL_STARTUP_TRAINING && training.getHyperparameters().warmStart > 0.0f &&
+            training.modelFileExists())
+        {
+            training.loadModel();
+        }
+        training.startTraining();
+    }
+#endif
+}
 
-    float speedCms = ahrs.getSpeed() * 100.0f;
-    float accelX = ahrs.getLinearAccelX();
-    float accelY = ahrs.getLinearAccelY();
-    float accelZ = ahrs.getLinearAccelZ();
-    float accelMag = sqrt(accelX * accelX + accelY * accelY + accelZ * accelZ);
-
-    speedSumCms += speedCms;
-    accelSumMps2 += accelMag;
-    ++sampleCount;
+static void reportBootTimings()
+{
+    char text[96];
+    for (uint8_t i = 0; i < bootProfiler.getPhaseCount(); ++i)
+    {
+        const BootProfiler::Phase &phase = bootProfiler.getPhase(i);
+        snprintf(text, sizeof(text), "Boot %-12s start %5u ms took %5u ms%s",
+                 phase.name,
+                 phase.startUs / 1000,
+                 (phase.endUs - phase.startUs) / 1000,
+                 phase.concurrent ? " (task)" : "");
+        serialLink.sendLog(text);
+    }
+    snprintf(text, sizeof(text), "Boot to first %s step: %u ms (%s profile)",
+             bootProfiler.wasFirstStepTraining() ? "training" : "policy",
+             bootProfiler.getFirstStepUs() / 1000,
+             fullBoot ? "full" : "fast");
+    serialLink.sendLog(text);
+    MemoryReport::dump(sendLogLine);
+}
 
-    float deltaTime = (currentTime - lastMeasurement) / 1000.0f;
-    if (deltaTime >= 0.5f)
+void setup()
+{
+    serialLink.begin();
+    serialLink.attachTraining(&training);
+    serialLink.setCommandHandler(handleHostCommand);
+    // setup() and loop() share the Arduino loop task
+    MemoryReport::watchTask("loop", xTaskGetCurrentTaskHandle(), getArduinoLoopTaskStackSize());
+
+    uint8_t phase = bootProfiler.beginPhase("config");
+    config.begin();
+    training.configure(config.get().training);
+    training.setStorage(ModelStorage::get(config.get().modelStorage));
+    fullBoot = config.get().bootProfile == BOOT_PROFILE_FULL;
+    bootProfiler.setConcurrent(!fullBoot);
+    bootProfiler.endPhase(phase);
+    if (fullBoot)
     {
-        float posX = ahrs.getPositionX();
-        float posY = ahrs.getPositionY();
-        float posZ = ahrs.getPositionZ();
+        delay(1000);
+    }
 
-        float dX = posX - lastPosX;
-        float dY = posY - lastPosY;
-        float dZ = posZ - lastPosZ;
-        float deltaDistanceCm = sqrt(dX * dX + dY * dY + dZ * dZ) * 100.0f;
+    phase = bootProfiler.beginPhase("display");
+    display.begin();
+    showStatus("RL Robot V2", "Booting...", 1000);
+    bootProfiler.endPhase(phase);
+
+    // Network and servos take seconds but never use I2C, so in the fast
+    // profile they overlap with the display and IMU work below
+    network = networkSlot.construct(&display, &config);
+    // An unprovisioned robot asks for its number on the display
+    network->resolveRobotNumber();
+    uint8_t networkPhase = bootProfiler.run("network", initNetwork, NULL, 0, 8192);
+    uint8_t servoPhase = bootProfiler.run("servos", initServos, NULL, 1);
+    bootProfiler.run("model", prepareModel, NULL, 1, 8192);
+
+    phase = bootProfiler.beginPhase("imu");
+    showStatus("Init AHRS...", NULL, 0);
+    if (!ahrs.begin())
+    {
+        showStatus("Init AHRS...", "AHRS FAIL", 0);
+        while (1)
+            ; // Stop if sensor fails
+    }
+    showStatus("Init AHRS...", "AHRS OK", 500);
+    bootProfiler.endPhase(phase);
 
-        float avgSpeedCms = sampleCount ? (speedSumCms / sampleCount) : 0.0f;
-        float avgAccel = sampleCount ? (accelSumMps2 / sampleCount) : 0.0f;
+    phase = bootProfiler.beginPhase("calibration");
+    bool reuseCalibration = config.get().hasCalibration &&
+                            (config.isEnabled(FEATURE_REUSE_CALIBRATION) || !fullBoot);
+    if (reuseCalibration)
+    {
+        ahrs.applyCalibration(config.get().calibration);
+        Serial.println("Using stored calibration");
+    }
+    else
+    {
+        // The robot has to be still, so let the servos reach their pose first
+        bootProfiler.wait(servoPhase);
+        showStatus("Calibrating...", "Keep Still!", 0);
+        Serial.println("Calibrating...");
+        ahrs.calibrate();
+        config.setCalibration(ahrs.getCalibration());
+        if (fullBoot)
+        {
+            delay(500);
+        }
+    }
+    bootProfiler.endPhase(phase);
 
-        bool actionChosen = false;
-        Training::StepResult stepResult = {};
+    bootProfiler.wait(networkPhase);
+    char robotId[16];
+    snprintf(robotId, sizeof(robotId), "Robot ID: %u", network->getRobotNumber());
+    showStatus(robotId, "Setup Complete", 1000);
 
-        if (training.isTraining())
+    if (fullBoot)
+    {
+        phase = bootProfiler.beginPhase("demos");
+        if (config.isEnabled(FEATURE_ANGLE_SWEEP))
+        {
+            runAngleSweep();
+        }
+        if (config.isEnabled(FEATURE_HEALTH_CHECK))
         {
-            stepResult = training.step(
-                deltaDistanceCm,
-                avgSpeedCms,
-                avgAccel,
-                servoControl.getCurrentDownAngle(),
-                servoControl.getCurrentUpAngle());
-            actionChosen = true;
-            if (!modelSaved && training.isEpsilonMin())
-            {
-                training.stopTraining();
-                training.saveModel();
-                modelSaved = true;
-            }
+            healthCheck.run();
         }
-        else if (training.hasLearnedBehavior())
+        if (config.isEnabled(FEATURE_WAVE_DEMO))
         {
-            stepResult = training.infer(
-                deltaDistanceCm,
-                avgSpeedCms,
-                avgAccel,
-                servoControl.getCurrentDownAngle(),
-                servoControl.getCurrentUpAngle());
-            actionChosen = true;
+            runWaveDemo();
         }
+        bootProfiler.endPhase(phase);
+    }
+
+    // Serve HTTP only once storage is mounted and the model is in place
+    bootProfiler.waitAll();
+    network->startServiceTask(config.get().servicePriority, config.get().serviceCore);
+#if !RLBOT_INFERENCE_ONLY
+    checkpointer.start(config.isEnabled(FEATURE_TRANSITION_LOG));
+#endif
+    // An inference-only build cannot fall back to training, so it stands
+    // still until a model is uploaded
+    const char *fallback = RLBOT_INFERENCE_ONLY ? "Waiting for model" : "Fallback train";
+    if (modelStartup == MODEL_STARTUP_MISSING)
+    {
+        showStatus("Model missing", fallback, 1500);
+    }
+    else if (modelStartup == MODEL_STARTUP_LOAD_FAILED)
+    {
+        showStatus("Model load err", fallback, 1500);
+    }
 
-        display.clear();
-        const uint8_t lineHeight = 10;
+    phase = bootProfiler.beginPhase("pose");
+    servoControl.moveUpSmooth(training.getUpAngleOption(0));
+    servoControl.moveDownSmooth(training.getDownAngleOption(0));
+    ahrs.resetPosition();
+    bootProfiler.endPhase(phase);
 
-        display.setCursor(0, 0);
-        display.print("Dist: ");
-        display.print(String(deltaDistanceCm, 1));
-        display.print(" cm");
+    // From here on the AHRS and servos are driven by the pipeline tasks
+    pipeline.attachNetwork(network);
+    pipeline.setControlInterval(config.get().controlIntervalMs);
+    pipeline.start();
+}
 
-        display.setCursor(0, lineHeight);
-        display.print("Spd: ");
-        display.print(String(avgSpeedCms, 1));
-        display.print(" cm/s");
+static void showDecision(const ControlPipeline::Decision &decision)
+{
+    const ControlPipeline::Features &features = decision.features;
+    const Training::StepResult &result = decision.result;
 
-        display.setCursor(0, lineHeight * 2);
-        display.print("Acc: ");
-        display.print(String(avgAccel, 2));
-        display.print(" m/s2");
+    display.clear();
+    const uint8_t lineHeight = 10;
 
-        display.setCursor(0, lineHeight * 3);
-        display.print("Episodes: ");
-        display.print(training.getTotalEpisodes());
+    display.setCursor(0, 0);
+    display.print("Dist: ");
+    display.print(String(features.deltaDistanceCm, 1));
+    display.print(" cm");
+
+    display.setCursor(0, lineHeight);
+    display.print("Spd: ");
+    display.print(String(features.avgSpeedCms, 1));
+    display.print(" cm/s");
+
+    display.setCursor(0, lineHeight * 2);
+    display.print("Acc: ");
+    display.print(String(features.avgAccelMps2, 2));
+    display.print(" m/s2");
+
+    display.setCursor(0, lineHeight * 3);
+    display.print("Episodes: ");
+    display.print(training.getTotalEpisodes());
+
+    display.setCursor(0, lineHeight * 4);
+    display.print("Total: ");
+    display.print(String(training.getTotalTrainingSeconds(), 1));
+    display.print(" s");
+
+    display.setCursor(0, lineHeight * 5);
+    display.print("Act: ");
+    if (decision.actionChosen)
+    {
+        bool isDown = training.isDownAction(result.actionIndex);
+        display.print(isDown ? "Down " : "Up ");
+        display.print(isDown ? result.targetDownAngle : result.targetUpAngle);
+        display.print(" R:");
+        display.print(String(result.reward, 3));
+    }
+    else
+    {
+        display.print("-");
+    }
 
-        display.setCursor(0, lineHeight * 4);
-        display.print("Total: ");
-        display.print(String(training.getTotalTrainingSeconds(), 1));
-        display.print(" s");
+    display.refresh();
+}
 
-        display.setCursor(0, lineHeight * 5);
-        display.print("Act: ");
-        if (actionChosen)
-        {
-            bool isDown = training.isDownAction(stepResult.actionIndex);
-            display.print(isDown ? "Down " : "Up ");
-            display.print(isDown ? stepResult.targetDownAngle : stepResult.targetUpAngle);
-            display.print(" R:");
-            display.print(String(stepResult.reward, 3));
-        }
-        else
-        {
-            display.print("-");
-        }
+static void sendDecisionTelemetry(const ControlPipeline::Decision &decision)
+{
+    const Training::StepResult &result = decision.result;
+
+    SerialLink::Telemetry telemetry = {};
+    telemetry.timeMs = decision.features.windowEndUs / 1000;
+    telemetry.deltaDistanceCm = decision.features.deltaDistanceCm;
+    telemetry.avgSpeedCms = decision.features.avgSpeedCms;
+    telemetry.avgAccelMps2 = decision.features.avgAccelMps2;
+    telemetry.reward = result.reward;
+    telemetry.epsilon = training.getEpsilon();
+    telemetry.episodes = training.getTotalEpisodes();
+    telemetry.actionIndex = decision.actionChosen ? result.actionIndex : -1;
+    telemetry.targetDownAngle = result.targetDownAngle;
+    telemetry.targetUpAngle = result.targetUpAngle;
+    telemetry.flags = (decision.training ? SerialLink::TELEMETRY_TRAINING : 0) |
+                      (decision.actionChosen ? SerialLink::TELEMETRY_ACTION_CHOSEN : 0) |
+                      (training.isDownAction(result.actionIndex) ? SerialLink::TELEMETRY_DOWN_ACTION : 0);
+    serialLink.sendTelemetry(telemetry);
+}
 
-        display.refresh();
+// Reporting stage: everything here is off the control path, so a slow
+// OLED refresh or a full UART only delays what the host sees.
+static void runReportStage()
+{
+    PROFILE_SCOPE(reportProbe);
+    serialLink.poll();
+    pipeline.setSampleStreaming(serialLink.isStreamingSamples());
 
-        Serial.print("Distance: ");
-        Serial.print(deltaDistanceCm);
-        Serial.print(" cm, Speed: ");
-        Serial.print(avgSpeedCms);
-        Serial.print(" cm/s, Accel: ");
-        Serial.print(avgAccel);
-        Serial.println(" m/s2");
+    ControlPipeline::Sample pipelineSample;
+    while (pipeline.popSample(pipelineSample))
+    {
+        SerialLink::Sample sample = {};
+        sample.timeUs = pipelineSample.timeUs;
+        memcpy(sample.linearAccel, pipelineSample.linearAccel, sizeof(sample.linearAccel));
+        sample.speedCms = pipelineSample.speedCms;
+        serialLink.sendSample(sample);
+    }
 
-        if (actionChosen)
+    ControlPipeline::Decision decision;
+    bool haveDecision = false;
+    while (pipeline.popReport(decision))
+    {
+        sendDecisionTelemetry(decision);
+        haveDecision = true;
+        if (decision.actionChosen && !bootProfiler.hasFirstStep())
         {
-            servoControl.moveDownSmooth(stepResult.targetDownAngle);
-            servoControl.moveUpSmooth(stepResult.targetUpAngle);
+            bootProfiler.markFirstStep(decision.decidedUs, decision.training);
+            reportBootTimings();
         }
-
-        resetIntervalTracking(currentTime);
     }
+    // The network service task posts OTA progress and the like instead of
+    // drawing it from core 0; while that is up it keeps the screen
+    bool noticeShown = network != NULL && network->showNotice();
+    if (haveDecision && !noticeShown)
+    {
+        // Only the newest decision is worth an OLED refresh
+        showDecision(decision);
+    }
+
+    reportPipelineStats(millis());
+}
 
-    // TODO: Implement main loop logic
-    // - Read sensors
-    // - Process data
-    // - Execute training if active
-    // - Execute learned behavior
-    // - Control servos
+void loop()
+{
+    runReportStage();
+    delay(5);
 }
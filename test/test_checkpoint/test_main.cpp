@@ -0,0 +1,310 @@
+// Power cuts during Training's checkpoints and journal appends.
+//
+// Each test trains on a RamStorage behind CutStorage, which stops carrying
+// out writes, appends, renames and removes once its budget of them is
+// spent, as if power went at that point. A second Training then boots on
+// what reached the RamStorage and resumes. Cutting before every storage
+// operation in turn checks that no cut loses more than the updates that
+// were not yet journaled.
+//
+//     pio test -e native_test
+
+#include <Arduino.h>
+#include <RamStorage.h>
+#include <Training.h>
+#include <unity.h>
+
+struct TrainingTestAccess
+{
+    struct Model
+    {
+        float q[Training::kNumStates][Training::kNumActions];
+        uint32_t visits[Training::kNumStates][Training::kNumActions];
+        uint32_t episodes;
+        float epsilon;
+    };
+
+    static void capture(const Training &training, Model &model)
+    {
+        memcpy(model.q, training.qTable, sizeof(model.q));
+        memcpy(model.visits, training.visitCounts, sizeof(model.visits));
+        model.episodes = training.totalEpisodes;
+        model.epsilon = training.currentEpsilon;
+    }
+};
+
+namespace
+{
+    typedef TrainingTestAccess::Model Model;
+
+    const char kCheckpointPath[] = "/checkpoint.bin";
+    const char kJournalPath[] = "/checkpoint.jnl";
+    const int kMaxUpdates = 64;
+
+    // Forwards to a RamStorage until the budget of changing operations
+    // runs out, then drops them. A torn cut writes the first few bytes of
+    // the append it lands on.
+    class CutStorage : public ModelStorage
+    {
+    public:
+        explicit CutStorage(RamStorage &backing) : backing(backing), budget(-1), tornBytes(0), cut(false) {}
+
+        void cutAfter(int operations, size_t tornAppendBytes = 0)
+        {
+            budget = operations;
+            tornBytes = tornAppendBytes;
+            cut = false;
+        }
+        bool wasCut() const { return cut; }
+
+        const char *getName() const override { return "cut"; }
+        bool begin() override { return true; }
+        bool exists(const char *name) override { return backing.exists(name); }
+        size_t size(const char *name) override { return backing.size(name); }
+        size_t read(const char *name, size_t offset, uint8_t *buffer, size_t length) override
+        {
+            return backing.read(name, offset, buffer, length);
+        }
+
+        bool write(const char *name, const uint8_t *data, size_t length) override
+        {
+            return spend() && backing.write(name, data, length);
+        }
+
+        bool append(const char *name, const uint8_t *data, size_t length) override
+        {
+            if (!spend())
+            {
+                if (tornBytes > 0 && tornBytes < length)
+                {
+                    backing.append(name, data, tornBytes);
+                }
+                return false;
+            }
+            return backing.append(name, data, length);
+        }
+
+        bool remove(const char *name) override { return spend() && backing.remove(name); }
+        bool rename(const char *from, const char *to) override { return spend() && backing.rename(from, to); }
+
+    private:
+        RamStorage &backing;
+        int budget;
+        size_t tornBytes;
+        bool cut;
+
+        bool spend()
+        {
+            if (cut || budget == 0)
+            {
+                cut = true;
+                return false;
+            }
+            if (budget > 0)
+            {
+                --budget;
+            }
+            return true;
+        }
+    };
+
+    // The robot before the cut: cell updates are collected as
+    // ModelCheckpointer would and journaled when flush() is called
+    struct Run
+    {
+        RamStorage backing;
+        CutStorage storage;
+        Training training;
+        Training::CellUpdate updates[kMaxUpdates];
+        int updateCount;
+        int down;
+        int up;
+        int steps;
+
+        Run() : storage(backing), updateCount(0), down(0), up(0), steps(0)
+        {
+            training.setStorage(&storage);
+            training.begin();
+            training.setUpdateHandler(onUpdate, this);
+            training.startTraining();
+            down = training.getDownAngleOption(0);
+            up = training.getUpAngleOption(0);
+        }
+
+        static void onUpdate(void *context, const Training::CellUpdate &update)
+        {
+            Run *run = static_cast<Run *>(context);
+            if (run->updateCount < kMaxUpdates)
+            {
+                run->updates[run->updateCount++] = update;
+            }
+        }
+
+        void train(int count)
+        {
+            for (int i = 0; i < count; ++i, ++steps)
+            {
+                // Some steps go forward, some back, so cells keep changing
+                float deltaCm = static_cast<float>((steps * 7) % 5) - 1.5f;
+                Training::StepResult result = training.step(deltaCm, deltaCm * 2.0f, 0.1f, down, up);
+                down = result.targetDownAngle;
+                up = result.targetUpAngle;
+            }
+        }
+
+        bool flush()
+        {
+            bool ok = training.appendJournal(updates, updateCount);
+            updateCount = 0;
+            return ok;
+        }
+
+        void capture(Model &model) const { TrainingTestAccess::capture(training, model); }
+    };
+
+    // Boots on what reached flash and resumes
+    bool reboot(RamStorage &backing, Model &resumed)
+    {
+        Training training;
+        training.setStorage(&backing);
+        training.begin();
+        bool ok = training.resumeTraining();
+        TrainingTestAccess::capture(training, resumed);
+        return ok;
+    }
+
+    void assertSameModel(const Model &expected, const Model &actual, int cut)
+    {
+        char message[32];
+        snprintf(message, sizeof(message), "cut before operation %d", cut);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected.q, actual.q, sizeof(expected.q), message);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected.visits, actual.visits, sizeof(expected.visits), message);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.episodes, actual.episodes, message);
+        TEST_ASSERT_EQUAL_FLOAT_MESSAGE(expected.epsilon, actual.epsilon, message);
+    }
+
+    // A run with a checkpoint and a journal of updates on top of it
+    void prepare(Run &run, Model &journaled)
+    {
+        run.train(20);
+        TEST_ASSERT_TRUE(run.flush());
+        run.train(20);
+        TEST_ASSERT_TRUE(run.flush());
+        run.capture(journaled);
+    }
+}
+
+void setUp()
+{
+    Serial.setMuted(true);
+}
+
+void tearDown()
+{
+    Serial.setMuted(false);
+}
+
+void test_resume_without_cut()
+{
+    Run run;
+    Model journaled;
+    prepare(run, journaled);
+
+    Model resumed;
+    TEST_ASSERT_TRUE(reboot(run.backing, resumed));
+    assertSameModel(journaled, resumed, -1);
+}
+
+// Writing the temporary checkpoint, removing the old one, renaming the new
+// one into place, and restarting the journal
+void test_cut_during_compaction()
+{
+    for (int cut = 0;; ++cut)
+    {
+        Run run;
+        Model journaled;
+        prepare(run, journaled);
+        run.storage.cutAfter(cut);
+        run.training.compactJournal();
+
+        Model resumed;
+        TEST_ASSERT_TRUE(reboot(run.backing, resumed));
+        assertSameModel(journaled, resumed, cut);
+        if (!run.storage.wasCut())
+        {
+            TEST_ASSERT_GREATER_THAN(2, cut);
+            break;
+        }
+    }
+}
+
+// The first append checkpoints the table before it starts the journal
+void test_cut_during_first_checkpoint()
+{
+    for (int cut = 0;; ++cut)
+    {
+        Run run;
+        run.train(20);
+        Model trained;
+        run.capture(trained);
+        run.storage.cutAfter(cut);
+        run.flush();
+
+        Model resumed;
+        if (reboot(run.backing, resumed))
+        {
+            assertSameModel(trained, resumed, cut);
+        }
+        else
+        {
+            // Nothing to resume until a checkpoint is in place
+            TEST_ASSERT_FALSE(run.backing.exists(kCheckpointPath));
+        }
+        if (!run.storage.wasCut())
+        {
+            TEST_ASSERT_TRUE(run.backing.exists(kCheckpointPath));
+            break;
+        }
+    }
+}
+
+// A record torn halfway is dropped, and the journal before it kept
+void test_torn_append()
+{
+    Run run;
+    Model journaled;
+    prepare(run, journaled);
+    run.train(5);
+    run.storage.cutAfter(0, 6);
+    TEST_ASSERT_FALSE(run.flush());
+
+    Model resumed;
+    TEST_ASSERT_TRUE(reboot(run.backing, resumed));
+    assertSameModel(journaled, resumed, 0);
+}
+
+void test_missing_journal()
+{
+    Run run;
+    Model journaled;
+    prepare(run, journaled);
+    TEST_ASSERT_TRUE(run.training.compactJournal());
+    run.backing.remove(kJournalPath);
+
+    Model resumed;
+    TEST_ASSERT_TRUE(reboot(run.backing, resumed));
+    assertSameModel(journaled, resumed, -1);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_resume_without_cut);
+    RUN_TEST(test_cut_during_compaction);
+    RUN_TEST(test_cut_during_first_checkpoint);
+    RUN_TEST(test_torn_append);
+    RUN_TEST(test_missing_journal);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+// The windows Training learns from line up with the actions it credits.
+//
+// ControlPipeline keeps one step in flight: a window stays open until the
+// move chosen from the previous one has finished, and step() credits the
+// window's distance to that move. CrawlerSim runs the pipeline the same
+// way, so here random moves between the angle options go through it at
+// control intervals short enough that many moves overrun them. Each window
+// must hold exactly the progress of the move that was just chosen, end
+// with the arm where that move sent it, and last the whole intervals the
+// move took.
+//
+//     pio test -e native_test
+
+#include <Arduino.h>
+#include <CrawlerSim.h>
+#include <Training.h>
+#include <math.h>
+#include <stdlib.h>
+#include <unity.h>
+
+namespace
+{
+    const int kSteps = 500;
+
+    void checkWindows(float intervalS)
+    {
+        Training training;
+        CrawlerSim::Params params;
+        params.intervalS = intervalS;
+        params.noiseCm = 0.0f;
+        params.driftStepCm = 0.0f;
+        CrawlerSim crawler(params);
+
+        int down = training.getDownAngleOption(0);
+        int up = training.getUpAngleOption(0);
+        CrawlerSim::Mechanics mechanics = crawler.restingAt(down, up);
+        srand(7);
+        int overruns = 0;
+        for (int step = 0; step < kSteps; ++step)
+        {
+            int toDown = training.getDownAngleOption(rand() % training.getDownActionCount());
+            int toUp = training.getUpAngleOption(rand() % training.getUpActionCount());
+            CrawlerSim::Mechanics::Window window = crawler.advance(mechanics, toDown, toUp);
+
+            char message[64];
+            snprintf(message, sizeof(message), "interval %.2f s, step %d", intervalS, step);
+            TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-3f, crawler.expectedDeltaCm(down, up, toDown, toUp), window.deltaCm,
+                                             message);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(toDown, mechanics.downDeg, message);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(toUp, mechanics.upDeg, message);
+
+            float moveS = static_cast<float>(abs(toDown - down) + abs(toUp - up)) / params.servoDegPerS;
+            float intervals = moveS > 0.0f ? ceilf(moveS / intervalS - 1e-4f) : 1.0f;
+            TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-4f, intervals * intervalS, window.seconds, message);
+            overruns += intervals > 1.0f ? 1 : 0;
+
+            down = toDown;
+            up = toUp;
+        }
+        if (intervalS < 0.45f)
+        {
+            // Otherwise the test would not be exercising long moves
+            TEST_ASSERT_GREATER_THAN(0, overruns);
+        }
+    }
+}
+
+void setUp()
+{
+    Serial.setMuted(true);
+}
+
+void tearDown()
+{
+    Serial.setMuted(false);
+}
+
+void test_windows_at_default_interval()
+{
+    checkWindows(0.5f);
+}
+
+void test_windows_with_moves_longer_than_the_interval()
+{
+    checkWindows(0.4f);
+    checkWindows(0.3f);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_windows_at_default_interval);
+    RUN_TEST(test_windows_with_moves_longer_than_the_interval);
+    return UNITY_END();
+}
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Compare two host benchmark runs (host/bench) and flag regressions.
+
+    pio run -e native_bench && .pio/build/native_bench/program --out before.json
+    # ...change something...
+    pio run -e native_bench && .pio/build/native_bench/program --out after.json
+    python tools/bench_diff.py before.json after.json --threshold 5
+
+Compares median ns/op per benchmark. Exits with 1 when any benchmark got
+slower by more than the threshold (percent), so it can gate a script.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    if data.get("schema") != 1:
+        raise SystemExit(f"{path}: unsupported schema {data.get('schema')}")
+    return {b["name"]: b["ns_per_op"] for b in data["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percent slowdown that counts as a regression (default 5)")
+    parser.add_argument("--metric", choices=("median", "min", "p90", "mean"), default="median")
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+    regressions = 0
+    print(f"{'benchmark':<28} {'before':>12} {'after':>12} {'change':>9}")
+    for name in sorted(set(before) | set(after)):
+        if name not in before or name not in after:
+            side = "after" if name in after else "before"
+            print(f"{name:<28} {'only in ' + side:>35}")
+            continue
+        old = before[name][args.metric]
+        new = after[name][args.metric]
+        change = (new - old) / old * 100 if old else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  slower"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "  faster"
+        print(f"{name:<28} {old:>10.1f}ns {new:>10.1f}ns {change:>+8.1f}%{flag}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
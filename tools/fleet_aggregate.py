@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Merge the Q-tables of robots 1-8 and push the result back.
+
+    python tools/fleet_aggregate.py collect fleet/
+    python tools/fleet_aggregate.py merge fleet/ merged.bin --baseline last-merged.bin
+    python tools/fleet_aggregate.py push merged.bin
+    python tools/fleet_aggregate.py sync --local-base-port 8080   # against mock_robot.py
+
+Q-values are averaged per (state, action) weighted by visit count. With
+--baseline (the previously pushed merge), only visits made since that merge
+are counted, so repeated syncs do not count shared experience twice.
+"""
+
+import argparse
+import glob
+import os
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+import model_transfer
+import rlmodel
+from mock_robot import parse_robot_range
+
+
+def robot_hosts(robots, host_template, local_base_port):
+    if local_base_port is not None:
+        return {n: "127.0.0.1:%d" % (local_base_port + n) for n in robots}
+    return {n: host_template.format(n=n) for n in robots}
+
+
+def merge_models(models, baseline=None):
+    if not models:
+        raise rlmodel.ModelError("nothing to merge")
+    states, actions = models[0].state_count, models[0].action_count
+    for model in models[1:] + ([baseline] if baseline else []):
+        if (model.state_count, model.action_count) != (states, actions):
+            raise rlmodel.ModelError("table sizes differ")
+        if (model.down_angles, model.up_angles) != (models[0].down_angles, models[0].up_angles):
+            raise rlmodel.ModelError("angle options differ")
+
+    merged = rlmodel.Model.zeros(states, actions, like=models[0])
+    for s in range(states):
+        for a in range(actions):
+            base_visits = baseline.visit_counts[s][a] if baseline else 0
+            weight_sum = base_visits
+            value_sum = baseline.q_table[s][a] * base_visits if baseline else 0.0
+            for model in models:
+                new_visits = max(model.visit_counts[s][a] - base_visits, 0)
+                weight_sum += new_visits
+                value_sum += model.q_table[s][a] * new_visits
+
+            if weight_sum > 0:
+                merged.q_table[s][a] = value_sum / weight_sum
+            else:
+                merged.q_table[s][a] = sum(m.q_table[s][a] for m in models) / len(models)
+            merged.visit_counts[s][a] = weight_sum
+    return merged
+
+
+def collect(hosts, out_dir):
+    os.makedirs(out_dir, exist_ok=True)
+
+    def fetch(item):
+        number, host = item
+        try:
+            data = model_transfer.pull(host, timeout=5.0)
+            rlmodel.Model.from_bytes(data)
+        except Exception as error:  # one unreachable robot must not stop the fleet
+            return number, "skipped (%s)" % error
+        with open(os.path.join(out_dir, "robot-%d.bin" % number), "wb") as handle:
+            handle.write(data)
+        return number, "%d bytes" % len(data)
+
+    with ThreadPoolExecutor(max_workers=len(hosts) or 1) as pool:
+        results = dict(pool.map(fetch, hosts.items()))
+    for number in sorted(results):
+        print("robot %d: %s" % (number, results[number]))
+
+
+def push_all(hosts, data):
+    def send(item):
+        number, host = item
+        try:
+            return number, model_transfer.push(host, data)
+        except Exception as error:
+            return number, "failed (%s)" % error
+
+    with ThreadPoolExecutor(max_workers=len(hosts) or 1) as pool:
+        results = dict(pool.map(send, hosts.items()))
+    for number in sorted(results):
+        print("robot %d: %s" % (number, results[number]))
+
+
+def merge_dir(in_dir, baseline_path):
+    paths = sorted(glob.glob(os.path.join(in_dir, "robot-*.bin")))
+    models = [rlmodel.load(path) for path in paths]
+    baseline = rlmodel.load(baseline_path) if baseline_path and os.path.exists(baseline_path) else None
+    merged = merge_models(models, baseline)
+    total = sum(sum(row) for row in merged.visit_counts)
+    print("Merged %d models, %d total visits" % (len(models), total))
+    return merged
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--robots", default="1-8")
+    parser.add_argument("--host-template", default="ESP32-OTA-{n}.local")
+    parser.add_argument("--local-base-port", type=int, help="talk to mock_robot.py instead")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    collect_cmd = commands.add_parser("collect", help="pull every reachable robot's model")
+    collect_cmd.add_argument("out_dir")
+    merge_cmd = commands.add_parser("merge", help="merge collected models")
+    merge_cmd.add_argument("in_dir")
+    merge_cmd.add_argument("out_path")
+    merge_cmd.add_argument("--baseline")
+    push_cmd = commands.add_parser("push", help="push one model to every robot")
+    push_cmd.add_argument("path")
+    sync_cmd = commands.add_parser("sync", help="collect, merge and push in one go")
+    sync_cmd.add_argument("--work-dir", default="fleet")
+    args = parser.parse_args()
+
+    hosts = robot_hosts(parse_robot_range(args.robots), args.host_template, args.local_base_port)
+    try:
+        if args.command == "collect":
+            collect(hosts, args.out_dir)
+        elif args.command == "merge":
+            rlmodel.save(merge_dir(args.in_dir, args.baseline), args.out_path)
+        elif args.command == "push":
+            with open(args.path, "rb") as handle:
+                push_all(hosts, handle.read())
+        else:
+            baseline_path = os.path.join(args.work_dir, "merged.bin")
+            collect(hosts, args.work_dir)
+            merged = merge_dir(args.work_dir, baseline_path)
+            rlmodel.save(merged, baseline_path)
+            push_all(hosts, merged.to_bytes())
+    except (OSError, rlmodel.ModelError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
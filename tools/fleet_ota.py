@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Push one firmware image to many robots at once over the HTTP OTA endpoint.
+
+    python tools/fleet_ota.py .pio/build/esp32-s3-devkitm-1/firmware.bin
+    python tools/fleet_ota.py firmware.bin --robots 2,5 --raw
+    python tools/fleet_ota.py firmware.bin --local-base-port 9080   # against mock_ota_receiver.py
+
+Robots are discovered by resolving their ESP32-OTA-N mDNS hostnames. The
+image is zlib-compressed and sent in offset-addressed chunks; after a
+dropped connection the upload resumes from the offset the robot reports.
+"""
+
+import argparse
+import hashlib
+import socket
+import sys
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+import zlib
+from concurrent.futures import ThreadPoolExecutor, TimeoutError as FutureTimeout
+
+from mock_robot import parse_robot_range
+
+
+class OtaError(RuntimeError):
+    pass
+
+
+def parse_status(text):
+    return dict(item.split("=", 1) for item in text.split() if "=" in item)
+
+
+def call(base_url, method, path, params=None, body=None, timeout=10.0):
+    url = base_url + path
+    if params:
+        url += "?" + urllib.parse.urlencode(params)
+    request = urllib.request.Request(url, data=body, method=method)
+    if body is not None:
+        request.add_header("Content-Type", "application/octet-stream")
+    try:
+        with urllib.request.urlopen(request, timeout=timeout) as response:
+            return response.status, parse_status(response.read().decode(errors="replace"))
+    except urllib.error.HTTPError as error:
+        return error.code, parse_status(error.read().decode(errors="replace"))
+
+
+def discover(robots, host_template, timeout):
+    """Resolve each robot's mDNS hostname; unresolvable robots are skipped."""
+    def resolve(number):
+        host = host_template.format(n=number)
+        return socket.getaddrinfo(host, 80, socket.AF_INET, socket.SOCK_STREAM)[0][4][0]
+
+    found = {}
+    with ThreadPoolExecutor(max_workers=len(robots) or 1) as pool:
+        futures = {number: pool.submit(resolve, number) for number in robots}
+        for number, future in futures.items():
+            try:
+                found[number] = "http://%s" % future.result(timeout=timeout)
+            except (OSError, FutureTimeout):
+                pass
+    return found
+
+
+def update_robot(base_url, payload, image, encoding, chunk_size, retries, log):
+    session = hashlib.md5(payload + encoding.encode()).hexdigest()[:16]
+    begin = {"session": session, "size": len(payload), "image": len(image),
+             "md5": hashlib.md5(image).hexdigest(), "encoding": encoding}
+
+    code, status = call(base_url, "POST", "/ota/begin", begin)
+    if code != 200:
+        raise OtaError("begin rejected (%d %s)" % (code, status.get("state", "")))
+    offset = int(status["offset"])
+    if offset:
+        log("resuming at %d/%d" % (offset, len(payload)))
+
+    # --retries caps failures in a row; any progress starts the count afresh
+    failures = 0
+    retried = 0
+    while offset < len(payload):
+        chunk = payload[offset:offset + chunk_size]
+        try:
+            code, status = call(base_url, "PUT", "/ota/chunk",
+                                {"session": session, "offset": offset}, chunk)
+            if code == 200:
+                acknowledged = int(status["offset"])
+                if acknowledged > offset:
+                    failures = 0
+                offset = acknowledged
+                continue
+        except (urllib.error.URLError, OSError):
+            pass
+
+        failures += 1
+        retried += 1
+        if failures > retries:
+            raise OtaError("gave up at %d/%d" % (offset, len(payload)))
+        time.sleep(min(0.2 * failures, 2.0))
+        try:
+            # Re-announcing the same session resumes; anything else restarts.
+            code, status = call(base_url, "POST", "/ota/begin", begin)
+            if code == 200:
+                acknowledged = int(status["offset"])
+                if acknowledged > offset:
+                    failures = 0
+                offset = acknowledged
+                log("retry %d from %d" % (retried, offset))
+        except (urllib.error.URLError, OSError):
+            pass
+
+    code, status = call(base_url, "POST", "/ota/commit")
+    if code != 200:
+        raise OtaError("commit failed (%d, written %s/%s)"
+                       % (code, status.get("written"), status.get("image")))
+    return retried
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("firmware")
+    parser.add_argument("--robots", default="1-8")
+    parser.add_argument("--host-template", default="ESP32-OTA-{n}.local")
+    parser.add_argument("--local-base-port", type=int, help="talk to mock_ota_receiver.py instead")
+    parser.add_argument("--raw", action="store_true", help="send the image uncompressed")
+    parser.add_argument("--chunk-size", type=int, default=16384)
+    parser.add_argument("--retries", type=int, default=30, help="failed chunks in a row before giving up")
+    parser.add_argument("--discover-timeout", type=float, default=3.0)
+    args = parser.parse_args()
+
+    with open(args.firmware, "rb") as handle:
+        image = handle.read()
+    encoding = "raw" if args.raw else "zlib"
+    payload = image if args.raw else zlib.compress(image, 9)
+    print("Image %d bytes, sending %d bytes (%s, %.0f%%)"
+          % (len(image), len(payload), encoding, 100.0 * len(payload) / len(image)))
+
+    robots = parse_robot_range(args.robots)
+    if args.local_base_port is not None:
+        targets = {n: "http://127.0.0.1:%d" % (args.local_base_port + n) for n in robots}
+    else:
+        targets = discover(robots, args.host_template, args.discover_timeout)
+    if not targets:
+        print("No robots found", file=sys.stderr)
+        return 1
+    print("Updating robots %s" % ", ".join(str(n) for n in sorted(targets)))
+
+    def run(item):
+        number, base_url = item
+        started = time.monotonic()
+
+        def log(message):
+            print("robot %d: %s" % (number, message))
+
+        try:
+            retries = update_robot(base_url, payload, image, encoding, args.chunk_size, args.retries, log)
+        except (OtaError, urllib.error.URLError, OSError, KeyError) as error:
+            return number, False, "FAILED: %s" % error
+        return number, True, "ok in %.1f s (%d retries)" % (time.monotonic() - started, retries)
+
+    with ThreadPoolExecutor(max_workers=len(targets)) as pool:
+        results = sorted(pool.map(run, targets.items()))
+    for number, _, message in results:
+        print("robot %d: %s" % (number, message))
+    return 0 if all(ok for _, ok, _ in results) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
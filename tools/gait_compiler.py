@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Distil a trained table policy into a header of constexpr gait keyframes.
+
+Follows the greedy policy of a model file (/training.bin) from the first
+angle options, as the robot starts, until it returns to a pose it has
+already visited. The poses it passes through become keyframes: a lead-in,
+then the cycle the robot walks forever. Firmware built with
+-D RLBOT_COMPILED_GAIT replays them instead of looking up the model, and
+does not need a model file at all. Mirrors Training::distilGait(); see
+lib/Training/CompiledGait.h.
+
+    python tools/gait_compiler.py training.bin
+    python tools/gait_compiler.py training.bin --out include/LearnedGait.h
+"""
+
+import argparse
+import os
+import sys
+import zlib
+
+import rlmodel
+
+DEFAULT_OUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "LearnedGait.h")
+
+
+def decode_action(model, action, down, up):
+    """The servo targets of an action, as Training::decodeAction()."""
+    down_count = len(model.down_angles)
+    if action < down_count:
+        return model.down_angles[action], up
+    return down, model.up_angles[action - down_count]
+
+
+def state_index(model, down, up):
+    return model.down_angles.index(down) * len(model.up_angles) + model.up_angles.index(up)
+
+
+def extract_gait(model):
+    """Keyframes (action, down, up) and the index the cycle starts at."""
+    down, up = model.down_angles[0], model.up_angles[0]
+    visited_at = {}
+    frames = []
+    state = state_index(model, down, up)
+    while state not in visited_at:
+        visited_at[state] = len(frames)
+        row = model.q_table[state]
+        # max() keeps the first of equal values, as selectBestAction() does
+        action = max(range(model.action_count), key=lambda a: row[a])
+        down, up = decode_action(model, action, down, up)
+        frames.append((action, down, up))
+        state = state_index(model, down, up)
+    return frames, visited_at[state]
+
+
+def render_header(model, frames, loop_start, source, crc):
+    lines = [
+        "// Generated by tools/gait_compiler.py from %s (CRC-32 0x%08X); do not edit." % (source, crc),
+        "// %d keyframes: a lead-in of %d, then a cycle of %d."
+        % (len(frames), loop_start, len(frames) - loop_start),
+        "#ifndef LEARNED_GAIT_H",
+        "#define LEARNED_GAIT_H",
+        "",
+        "#include <CompiledGait.h>",
+        "",
+        "namespace LearnedGait",
+        "{",
+        "    constexpr GaitKeyframe kFrames[] = {",
+    ]
+    for index, (action, down, up) in enumerate(frames):
+        marker = ", cycle starts" if index == loop_start else ""
+        lines.append("        {%d, %d, %d}, // %s -> D%d/U%d%s"
+                     % (action, down, up, model.action_label(action), down, up, marker))
+    lines += [
+        "    };",
+        "",
+        "    constexpr CompiledGait kGait = {kFrames, %d, %d};" % (len(frames), loop_start),
+        "}",
+        "",
+        "#endif // LEARNED_GAIT_H",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", help="model file, e.g. pulled with serial_link.py pull")
+    parser.add_argument("--out", default=DEFAULT_OUT, help="header to write (default include/LearnedGait.h)")
+    args = parser.parse_args()
+
+    try:
+        with open(args.model, "rb") as handle:
+            data = handle.read()
+        model = rlmodel.Model.from_bytes(data)
+        if any(not 0 <= angle <= 255 for angle in model.down_angles + model.up_angles):
+            raise rlmodel.ModelError("angle options do not fit a keyframe")
+        frames, loop_start = extract_gait(model)
+        header = render_header(model, frames, loop_start, os.path.basename(args.model), zlib.crc32(data))
+        with open(args.out, "w") as handle:
+            handle.write(header)
+    except (OSError, rlmodel.ModelError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+
+    for index, (action, down, up) in enumerate(frames):
+        print("%s%-5s -> D%d/U%d" % ("* " if index >= loop_start else "  ", model.action_label(action), down, up))
+    print("wrote %s: %d keyframes, cycle of %d from frame %d"
+          % (args.out, len(frames), len(frames) - loop_start, loop_start))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
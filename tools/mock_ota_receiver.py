@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Local stand-in for the firmware's HTTP OTA endpoint (lib/Network/HttpOta).
+
+    python tools/mock_ota_receiver.py --robots 1-8 --base-port 9080 --drop-rate 0.2
+
+Robot N listens on 127.0.0.1:(base_port + N). With --drop-rate, chunk
+requests are randomly cut off part-way through, the way a flaky Wi-Fi link
+would, so the host tool's resume path gets exercised. Verified images can be
+written out with --out-dir.
+"""
+
+import argparse
+import hashlib
+import os
+import random
+import sys
+import threading
+import urllib.parse
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+from mock_robot import parse_robot_range
+
+
+class OtaSession:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self, state="idle"):
+        self.state = state
+        self.session = ""
+        self.size = self.image_size = self.offset = 0
+        self.md5 = ""
+        self.inflater = None
+        self.image = bytearray()
+
+    def status(self):
+        return ("state=%s session=%s offset=%d size=%d written=%d image=%d\n"
+                % (self.state, self.session, self.offset, self.size, len(self.image), self.image_size))
+
+    def consume(self, data):
+        if self.offset + len(data) > self.size:
+            raise ValueError("upload larger than announced")
+        out = self.inflater.decompress(data) if self.inflater else data
+        if len(self.image) + len(out) > self.image_size:
+            raise ValueError("image larger than announced")
+        self.image.extend(out)
+        self.offset += len(data)
+
+
+def make_handler(number, ota, drop_rate, out_dir, rng):
+    class Handler(BaseHTTPRequestHandler):
+        def log_message(self, fmt, *args):
+            pass
+
+        def reply(self, code):
+            body = ota.status().encode()
+            self.send_response(code)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def route(self):
+            parsed = urllib.parse.urlparse(self.path)
+            return parsed.path, {k: v[0] for k, v in urllib.parse.parse_qs(parsed.query).items()}
+
+        def do_GET(self):
+            path, _ = self.route()
+            with ota.lock:
+                self.reply(200 if path == "/ota/status" else 404)
+
+        def do_POST(self):
+            path, args = self.route()
+            with ota.lock:
+                if path == "/ota/begin":
+                    return self.begin(args)
+                if path == "/ota/commit":
+                    return self.commit()
+                self.reply(404)
+
+        def begin(self, args):
+            if ota.state == "receiving" and args.get("session") == ota.session:
+                return self.reply(200)
+            try:
+                size, image = int(args["size"]), int(args["image"])
+                encoding, md5, session = args["encoding"], args["md5"], args["session"]
+            except (KeyError, ValueError):
+                ota.reset()
+                return self.reply(400)
+            if encoding not in ("raw", "zlib") or len(md5) != 32 or not session:
+                ota.reset()
+                return self.reply(400)
+            ota.reset("receiving")
+            ota.session, ota.size, ota.image_size, ota.md5 = session, size, image, md5
+            ota.inflater = zlib.decompressobj() if encoding == "zlib" else None
+            self.reply(200)
+
+        def commit(self):
+            done = (ota.state == "receiving" and ota.offset == ota.size
+                    and len(ota.image) == ota.image_size
+                    and (ota.inflater is None or ota.inflater.eof))
+            if not done:
+                return self.reply(409)
+            if hashlib.md5(ota.image).hexdigest() != ota.md5:
+                ota.reset("failed")
+                return self.reply(500)
+            if out_dir:
+                with open(os.path.join(out_dir, "robot-%d.bin" % number), "wb") as handle:
+                    handle.write(ota.image)
+            ota.state = "complete"
+            print("robot %d: image verified (%d bytes)" % (number, len(ota.image)))
+            self.reply(200)
+
+        def do_PUT(self):
+            path, args = self.route()
+            length = int(self.headers.get("Content-Length", 0))
+            with ota.lock:
+                if path != "/ota/chunk":
+                    return self.reply(404)
+                accepted = (ota.state == "receiving" and args.get("session") == ota.session
+                            and args.get("offset") == str(ota.offset))
+                if not accepted:
+                    self.rfile.read(length)
+                    return self.reply(409 if ota.state == "receiving" else 400)
+
+                dropped = rng.random() < drop_rate
+                data = self.rfile.read(rng.randint(0, length) if dropped else length)
+                try:
+                    ota.consume(data)
+                except (ValueError, zlib.error):
+                    ota.reset("failed")
+                    return self.reply(400)
+                if dropped:
+                    # Bytes already received stay consumed, like on the robot.
+                    self.close_connection = True
+                    self.connection.shutdown(2)
+                    return
+                self.reply(200)
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--robots", default="1-8")
+    parser.add_argument("--base-port", type=int, default=9080)
+    parser.add_argument("--drop-rate", type=float, default=0.0)
+    parser.add_argument("--out-dir")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    if args.out_dir:
+        os.makedirs(args.out_dir, exist_ok=True)
+    servers = []
+    for number in parse_robot_range(args.robots):
+        handler = make_handler(number, OtaSession(), args.drop_rate, args.out_dir,
+                               random.Random(args.seed * 1000 + number))
+        server = ThreadingHTTPServer(("127.0.0.1", args.base_port + number), handler)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        servers.append(server)
+        print("robot %d OTA on 127.0.0.1:%d" % (number, args.base_port + number))
+    try:
+        threading.Event().wait()
+    except KeyboardInterrupt:
+        for server in servers:
+            server.shutdown()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
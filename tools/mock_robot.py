@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Local stand-in for one or more robots' model server.
+
+Each robot N listens on 127.0.0.1:(base_port + N) and speaks the same
+GET/POST /model protocol as the firmware, so fleet tools can be exercised on
+a single machine:
+
+    python tools/mock_robot.py --robots 1-8 --base-port 8080 --seed 1
+"""
+
+import argparse
+import random
+import sys
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import rlmodel
+
+STATE_COUNT = 9
+ACTION_COUNT = 6
+
+
+def parse_robot_range(text):
+    robots = set()
+    for part in text.split(","):
+        if "-" in part:
+            first, last = part.split("-", 1)
+            robots.update(range(int(first), int(last) + 1))
+        else:
+            robots.add(int(part))
+    return sorted(robots)
+
+
+def extract_multipart_file(content_type, body):
+    """Return the first part's payload of a multipart/form-data body."""
+    marker = "boundary="
+    if marker not in content_type:
+        return None
+    boundary = content_type.split(marker, 1)[1].split(";")[0].strip('"').encode()
+    for part in body.split(b"--" + boundary):
+        head, sep, payload = part.partition(b"\r\n\r\n")
+        if sep and b"Content-Disposition" in head:
+            return payload[:-2] if payload.endswith(b"\r\n") else payload
+    return None
+
+
+def random_model(rng):
+    """A model shaped like one after a partial training run."""
+    model = rlmodel.Model.zeros(STATE_COUNT, ACTION_COUNT)
+    for state in range(STATE_COUNT):
+        for action in range(ACTION_COUNT):
+            visits = rng.randint(0, 60)
+            model.visit_counts[state][action] = visits
+            model.q_table[state][action] = rng.gauss(0.5, 1.0) if visits else 0.0
+    return model
+
+
+class MockRobot:
+    def __init__(self, number, model):
+        self.number = number
+        self.lock = threading.Lock()
+        self.model_bytes = model.to_bytes() if model else None
+
+    def handler(self):
+        robot = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def log_message(self, fmt, *args):
+                sys.stderr.write("[robot %d] %s\n" % (robot.number, fmt % args))
+
+            def reply(self, code, body, content_type="text/plain"):
+                self.send_response(code)
+                self.send_header("Content-Type", content_type)
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def do_GET(self):
+                if self.path != "/model":
+                    return self.reply(404, b"Not found\n")
+                with robot.lock:
+                    data = robot.model_bytes
+                if data is None:
+                    return self.reply(404, b"No model\n")
+                self.reply(200, data, "application/octet-stream")
+
+            def do_POST(self):
+                if self.path != "/model":
+                    return self.reply(404, b"Not found\n")
+                length = int(self.headers.get("Content-Length", 0))
+                payload = extract_multipart_file(self.headers.get("Content-Type", ""),
+                                                 self.rfile.read(length))
+                try:
+                    model = rlmodel.Model.from_bytes(payload or b"")
+                    if (model.state_count, model.action_count) != (STATE_COUNT, ACTION_COUNT):
+                        raise rlmodel.ModelError("table size mismatch")
+                except rlmodel.ModelError:
+                    return self.reply(400, b"Model rejected\n")
+                with robot.lock:
+                    robot.model_bytes = payload
+                self.reply(200, b"Model installed\n")
+
+        return Handler
+
+
+def serve(robots, base_port, seed, empty):
+    servers = []
+    for number in robots:
+        model = None if empty else random_model(random.Random(seed * 1000 + number))
+        robot = MockRobot(number, model)
+        server = ThreadingHTTPServer(("127.0.0.1", base_port + number), robot.handler())
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        servers.append(server)
+        print("robot %d on 127.0.0.1:%d" % (number, base_port + number))
+    return servers
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--robots", default="1-8", help="robot numbers, e.g. 1-8 or 1,3,5")
+    parser.add_argument("--base-port", type=int, default=8080)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--empty", action="store_true", help="start without a stored model")
+    args = parser.parse_args()
+
+    servers = serve(parse_robot_range(args.robots), args.base_port, args.seed, args.empty)
+    try:
+        threading.Event().wait()
+    except KeyboardInterrupt:
+        for server in servers:
+            server.shutdown()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Pull or push the Training model over the robot's Wi-Fi AP.
+
+    python tools/model_transfer.py pull training.bin
+    python tools/model_transfer.py push training.bin --host ESP32-OTA-3.local
+
+The robot serves GET /model and accepts a multipart POST /model; uploads are
+validated against the model header before they replace /training.bin.
+"""
+
+import argparse
+import sys
+import urllib.error
+import urllib.request
+import uuid
+
+import rlmodel
+
+DEFAULT_HOST = "192.168.4.1"
+
+
+def model_url(host):
+    if "://" not in host:
+        host = "http://" + host
+    return host.rstrip("/") + "/model"
+
+
+def pull(host, timeout=10.0):
+    with urllib.request.urlopen(model_url(host), timeout=timeout) as response:
+        return response.read()
+
+
+def push(host, data, timeout=30.0):
+    boundary = uuid.uuid4().hex
+    body = b"".join([
+        b"--" + boundary.encode() + b"\r\n",
+        b'Content-Disposition: form-data; name="model"; filename="training.bin"\r\n',
+        b"Content-Type: application/octet-stream\r\n\r\n",
+        data,
+        b"\r\n--" + boundary.encode() + b"--\r\n",
+    ])
+    request = urllib.request.Request(
+        model_url(host), data=body, method="POST",
+        headers={"Content-Type": "multipart/form-data; boundary=" + boundary})
+    with urllib.request.urlopen(request, timeout=timeout) as response:
+        return response.read().decode(errors="replace").strip()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("command", choices=["pull", "push"])
+    parser.add_argument("path", help="local model file")
+    parser.add_argument("--host", default=DEFAULT_HOST, help="robot address (default %(default)s)")
+    args = parser.parse_args()
+
+    try:
+        if args.command == "pull":
+            data = pull(args.host)
+            model = rlmodel.Model.from_bytes(data)
+            with open(args.path, "wb") as handle:
+                handle.write(data)
+            print("Pulled %d bytes (%d states x %d actions)"
+                  % (len(data), model.state_count, model.action_count))
+        else:
+            with open(args.path, "rb") as handle:
+                data = handle.read()
+            rlmodel.Model.from_bytes(data)  # refuse to send something the robot will reject
+            print(push(args.host, data))
+    except (urllib.error.URLError, OSError, rlmodel.ModelError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Train a Q-table offline from the transitions a robot logged.
+
+Reads transition logs (lib/Training/TransitionLog.h) pulled with
+`serial_link.py pull-transitions` and runs fitted Q-iteration over all of
+them at once. Each sweep sets every (state, action) cell the logs cover to
+the mean, over its logged steps, of reward + gamma * max Q(next state),
+with Q from the sweep before, until no cell moves by more than
+--tolerance. For a table that is value iteration on the transition and
+reward model the logs estimate. Every logged step is used in every sweep,
+where on the robot each one was learned from once, with a step size of
+1 / (1 + visits).
+
+Cells the logs never reach keep their value from --base, such as the model
+the robot trained, or 0 without one. The result is a model file to push
+back to the robot:
+
+    python tools/offline_train.py transitions.old transitions.bin --base training.bin --out offline.bin
+    python tools/serial_link.py --port /dev/ttyUSB0 push offline.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+import rlmodel
+
+LOG_MAGIC = 0x524C5431  # "RLT1"
+LOG_VERSION = 1
+
+# magic, version, headerSize, recordSize, downOptionCount, upOptionCount,
+# reserved, downAngles[8], upAngles[8]
+LOG_HEADER = struct.Struct("<2I2H2BH8h8h")
+# state, action, nextState, flags, deltaDistance, speed, acceleration,
+# pitch, check
+RECORD = struct.Struct("<4B3hbB")
+RUN_START = 1
+
+# Fixed-point units per cm, cm/s, m/s^2 and degree
+DISTANCE_SCALE = 100.0
+SPEED_SCALE = 100.0
+ACCELERATION_SCALE = 1000.0
+PITCH_SCALE = 2.0
+
+
+class Transition:
+    __slots__ = ("state", "action", "next_state", "run_start", "distance_cm", "speed_cms",
+                 "acceleration_mps2", "pitch_deg")
+
+    def __init__(self, fields):
+        state, action, next_state, flags, distance, speed, acceleration, pitch, _ = fields
+        self.state = state
+        self.action = action
+        self.next_state = next_state
+        self.run_start = bool(flags & RUN_START)
+        self.distance_cm = distance / DISTANCE_SCALE
+        self.speed_cms = speed / SPEED_SCALE
+        self.acceleration_mps2 = acceleration / ACCELERATION_SCALE
+        self.pitch_deg = pitch / PITCH_SCALE
+
+
+def read_log(data, name):
+    """Angle options and transitions of one log, up to its first torn record."""
+    if len(data) < LOG_HEADER.size:
+        raise rlmodel.ModelError("%s: not a transition log" % name)
+    fields = LOG_HEADER.unpack_from(data)
+    magic, version, header_size, record_size, down_count, up_count = fields[:6]
+    if magic != LOG_MAGIC or version != LOG_VERSION or record_size != RECORD.size:
+        raise rlmodel.ModelError("%s: not a version %d transition log" % (name, LOG_VERSION))
+    if not (0 < down_count <= rlmodel.MAX_ANGLE_OPTIONS and 0 < up_count <= rlmodel.MAX_ANGLE_OPTIONS):
+        raise rlmodel.ModelError("%s: angle option counts are invalid" % name)
+    down_angles = list(fields[7:7 + down_count])
+    up_angles = list(fields[15:15 + up_count])
+
+    states, actions = down_count * up_count, down_count + up_count
+    transitions = []
+    for offset in range(header_size, len(data) - RECORD.size + 1, RECORD.size):
+        record = data[offset:offset + RECORD.size]
+        fields = RECORD.unpack(record)
+        # The check byte is the low byte of the CRC-32 of the rest
+        if fields[-1] != zlib.crc32(record[:-1]) & 0xFF:
+            break
+        transition = Transition(fields)
+        if transition.state >= states or transition.next_state >= states or transition.action >= actions:
+            break
+        transitions.append(transition)
+    dropped = (len(data) - header_size) // RECORD.size - len(transitions)
+    return down_angles, up_angles, transitions, dropped
+
+
+def fitted_q(transitions, states, actions, gamma, initial, tolerance, max_sweeps):
+    """Q after fitted Q-iteration, the number of sweeps, and each cell's sample count."""
+    # Everything a sweep needs per cell: the mean reward and how often
+    # each next state followed
+    counts = [[0] * actions for _ in range(states)]
+    reward_sums = [[0.0] * actions for _ in range(states)]
+    next_counts = [[{} for _ in range(actions)] for _ in range(states)]
+    for t in transitions:
+        counts[t.state][t.action] += 1
+        reward_sums[t.state][t.action] += t.distance_cm
+        following = next_counts[t.state][t.action]
+        following[t.next_state] = following.get(t.next_state, 0) + 1
+    cells = [(s, a, reward_sums[s][a] / counts[s][a],
+              [(next_state, n / counts[s][a]) for next_state, n in next_counts[s][a].items()])
+             for s in range(states) for a in range(actions) if counts[s][a]]
+
+    q = [list(row) for row in initial]
+    for sweep in range(1, max_sweeps + 1):
+        best = [max(row) for row in q]
+        change = 0.0
+        updated = [list(row) for row in q]
+        for s, a, reward, following in cells:
+            target = reward + gamma * sum(p * best[next_state] for next_state, p in following)
+            change = max(change, abs(target - q[s][a]))
+            updated[s][a] = target
+        q = updated
+        if change <= tolerance:
+            return q, sweep, counts
+    return q, max_sweeps, counts
+
+
+def greedy_actions(model):
+    return [max(range(model.action_count), key=lambda a, row=row: row[a]) for row in model.q_table]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("logs", nargs="+", help="transition logs, e.g. pulled with serial_link.py")
+    parser.add_argument("--base", help="model to start from; keeps the cells the logs do not reach")
+    parser.add_argument("--out", default="offline.bin", help="model file to write (default offline.bin)")
+    parser.add_argument("--gamma", type=float, help="discount (default: the base model's, else 0.95)")
+    parser.add_argument("--tolerance", type=float, default=1e-4, help="stop once no cell moves more")
+    parser.add_argument("--max-sweeps", type=int, default=2000)
+    args = parser.parse_args()
+
+    try:
+        angles = None
+        transitions = []
+        for path in args.logs:
+            with open(path, "rb") as handle:
+                down_angles, up_angles, logged, dropped = read_log(handle.read(), path)
+            if angles is not None and angles != (down_angles, up_angles):
+                raise rlmodel.ModelError("%s: angle options differ from the other logs" % path)
+            angles = (down_angles, up_angles)
+            transitions += logged
+            print("%s: %d transitions%s" % (path, len(logged), ", %d after a torn record dropped" % dropped
+                                            if dropped else ""))
+        if not transitions:
+            raise rlmodel.ModelError("the logs hold no transitions")
+
+        states, actions = len(angles[0]) * len(angles[1]), len(angles[0]) + len(angles[1])
+        base = rlmodel.load(args.base) if args.base else None
+        if base is not None and (base.down_angles, base.up_angles) != angles:
+            raise rlmodel.ModelError("the base model has other angle options than the logs")
+        model = rlmodel.Model.zeros(states, actions, like=base)
+        model.down_angles, model.up_angles = angles
+        if args.gamma is not None:
+            if not 0.0 <= args.gamma < 1.0:
+                raise rlmodel.ModelError("gamma must be in [0, 1)")
+            model.hyperparameters["gamma"] = rlmodel.float32(args.gamma)
+        gamma = model.hyperparameters["gamma"]
+
+        initial = base.q_table if base is not None else model.q_table
+        q, sweeps, counts = fitted_q(transitions, states, actions, gamma, initial, args.tolerance,
+                                     args.max_sweeps)
+        model.q_table = [[rlmodel.float32(value) for value in row] for row in q]
+        # The base model may have learned from the same steps, so its
+        # visits are not added to the logged ones
+        model.visit_counts = [[max(counts[s][a], base.visit_counts[s][a] if base is not None else 0)
+                               for a in range(actions)] for s in range(states)]
+        model.total_episodes = max(len(transitions), base.total_episodes if base is not None else 0)
+        model.training_seconds = base.training_seconds if base is not None else 0
+        model.epsilon = model.hyperparameters["epsilon_min"]
+        rlmodel.save(model, args.out)
+    except (OSError, rlmodel.ModelError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+
+    covered = sum(1 for row in counts for n in row if n)
+    print("%d transitions cover %d of %d cells; converged after %d sweeps (gamma %.3f)"
+          % (len(transitions), covered, states * actions, sweeps, gamma))
+    before = greedy_actions(base) if base is not None else None
+    for state, action in enumerate(greedy_actions(model)):
+        changed = before is not None and before[state] != action
+        print("  %-9s -> %-5s%s" % (model.state_label(state), model.action_label(action),
+                                    "  (was %s)" % base.action_label(before[state]) if changed else ""))
+    print("wrote %s" % args.out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
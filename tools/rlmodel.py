@@ -0,0 +1,326 @@
+#!/usr/bin/env python3
+"""Reader/writer and inspection tool for Training model files (/training.bin).
+
+Mirrors lib/Training/ModelFormat.h so host tools can inspect, merge and
+rewrite models without the firmware. Version 3 files describe themselves
+(angle options, hyperparameters, training progress) and always end in a
+CRC-32; version 2 files are still read, with or without their CRC.
+
+    python tools/rlmodel.py dump training.bin
+    python tools/rlmodel.py dump training.bin --json
+    python tools/rlmodel.py diff before.bin after.bin --tolerance 0.01
+    python tools/rlmodel.py convert old-v2.bin training.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+MODEL_MAGIC = 0x524C4D31  # "RLM1"
+MODEL_VERSION = 3
+LEGACY_VERSION = 2
+MAX_ANGLE_OPTIONS = 8
+
+# magic, version, headerSize, fileSize, stateCount, actionCount,
+# downOptionCount, upOptionCount, qOffset, visitsOffset, totalEpisodes,
+# trainingSeconds, epsilon, gamma, epsilonStart, epsilonMin, epsilonDecay,
+# downAngles[8], upAngles[8], reserved
+HEADER = struct.Struct("<4I4H2I2I5f8h8hI")
+LEGACY_HEADER = struct.Struct("<5I")  # magic, version, stateCount, actionCount, payloadSize
+TRAILER = struct.Struct("<I")
+
+
+def float32(value):
+    """Round to the nearest float the firmware can store."""
+    return struct.unpack("<f", struct.pack("<f", value))[0]
+
+
+# What the firmware uses when nothing else is configured; version 2 files
+# were always written with these
+DEFAULT_DOWN_ANGLES = (140, 90, 45)
+DEFAULT_UP_ANGLES = (40, 90, 125)
+DEFAULT_HYPERPARAMETERS = {
+    "gamma": float32(0.95),
+    "epsilon_start": float32(1.0),
+    "epsilon_min": float32(0.1),
+    "epsilon_decay": float32(0.9995),
+}
+
+
+class ModelError(ValueError):
+    pass
+
+
+class Model:
+    def __init__(self, q_table, visit_counts, down_angles=DEFAULT_DOWN_ANGLES, up_angles=DEFAULT_UP_ANGLES):
+        self.q_table = q_table
+        self.visit_counts = visit_counts
+        self.down_angles = list(down_angles)
+        self.up_angles = list(up_angles)
+        self.hyperparameters = dict(DEFAULT_HYPERPARAMETERS)
+        self.total_episodes = 0
+        self.training_seconds = 0
+        self.epsilon = self.hyperparameters["epsilon_start"]
+        self.version = MODEL_VERSION
+
+    @property
+    def state_count(self):
+        return len(self.q_table)
+
+    @property
+    def action_count(self):
+        return len(self.q_table[0]) if self.q_table else 0
+
+    @classmethod
+    def zeros(cls, state_count, action_count, like=None):
+        model = cls([[0.0] * action_count for _ in range(state_count)],
+                    [[0] * action_count for _ in range(state_count)])
+        if like is not None:
+            model.down_angles = list(like.down_angles)
+            model.up_angles = list(like.up_angles)
+            model.hyperparameters = dict(like.hyperparameters)
+        return model
+
+    def state_label(self, state):
+        up_count = len(self.up_angles)
+        return "D%d/U%d" % (self.down_angles[state // up_count], self.up_angles[state % up_count])
+
+    def action_label(self, action):
+        down_count = len(self.down_angles)
+        if action < down_count:
+            return "D%d" % self.down_angles[action]
+        return "U%d" % self.up_angles[action - down_count]
+
+    @classmethod
+    def from_bytes(cls, data):
+        if len(data) < LEGACY_HEADER.size:
+            raise ModelError("model file is incomplete")
+        magic, version = struct.unpack_from("<2I", data)
+        if magic != MODEL_MAGIC:
+            raise ModelError("bad magic 0x%08X" % magic)
+        if version == MODEL_VERSION:
+            return cls._from_v3(data)
+        if version == LEGACY_VERSION:
+            return cls._from_v2(data)
+        raise ModelError("unsupported model version %d" % version)
+
+    @classmethod
+    def _from_v3(cls, data):
+        if len(data) < HEADER.size:
+            raise ModelError("model file is incomplete")
+        fields = HEADER.unpack_from(data)
+        (_, _, header_size, file_size, states, actions, down_count, up_count, q_offset, visits_offset,
+         episodes, seconds, epsilon, gamma, epsilon_start, epsilon_min, epsilon_decay) = fields[:17]
+        down_angles = fields[17:17 + down_count]
+        up_angles = fields[25:25 + up_count]
+        cells = states * actions
+        if not (0 < down_count <= MAX_ANGLE_OPTIONS and 0 < up_count <= MAX_ANGLE_OPTIONS
+                and states == down_count * up_count and actions == down_count + up_count):
+            raise ModelError("model table shape is invalid")
+        if (header_size < HEADER.size or q_offset < header_size or q_offset % 4
+                or visits_offset != q_offset + cells * 4
+                or file_size != visits_offset + cells * 4 + TRAILER.size):
+            raise ModelError("model header sizes are inconsistent")
+        if len(data) != file_size:
+            raise ModelError("model file is incomplete" if len(data) < file_size else "model file too large")
+        if TRAILER.unpack_from(data, file_size - TRAILER.size)[0] != zlib.crc32(data[:file_size - TRAILER.size]):
+            raise ModelError("CRC mismatch")
+
+        model = cls(*_unpack_tables(data, states, actions, q_offset, visits_offset), down_angles, up_angles)
+        model.hyperparameters = {
+            "gamma": gamma,
+            "epsilon_start": epsilon_start,
+            "epsilon_min": epsilon_min,
+            "epsilon_decay": epsilon_decay,
+        }
+        model.total_episodes = episodes
+        model.training_seconds = seconds
+        model.epsilon = epsilon
+        return model
+
+    @classmethod
+    def _from_v2(cls, data):
+        _, _, states, actions, payload = LEGACY_HEADER.unpack_from(data)
+        cells = states * actions
+        body = LEGACY_HEADER.size + payload
+        if payload != cells * 8 or len(data) not in (body, body + TRAILER.size):
+            raise ModelError("payload size mismatch")
+        if len(data) > body and TRAILER.unpack_from(data, body)[0] != zlib.crc32(data[:body]):
+            raise ModelError("CRC mismatch")
+        if (states, actions) != (len(DEFAULT_DOWN_ANGLES) * len(DEFAULT_UP_ANGLES),
+                                 len(DEFAULT_DOWN_ANGLES) + len(DEFAULT_UP_ANGLES)):
+            raise ModelError("version 2 model with an unknown %dx%d layout" % (states, actions))
+
+        q_offset = LEGACY_HEADER.size
+        model = cls(*_unpack_tables(data, states, actions, q_offset, q_offset + cells * 4))
+        model.version = LEGACY_VERSION
+        return model
+
+    def to_bytes(self):
+        states, actions = self.state_count, self.action_count
+        down_count, up_count = len(self.down_angles), len(self.up_angles)
+        if not (0 < down_count <= MAX_ANGLE_OPTIONS and 0 < up_count <= MAX_ANGLE_OPTIONS
+                and states == down_count * up_count and actions == down_count + up_count):
+            raise ModelError("table shape does not match the angle options")
+        cells = states * actions
+        q_offset = HEADER.size
+        visits_offset = q_offset + cells * 4
+        file_size = visits_offset + cells * 4 + TRAILER.size
+        pad = [0] * MAX_ANGLE_OPTIONS
+        params = self.hyperparameters
+        header = HEADER.pack(
+            MODEL_MAGIC, MODEL_VERSION, HEADER.size, file_size, states, actions, down_count, up_count,
+            q_offset, visits_offset, self.total_episodes, self.training_seconds, self.epsilon,
+            params["gamma"], params["epsilon_start"], params["epsilon_min"], params["epsilon_decay"],
+            *(list(self.down_angles) + pad)[:MAX_ANGLE_OPTIONS],
+            *(list(self.up_angles) + pad)[:MAX_ANGLE_OPTIONS], 0)
+        q_flat = [q for row in self.q_table for q in row]
+        n_flat = [n for row in self.visit_counts for n in row]
+        body = header + struct.pack("<%df" % cells, *q_flat) + struct.pack("<%dI" % cells, *n_flat)
+        return body + TRAILER.pack(zlib.crc32(body))
+
+    def describe(self):
+        return {
+            "version": self.version,
+            "states": self.state_count,
+            "actions": self.action_count,
+            "down_angles": self.down_angles,
+            "up_angles": self.up_angles,
+            "hyperparameters": {name: round(value, 7) for name, value in self.hyperparameters.items()},
+            "total_episodes": self.total_episodes,
+            "training_seconds": self.training_seconds,
+            "epsilon": round(self.epsilon, 7),
+            "q_table": self.q_table,
+            "visit_counts": self.visit_counts,
+        }
+
+
+def _unpack_tables(data, states, actions, q_offset, visits_offset):
+    cells = states * actions
+    q_flat = struct.unpack_from("<%df" % cells, data, q_offset)
+    n_flat = struct.unpack_from("<%dI" % cells, data, visits_offset)
+    q_table = [list(q_flat[s * actions:(s + 1) * actions]) for s in range(states)]
+    counts = [list(n_flat[s * actions:(s + 1) * actions]) for s in range(states)]
+    return q_table, counts
+
+
+def load(path):
+    with open(path, "rb") as handle:
+        return Model.from_bytes(handle.read())
+
+
+def save(model, path):
+    with open(path, "wb") as handle:
+        handle.write(model.to_bytes())
+
+
+def print_model(model, out):
+    params = model.hyperparameters
+    out.write("version %d, %d states x %d actions\n" % (model.version, model.state_count, model.action_count))
+    out.write("down angles %s, up angles %s\n" % (model.down_angles, model.up_angles))
+    out.write("episodes %d, trained %d s, epsilon %.4f\n"
+              % (model.total_episodes, model.training_seconds, model.epsilon))
+    out.write("gamma %.4f, epsilon start %.4f min %.4f decay %.6f\n"
+              % (params["gamma"], params["epsilon_start"], params["epsilon_min"], params["epsilon_decay"]))
+    out.write("%-10s" % "state" + "".join("%16s" % model.action_label(a) for a in range(model.action_count))
+              + "   best\n")
+    for s in range(model.state_count):
+        row = model.q_table[s]
+        cells = "".join("%10.4f/%-5d" % (row[a], model.visit_counts[s][a]) for a in range(model.action_count))
+        best = max(range(model.action_count), key=lambda a: row[a])
+        out.write("%-10s%s   %s\n" % (model.state_label(s), cells, model.action_label(best)))
+
+
+def diff_models(before, after, tolerance, out):
+    """Print what changed between two models; returns the number of differences."""
+    changes = 0
+    for name in ("down_angles", "up_angles", "hyperparameters"):
+        if getattr(before, name) != getattr(after, name):
+            out.write("%s: %s -> %s\n" % (name, getattr(before, name), getattr(after, name)))
+            changes += 1
+    if (before.state_count, before.action_count) != (after.state_count, after.action_count):
+        out.write("table shape %dx%d -> %dx%d\n" % (before.state_count, before.action_count,
+                                                    after.state_count, after.action_count))
+        return changes + 1
+    out.write("episodes %d -> %d, epsilon %.4f -> %.4f\n"
+              % (before.total_episodes, after.total_episodes, before.epsilon, after.epsilon))
+
+    for s in range(before.state_count):
+        for a in range(before.action_count):
+            q0, q1 = before.q_table[s][a], after.q_table[s][a]
+            n0, n1 = before.visit_counts[s][a], after.visit_counts[s][a]
+            if abs(q1 - q0) > tolerance or n0 != n1:
+                out.write("%-10s %-5s q %10.4f -> %10.4f  visits %6d -> %6d\n"
+                          % (after.state_label(s), after.action_label(a), q0, q1, n0, n1))
+                changes += 1
+        best0 = max(range(before.action_count), key=lambda a: before.q_table[s][a])
+        best1 = max(range(after.action_count), key=lambda a: after.q_table[s][a])
+        if best0 != best1:
+            out.write("%-10s policy %s -> %s\n"
+                      % (after.state_label(s), before.action_label(best0), after.action_label(best1)))
+            changes += 1
+    return changes
+
+
+def parse_angles(text):
+    return [int(value) for value in text.split(",")]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    dump_cmd = sub.add_parser("dump", help="print a model's header and Q-table")
+    dump_cmd.add_argument("path")
+    dump_cmd.add_argument("--json", action="store_true", help="print JSON instead of a table")
+
+    diff_cmd = sub.add_parser("diff", help="compare two models; exits 1 if their options, hyperparameters "
+                                           "or tables differ")
+    diff_cmd.add_argument("before")
+    diff_cmd.add_argument("after")
+    diff_cmd.add_argument("--tolerance", type=float, default=0.0, help="ignore Q changes up to this size")
+
+    convert_cmd = sub.add_parser("convert", help="rewrite a model (v2 or v3) as v3")
+    convert_cmd.add_argument("src")
+    convert_cmd.add_argument("dst")
+    convert_cmd.add_argument("--down-angles", type=parse_angles,
+                             help="down options the model was trained with, e.g. 140,90,45")
+    convert_cmd.add_argument("--up-angles", type=parse_angles, help="up options, e.g. 40,90,125")
+    convert_cmd.add_argument("--episodes", type=int, help="set the recorded episode count")
+    convert_cmd.add_argument("--epsilon", type=float, help="set the recorded epsilon")
+
+    args = parser.parse_args()
+    try:
+        if args.command == "dump":
+            model = load(args.path)
+            if args.json:
+                json.dump(model.describe(), sys.stdout, indent=2)
+                sys.stdout.write("\n")
+            else:
+                print_model(model, sys.stdout)
+        elif args.command == "diff":
+            changes = diff_models(load(args.before), load(args.after), args.tolerance, sys.stdout)
+            print("%d difference(s)" % changes)
+            return 1 if changes else 0
+        else:
+            model = load(args.src)
+            if args.down_angles is not None:
+                model.down_angles = args.down_angles
+            if args.up_angles is not None:
+                model.up_angles = args.up_angles
+            if args.episodes is not None:
+                model.total_episodes = args.episodes
+            if args.epsilon is not None:
+                model.epsilon = args.epsilon
+            save(model, args.dst)
+            print("wrote %s (version %d, %d bytes)" % (args.dst, MODEL_VERSION, len(model.to_bytes())))
+    except (OSError, ModelError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,364 @@
+#!/usr/bin/env python3
+"""Host side of the framed binary serial protocol (lib/SerialLink).
+
+    python tools/serial_link.py --port /dev/ttyUSB0 monitor
+    python tools/serial_link.py --port /dev/ttyUSB0 samples samples.csv --seconds 10
+    python tools/serial_link.py --port /dev/ttyUSB0 command stop
+    python tools/serial_link.py --port /dev/ttyUSB0 profile --reset
+    python tools/serial_link.py --port /dev/ttyUSB0 memory
+    python tools/serial_link.py --port /dev/ttyUSB0 jitter --seconds 60 --max-late-us 512
+    python tools/serial_link.py --port /dev/ttyUSB0 pull training.bin
+    python tools/serial_link.py --port /dev/ttyUSB0 push training.bin
+    python tools/serial_link.py --port /dev/ttyUSB0 pull-transitions transitions.bin
+
+Needs pyserial, which PlatformIO already installs.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+MSG_TELEMETRY = 0x01
+MSG_COMMAND = 0x02
+MSG_ACK = 0x03
+MSG_MODEL_BEGIN = 0x04
+MSG_MODEL_CHUNK = 0x05
+MSG_MODEL_END = 0x06
+MSG_MODEL_REQUEST = 0x07
+MSG_LOG = 0x08
+MSG_SAMPLE = 0x09
+MSG_SCHEDULER = 0x0A
+MSG_TRANSITIONS_REQUEST = 0x0B
+
+COMMANDS = {"start": 1, "stop": 2, "reset": 3, "load": 4, "save": 5,
+            "samples-on": 6, "samples-off": 7, "profile": 8, "profile-reset": 9,
+            "memory": 10, "storage-bench": 11,
+            "explore-epsilon": 12, "explore-ucb": 13, "explore-softmax": 14,
+            "clear-transitions": 15}
+ACK_NAMES = {0: "ok", 1: "failed", 2: "unsupported"}
+
+TELEMETRY = struct.Struct("<I5fIbBBB")
+SAMPLE = struct.Struct("<I4f")
+SCHEDULER = struct.Struct("<6I8H")
+BAUD_RATE = 921600
+MODEL_CHUNK_SIZE = 192
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as in SerialLink::crc16()."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index, code = 0, 1
+    for byte in data:
+        if byte == 0:
+            out[code_index] = code
+            code_index, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(byte)
+        code += 1
+        if code == 0xFF:
+            out[code_index] = code
+            code_index, code = len(out), 1
+            out.append(0)
+    out[code_index] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            return None
+        out += data[index + 1:index + code]
+        index += code
+        if code != 0xFF and index != len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(msg_type, seq, payload=b""):
+    body = bytes([msg_type, seq & 0xFF]) + payload
+    return b"\x00" + cobs_encode(body + struct.pack("<H", crc16(body))) + b"\x00"
+
+
+class FrameReader:
+    """Splits the byte stream on zero delimiters; invalid chunks are text."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            end = self.buffer.find(b"\x00")
+            if end < 0:
+                return
+            chunk, self.buffer = bytes(self.buffer[:end]), self.buffer[end + 1:]
+            if not chunk:
+                continue
+            frame = cobs_decode(chunk)
+            if frame and len(frame) >= 4 and crc16(frame[:-2]) == struct.unpack("<H", frame[-2:])[0]:
+                yield frame[0], frame[1], frame[2:-2]
+            else:
+                yield None, None, chunk
+
+
+class Link:
+    def __init__(self, port, baud):
+        import serial  # pyserial; imported here so the codec works without it
+        self.port = serial.Serial(port, baud, timeout=0.05)
+        self.reader = FrameReader()
+        self.seq = 0
+
+    def frames(self, timeout=None):
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while deadline is None or time.monotonic() < deadline:
+            for frame in self.reader.feed(self.port.read(4096)):
+                yield frame
+
+    def send(self, msg_type, payload=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        self.port.write(encode_frame(msg_type, self.seq, payload))
+        return self.seq
+
+    def request(self, msg_type, payload=b"", timeout=2.0):
+        seq = self.send(msg_type, payload)
+        for kind, _, body in self.frames(timeout):
+            if kind == MSG_ACK and body[0] == msg_type and body[1] == seq:
+                return body[2]
+        return None
+
+
+def format_telemetry(body):
+    (time_ms, dist, speed, accel, reward, epsilon, episodes,
+     action, down, up, flags) = TELEMETRY.unpack(body)
+    action_text = "-" if action < 0 else "%s %d" % ("Down" if flags & 4 else "Up", down if flags & 4 else up)
+    return ("t=%8.2fs dist=%6.2fcm speed=%6.2fcm/s accel=%5.2fm/s2 reward=%7.3f eps=%.3f ep=%d act=%s%s"
+            % (time_ms / 1000.0, dist, speed, accel, reward, epsilon, episodes, action_text,
+               " [training]" if flags & 1 else ""))
+
+
+def format_scheduler(body):
+    fields = SCHEDULER.unpack(body)
+    time_ms, period_us, ticks, dropped, overruns, max_late = fields[:6]
+    buckets = " ".join("<%d:%d" % (64 << i, count) for i, count in enumerate(fields[6:13]))
+    return ("sched t=%8.2fs period=%dms ticks=%d dropped=%d overruns=%d max-late=%dus late-us %s >=%d:%d"
+            % (time_ms / 1000.0, period_us // 1000, ticks, dropped, overruns, max_late,
+               buckets, 64 << 7, fields[13]))
+
+
+def cmd_monitor(link, args):
+    for kind, _, body in link.frames():
+        if kind == MSG_TELEMETRY and len(body) == TELEMETRY.size:
+            print(format_telemetry(body))
+        elif kind == MSG_SCHEDULER and len(body) == SCHEDULER.size:
+            print(format_scheduler(body))
+        elif kind == MSG_LOG:
+            print("log: " + body.decode(errors="replace"))
+        elif kind is None:
+            text = body.decode(errors="replace").strip()
+            if text:
+                print(text)
+
+
+def cmd_jitter(link, args):
+    """Add up the sched reports; fail if a control tick woke later than --max-late-us."""
+    reports = ticks = dropped = overruns = max_late = 0
+    late = [0] * 8
+    for kind, _, body in link.frames(args.seconds):
+        if kind == MSG_SCHEDULER and len(body) == SCHEDULER.size:
+            fields = SCHEDULER.unpack(body)
+            reports += 1
+            ticks += fields[2]
+            dropped += fields[3]
+            overruns += fields[4]
+            max_late = max(max_late, fields[5])
+            late = [total + count for total, count in zip(late, fields[6:])]
+    if reports == 0:
+        print("no sched reports", file=sys.stderr)
+        return 1
+
+    print("%d reports: ticks=%d dropped=%d overruns=%d max-late=%dus" % (reports, ticks, dropped, overruns, max_late))
+    print("late-us " + " ".join("<%d:%d" % (64 << i, count) for i, count in enumerate(late[:7]))
+          + " >=%d:%d" % (64 << 7, late[7]))
+    counted = sum(late)
+    if counted:
+        covered = 0
+        for bucket, count in enumerate(late):
+            covered += count
+            if covered * 100 >= counted * 99:
+                break
+        print("p99 " + ("below %dus" % (64 << bucket) if bucket < 7 else "at or above %dus" % (64 << 7)))
+    if args.max_late_us is not None and max_late > args.max_late_us:
+        print("a control tick woke %dus late, over the %dus limit" % (max_late, args.max_late_us),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+def cmd_samples(link, args):
+    if link.request(MSG_COMMAND, bytes([COMMANDS["samples-on"]])) != 0:
+        print("robot did not enable sample streaming", file=sys.stderr)
+        return 1
+    count = 0
+    with open(args.path, "w") as out:
+        out.write("time_us,ax,ay,az,speed_cms\n")
+        for kind, _, body in link.frames(args.seconds):
+            if kind == MSG_SAMPLE and len(body) == SAMPLE.size:
+                out.write("%d,%f,%f,%f,%f\n" % SAMPLE.unpack(body))
+                count += 1
+    link.request(MSG_COMMAND, bytes([COMMANDS["samples-off"]]))
+    print("%d samples (%.0f Hz)" % (count, count / args.seconds))
+    return 0
+
+
+def cmd_command(link, args):
+    status = link.request(MSG_COMMAND, bytes([COMMANDS[args.name]]))
+    print(ACK_NAMES.get(status, "no reply"))
+    return 0 if status == 0 else 1
+
+
+def cmd_profile(link, args):
+    """Dump the hot-path probes; the robot sends them as log lines before its ack."""
+    seq = link.send(MSG_COMMAND, bytes([COMMANDS["profile"]]))
+    for kind, _, body in link.frames(5.0):
+        if kind == MSG_LOG and body.startswith((b"prof ", b"hist ")):
+            print(body.decode(errors="replace"))
+        elif kind == MSG_ACK and body[0] == MSG_COMMAND and body[1] == seq:
+            if args.reset:
+                link.request(MSG_COMMAND, bytes([COMMANDS["profile-reset"]]))
+            return 0 if body[2] == 0 else 1
+    print("no reply", file=sys.stderr)
+    return 1
+
+
+def cmd_memory(link, args):
+    """Print heap low-water marks and per-task stack use."""
+    seq = link.send(MSG_COMMAND, bytes([COMMANDS["memory"]]))
+    for kind, _, body in link.frames(5.0):
+        if kind == MSG_LOG and body.startswith(b"mem "):
+            print(body.decode(errors="replace"))
+        elif kind == MSG_ACK and body[0] == MSG_COMMAND and body[1] == seq:
+            return 0 if body[2] == 0 else 1
+    print("no reply", file=sys.stderr)
+    return 1
+
+
+def cmd_storage_bench(link, args):
+    """Time checkpoints on each storage backend; takes a while on real flash."""
+    seq = link.send(MSG_COMMAND, bytes([COMMANDS["storage-bench"]]))
+    for kind, _, body in link.frames(60.0):
+        if kind == MSG_LOG and body.startswith(b"storage "):
+            print(body.decode(errors="replace"))
+        elif kind == MSG_ACK and body[0] == MSG_COMMAND and body[1] == seq:
+            return 0 if body[2] == 0 else 1
+    print("no reply", file=sys.stderr)
+    return 1
+
+
+def cmd_pull(link, args):
+    return pull_file(link, MSG_MODEL_REQUEST, b"", args.path, "robot has no model")
+
+
+def cmd_pull_transitions(link, args):
+    """Download the transition log, or with --previous the one it replaced."""
+    return pull_file(link, MSG_TRANSITIONS_REQUEST, bytes([1 if args.previous else 0]), args.path,
+                     "robot has no transition log")
+
+
+def pull_file(link, request, payload, path, missing):
+    link.send(request, payload)
+    data = bytearray()
+    for kind, _, body in link.frames(5.0):
+        if kind == MSG_MODEL_CHUNK:
+            offset = struct.unpack_from("<I", body)[0]
+            if offset != len(data):
+                print("lost a chunk at %d" % len(data), file=sys.stderr)
+                return 1
+            data += body[4:]
+        elif kind == MSG_MODEL_END:
+            with open(path, "wb") as handle:
+                handle.write(data)
+            print("Pulled %d bytes" % len(data))
+            return 0
+        elif kind == MSG_ACK and body[0] == request:
+            # After some chunks, the file changed under the pull
+            print("robot abandoned the pull at %d, try again" % len(data) if data else missing,
+                  file=sys.stderr)
+            return 1
+    print("timed out", file=sys.stderr)
+    return 1
+
+
+def cmd_push(link, args):
+    with open(args.path, "rb") as handle:
+        data = handle.read()
+    if link.request(MSG_MODEL_BEGIN, struct.pack("<I", len(data))) != 0:
+        print("robot refused the upload", file=sys.stderr)
+        return 1
+    for offset in range(0, len(data), MODEL_CHUNK_SIZE):
+        chunk = struct.pack("<I", offset) + data[offset:offset + MODEL_CHUNK_SIZE]
+        for _ in range(3):
+            status = link.request(MSG_MODEL_CHUNK, chunk)
+            if status is not None:
+                break
+        if status != 0:
+            print("chunk at %d rejected" % offset, file=sys.stderr)
+            return 1
+    status = link.request(MSG_MODEL_END, struct.pack("<I", len(data)), timeout=5.0)
+    print("Model installed" if status == 0 else "Model rejected")
+    return 0 if status == 0 else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=BAUD_RATE)
+    commands = parser.add_subparsers(dest="command", required=True)
+    commands.add_parser("monitor", help="print telemetry and log lines")
+    samples = commands.add_parser("samples", help="record high-rate IMU samples to CSV")
+    samples.add_argument("path")
+    samples.add_argument("--seconds", type=float, default=10.0)
+    command = commands.add_parser("command", help="send a training command")
+    command.add_argument("name", choices=sorted(COMMANDS))
+    profile = commands.add_parser("profile", help="dump hot-path latency histograms")
+    profile.add_argument("--reset", action="store_true", help="clear the histograms afterwards")
+    commands.add_parser("memory", help="print heap and task stack headroom")
+    jitter = commands.add_parser("jitter", help="sum up control tick lateness from the sched reports")
+    jitter.add_argument("--seconds", type=float, default=60.0)
+    jitter.add_argument("--max-late-us", type=int, help="exit with 1 if any tick woke later than this")
+    commands.add_parser("storage-bench", help="compare checkpoint cost across storage backends")
+    pull = commands.add_parser("pull", help="download the stored model")
+    pull.add_argument("path")
+    push = commands.add_parser("push", help="upload and install a model")
+    push.add_argument("path")
+    transitions = commands.add_parser("pull-transitions", help="download the logged training transitions")
+    transitions.add_argument("path")
+    transitions.add_argument("--previous", action="store_true", help="the log the current one replaced")
+    args = parser.parse_args()
+
+    link = Link(args.port, args.baud)
+    handlers = {"monitor": cmd_monitor, "samples": cmd_samples, "command": cmd_command,
+                "profile": cmd_profile, "memory": cmd_memory, "jitter": cmd_jitter,
+                "storage-bench": cmd_storage_bench, "pull": cmd_pull, "push": cmd_push,
+                "pull-transitions": cmd_pull_transitions}
+    try:
+        return handlers[args.command](link, args) or 0
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())